@@ -297,6 +297,13 @@ public:
   std::vector<const char *> &getFuncTableBucket(FunctionScopePtr func);
 
   std::set<std::string> m_variableTableFunctions;
+
+  /**
+   * Per file, how many types the emitter recorded as proven: "Inputs"
+   * the JIT won't guard, and "Returns" of functions whose return type
+   * it knows.  Filled in by the emitter under lock().
+   */
+  std::map<std::string, std::map<std::string, int> > m_inferredTypes;
   std::set<int> m_concatLengths;
   int m_arrayLitstrKeyMaxSize;
   int m_arrayIntegerKeyMaxSize;
@@ -1176,11 +1176,22 @@ void MetaInfoBuilder::setForUnit(UnitEmitter& target) const {
   free(meta);
 }
 
+int MetaInfoBuilder::count(Unit::MetaInfo::Kind kind) const {
+  int n = 0;
+  for (auto& entry : m_metaMap) {
+    for (auto& mi : entry.second) {
+      if (mi.m_kind == kind) ++n;
+    }
+  }
+  return n;
+}
+
 EmitterVisitor::EmittedClosures EmitterVisitor::s_emittedClosures;
 
 EmitterVisitor::EmitterVisitor(UnitEmitter& ue)
   : m_ue(ue), m_curFunc(ue.getMain()), m_evalStackIsUnknown(false),
-    m_actualStackHighWater(0), m_fdescHighWater(0) {
+    m_actualStackHighWater(0), m_fdescHighWater(0),
+    m_retType(KindOfUnknown), m_provenReturns(0) {
   m_prevOpcode = OpLowInvalid;
   m_evalStack.m_actualStackHighWaterPtr = &m_actualStackHighWater;
   m_evalStack.m_fdescHighWaterPtr = &m_fdescHighWater;
@@ -1820,6 +1831,14 @@ void EmitterVisitor::visit(FileScopePtr file) {
   emitPostponedCinits();
   Peephole peephole(m_ue, m_metaInfo);
   m_metaInfo.setForUnit(m_ue);
+
+  if (Option::WholeProgram) {
+    auto locked = ar->lock();
+    auto& counts = locked->m_inferredTypes[filename];
+    counts["Inputs"] =
+      m_metaInfo.count(Unit::MetaInfo::Kind::DataTypeInferred);
+    counts["Returns"] = m_provenReturns;
+  }
 }
 
 static StringData* getClassName(ExpressionPtr e) {
@@ -1846,6 +1865,24 @@ static StringData* getClassName(ExpressionPtr e) {
   return nullptr;
 }
 
+/*
+ * The type of the value a return statement returns, when it's a
+ * literal or static analysis proved it (by the same test visit() uses
+ * for DataTypeInferred); KindOfUnknown otherwise.
+ */
+static DataType getProvenDataType(ExpressionPtr expr) {
+  if (!expr) return KindOfNull;
+  DataType dt = KindOfUnknown;
+  Variant v;
+  if (expr->isScalar() && expr->getScalarValue(v)) {
+    dt = v.getType();
+  } else if (Option::WholeProgram &&
+             expr->maybeInited() && expr->isNonNull()) {
+    if (TypePtr act = expr->getActualType()) dt = act->getDataType();
+  }
+  return dt == KindOfStaticString ? KindOfString : dt;
+}
+
 static DataType getPredictedDataType(ExpressionPtr expr) {
   if (!expr->maybeInited()) {
     return KindOfUninit;
@@ -2265,6 +2302,8 @@ bool EmitterVisitor::visitImpl(ConstructPtr node) {
           m_metaInfo.add(m_ue.bcPos(), Unit::MetaInfo::Kind::NonRefCounted,
                          false, 0, v);
         }*/
+        joinReturnType(retV ? KindOfUnknown
+                            : getProvenDataType(r->getRetExp()));
         if (retV) {
           e.RetV();
         } else {
@@ -5885,12 +5924,26 @@ void EmitterVisitor::emitMethodPrologue(Emitter& e, MethodStatementPtr meth) {
   }
 }
 
+/*
+ * Fold the type of one more value the current function returns into
+ * m_retType.  KindOfInvalid means we haven't seen a return yet, and
+ * KindOfUnknown that they disagree (or one of them isn't known).
+ */
+void EmitterVisitor::joinReturnType(DataType dt) {
+  if (m_retType == KindOfInvalid) {
+    m_retType = dt;
+  } else if (m_retType != dt) {
+    m_retType = KindOfUnknown;
+  }
+}
+
 void EmitterVisitor::emitMethod(MethodStatementPtr meth) {
   Emitter e(meth, m_ue, *this);
   Label topOfBody(e);
   emitMethodPrologue(e, meth);
 
   // emit method body
+  m_retType = KindOfInvalid;
   visit(meth->getStmts());
   assert(m_evalStack.size() == 0);
 
@@ -5905,10 +5958,20 @@ void EmitterVisitor::emitMethod(MethodStatementPtr meth) {
       m_metaInfo.add(m_ue.bcPos(), Unit::MetaInfo::Kind::GuardedThis,
                      false, 0, 0);
     }
+    joinReturnType(KindOfNull);
     e.RetC();
     e.setTempLocation(LocationPtr());
   }
 
+  // If every return agrees, record the type in the repo so the JIT can
+  // skip the guard on the result of calls it knows the target of.  This
+  // is kept apart from the return type annotation, which isn't enforced.
+  if (Option::WholeProgram &&
+      m_retType != KindOfInvalid && m_retType != KindOfUnknown) {
+    m_curFunc->setProvenReturnType(m_retType);
+    ++m_provenReturns;
+  }
+
   FuncFinisher ff(this, e, m_curFunc);
 
   emitMethodDVInitializers(e, meth, topOfBody);
@@ -62,6 +62,7 @@ struct MetaInfoBuilder {
                         int      arg);
   void deleteInfo(Offset bcOffset);
   void setForUnit(UnitEmitter&) const;
+  int count(Unit::MetaInfo::Kind kind) const;
 
 private:
   typedef std::vector<Unit::MetaInfo> Vec;
@@ -553,6 +554,10 @@ private:
   std::map<StringData*, Label, string_data_lt> m_gotoLabels;
   std::vector<Label> m_yieldLabels;
   MetaInfoBuilder m_metaInfo;
+  // The type every RetC in the function being emitted returns, if
+  // they all agree; see joinReturnType.
+  DataType m_retType;
+  int m_provenReturns;
 public:
   bool checkIfStackEmpty(const char* forInstruction) const;
   void unexpectedStackSym(char sym, const char* where) const;
@@ -642,6 +647,7 @@ public:
                              bool builtin = false);
   void emitMethodPrologue(Emitter& e, MethodStatementPtr meth);
   void emitMethod(MethodStatementPtr meth);
+  void joinReturnType(DataType dt);
   std::pair<FuncEmitter*,bool> createFuncEmitterForGeneratorBody(
                  MethodStatementPtr meth,
                  FuncEmitter* fe,
@@ -359,6 +359,9 @@ void Package::saveStatsToFile(const char *filename, int totalSeconds) const {
     }
     ls.done();
 
+    ms.add("InferredTypes");
+    o << m_ar->m_inferredTypes;
+
     ms.done();
     f.close();
   }
@@ -491,6 +491,9 @@ public:
   static constexpr size_t offsetofKind() {
     return offsetof(ArrayData, m_kind);
   }
+  static constexpr size_t offsetofSize() {
+    return offsetof(ArrayData, m_size);
+  }
 
   static const char* kindToString(ArrayKind kind);
 
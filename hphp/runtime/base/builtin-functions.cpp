@@ -783,6 +783,15 @@ String f_serialize(CVarRef value) {
   return "";
 }
 
+String binary_serialize(CVarRef value) {
+  VariableSerializer vs(VariableSerializer::Type::BinarySerialize);
+  return vs.serialize(value, true);
+}
+
+bool is_binary_serialized(const char* str, int len) {
+  return str && len > 0 && str[0] == VariableSerializer::kBinaryMarker;
+}
+
 Variant unserialize_ex(const char* str, int len,
                        VariableUnserializer::Type type,
                        CArrRef class_whitelist /* = null_array */) {
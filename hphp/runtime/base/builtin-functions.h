@@ -304,6 +304,14 @@ inline Variant unserialize_from_string(const String& str,
   return unserialize_from_buffer(str.data(), str.size(), class_whitelist);
 }
 
+/**
+ * serialize() in VariableSerializer's binary format, and whether a buffer
+ * holds data in that format.  Read it back with unserialize_ex() and
+ * VariableUnserializer::Type::BinarySerialize.
+ */
+String binary_serialize(CVarRef value);
+bool is_binary_serialized(const char* str, int len);
+
 String resolve_include(const String& file, const char* currentDir,
                        bool (*tryFile)(const String& file, void* ctx),
                        void* ctx);
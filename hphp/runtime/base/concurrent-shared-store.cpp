@@ -15,11 +15,19 @@
 */
 
 #include "hphp/runtime/base/concurrent-shared-store.h"
+#include "hphp/runtime/base/shared-store-base.h"
 #include "hphp/runtime/base/variable-serializer.h"
 #include "hphp/runtime/ext/ext_apc.h"
+#include "hphp/util/async-func.h"
 #include "hphp/util/logger.h"
 #include "hphp/util/timer.h"
+#include "folly/Random.h"
+#include "folly/String.h"
+#include <algorithm>
 #include <mutex>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 using std::set;
 
@@ -119,19 +127,58 @@ std::string ConcurrentTableSharedStore::GetSkeleton(const String& key) {
   return ret;
 }
 
+ConcurrentTableSharedStore::ConcurrentTableSharedStore(int id,
+                                                       int shards /* = 1 */)
+  : m_id(id)
+  , m_lockingFlag(false)
+  , m_shardLimit(apcExtension::MemoryLimit > 0 ?
+                 std::max<int64_t>(apcExtension::MemoryLimit / shards, 1) :
+                 0) {
+  assert(shards >= 1);
+  bool useSketch = m_shardLimit &&
+    apcExtension::EvictionPolicy ==
+    apcExtension::EvictionPolicies::TinyLFU;
+  for (int i = 0; i < shards; i++) {
+    m_shards.push_back(
+      std::unique_ptr<Shard>(new Shard(shards > 1, useSketch)));
+  }
+  if (m_id == SHARED_STORE_APPLICATION_CACHE) {
+    SharedStoreStats::setShardCount(shards);
+  }
+}
+
+int ConcurrentTableSharedStore::size() const {
+  int total = 0;
+  for (auto& shard : m_shards) {
+    total += shard->vars.size();
+  }
+  return total;
+}
+
+int64_t ConcurrentTableSharedStore::memoryUsage() const {
+  int64_t total = 0;
+  for (auto& shard : m_shards) {
+    total += shard->bytes.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
 bool ConcurrentTableSharedStore::clear() {
   if (apcExtension::ConcurrentTableLockFree) {
     return false;
   }
-  WriteLock l(m_lock);
-  for (Map::iterator iter = m_vars.begin(); iter != m_vars.end();
-       ++iter) {
-    if (iter->second.inMem()) {
-      iter->second.var->decRef();
+  for (auto& shard : m_shards) {
+    WriteLock l(shard->lock);
+    for (Map::iterator iter = shard->vars.begin();
+         iter != shard->vars.end(); ++iter) {
+      if (iter->second.inMem()) {
+        iter->second.var->decRef();
+      }
+      free((void *)iter->first);
     }
-    free((void *)iter->first);
+    shard->vars.clear();
+    shard->bytes = 0;
   }
-  m_vars.clear();
   return true;
 }
 
@@ -154,10 +201,11 @@ bool ConcurrentTableSharedStore::erase(const String& key,
  */
 bool ConcurrentTableSharedStore::eraseImpl(const String& key, bool expired) {
   if (key.isNull()) return false;
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
+  Shard& shard = shardFor(key);
+  ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                    m_lockingFlag);
   Map::accessor acc;
-  if (m_vars.find(acc, tagStringData(key.get()))) {
+  if (shard.vars.find(acc, tagStringData(key.get()))) {
     if (expired && !acc->second.expired()) {
       return false;
     }
@@ -166,76 +214,297 @@ bool ConcurrentTableSharedStore::eraseImpl(const String& key, bool expired) {
       acc->second.var->decRef();
     } else {
       assert(acc->second.inFile());
-      assert(acc->second.expiry == 0);
+      assert(acc->second.expiry == 0 || acc->second.fromSnapshot);
     }
-    if (expired && acc->second.inFile()) {
+    if (expired && acc->second.keepFileCopy()) {
       // a primed key expired, do not erase the table entry
       acc->second.var = nullptr;
       acc->second.size = 0;
       acc->second.expiry = 0;
+      charge(shard, key.size(), &acc->second);
     } else {
-      eraseAcc(acc);
+      uncharge(shard, &acc->second);
+      eraseAcc(shard, acc);
     }
     return true;
   }
   return false;
 }
 
-// Should be called outside m_lock
-void ConcurrentTableSharedStore::purgeExpired() {
-  if (m_purgeCounter.fetch_add(1, std::memory_order_relaxed) %
+/*
+ * Erases key if it has expired, or handles the file storage flag key.
+ * Returns whether this counts towards PurgeRate.
+ */
+bool ConcurrentTableSharedStore::expireKey(const char* key) {
+  if (apcExtension::UseFileStorage &&
+      strcmp(key, apcExtension::FileStorageFlagKey.c_str()) == 0) {
+    s_apc_file_storage.adviseOut();
+    addToExpirationQueue(apcExtension::FileStorageFlagKey.c_str(),
+                         time(nullptr) +
+                         apcExtension::FileStorageAdviseOutPeriod);
+    return false;
+  }
+  eraseImpl(key, true);
+  return true;
+}
+
+// Should be called outside the shard lock
+void ConcurrentTableSharedStore::purgeExpired(int shardId) {
+  Shard& shard = *m_shards[shardId];
+  if (shard.purgeCounter.fetch_add(1, std::memory_order_relaxed) %
       apcExtension::PurgeFrequency != 0) {
     return;
   }
   time_t now = time(nullptr);
-  ExpirationPair tmp;
   struct timespec tsBegin, tsEnd;
   Timer::GetMonotonicTime(tsBegin);
   int i = 0;
-  while (apcExtension::PurgeRate < 0 || i < apcExtension::PurgeRate) {
-    if (!m_expQueue.try_pop(tmp)) {
-      break;
-    }
-    if (tmp.second > now) {
-      m_expQueue.push(tmp);
-      break;
-    }
-    if (apcExtension::UseFileStorage &&
-        strcmp(tmp.first, apcExtension::FileStorageFlagKey.c_str()) == 0) {
-      s_apc_file_storage.adviseOut();
-      addToExpirationQueue(apcExtension::FileStorageFlagKey.c_str(),
-                           time(nullptr) +
-                           apcExtension::FileStorageAdviseOutPeriod);
-      continue;
+  int64_t queueSize;
+  if (shard.expWheel) {
+    // someone else is already purging this shard
+    if (!shard.expWheel->tryLock()) return;
+    i = shard.expWheel->advance(now, apcExtension::PurgeRate,
+                                [&] (const char* key) {
+                                  return expireKey(key);
+                                });
+    shard.expWheel->unlock();
+    queueSize = shard.expWheel->size();
+  } else {
+    ExpirationPair tmp;
+    while (apcExtension::PurgeRate < 0 || i < apcExtension::PurgeRate) {
+      if (!shard.expQueue.try_pop(tmp)) {
+        break;
+      }
+      if (tmp.second > now) {
+        shard.expQueue.push(tmp);
+        break;
+      }
+      shard.expMap.erase(tmp.first);
+      if (expireKey(tmp.first)) ++i;
+      free((void *)tmp.first);
     }
-    m_expMap.erase(tmp.first);
-    eraseImpl(tmp.first, true);
-    free((void *)tmp.first);
-    ++i;
+    queueSize = shard.expQueue.size();
   }
   Timer::GetMonotonicTime(tsEnd);
   int64_t elapsed = gettime_diff_us(tsBegin, tsEnd);
   SharedStoreStats::addPurgingTime(elapsed);
+  if (m_id == SHARED_STORE_APPLICATION_CACHE) {
+    SharedStoreStats::onShardPurge(shardId, shard.vars.size(), queueSize, i,
+                                   elapsed);
+  }
   // Size could be inaccurate, but for stats reporting, it is good enough
-  SharedStoreStats::setExpireQueueSize(m_expQueue.size());
+  if (m_shards.size() == 1) {
+    SharedStoreStats::setExpireQueueSize(queueSize);
+  }
 }
 
 void ConcurrentTableSharedStore::addToExpirationQueue(const char* key,
                                                       int64_t etime) {
+  Shard& shard = shardFor(key);
+  if (shard.expWheel) {
+    shard.expWheel->add(key, etime);
+    return;
+  }
+
   ExpMap::accessor acc;
-  if (m_expMap.find(acc, key)) {
+  if (shard.expMap.find(acc, key)) {
     acc->second++;
     return;
   }
 
   const char *copy = strdup(key);
-  if (!m_expMap.insert(acc, copy)) {
+  if (!shard.expMap.insert(acc, copy)) {
     free((void *)copy);
     acc->second++;
     return;
   }
   ExpirationPair p(copy, etime);
-  m_expQueue.push(p);
+  shard.expQueue.push(p);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// memory limit
+
+static string std_apc_evicted = "apc.evicted";
+
+void ConcurrentTableSharedStore::charge(Shard& shard, size_t keyLen,
+                                        const StoreValue* sval) {
+  if (!m_shardLimit) return;
+  int32_t size = keyLen + 1 + sizeof(StoreValue);
+  if (sval->inMem()) {
+    size += sval->var->getSpaceUsage();
+  }
+  shard.bytes.fetch_add(size - sval->memSize, std::memory_order_relaxed);
+  sval->memSize = size;
+}
+
+void ConcurrentTableSharedStore::uncharge(Shard& shard,
+                                          const StoreValue* sval) {
+  if (!sval->memSize) return;
+  shard.bytes.fetch_sub(sval->memSize, std::memory_order_relaxed);
+  sval->memSize = 0;
+}
+
+void ConcurrentTableSharedStore::touch(Shard& shard, const char* key,
+                                       const StoreValue* sval) {
+  if (!m_shardLimit) return;
+  // racy, but a lost update only makes the entry look a second older
+  sval->atime = time(nullptr);
+  if (shard.sketch) {
+    charHashCompare hc;
+    shard.sketch->increment(hc.hash(key));
+  }
+}
+
+/*
+ * How many random entries are ranked to pick each victim, and how many
+ * victims are evicted per hold of the shard lock.
+ */
+static const int kEvictionSamples = 5;
+static const int kEvictionBatch = 32;
+// Bounds the walk sampleVictim() falls back to when sampling misses.
+static const size_t kEvictionScanLimit = 4096;
+
+/*
+ * Picks the lowest ranked of kEvictionSamples random in-memory entries:
+ * by last access time, or for TinyLFU by estimated frequency and then
+ * access time. Each sample descends to a random leaf of the map's bucket
+ * range, so a draw costs a few splits instead of a walk of the shard.
+ *
+ * If every draw hits an empty leaf or entries backed by file storage,
+ * which is likely when most of the shard was primed from a file, it walks
+ * up to kEvictionScanLimit entries from a random leaf instead. Returns
+ * nullptr only if that walk finds nothing evictable either.
+ *
+ * Must be called with the shard's write lock held.
+ */
+const char* ConcurrentTableSharedStore::sampleVictim(Shard& shard,
+                                                     std::minstd_rand& rng) {
+  charHashCompare hc;
+  const char* victim = nullptr;
+  uint64_t victimRank = 0;
+  int found = 0;
+
+  auto randomLeaf = [&] {
+    Map::range_type r = shard.vars.range(1);
+    while (r.is_divisible()) {
+      Map::range_type upper(r, tbb::split());
+      if (rng() & 1) r = upper;
+    }
+    return r;
+  };
+  // Ranks iter's entry against the best so far; false if it can't be
+  // evicted.
+  auto consider = [&] (Map::iterator iter) {
+    const StoreValue& sval = iter->second;
+    if (!sval.inMem()) return false;
+    if (!apcExtension::CompletionKeys.empty() &&
+        apcExtension::CompletionKeys.count(iter->first)) {
+      return false;
+    }
+    uint64_t rank = sval.atime;
+    if (shard.sketch) {
+      rank |= uint64_t(shard.sketch->estimate(hc.hash(iter->first))) << 32;
+    }
+    if (!victim || rank < victimRank) {
+      victim = iter->first;
+      victimRank = rank;
+    }
+    ++found;
+    return true;
+  };
+
+  for (int tries = 0;
+       found < kEvictionSamples && tries < 4 * kEvictionSamples; ++tries) {
+    Map::range_type r = randomLeaf();
+    for (Map::iterator iter = r.begin(); iter != r.end(); ++iter) {
+      if (consider(iter)) break;
+    }
+  }
+  if (victim) return victim;
+
+  size_t limit = std::min(kEvictionScanLimit, shard.vars.size());
+  Map::iterator iter = randomLeaf().begin();
+  for (size_t n = 0; n < limit && found < kEvictionSamples; ++n, ++iter) {
+    if (iter == shard.vars.end()) {
+      iter = shard.vars.begin();
+      if (iter == shard.vars.end()) break;
+    }
+    consider(iter);
+  }
+  return victim;
+}
+
+/*
+ * Approximates LRU (or TinyLFU) by sampling, as Redis does: evicts the
+ * lowest ranked of a few random entries and repeats until the shard is 10%
+ * under its share of the limit. Evicting down to a low watermark keeps
+ * this slow path rare, and the shard lock is dropped after every batch so
+ * writers never wait behind more than a handful of lookups.
+ *
+ * Entries backed by file storage only lose their in-memory copy, the same
+ * as when they expire. CompletionKeys are never evicted.
+ */
+void ConcurrentTableSharedStore::evict(int shardId) {
+  Shard& shard = *m_shards[shardId];
+  if (!m_shardLimit ||
+      shard.bytes.load(std::memory_order_relaxed) <= m_shardLimit) {
+    return;
+  }
+  // Readers don't take the shard lock in lock-free mode, so the map cannot
+  // be walked safely
+  if (apcExtension::ConcurrentTableLockFree) return;
+  // someone else is already evicting from this shard
+  if (shard.evicting.exchange(true, std::memory_order_acquire)) return;
+
+  struct timespec tsBegin, tsEnd;
+  Timer::GetMonotonicTime(tsBegin);
+  int64_t target = m_shardLimit - m_shardLimit / 10;
+  int64_t before = shard.bytes.load(std::memory_order_relaxed);
+  int count = 0;
+  std::minstd_rand rng(folly::randomNumberSeed());
+  bool exhausted = false;
+  while (!exhausted && shard.bytes.load(std::memory_order_relaxed) > target) {
+    WriteLock l(shard.lock);
+    for (int i = 0; i < kEvictionBatch; ++i) {
+      if (shard.bytes.load(std::memory_order_relaxed) <= target) break;
+      const char* key = sampleVictim(shard, rng);
+      if (!key) {
+        exhausted = true;
+        break;
+      }
+      Map::accessor acc;
+      if (!shard.vars.find(acc, key)) continue;
+      StoreValue* sval = &acc->second;
+      size_t keyLen = strlen(acc->first);
+      if (RuntimeOption::EnableAPCSizeStats) {
+        String skey(acc->first, keyLen, CopyString);
+        stats_on_delete(skey.get(), sval, false);
+      }
+      sval->var->decRef();
+      if (sval->keepFileCopy()) {
+        sval->var = nullptr;
+        sval->size = 0;
+        sval->expiry = 0;
+        charge(shard, keyLen, sval);
+      } else {
+        uncharge(shard, sval);
+        eraseAcc(shard, acc);
+      }
+      ++count;
+    }
+  }
+  int64_t remaining = shard.bytes.load(std::memory_order_relaxed);
+  shard.evicting.store(false, std::memory_order_release);
+
+  Timer::GetMonotonicTime(tsEnd);
+  if (m_id == SHARED_STORE_APPLICATION_CACHE) {
+    SharedStoreStats::onShardEvict(shardId, count, before - remaining,
+                                   gettime_diff_us(tsBegin, tsEnd));
+  }
+  if (RuntimeOption::EnableStats && RuntimeOption::EnableAPCStats) {
+    ServerStats::Log(std_apc_evicted, count);
+  }
 }
 
 bool ConcurrentTableSharedStore::handlePromoteObj(const String& key,
@@ -243,8 +512,9 @@ bool ConcurrentTableSharedStore::handlePromoteObj(const String& key,
                                                   CVarRef value) {
   SharedVariant *converted = svar->convertObj(value);
   if (converted) {
+    Shard& shard = shardFor(key);
     Map::accessor acc;
-    if (!m_vars.find(acc, tagStringData(key.get()))) {
+    if (!shard.vars.find(acc, tagStringData(key.get()))) {
       // There is a chance another thread deletes the key when this thread is
       // converting the object. In that case, we just bail
       converted->decRef();
@@ -260,6 +530,7 @@ bool ConcurrentTableSharedStore::handlePromoteObj(const String& key,
       stats_on_update(key.get(), sval, converted, ttl);
       sval->var = converted;
       sv->decRef();
+      charge(shard, key.size(), sval);
       return true;
     }
     converted->decRef();
@@ -277,13 +548,10 @@ SharedVariant* ConcurrentTableSharedStore::unserialize(const String& key,
                                                        const StoreValue* sval) {
   try {
     VariableUnserializer::Type sType =
-      apcExtension::EnableApcSerialize ?
-      VariableUnserializer::Type::APCSerialize :
-      VariableUnserializer::Type::Serialize;
+      apc_unserialize_type(sval->sAddr, sval->getSerializedSize());
 
     VariableUnserializer vu(sval->sAddr, sval->getSerializedSize(), sType);
-    Variant v;
-    v.unserialize(&vu);
+    Variant v = vu.unserialize();
     sval->var = SharedVariant::Create(v, sval->isSerializedObj());
     stats_on_add(key.get(), sval, 0, true, true); // delayed prime
     return sval->var;
@@ -297,13 +565,14 @@ SharedVariant* ConcurrentTableSharedStore::unserialize(const String& key,
 bool ConcurrentTableSharedStore::get(const String& key, Variant &value) {
   const StoreValue *sval;
   SharedVariant *svar = nullptr;
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
+  Shard& shard = shardFor(key);
+  ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                    m_lockingFlag);
   bool expired = false;
   bool promoteObj = false;
   {
     Map::const_accessor acc;
-    if (!m_vars.find(acc, tagStringData(key.get()))) {
+    if (!shard.vars.find(acc, tagStringData(key.get()))) {
       log_apc(std_apc_miss);
       return false;
     } else {
@@ -319,6 +588,7 @@ bool ConcurrentTableSharedStore::get(const String& key, Variant &value) {
           if (!sval->inMem()) {
             svar = unserialize(key, sval);
             if (!svar) return false;
+            charge(shard, key.size(), sval);
           } else {
             svar = sval->var;
           }
@@ -333,6 +603,7 @@ bool ConcurrentTableSharedStore::get(const String& key, Variant &value) {
         }
         value = svar->toLocal();
         stats_on_get(key.get(), svar);
+        touch(shard, tagStringData(key.get()), sval);
       }
     }
   }
@@ -366,18 +637,21 @@ int64_t ConcurrentTableSharedStore::inc(const String& key, int64_t step,
                                         bool &found) {
   found = false;
   int64_t ret = 0;
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
+  Shard& shard = shardFor(key);
+  ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                    m_lockingFlag);
   StoreValue *sval;
   {
     Map::accessor acc;
-    if (m_vars.find(acc, tagStringData(key.get()))) {
+    if (shard.vars.find(acc, tagStringData(key.get()))) {
       sval = &acc->second;
       if (!sval->expired()) {
         ret = get_int64_value(sval) + step;
         SharedVariant *svar = construct(Variant(ret));
         sval->var->decRef();
         sval->var = svar;
+        charge(shard, key.size(), sval);
+        touch(shard, tagStringData(key.get()), sval);
         found = true;
         log_apc(std_apc_hit);
       }
@@ -389,17 +663,20 @@ int64_t ConcurrentTableSharedStore::inc(const String& key, int64_t step,
 bool ConcurrentTableSharedStore::cas(const String& key, int64_t old,
                                      int64_t val) {
   bool success = false;
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
+  Shard& shard = shardFor(key);
+  ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                    m_lockingFlag);
   StoreValue *sval;
   {
     Map::accessor acc;
-    if (m_vars.find(acc, tagStringData(key.get()))) {
+    if (shard.vars.find(acc, tagStringData(key.get()))) {
       sval = &acc->second;
       if (!sval->expired() && get_int64_value(sval) == old) {
         SharedVariant *var = construct(Variant(val));
         sval->var->decRef();
         sval->var = var;
+        charge(shard, key.size(), sval);
+        touch(shard, tagStringData(key.get()), sval);
         success = true;
         log_apc(std_apc_cas);
       }
@@ -410,12 +687,13 @@ bool ConcurrentTableSharedStore::cas(const String& key, int64_t old,
 
 bool ConcurrentTableSharedStore::exists(const String& key) {
   const StoreValue *sval;
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
+  Shard& shard = shardFor(key);
+  ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                    m_lockingFlag);
   bool expired = false;
   {
     Map::const_accessor acc;
-    if (!m_vars.find(acc, tagStringData(key.get()))) {
+    if (!shard.vars.find(acc, tagStringData(key.get()))) {
       log_apc(std_apc_miss);
       return false;
     } else {
@@ -429,6 +707,7 @@ bool ConcurrentTableSharedStore::exists(const String& key) {
         if (sval->inMem()) {
           stats_on_get(key.get(), sval->var);
         }
+        touch(shard, tagStringData(key.get()), sval);
       }
     }
   }
@@ -455,53 +734,67 @@ bool ConcurrentTableSharedStore::store(const String& key, CVarRef value,
                                        bool overwrite /* = true */) {
   StoreValue *sval;
   SharedVariant* svar = construct(value);
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
-  const char *kcp = strdup(key.data());
+  int shardId = shardIndex(tagStringData(key.get()));
+  Shard& shard = *m_shards[shardId];
   bool present;
-  time_t expiry = 0;
-  bool overwritePrime = false;
   {
-    Map::accessor acc;
-    present = !m_vars.insert(acc, kcp);
-    sval = &acc->second;
-    bool update = false;
-    if (present) {
-      free((void *)kcp);
-      if (overwrite || sval->expired()) {
-        // if ApcTTLLimit is set, then only primed keys can have expiry == 0
-        overwritePrime = (sval->expiry == 0);
-        if (sval->inMem()) {
-          stats_on_update(key.get(), sval, svar,
-                          adjust_ttl(ttl, overwritePrime));
-          sval->var->decRef();
-          update = true;
+    ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                      m_lockingFlag);
+    const char *kcp = strdup(key.data());
+    time_t expiry = 0;
+    bool overwritePrime = false;
+    {
+      Map::accessor acc;
+      present = !shard.vars.insert(acc, kcp);
+      sval = &acc->second;
+      bool update = false;
+      if (present) {
+        free((void *)kcp);
+        if (overwrite || sval->expired()) {
+          // if ApcTTLLimit is set, then only primed keys can have expiry == 0
+          overwritePrime = (sval->expiry == 0);
+          if (sval->inMem()) {
+            stats_on_update(key.get(), sval, svar,
+                            adjust_ttl(ttl, overwritePrime));
+            sval->var->decRef();
+            update = true;
+          } else {
+            // mark the inFile copy invalid since we are updating the key
+            sval->sAddr = nullptr;
+            sval->sSize = 0;
+          }
+          if (sval->fromSnapshot) {
+            // unlike a primed value, the snapshot's is never restored
+            sval->sAddr = nullptr;
+            sval->sSize = 0;
+            sval->fromSnapshot = false;
+          }
         } else {
-          // mark the inFile copy invalid since we are updating the key
-          sval->sAddr = nullptr;
-          sval->sSize = 0;
+          svar->decRef();
+          return false;
         }
-      } else {
-        svar->decRef();
-        return false;
       }
+      int64_t adjustedTtl = adjust_ttl(ttl, overwritePrime);
+      if (check_noTTL(key.data(), key.size())) {
+        adjustedTtl = 0;
+      }
+      sval->set(svar, adjustedTtl);
+      expiry = sval->expiry;
+      if (!update) {
+        stats_on_add(key.get(), sval, adjustedTtl, false, false);
+      }
+      charge(shard, key.size(), sval);
+      touch(shard, tagStringData(key.get()), sval);
     }
-    int64_t adjustedTtl = adjust_ttl(ttl, overwritePrime);
-    if (check_noTTL(key.data(), key.size())) {
-      adjustedTtl = 0;
+    if (expiry) {
+      addToExpirationQueue(key.data(), expiry);
     }
-    sval->set(svar, adjustedTtl);
-    expiry = sval->expiry;
-    if (!update) {
-      stats_on_add(key.get(), sval, adjustedTtl, false, false);
+    if (apcExtension::ExpireOnSets) {
+      purgeExpired(shardId);
     }
   }
-  if (expiry) {
-    addToExpirationQueue(key.data(), expiry);
-  }
-  if (apcExtension::ExpireOnSets) {
-    purgeExpired();
-  }
+  // eviction takes the shard's write lock, so the read lock must be released
+  evict(shardId);
   if (present) {
     log_apc(std_apc_update);
   } else {
@@ -515,19 +808,23 @@ bool ConcurrentTableSharedStore::store(const String& key, CVarRef value,
 }
 
 void ConcurrentTableSharedStore::prime(const std::vector<KeyValuePair> &vars) {
-  ConditionalReadLock l(m_lock, !apcExtension::ConcurrentTableLockFree ||
-                                m_lockingFlag);
   // we are priming, so we are not checking existence or expiration
   for (unsigned int i = 0; i < vars.size(); i++) {
     const KeyValuePair &item = vars[i];
+    Shard& shard = shardFor(item.key);
+    ConditionalReadLock l(shard.lock,
+                          !apcExtension::ConcurrentTableLockFree ||
+                          m_lockingFlag);
     Map::accessor acc;
     const char *copy = strdup(item.key);
-    m_vars.insert(acc, copy);
+    shard.vars.insert(acc, copy);
     if (item.inMem()) {
       acc->second.set(item.value, 0);
+      charge(shard, item.len, &acc->second);
     } else {
       acc->second.sAddr = item.sAddr;
       acc->second.sSize = item.sSize;
+      charge(shard, item.len, &acc->second);
       continue;
     }
     if (RuntimeOption::APCSizeCountPrime) {
@@ -598,10 +895,386 @@ void ConcurrentTableSharedStore::primeDone() {
        iter != apcExtension::CompletionKeys.end(); ++iter) {
     Map::accessor acc;
     const char *copy = strdup(iter->c_str());
-    if (m_vars.insert(acc, copy)) {
+    Shard& shard = shardFor(copy);
+    if (shard.vars.insert(acc, copy)) {
       acc->second.set(this->construct(1), 0);
+      charge(shard, iter->size(), &acc->second);
+    }
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshots
+
+namespace {
+
+const char kSnapshotMagic[8] = { 'H', 'H', 'A', 'P', 'C', 'S', 'N', 'P' };
+const uint32_t kSnapshotVersion = 2;
+
+/*
+ * A snapshot file is a SnapshotHeader, the entries, and then an index
+ * of `count' uint64_t entry offsets.  Everything is 8-byte aligned.
+ */
+struct SnapshotHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t apcSerialize;  // apcExtension::EnableApcSerialize when written
+  uint32_t flatLayout;    // FlatArray::kLayoutVersion when written
+  uint32_t pad;
+  uint64_t count;
+  uint64_t indexOffset;
+};
+
+enum class SnapshotKind : uint8_t {
+  Serialized,
+  SerializedObj,  // like a negative StoreValue::sSize
+  Flat,
+};
+
+size_t snapshotAlign(size_t n) {
+  return (n + 7) & ~size_t(7);
+}
+
+struct SnapshotEntry {
+  uint32_t keyLen;
+  uint32_t valLen;
+  int64_t expiry;  // absolute; 0 means no TTL
+  SnapshotKind kind;
+  char pad[7];
+
+  // the key and a NUL follow, then the value at the next 8-byte boundary
+  const char* key() const {
+    return reinterpret_cast<const char*>(this + 1);
+  }
+  const char* value() const {
+    return key() + snapshotAlign(keyLen + 1);
+  }
+};
+
+struct SnapshotWriter {
+  explicit SnapshotWriter(FILE* f) : file(f), offset(0), ok(true) {}
+
+  void write(const void* data, size_t len) {
+    if (ok && fwrite(data, 1, len, file) != len) ok = false;
+    offset += len;
+  }
+  void align() {
+    static const char zeros[8] = {};
+    write(zeros, snapshotAlign(offset) - offset);
+  }
+
+  FILE* file;
+  uint64_t offset;
+  bool ok;
+};
+
+// One entry, referenced under the shard lock and written out after it
+// is released.
+struct SnapshotItem {
+  std::string key;
+  int64_t expiry;
+  SharedVariant* var;   // refcounted values, with a reference held
+  Variant scalar;       // other values in memory
+  const char* sAddr;    // values only in file storage (never freed)
+  int32_t sSize;
+};
+
+}
+
+bool ConcurrentTableSharedStore::saveSnapshot(const std::string& path,
+                                              int waitSeconds,
+                                              SnapshotInfo& info) {
+  timespec tsBegin, tsEnd;
+  Timer::GetMonotonicTime(tsBegin);
+
+  std::string tmpPath = path + ".tmp";
+  FILE* f = fopen(tmpPath.c_str(), "w");
+  if (!f) {
+    Logger::Error("Unable to open APC snapshot %s: %s", tmpPath.c_str(),
+                  folly::errnoStr(errno).c_str());
+    return false;
+  }
+  SnapshotWriter w(f);
+  SnapshotHeader header;
+  memset(&header, 0, sizeof header);
+  w.write(&header, sizeof header); // rewritten at the end
+
+  // Same as dump(): lock-free operations don't take the shard locks, so
+  // make them start doing so and give in-flight ones time to finish.
+  if (apcExtension::ConcurrentTableLockFree) {
+    m_lockingFlag = true;
+    int begin = time(nullptr);
+    while (time(nullptr) - begin < waitSeconds) {
+      sleep(1);
     }
   }
+
+  std::vector<uint64_t> index;
+  std::vector<SnapshotItem> items;
+  for (auto& shard : m_shards) {
+    items.clear();
+    {
+      WriteLock l(shard->lock);
+      items.reserve(shard->vars.size());
+      for (Map::iterator iter = shard->vars.begin();
+           iter != shard->vars.end(); ++iter) {
+        const StoreValue* sval = &iter->second;
+        if (sval->expired()) continue;
+        items.emplace_back();
+        SnapshotItem& item = items.back();
+        item.key = iter->first;
+        item.expiry = sval->expiry;
+        item.var = nullptr;
+        item.sAddr = nullptr;
+        item.sSize = 0;
+        if (sval->inMem()) {
+          if (IS_REFCOUNTED_TYPE(sval->var->getType())) {
+            item.var = sval->var;
+            item.var->incRef();
+          } else {
+            item.scalar = sval->var->toLocal();
+          }
+        } else {
+          item.sAddr = sval->sAddr;
+          item.sSize = sval->sSize;
+        }
+      }
+    }
+
+    for (auto& item : items) {
+      SCOPE_EXIT { if (item.var) item.var->decRef(); };
+      SnapshotKind kind = SnapshotKind::Serialized;
+      String serialized;
+      const char* val;
+      size_t valLen;
+      try {
+        if (item.var && item.var->is(KindOfArray) &&
+            item.var->flatArray()) {
+          kind = SnapshotKind::Flat;
+          val = reinterpret_cast<const char*>(item.var->flatArray());
+          valLen = item.var->flatArray()->bytes();
+        } else if (item.sAddr) {
+          if (item.sSize < 0) kind = SnapshotKind::SerializedObj;
+          val = item.sAddr;
+          valLen = abs(item.sSize);
+        } else {
+          Variant v = item.var ? item.var->toLocal() : item.scalar;
+          if (v.isObject()) {
+            // stored the way constructPrime stores serialized objects,
+            // so loading doesn't need the class
+            kind = SnapshotKind::SerializedObj;
+            serialized = apc_serialize(Variant(apc_serialize(v)));
+          } else {
+            serialized = apc_serialize(v);
+          }
+          val = serialized.data();
+          valLen = serialized.size();
+        }
+      } catch (const Exception&) {
+        ++info.skipped;
+        continue;
+      }
+      if (valLen > std::numeric_limits<int32_t>::max()) {
+        ++info.skipped;
+        continue;
+      }
+
+      index.push_back(w.offset);
+      SnapshotEntry e;
+      memset(&e, 0, sizeof e);
+      e.keyLen = item.key.size();
+      e.valLen = valLen;
+      e.expiry = item.expiry;
+      e.kind = kind;
+      w.write(&e, sizeof e);
+      w.write(item.key.c_str(), item.key.size() + 1);
+      w.align();
+      w.write(val, valLen);
+      w.align();
+      ++info.entries;
+    }
+  }
+
+  if (apcExtension::ConcurrentTableLockFree) {
+    m_lockingFlag = false;
+  }
+
+  memcpy(header.magic, kSnapshotMagic, sizeof header.magic);
+  header.version = kSnapshotVersion;
+  header.apcSerialize = apcExtension::EnableApcSerialize;
+  header.flatLayout = FlatArray::kLayoutVersion;
+  header.count = index.size();
+  header.indexOffset = w.offset;
+  w.write(index.data(), index.size() * sizeof(uint64_t));
+  info.bytes = w.offset;
+  if (w.ok && fseek(f, 0, SEEK_SET) == 0) {
+    w.write(&header, sizeof header);
+  } else {
+    w.ok = false;
+  }
+  if (fclose(f) != 0) w.ok = false;
+  if (!w.ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    Logger::Error("Unable to write APC snapshot %s: %s", path.c_str(),
+                  folly::errnoStr(errno).c_str());
+    unlink(tmpPath.c_str());
+    return false;
+  }
+
+  Timer::GetMonotonicTime(tsEnd);
+  info.usec = gettime_diff_us(tsBegin, tsEnd);
+  return true;
+}
+
+struct ConcurrentTableSharedStore::SnapshotLoader {
+  void run() {
+    store->loadSnapshotEntries(base, size, index, begin, end, info);
+  }
+
+  ConcurrentTableSharedStore* store;
+  const char* base;
+  size_t size;
+  const uint64_t* index;
+  size_t begin;
+  size_t end;
+  SnapshotInfo info;
+};
+
+void ConcurrentTableSharedStore::loadSnapshotEntries(const char* base,
+                                                     size_t size,
+                                                     const uint64_t* index,
+                                                     size_t begin, size_t end,
+                                                     SnapshotInfo& info) {
+  time_t now = time(nullptr);
+  for (size_t i = begin; i < end; ++i) {
+    if (index[i] > size - sizeof(SnapshotEntry) || index[i] % 8) {
+      ++info.skipped;
+      continue;
+    }
+    auto e = reinterpret_cast<const SnapshotEntry*>(base + index[i]);
+    // Offsets rather than pointers, so a corrupt keyLen can't wrap.
+    uint64_t valOff = index[i] + sizeof(SnapshotEntry) +
+                      snapshotAlign(uint64_t(e->keyLen) + 1);
+    if (valOff > size || e->valLen > size - valOff || e->key()[e->keyLen] ||
+        e->valLen > uint32_t(std::numeric_limits<int32_t>::max()) ||
+        (e->expiry && e->expiry <= now)) {
+      ++info.skipped;
+      continue;
+    }
+
+    SharedVariant* var = nullptr;
+    if (e->kind == SnapshotKind::Flat) {
+      FlatArray* flat = FlatArray::FromBytes(e->value(), e->valLen);
+      if (!flat) {
+        ++info.skipped;
+        continue;
+      }
+      var = SharedVariant::CreateFlat(flat);
+    }
+
+    const char* key = e->key();
+    Shard& shard = shardFor(key);
+    ConditionalReadLock l(shard.lock, !apcExtension::ConcurrentTableLockFree ||
+                                      m_lockingFlag);
+    {
+      Map::accessor acc;
+      const char* copy = strdup(key);
+      if (!shard.vars.insert(acc, copy)) {
+        free((void*)copy);
+        if (var) var->decRef();
+        ++info.skipped;
+        continue;
+      }
+      StoreValue* sval = &acc->second;
+      if (var) {
+        sval->var = var;
+      } else {
+        sval->sAddr = const_cast<char*>(e->value());
+        sval->sSize = e->kind == SnapshotKind::SerializedObj ?
+          -int32_t(e->valLen) : int32_t(e->valLen);
+        sval->fromSnapshot = true;
+      }
+      sval->expiry = e->expiry;
+      charge(shard, e->keyLen, sval);
+    }
+    if (e->expiry) {
+      addToExpirationQueue(key, e->expiry);
+    }
+    ++info.entries;
+  }
+}
+
+bool ConcurrentTableSharedStore::loadSnapshot(const std::string& path,
+                                              int threads,
+                                              SnapshotInfo& info) {
+  timespec tsBegin, tsEnd;
+  Timer::GetMonotonicTime(tsBegin);
+
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Logger::Warning("Unable to open APC snapshot %s: %s", path.c_str(),
+                    folly::errnoStr(errno).c_str());
+    return false;
+  }
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(SnapshotHeader)) {
+    addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    Logger::Warning("Unable to map APC snapshot %s", path.c_str());
+    return false;
+  }
+
+  const char* base = static_cast<const char*>(addr);
+  size_t size = st.st_size;
+  auto header = reinterpret_cast<const SnapshotHeader*>(base);
+  if (memcmp(header->magic, kSnapshotMagic, sizeof header->magic) ||
+      header->version != kSnapshotVersion ||
+      header->apcSerialize != uint32_t(apcExtension::EnableApcSerialize) ||
+      header->flatLayout != FlatArray::kLayoutVersion ||
+      header->indexOffset % sizeof(uint64_t) ||
+      header->indexOffset > size ||
+      header->count > (size - header->indexOffset) / sizeof(uint64_t)) {
+    Logger::Warning("Ignoring APC snapshot %s: bad or incompatible header",
+                    path.c_str());
+    munmap(addr, size);
+    return false;
+  }
+  auto index = reinterpret_cast<const uint64_t*>(base + header->indexOffset);
+  size_t count = header->count;
+
+  // Don't bother with threads for small snapshots.
+  threads = std::max(1, std::min<int>(threads, count / 4096 + 1));
+  std::vector<std::unique_ptr<SnapshotLoader>> loaders;
+  std::vector<std::unique_ptr<AsyncFunc<SnapshotLoader>>> funcs;
+  for (int i = 0; i < threads; ++i) {
+    auto loader = new SnapshotLoader;
+    loader->store = this;
+    loader->base = base;
+    loader->size = size;
+    loader->index = index;
+    loader->begin = count * i / threads;
+    loader->end = count * (i + 1) / threads;
+    loaders.emplace_back(loader);
+    funcs.emplace_back(
+      new AsyncFunc<SnapshotLoader>(loader, &SnapshotLoader::run));
+  }
+  for (auto& f : funcs) f->start();
+  for (auto& f : funcs) f->waitForEnd();
+  for (auto& l : loaders) {
+    info.entries += l->info.entries;
+    info.skipped += l->info.skipped;
+  }
+  for (int i = 0; i < (int)m_shards.size(); ++i) {
+    evict(i);
+  }
+
+  if (!info.entries) munmap(addr, size);
+  info.bytes = size;
+  Timer::GetMonotonicTime(tsEnd);
+  info.usec = gettime_diff_us(tsBegin, tsEnd);
+  return true;
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -609,8 +1282,8 @@ void ConcurrentTableSharedStore::primeDone() {
 
 void ConcurrentTableSharedStore::dump(std::ostream & out, bool keyOnly,
                                       int waitSeconds) {
-  // Use write lock here to prevent concurrent ops running in parallel from
-  // invalidatint the iterator.
+  // Use write locks here to prevent concurrent ops running in parallel from
+  // invalidatint the iterators.
   // This functionality is for debugging and should not be called regularly
   if (apcExtension::ConcurrentTableLockFree) {
     m_lockingFlag = true;
@@ -620,35 +1293,38 @@ void ConcurrentTableSharedStore::dump(std::ostream & out, bool keyOnly,
       sleep(1);
     }
   }
-  WriteLock l(m_lock);
   Logger::Info("dumping apc");
-  out << "Total " << m_vars.size() << std::endl;
-  for (Map::iterator iter = m_vars.begin(); iter != m_vars.end(); ++iter) {
-    const char *key = iter->first;
-    out << key;
-    if (!keyOnly) {
-      out << " #### ";
-      const StoreValue *sval = &iter->second;
-      if (!sval->expired()) {
-        VariableSerializer vs(VariableSerializer::Type::Serialize);
-        Variant value;
-        if (sval->inMem()) {
-          value = sval->var->toLocal();
-        } else {
-          assert(sval->inFile());
-          // we need unserialize and serialize again because the format was
-          // APCSerialize
-          value = apc_unserialize(sval->sAddr, sval->getSerializedSize());
-        }
-        try {
-          String valS(vs.serialize(value, true));
-          out << valS->toCPPString();
-        } catch (const Exception &e) {
-          out << "Exception: " << e.what();
+  out << "Total " << size() << std::endl;
+  for (auto& shard : m_shards) {
+    WriteLock l(shard->lock);
+    for (Map::iterator iter = shard->vars.begin();
+         iter != shard->vars.end(); ++iter) {
+      const char *key = iter->first;
+      out << key;
+      if (!keyOnly) {
+        out << " #### ";
+        const StoreValue *sval = &iter->second;
+        if (!sval->expired()) {
+          VariableSerializer vs(VariableSerializer::Type::Serialize);
+          Variant value;
+          if (sval->inMem()) {
+            value = sval->var->toLocal();
+          } else {
+            assert(sval->inFile());
+            // we need unserialize and serialize again because the format
+            // was APCSerialize
+            value = apc_unserialize(sval->sAddr, sval->getSerializedSize());
+          }
+          try {
+            String valS(vs.serialize(value, true));
+            out << valS->toCPPString();
+          } catch (const Exception &e) {
+            out << "Exception: " << e.what();
+          }
         }
       }
+      out << std::endl;
     }
-    out << std::endl;
   }
   Logger::Info("dumping apc done");
   if (apcExtension::ConcurrentTableLockFree) {
@@ -20,6 +20,7 @@
 #define TBB_PREVIEW_CONCURRENT_PRIORITY_QUEUE 1
 
 #include "hphp/util/smalllocks.h"
+#include "hphp/util/hash.h"
 #include "hphp/runtime/base/complex-types.h"
 #include "hphp/runtime/base/shared-variant.h"
 #include "hphp/runtime/base/runtime-option.h"
@@ -29,16 +30,23 @@
 #include <tbb/concurrent_hash_map.h>
 #include <tbb/concurrent_priority_queue.h>
 #include "hphp/runtime/base/shared-store-stats.h"
+#include "hphp/runtime/base/expiration-wheel.h"
+#include "hphp/runtime/base/frequency-sketch.h"
+#include <memory>
+#include <random>
 
 namespace HPHP {
 
 //////////////////////////////////////////////////////////////////////
 
 struct StoreValue {
-  StoreValue() : var(nullptr), sAddr(nullptr), expiry(0), size(0), sSize(0) {}
+  StoreValue() : var(nullptr), sAddr(nullptr), expiry(0), size(0), sSize(0),
+                 memSize(0), atime(0), fromSnapshot(false) {}
   StoreValue(const StoreValue& v) : var(v.var), sAddr(v.sAddr),
                                     expiry(v.expiry), size(v.size),
-                                    sSize(v.sSize) {}
+                                    sSize(v.sSize), memSize(v.memSize),
+                                    atime(v.atime),
+                                    fromSnapshot(v.fromSnapshot) {}
   void set(SharedVariant *v, int64_t ttl);
   bool expired() const;
 
@@ -51,6 +59,12 @@ struct StoreValue {
   mutable int32_t size;
   int32_t sSize; // For file storage, negative means serailized object
   mutable SmallLock lock;
+  // Only maintained when apcExtension::MemoryLimit is set: the bytes this
+  // entry is charged against the limit, and when it was last accessed
+  mutable int32_t memSize;
+  mutable uint32_t atime;
+  // sAddr points into a loaded snapshot rather than at a primed value
+  bool fromSnapshot;
 
   bool inMem() const {
     return var != nullptr;
@@ -58,6 +72,11 @@ struct StoreValue {
   bool inFile() const {
     return sAddr != nullptr;
   }
+  // Whether expiring or evicting this entry should only drop the in-memory
+  // copy. A snapshot copy of an entry with a TTL would outlive the TTL.
+  bool keepFileCopy() const {
+    return inFile() && !(fromSnapshot && expiry);
+  }
 
   int32_t getSerializedSize() const {
     return abs(sSize);
@@ -83,17 +102,25 @@ struct ConcurrentTableSharedStore {
 
   static std::string GetSkeleton(const String& key);
 
-  explicit ConcurrentTableSharedStore(int id)
-    : m_id(id)
-    , m_lockingFlag(false)
-    , m_purgeCounter(0)
-  {}
+  /*
+   * With shards > 1 the table is split by key hash into independent
+   * shards, each with its own map, lock and an ExpirationWheel for TTLs.
+   * With a single shard it behaves as it always has, using a priority
+   * queue for expiration.
+   *
+   * With apcExtension::MemoryLimit set, each shard gets an equal share of
+   * the limit; a store that takes a shard over its share evicts sampled
+   * least recently (or, with the TinyLFU policy, least frequently) used
+   * entries of that shard until it is 10% under.
+   */
+  explicit ConcurrentTableSharedStore(int id, int shards = 1);
 
   ConcurrentTableSharedStore(const ConcurrentTableSharedStore&) = delete;
   ConcurrentTableSharedStore&
     operator=(const ConcurrentTableSharedStore&) = delete;
 
-  int size() const { return m_vars.size(); }
+  int size() const;
+  int64_t memoryUsage() const;
   bool get(const String& key, Variant &value);
   bool store(const String& key, CVarRef val, int64_t ttl,
                      bool overwrite = true);
@@ -108,6 +135,33 @@ struct ConcurrentTableSharedStore {
   bool constructPrime(CVarRef v, KeyValuePair& item);
   void primeDone();
 
+  /*
+   * Snapshots let a restarted server start with a warm cache.
+   *
+   * saveSnapshot writes every live entry (key, absolute expiry, value) to
+   * path.  Flat arrays are written as their FlatArray bytes; everything
+   * else in APC serialized form.  Shards are locked one at a time, only
+   * long enough to take references to their values.
+   *
+   * loadSnapshot maps the file and inserts its entries from `threads'
+   * threads.  Flat arrays are copied in right away; other values are
+   * left in the mapping and unserialized on first fetch, the same way
+   * file storage entries are, so the mapping is never released.  Keys
+   * that already exist (e.g. from the prime library) and entries that
+   * expired in the meantime are skipped.
+   */
+  struct SnapshotInfo {
+    SnapshotInfo() : entries(0), skipped(0), bytes(0), usec(0) {}
+    int64_t entries;  // written or loaded
+    int64_t skipped;  // couldn't be written, or expired/present on load
+    int64_t bytes;    // file size
+    int64_t usec;
+  };
+  bool saveSnapshot(const std::string& path, int waitSeconds,
+                    SnapshotInfo& info);
+  bool loadSnapshot(const std::string& path, int threads,
+                    SnapshotInfo& info);
+
   // debug support
   void dump(std::ostream & out, bool keyOnly, int waitSeconds);
 
@@ -161,40 +215,82 @@ private:
     }
   };
 
+  struct Shard {
+    Shard(bool useWheel, bool useSketch)
+      : purgeCounter(0), expWheel(useWheel ? new ExpirationWheel() : nullptr)
+      , bytes(0), evicting(false)
+      , sketch(useSketch ? new FrequencySketch() : nullptr)
+    {}
+
+    Map vars;
+    // Read lock is acquired whenever using concurrent ops
+    // Write lock is acquired for whole table operations
+    ReadWriteMutex lock;
+
+    tbb::concurrent_priority_queue<ExpirationPair,
+                                   ExpirationCompare> expQueue;
+    ExpMap expMap;
+    std::atomic<uint64_t> purgeCounter;
+    std::unique_ptr<ExpirationWheel> expWheel;
+
+    std::atomic<int64_t> bytes; // charged against m_shardLimit
+    std::atomic<bool> evicting;
+    std::unique_ptr<FrequencySketch> sketch; // TinyLFU eviction only
+  };
+
 private:
   SharedVariant* construct(CVarRef v) {
     return SharedVariant::Create(v, false);
   }
 
+  int shardIndex(const char* key) const {
+    if (m_shards.size() == 1) return 0;
+    charHashCompare hc;
+    return hash_int64(hc.hash(key)) % m_shards.size();
+  }
+  Shard& shardFor(const char* key) {
+    return *m_shards[shardIndex(key)];
+  }
+  Shard& shardFor(const String& key) {
+    return shardFor(tagStringData(key.get()));
+  }
+
   bool eraseImpl(const String& key, bool expired);
 
-  void eraseAcc(Map::accessor &acc) {
+  void eraseAcc(Shard& shard, Map::accessor &acc) {
     const char *pkey = acc->first;
-    m_vars.erase(acc);
+    shard.vars.erase(acc);
     free((void *)pkey);
   }
 
-  // Should be called outside m_lock
-  void purgeExpired();
+  // Should be called outside the shard lock
+  void purgeExpired(int shardId);
+  bool expireKey(const char* key);
+
+  // memory limit accounting; all of these are no-ops without a limit
+  void charge(Shard& shard, size_t keyLen, const StoreValue* sval);
+  void uncharge(Shard& shard, const StoreValue* sval);
+  void touch(Shard& shard, const char* key, const StoreValue* sval);
+  // Should be called outside the shard lock
+  void evict(int shardId);
+  const char* sampleVictim(Shard& shard, std::minstd_rand& rng);
 
   void addToExpirationQueue(const char* key, int64_t etime);
 
+  struct SnapshotLoader;
+  void loadSnapshotEntries(const char* base, size_t size,
+                           const uint64_t* index, size_t begin, size_t end,
+                           SnapshotInfo& info);
+
   bool handleUpdate(const String& key, SharedVariant* svar);
   bool handlePromoteObj(const String& key, SharedVariant* svar, CVarRef valye);
   SharedVariant* unserialize(const String& key, const StoreValue* sval);
 
 private:
   int m_id;
-  Map m_vars;
-  // Read lock is acquired whenever using concurrent ops
-  // Write lock is acquired for whole table operations
-  ReadWriteMutex m_lock;
+  std::vector<std::unique_ptr<Shard>> m_shards;
   bool m_lockingFlag; // flag to enable temporary locking
-
-  tbb::concurrent_priority_queue<ExpirationPair,
-                                 ExpirationCompare> m_expQueue;
-  ExpMap m_expMap;
-  std::atomic<uint64_t> m_purgeCounter;
+  int64_t m_shardLimit; // 0 means unbounded
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -0,0 +1,257 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_EXPIRATION_WHEEL_H_
+#define incl_HPHP_EXPIRATION_WHEEL_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <time.h>
+
+#include <tbb/concurrent_hash_map.h>
+
+#include "hphp/util/assertions.h"
+#include "hphp/util/hash.h"
+#include "hphp/util/util.h"
+
+namespace HPHP {
+
+//////////////////////////////////////////////////////////////////////
+
+/*
+ * Hierarchical timing wheel of (key, expiry) pairs with one second
+ * resolution, used by the sharded APC table for TTL expiration.
+ *
+ * add() may be called from any thread: it pushes onto the head of a slot's
+ * singly-linked list with a CAS. advance() pops whole slots with an exchange
+ * and must only run on one thread at a time; callers use tryLock()/unlock()
+ * around it.
+ *
+ * Each of the kLevels levels has kSlots slots; a slot at level n covers
+ * kSlots^n seconds, so four levels of 64 slots reach about 194 days. Longer
+ * TTLs are parked in the last level and re-filed when it cascades.
+ *
+ * A key has at most one node in the wheel, found through m_keys. Adding a
+ * key that is already scheduled only records the new expiry on its node; a
+ * node drained before its recorded expiry is filed again instead of
+ * expiring. A key re-stored with a shorter TTL therefore keeps its later
+ * slot and is purged late, as is an add() racing with advance() that lands
+ * in a slot which was just drained. Both only delay reclaiming memory, since
+ * readers always check the expiry themselves; the callback must likewise
+ * re-check the table entry's own expiry before erasing it.
+ */
+struct ExpirationWheel {
+  static const int kSlotBits = 6;
+  static const int kSlots = 1 << kSlotBits;
+  static const int kLevels = 4;
+
+  explicit ExpirationWheel(int64_t now = time(nullptr))
+    : m_current(now), m_size(0), m_busy(false) {
+    for (int l = 0; l < kLevels; l++) {
+      for (int s = 0; s < kSlots; s++) {
+        m_slots[l][s].store(nullptr, std::memory_order_relaxed);
+      }
+    }
+    m_overdue.store(nullptr, std::memory_order_relaxed);
+  }
+
+  ~ExpirationWheel() {
+    for (int l = 0; l < kLevels; l++) {
+      for (int s = 0; s < kSlots; s++) {
+        freeList(m_slots[l][s].load(std::memory_order_relaxed));
+      }
+    }
+    freeList(m_overdue.load(std::memory_order_relaxed));
+  }
+
+  ExpirationWheel(const ExpirationWheel&) = delete;
+  ExpirationWheel& operator=(const ExpirationWheel&) = delete;
+
+  void add(const char* key, int64_t expiry) {
+    KeyMap::accessor acc;
+    if (m_keys.find(acc, key)) {
+      acc->second->expiry.store(expiry, std::memory_order_relaxed);
+      return;
+    }
+    size_t len = strlen(key);
+    Node* n = (Node*)malloc(sizeof(Node) + len);
+    n->expiry.store(expiry, std::memory_order_relaxed);
+    memcpy(n->key, key, len + 1);
+    if (!m_keys.insert(acc, n->key)) {
+      // another thread scheduled it first
+      acc->second->expiry.store(expiry, std::memory_order_relaxed);
+      free(n);
+      return;
+    }
+    acc->second = n;
+    m_size.fetch_add(1, std::memory_order_relaxed);
+    push(n);
+  }
+
+  bool tryLock() {
+    return !m_busy.exchange(true, std::memory_order_acquire);
+  }
+  void unlock() {
+    m_busy.store(false, std::memory_order_release);
+  }
+
+  /*
+   * Moves the wheel forward to now, calling expire(key) for every entry
+   * whose expiry has passed. Stops early once expire() has returned true
+   * limit times (limit < 0 means no limit); whatever is left over is kept
+   * for the next call. Returns the number of true returns from expire().
+   *
+   * Must be called with the lock held.
+   */
+  template<class F>
+  int advance(int64_t now, int limit, F expire) {
+    int count = 0;
+    // entries that were already due when they were added, or left over
+    // from a previous call that hit the limit
+    Node* due = m_overdue.exchange(nullptr, std::memory_order_acquire);
+    if (!drain(due, now, limit, count, expire)) return count;
+
+    int64_t t = m_current.load(std::memory_order_relaxed);
+    while (t < now) {
+      ++t;
+      m_current.store(t, std::memory_order_release);
+      for (int l = 1; l < kLevels; l++) {
+        // cascade the next higher-level slot down whenever all lower
+        // levels wrap around; its entries now fit in lower levels
+        if ((t & ((int64_t(1) << (kSlotBits * l)) - 1)) != 0) break;
+        int idx = (t >> (kSlotBits * l)) & (kSlots - 1);
+        Node* n = m_slots[l][idx].exchange(nullptr, std::memory_order_acquire);
+        while (n) {
+          Node* next = n->next;
+          push(n);
+          n = next;
+        }
+      }
+      Node* n = m_slots[0][t & (kSlots - 1)].exchange(
+        nullptr, std::memory_order_acquire);
+      if (!drain(n, t, limit, count, expire)) return count;
+    }
+    // cascading may have found entries due exactly now
+    due = m_overdue.exchange(nullptr, std::memory_order_acquire);
+    drain(due, now, limit, count, expire);
+    return count;
+  }
+
+  int64_t size() const {
+    return m_size.load(std::memory_order_relaxed);
+  }
+
+private:
+  struct Node {
+    Node* next;
+    std::atomic<int64_t> expiry;
+    char key[1];
+  };
+
+  struct KeyHashCompare {
+    bool equal(const char* s1, const char* s2) const {
+      return strcmp(s1, s2) == 0;
+    }
+    size_t hash(const char* s) const {
+      return hash_string(s);
+    }
+  };
+  typedef tbb::concurrent_hash_map<const char*, Node*, KeyHashCompare>
+    KeyMap;
+
+  static void freeList(Node* n) {
+    while (n) {
+      Node* next = n->next;
+      free(n);
+      n = next;
+    }
+  }
+
+  std::atomic<Node*>& slotFor(Node* n) {
+    int64_t expiry = n->expiry.load(std::memory_order_relaxed);
+    int64_t current = m_current.load(std::memory_order_acquire);
+    int64_t delta = expiry - current;
+    if (delta <= 0) return m_overdue;
+    for (int l = 0; l < kLevels - 1; l++) {
+      if (delta < (int64_t(1) << (kSlotBits * (l + 1)))) {
+        return m_slots[l][(expiry >> (kSlotBits * l)) & (kSlots - 1)];
+      }
+    }
+    const int shift = kSlotBits * (kLevels - 1);
+    const int64_t span = int64_t(1) << (kSlotBits * kLevels);
+    if (delta >= span) {
+      // park it in the farthest slot; it gets re-filed when that cascades
+      expiry = current + span - (int64_t(1) << shift);
+    }
+    return m_slots[kLevels - 1][(expiry >> shift) & (kSlots - 1)];
+  }
+
+  void push(Node* n) {
+    std::atomic<Node*>& head = slotFor(n);
+    Node* old = head.load(std::memory_order_relaxed);
+    do {
+      n->next = old;
+    } while (!head.compare_exchange_weak(old, n, std::memory_order_release,
+                                         std::memory_order_relaxed));
+  }
+
+  template<class F>
+  bool drain(Node* n, int64_t now, int limit, int& count, F& expire) {
+    while (n) {
+      Node* next = n->next;
+      if ((limit >= 0 && count >= limit) || !unschedule(n, now)) {
+        // over the limit, or a parked, raced or re-added entry that isn't
+        // due yet
+        push(n);
+      } else {
+        if (expire((const char*)n->key)) ++count;
+        m_size.fetch_sub(1, std::memory_order_relaxed);
+        free(n);
+      }
+      n = next;
+    }
+    return limit < 0 || count < limit;
+  }
+
+  /*
+   * Removes n from m_keys if it is due by now. Holding the key's accessor
+   * keeps a concurrent add() from updating a node that is about to be
+   * freed; once the key is gone, add() schedules a fresh node.
+   */
+  bool unschedule(Node* n, int64_t now) {
+    KeyMap::accessor acc;
+    DEBUG_ONLY bool found = m_keys.find(acc, n->key);
+    assert(found && acc->second == n);
+    if (n->expiry.load(std::memory_order_relaxed) > now) return false;
+    m_keys.erase(acc);
+    return true;
+  }
+
+  KeyMap m_keys;
+  std::atomic<Node*> m_slots[kLevels][kSlots];
+  std::atomic<Node*> m_overdue;
+  std::atomic<int64_t> m_current;
+  std::atomic<int64_t> m_size;
+  std::atomic<bool> m_busy;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}
+
+#endif
@@ -0,0 +1,295 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/base/flat-array.h"
+#include "hphp/runtime/base/array-iterator.h"
+
+#include <vector>
+
+namespace HPHP {
+
+///////////////////////////////////////////////////////////////////////////////
+
+/*
+ * Builds a FlatArray tree into one growing buffer. Everything is
+ * addressed by offset while building because the buffer moves as it
+ * grows.
+ */
+// Deeper arrays aren't flattened, so FromBytes can check them recursively.
+const int kMaxDepth = 256;
+
+struct FlatArrayBuilder {
+  std::vector<char> buf;
+
+  size_t alloc(size_t bytes) {
+    size_t off = (buf.size() + 7) & ~size_t(7);
+    buf.resize(off + bytes);
+    return off;
+  }
+
+  template<class T> T* at(size_t off) {
+    return reinterpret_cast<T*>(&buf[off]);
+  }
+
+  size_t addString(const char* data, uint32_t len, strhash_t hash) {
+    size_t off = alloc(offsetof(FlatArray::Str, data) + len + 1);
+    auto s = at<FlatArray::Str>(off);
+    s->len = len;
+    s->hash = hash;
+    memcpy(s->data, data, len);
+    s->data[len] = 0;
+    return off;
+  }
+
+  size_t addString(const StringData* sd) {
+    return addString(sd->data(), sd->size(), sd->hash());
+  }
+
+  // Returns the offset of the new array, or -1 if arr can't be flattened.
+  ssize_t addArray(ArrayData* arr, int depth = 0) {
+    if (depth > kMaxDepth) return -1;
+    uint32_t num = arr->size();
+    bool packed = arr->isVectorData();
+    uint32_t hashSize =
+      packed ? 0 : num > 2 ? Util::roundUpToPowerOfTwo(num) : 2;
+    size_t base = alloc(sizeof(FlatArray) + hashSize * sizeof(int32_t) +
+                        num * sizeof(FlatArray::Elm));
+    {
+      auto fa = at<FlatArray>(base);
+      fa->m_size = num;
+      fa->m_hashSize = hashSize;
+      fa->m_pad = 0;
+      auto hash = const_cast<int32_t*>(fa->hash());
+      for (uint32_t i = 0; i < hashSize; i++) hash[i] = -1;
+    }
+    size_t elmsOff = base + sizeof(FlatArray) + hashSize * sizeof(int32_t);
+
+    uint32_t pos = 0;
+    for (ArrayIter it(arr); !it.end(); it.next(), pos++) {
+      FlatArray::Elm e;
+      memset(&e, 0, sizeof e);
+      e.next = -1;
+
+      Variant key = it.first();
+      strhash_t h;
+      if (key.isInteger()) {
+        e.key = key.toInt64();
+        h = e.key;
+      } else {
+        const StringData* sd = key.getStringData();
+        e.strKey = true;
+        e.key = addString(sd) - base;
+        h = sd->hash();
+      }
+
+      CVarRef val = it.secondRef();
+      switch (val.getType()) {
+      case KindOfUninit:
+      case KindOfNull:
+        e.val.m_type = KindOfNull;
+        break;
+      case KindOfBoolean:
+        e.val.m_type = KindOfBoolean;
+        e.val.m_data.num = val.toBoolean();
+        break;
+      case KindOfInt64:
+        e.val.m_type = KindOfInt64;
+        e.val.m_data.num = val.toInt64();
+        break;
+      case KindOfDouble:
+        e.val.m_type = KindOfDouble;
+        e.val.m_data.dbl = val.toDouble();
+        break;
+      case KindOfStaticString:
+      case KindOfString:
+        e.val.m_type = KindOfString;
+        e.val.m_data.num = addString(val.getStringData()) - base;
+        break;
+      case KindOfArray: {
+        ssize_t sub = addArray(val.getArrayData(), depth + 1);
+        if (sub < 0) return -1;
+        e.val.m_type = KindOfArray;
+        e.val.m_data.num = sub - base;
+        break;
+      }
+      default:
+        return -1;
+      }
+
+      auto fa = at<FlatArray>(base);
+      if (hashSize) {
+        auto& head = const_cast<int32_t*>(fa->hash())[h & (hashSize - 1)];
+        e.next = head;
+        head = pos;
+      }
+      memcpy(at<FlatArray::Elm>(elmsOff) + pos, &e, sizeof e);
+    }
+    assert(pos == num);
+
+    // m_bytes is 32 bits; anything bigger stays a regular SharedVariant
+    size_t bytes = buf.size() - base;
+    if (bytes > std::numeric_limits<uint32_t>::max()) return -1;
+    at<FlatArray>(base)->m_bytes = bytes;
+    return base;
+  }
+};
+
+FlatArray* FlatArray::Create(ArrayData* arr) {
+  FlatArrayBuilder b;
+  if (b.addArray(arr) != 0) return nullptr;
+  assert(b.at<FlatArray>(0)->m_bytes == b.buf.size());
+  auto ret = static_cast<FlatArray*>(malloc(b.buf.size()));
+  memcpy(ret, &b.buf[0], b.buf.size());
+  return ret;
+}
+
+FlatArray* FlatArray::FromBytes(const void* data, size_t len) {
+  if (len < sizeof(FlatArray) ||
+      static_cast<const FlatArray*>(data)->m_bytes != len) {
+    return nullptr;
+  }
+  // Check the copy, not the source: the source may be a file mapping
+  // that someone else can still write to.
+  auto ret = static_cast<FlatArray*>(malloc(len));
+  memcpy(ret, data, len);
+  if (ret->m_bytes != len || !ret->checkLayout(len, 0)) {
+    Destroy(ret);
+    return nullptr;
+  }
+  return ret;
+}
+
+/*
+ * This array has avail bytes to live in.  Check that its header, hash
+ * chains, keys and values only refer to bytes inside its own m_bytes,
+ * then do the same for each subarray.  Offsets must also have the
+ * 8-byte alignment the builder gives them.
+ */
+bool FlatArray::checkLayout(size_t avail, int depth) const {
+  if (depth > kMaxDepth || avail < sizeof(FlatArray) || m_bytes > avail ||
+      (m_hashSize & (m_hashSize - 1))) {
+    return false;
+  }
+  uint64_t elmsEnd = sizeof(FlatArray) + uint64_t(m_hashSize) * sizeof(int32_t)
+                     + uint64_t(m_size) * sizeof(Elm);
+  if (elmsEnd > m_bytes) return false;
+
+  auto validStr = [&] (int64_t off) {
+    if (off < int64_t(elmsEnd) || off % 8 ||
+        uint64_t(off) + offsetof(Str, data) >= m_bytes) {
+      return false;
+    }
+    auto str = strAt(off);
+    return uint64_t(off) + offsetof(Str, data) + str->len < m_bytes &&
+           str->data[str->len] == 0;
+  };
+
+  // Every element is on at most one hash chain, at most once, so
+  // lookups always terminate.
+  auto e = elms();
+  std::vector<bool> chained(m_size);
+  for (uint32_t h = 0; h < m_hashSize; h++) {
+    for (int32_t i = hash()[h]; i != -1; i = e[i].next) {
+      if (i < -1 || i >= int64_t(m_size) || chained[i]) return false;
+      chained[i] = true;
+    }
+  }
+
+  // Subarrays follow each other without overlapping, as the builder
+  // lays them out; that also keeps this check linear in the block size.
+  uint64_t nextArray = elmsEnd;
+  for (uint32_t i = 0; i < m_size; i++) {
+    if (e[i].next < -1 || e[i].next >= int64_t(m_size)) return false;
+    auto strKey = *reinterpret_cast<const uint8_t*>(&e[i].strKey);
+    if (strKey > 1 || (strKey && (isPacked() || !validStr(e[i].key)))) {
+      return false;
+    }
+    auto& val = e[i].val;
+    switch (val.m_type) {
+    case KindOfNull:
+    case KindOfBoolean:
+    case KindOfInt64:
+    case KindOfDouble:
+      break;
+    case KindOfString:
+      if (!validStr(val.m_data.num)) return false;
+      break;
+    case KindOfArray: {
+      int64_t off = val.m_data.num;
+      if (off < int64_t(nextArray) || off % 8 || uint64_t(off) >= m_bytes ||
+          !arrayAt(i)->checkLayout(m_bytes - off, depth + 1)) {
+        return false;
+      }
+      nextArray = off + arrayAt(i)->m_bytes;
+      break;
+    }
+    default:
+      return false;
+    }
+  }
+  return true;
+}
+
+ssize_t FlatArray::indexOf(int64_t key) const {
+  if (isPacked()) {
+    return key >= 0 && key < m_size ? key : -1;
+  }
+  auto e = elms();
+  for (int32_t i = hash()[key & (m_hashSize - 1)]; i != -1; i = e[i].next) {
+    if (!e[i].strKey && e[i].key == key) return i;
+  }
+  return -1;
+}
+
+ssize_t FlatArray::indexOf(const StringData* key) const {
+  if (isPacked()) return -1;
+  strhash_t h = key->hash();
+  uint32_t len = key->size();
+  auto e = elms();
+  for (int32_t i = hash()[h & (m_hashSize - 1)]; i != -1; i = e[i].next) {
+    if (!e[i].strKey) continue;
+    auto s = strAt(e[i].key);
+    if (s->hash == h && s->len == len && !memcmp(s->data, key->data(), len)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+StringData* FlatArray::stringAt(ssize_t pos) const {
+  auto tv = valAt(pos);
+  assert(tv->m_type == KindOfString);
+  auto s = strAt(tv->m_data.num);
+  return StringData::Make(s->data, s->len, CopyString);
+}
+
+const FlatArray* FlatArray::arrayAt(ssize_t pos) const {
+  auto tv = valAt(pos);
+  assert(tv->m_type == KindOfArray);
+  return reinterpret_cast<const FlatArray*>(
+    reinterpret_cast<const char*>(this) + tv->m_data.num);
+}
+
+Variant FlatArray::keyAt(ssize_t pos) const {
+  assert(pos >= 0 && pos < m_size);
+  if (isPacked()) return pos;
+  auto& e = elms()[pos];
+  if (!e.strKey) return e.key;
+  auto s = strAt(e.key);
+  return String(s->data, s->len, CopyString);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+}
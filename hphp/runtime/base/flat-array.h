@@ -0,0 +1,127 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_FLAT_ARRAY_H_
+#define incl_HPHP_FLAT_ARRAY_H_
+
+#include "hphp/runtime/base/types.h"
+#include "hphp/runtime/base/complex-types.h"
+#include "hphp/util/hash.h"
+
+namespace HPHP {
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * FlatArray is a read-only encoding of a whole array tree (null, bool,
+ * int, double and string values plus nested arrays) in one malloc'd
+ * block. Nothing inside the block is a pointer. Strings and nested
+ * arrays are found by their byte offset from the FlatArray that refers
+ * to them, so the block can be copied, written out, or mapped at any
+ * address.
+ *
+ * Each (sub)array is laid out as
+ *
+ *   FlatArray                  header
+ *   int32_t hash[m_hashSize]   hash chain heads; absent if packed
+ *   Elm elms[m_size]           in iteration order
+ *   ...                        key strings, value strings, subarrays
+ *
+ * Scalar values are stored as ordinary TypedValues, so SharedArray can
+ * hand out pointers to them directly. Strings and arrays are only
+ * materialized when they are read, which keeps a fetch followed by a
+ * few reads at O(elements read) regardless of the array size.
+ */
+struct FlatArray {
+  /*
+   * Returns nullptr if arr holds anything other than the types above.
+   */
+  static FlatArray* Create(ArrayData* arr);
+  static void Destroy(FlatArray* flat) { free(flat); }
+
+  /*
+   * Copy a FlatArray that was written out as bytes() bytes. Returns
+   * nullptr unless the block is exactly len bytes and every offset,
+   * hash chain and value type in it, at every level, stays inside it.
+   */
+  static FlatArray* FromBytes(const void* data, size_t len);
+
+  /*
+   * Bump this whenever the layout below changes.  Anything that writes
+   * FlatArrays out (APC snapshots) records it and refuses other values.
+   */
+  static const uint32_t kLayoutVersion = 1;
+
+  uint32_t size() const { return m_size; }
+  bool isPacked() const { return m_hashSize == 0; }
+  // bytes used by this array and everything under it
+  uint32_t bytes() const { return m_bytes; }
+
+  ssize_t indexOf(int64_t key) const;
+  ssize_t indexOf(const StringData* key) const;
+
+  /*
+   * The value at pos. For KindOfString and KindOfArray, m_data is an
+   * offset: use stringAt/arrayAt instead of looking at it.
+   */
+  const TypedValue* valAt(ssize_t pos) const {
+    assert(pos >= 0 && pos < m_size);
+    return &elms()[pos].val;
+  }
+  StringData* stringAt(ssize_t pos) const;
+  const FlatArray* arrayAt(ssize_t pos) const;
+  Variant keyAt(ssize_t pos) const;
+
+private:
+  friend struct FlatArrayBuilder;
+
+  struct Str {
+    uint32_t len;
+    strhash_t hash;
+    char data[1]; // len bytes, then a NUL
+  };
+
+  struct Elm {
+    TypedValue val;
+    int64_t key;        // int key, or offset of the Str for a string key
+    int32_t next;       // next elm in this hash chain, or -1
+    bool strKey;
+  };
+
+  FlatArray() = delete;
+
+  bool checkLayout(size_t avail, int depth) const;
+
+  const int32_t* hash() const {
+    return reinterpret_cast<const int32_t*>(this + 1);
+  }
+  const Elm* elms() const {
+    return reinterpret_cast<const Elm*>(hash() + m_hashSize);
+  }
+  const Str* strAt(int64_t off) const {
+    return reinterpret_cast<const Str*>(
+      reinterpret_cast<const char*>(this) + off);
+  }
+
+  uint32_t m_size;
+  uint32_t m_hashSize;  // power of 2, or 0 for packed arrays
+  uint32_t m_bytes;
+  uint32_t m_pad;
+};
+
+///////////////////////////////////////////////////////////////////////////////
+}
+
+#endif /* incl_HPHP_FLAT_ARRAY_H_ */
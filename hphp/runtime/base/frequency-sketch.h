@@ -0,0 +1,117 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_FREQUENCY_SKETCH_H_
+#define incl_HPHP_FREQUENCY_SKETCH_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "hphp/util/hash.h"
+
+namespace HPHP {
+
+//////////////////////////////////////////////////////////////////////
+
+/*
+ * Approximate access counts for a set of hashed keys, in the style of
+ * TinyLFU: a count-min sketch of kDepth rows of small saturating counters.
+ * Once the number of increments reaches ten times the width every counter
+ * is halved, so the estimate favors keys that are popular now over keys
+ * that were popular a long time ago.
+ *
+ * Increments use relaxed atomics and the reset is not synchronized with
+ * concurrent increments; the estimate is only ever used to rank eviction
+ * candidates, so losing the odd update is harmless.
+ */
+struct FrequencySketch {
+  static const int kDepth = 4;
+  static const uint8_t kMaxCount = 15;
+
+  // width is rounded up to a power of two
+  explicit FrequencySketch(uint32_t width = 4096)
+    : m_mask(roundUp(width) - 1)
+    , m_table(new std::atomic<uint8_t>[kDepth * (m_mask + 1)])
+    , m_additions(0)
+    , m_sampleSize(10 * (m_mask + 1)) {
+    for (uint32_t i = 0; i < kDepth * (m_mask + 1); i++) {
+      m_table[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  FrequencySketch(const FrequencySketch&) = delete;
+  FrequencySketch& operator=(const FrequencySketch&) = delete;
+
+  void increment(uint64_t hash) {
+    bool added = false;
+    for (int i = 0; i < kDepth; i++) {
+      std::atomic<uint8_t>& c = counter(i, hash);
+      uint8_t v = c.load(std::memory_order_relaxed);
+      if (v < kMaxCount) {
+        c.store(v + 1, std::memory_order_relaxed);
+        added = true;
+      }
+    }
+    if (added &&
+        m_additions.fetch_add(1, std::memory_order_relaxed) + 1 ==
+        m_sampleSize) {
+      reset();
+    }
+  }
+
+  uint8_t estimate(uint64_t hash) const {
+    uint8_t ret = kMaxCount;
+    for (int i = 0; i < kDepth; i++) {
+      uint8_t v = const_cast<FrequencySketch*>(this)->counter(i, hash)
+        .load(std::memory_order_relaxed);
+      if (v < ret) ret = v;
+    }
+    return ret;
+  }
+
+private:
+  static uint32_t roundUp(uint32_t n) {
+    uint32_t ret = 1;
+    while (ret < n) ret <<= 1;
+    return ret;
+  }
+
+  std::atomic<uint8_t>& counter(int row, uint64_t hash) {
+    // a different mix of the hash per row
+    uint64_t h = hash_int64(hash + row * 0x9e3779b97f4a7c15ULL);
+    return m_table[row * (m_mask + 1) + (h & m_mask)];
+  }
+
+  void reset() {
+    for (uint32_t i = 0; i < kDepth * (m_mask + 1); i++) {
+      uint8_t v = m_table[i].load(std::memory_order_relaxed);
+      m_table[i].store(v >> 1, std::memory_order_relaxed);
+    }
+    m_additions.store(m_sampleSize / 2, std::memory_order_relaxed);
+  }
+
+  const uint32_t m_mask;
+  std::unique_ptr<std::atomic<uint8_t>[]> m_table;
+  std::atomic<uint64_t> m_additions;
+  const uint64_t m_sampleSize;
+};
+
+//////////////////////////////////////////////////////////////////////
+
+}
+
+#endif
@@ -244,6 +244,47 @@ HphpArray* HphpArray::MakePacked(uint32_t size, const TypedValue* values) {
   return ad;
 }
 
+HphpArray* HphpArray::MakePackedCopy(uint32_t size, const Cell* values) {
+  assert(size > 0);
+
+  auto const cmret = computeCapAndMask(size);
+  auto const cap   = cmret.first;
+  auto const mask  = cmret.second;
+  auto const ad    = smartAllocFlat(cap, mask);
+
+  auto const shiftedSize = uint64_t{size} << 32;
+  ad->m_kindModeAndSize  = shiftedSize |
+                            static_cast<uint32_t>(AllocationMode::smart) << 8 |
+                            kPackedKind;
+  ad->m_posAndCount      = uint64_t{1} << 32;
+  ad->m_strongIterators  = nullptr;
+  ad->m_capAndUsed       = shiftedSize | cap;
+  ad->m_tableMask        = mask;
+
+  auto const data = reinterpret_cast<Elm*>(ad + 1);
+  ad->m_data = data;
+
+  for (uint32_t i = 0; i < size; i++) {
+    assert(values[i].m_type != KindOfRef);
+    cellDup(values[i], data[i].data);
+  }
+
+  assert(ad->m_kind == kPackedKind);
+  assert(ad->m_size == size);
+  assert(ad->m_count == 1);
+  assert(ad->m_used == size);
+  assert(ad->checkInvariants());
+  return ad;
+}
+
+void HphpArray::CopyPackedCells(const ArrayData* ad, Cell* out) {
+  auto const a = asPacked(ad);
+  auto const data = a->m_data;
+  for (uint32_t i = 0, limit = a->m_used; i < limit; ++i) {
+    cellDup(*tvToCell(&data[i].data), out[i]);
+  }
+}
+
 // for internal use by nonSmartCopy() and copyPacked()
 ALWAYS_INLINE
 HphpArray* HphpArray::CopyPacked(const HphpArray& other, AllocationMode mode) {
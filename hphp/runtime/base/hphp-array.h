@@ -92,6 +92,24 @@ public:
    */
   static HphpArray* MakePacked(uint32_t size, const TypedValue* values);
 
+  /*
+   * Allocate a packed HphpArray holding a copy of the `size' cells in
+   * `values', in order.  Used to turn a Vector into an array without
+   * appending element by element.
+   *
+   * The returned array is already incref'd.
+   *
+   * Pre: size > 0
+   */
+  static HphpArray* MakePackedCopy(uint32_t size, const Cell* values);
+
+  /*
+   * Copy the values of the packed array `ad' to `out', in order, unboxing
+   * any refs and incrementing refcounts.  `out' must have room for
+   * ad->size() cells.
+   */
+  static void CopyPackedCells(const ArrayData* ad, Cell* out);
+
   /*
    * Return a pointer to the singleton static empty array.  This is
    * used for initial empty arrays (COW will cause it to escalate to a
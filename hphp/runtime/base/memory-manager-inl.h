@@ -198,8 +198,12 @@ inline void MemoryManager::smartFreeSize(void* ptr, uint32_t bytes) {
 
   unsigned i = (bytes - 1) >> kLgSizeQuantum;
   assert(i < kNumSizes);
-  m_sizeUntrackedFree[i].push(debugPreFree(ptr, bytes, bytes));
-  m_stats.usage -= bytes;
+  auto const p = debugPreFree(ptr, bytes, bytes);
+  // See smartFree: arena blocks stay counted until the request ends.
+  if (LIKELY(!m_arena)) {
+    m_sizeUntrackedFree[i].push(p);
+    m_stats.usage -= bytes;
+  }
 
   FTRACE(1, "smartFreeSize: {} ({} bytes)\n", ptr, bytes);
 }
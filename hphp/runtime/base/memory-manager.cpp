@@ -167,6 +167,7 @@ void MemoryManager::OnThreadExit(MemoryManager* mm) {
 MemoryManager::MemoryManager()
     : m_front(nullptr)
     , m_limit(nullptr)
+    , m_arena(RuntimeOption::RequestArenaMaxBytes > 0)
     , m_sweeping(false) {
 #ifdef USE_JEMALLOC
   threadStats(m_allocated, m_deallocated, m_cactive, m_cactiveLimit);
@@ -178,6 +179,12 @@ MemoryManager::MemoryManager()
   m_strings.next = m_strings.prev = &m_strings;
 }
 
+MemoryManager::~MemoryManager() {
+  for (auto slab : m_spareSlabs) {
+    free(slab);
+  }
+}
+
 void MemoryManager::resetStats() {
   m_stats.usage = 0;
   m_stats.alloc = 0;
@@ -222,9 +229,15 @@ void MemoryManager::sweep() {
 void MemoryManager::resetAllocator() {
   StringData::sweepAll();
 
-  // free smart-malloc slabs
+  // free smart-malloc slabs, except for the ones the next request's
+  // arena will start out with
+  size_t const arenaSlabs = RuntimeOption::RequestArenaMaxBytes / SLAB_SIZE;
   for (auto slab : m_slabs) {
-    free(slab);
+    if (m_spareSlabs.size() < arenaSlabs) {
+      m_spareSlabs.push_back(slab);
+    } else {
+      free(slab);
+    }
   }
   m_slabs.clear();
 
@@ -239,6 +252,7 @@ void MemoryManager::resetAllocator() {
   for (auto& i : m_sizeUntrackedFree) i.head = nullptr;
   for (auto& i : m_sizeTrackedFree)   i.head = nullptr;
   m_front = m_limit = 0;
+  m_arena = RuntimeOption::RequestArenaMaxBytes > 0;
 }
 
 /*
@@ -319,8 +333,12 @@ inline void MemoryManager::smartFree(void* ptr) {
     auto const idx = (padbytes - 1) >> kLgSizeQuantum;
     assert(idx < kNumSizes && idx >= 0);
     FTRACE(1, "smartFree: {}\n", ptr);
-    m_sizeTrackedFree[idx].push(ptr);
-    m_stats.usage -= padbytes;
+    // In arena mode the block is never handed out again, so it stays
+    // counted against the request until the slabs are rewound.
+    if (LIKELY(!m_arena)) {
+      m_sizeTrackedFree[idx].push(ptr);
+      m_stats.usage -= padbytes;
+    }
     return;
   }
   smartFreeBig(n);
@@ -369,9 +387,22 @@ NEVER_INLINE char* MemoryManager::newSlab(size_t nbytes) {
   if (UNLIKELY(m_stats.usage > m_stats.maxBytes)) {
     refreshStatsHelper();
   }
-  char* slab = (char*) Util::safe_malloc(SLAB_SIZE);
+  if (m_arena && m_stats.alloc + SLAB_SIZE >
+                 RuntimeOption::RequestArenaMaxBytes) {
+    // This request is too big for the arena; start reusing freed
+    // blocks from here on.
+    FTRACE(1, "newSlab: leaving arena mode at {} bytes\n", m_stats.alloc);
+    m_arena = false;
+  }
+  char* slab;
+  if (!m_spareSlabs.empty()) {
+    slab = m_spareSlabs.back();
+    m_spareSlabs.pop_back();
+  } else {
+    slab = (char*) Util::safe_malloc(SLAB_SIZE);
+    JEMALLOC_STATS_ADJUST(&m_stats, SLAB_SIZE);
+  }
   assert(uintptr_t(slab) % 16 == 0);
-  JEMALLOC_STATS_ADJUST(&m_stats, SLAB_SIZE);
   m_stats.alloc += SLAB_SIZE;
   if (m_stats.alloc > m_stats.peakAlloc) {
     m_stats.peakAlloc = m_stats.alloc;
@@ -301,6 +301,7 @@ private:
 
 private:
   MemoryManager();
+  ~MemoryManager();
   MemoryManager(const MemoryManager&) = delete;
   MemoryManager& operator=(const MemoryManager&) = delete;
 
@@ -342,6 +343,19 @@ private:
   SweepNode m_strings; // in-place node is head of circular list
   MemoryUsageStats m_stats;
   std::vector<char*> m_slabs;
+  std::vector<char*> m_spareSlabs; // kept for the next request's arena
+
+  /*
+   * Arena mode (RuntimeOption::RequestArenaMaxBytes > 0).
+   *
+   * Each request starts out never reusing freed small blocks: they are
+   * dropped instead of being pushed on the free lists, so small
+   * allocations are just a pointer bump in the current slab.  Slabs up
+   * to the arena size are kept across requests, so resetAllocator()
+   * just rewinds them.  A request whose slabs outgrow the arena size
+   * leaves arena mode and uses the free lists as usual from then on.
+   */
+  bool m_arena;
 
 #ifdef USE_JEMALLOC
   uint64_t* m_allocated;
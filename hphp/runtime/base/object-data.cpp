@@ -585,7 +585,9 @@ void ObjectData::serializeImpl(VariableSerializer* serializer) const {
   Variant ret;
 
   if (LIKELY(serializer->getType() == VariableSerializer::Type::Serialize ||
-             serializer->getType() == VariableSerializer::Type::APCSerialize)) {
+             serializer->getType() == VariableSerializer::Type::APCSerialize ||
+             serializer->getType() ==
+               VariableSerializer::Type::BinarySerialize)) {
     if (instanceof(SystemLib::s_SerializableClass)) {
       assert(!isCollection());
       Variant ret =
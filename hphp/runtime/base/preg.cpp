@@ -25,7 +25,11 @@
 #include "hphp/runtime/base/array-iterator.h"
 #include "hphp/runtime/base/ini-setting.h"
 #include "hphp/runtime/base/thread-init-fini.h"
+#include "hphp/runtime/vm/treadmill.h"
+#include "hphp/util/timer.h"
 #include <tbb/concurrent_hash_map.h>
+#include <algorithm>
+#include <atomic>
 
 #define PREG_PATTERN_ORDER          1
 #define PREG_SET_ORDER              2
@@ -59,9 +63,13 @@ class pcre_cache_entry {
   pcre_cache_entry& operator=(const pcre_cache_entry&);
 
 public:
-  pcre_cache_entry() {}
+  pcre_cache_entry() : jitted(false) {}
   ~pcre_cache_entry() {
+#ifdef PCRE_STUDY_JIT_COMPILE
+    if (extra) pcre_free_study(extra);
+#else
     if (extra) free(extra); // we don't have pcre_free_study yet
+#endif
     pcre_free(re);
   }
 
@@ -69,6 +77,7 @@ public:
   pcre_extra *extra; // Holds results of studying
   int preg_options;
   int compile_options;
+  bool jitted;
 };
 
 struct ahm_string_data_same {
@@ -83,6 +92,175 @@ typedef std::pair<const StringData*, const pcre_cache_entry*> PCREEntry;
 
 static PCREStringMap* s_pcreCacheMap;
 
+/*
+ * Counters reported by the admin server's /pcre-cache-stats.
+ */
+static std::atomic<int64_t> s_pcreHits(0);
+static std::atomic<int64_t> s_pcreMisses(0);
+static std::atomic<int64_t> s_pcreCompiles(0);
+static std::atomic<int64_t> s_pcreCompileUs(0);
+static std::atomic<int64_t> s_pcreJitCompiles(0);
+static std::atomic<int64_t> s_pcreEvictions(0);
+static std::atomic<int64_t> s_pcreJitStackFallbacks(0);
+
+/*
+ * Bounded regex cache used when Eval.PCRECacheType is "lru".
+ *
+ * Patterns are split across shards by hash. Each shard approximates LRU with
+ * the CLOCK algorithm: lookups only set a reference bit under a read lock,
+ * and an insert into a full shard sweeps the clock hand, clearing reference
+ * bits until it finds an entry that hasn't been used since the last sweep.
+ *
+ * Keys are malloc'd copies of the pattern rather than static strings, and an
+ * evicted entry (key and compiled regex) is freed through the Treadmill,
+ * since requests still running may hold on to the pcre_cache_entry.
+ */
+class PCRECache {
+  struct Node {
+    Node(StringData* k, const pcre_cache_entry* e)
+      : key(k), entry(e), referenced(true), hits(0) {}
+
+    StringData* key;
+    const pcre_cache_entry* entry;
+    std::atomic<bool> referenced;
+    std::atomic<uint32_t> hits;
+  };
+
+  class FreeNodeTrigger : public Treadmill::WorkItem {
+    Node* m_node;
+  public:
+    explicit FreeNodeTrigger(Node* n) : m_node(n) {}
+    virtual void operator()() {
+      delete m_node->entry;
+      if (m_node->key) m_node->key->destruct();
+      delete m_node;
+    }
+  };
+
+  struct Shard {
+    Shard() : hand(0) {}
+
+    ReadWriteMutex lock;
+    hphp_hash_map<const StringData*, Node*,
+                  string_data_hash, string_data_same> map;
+    std::vector<Node*> clock;
+    size_t hand;
+  };
+
+  static const int kNumShards = 16;
+
+public:
+  explicit PCRECache(size_t capacity)
+    : m_shardCapacity(std::max<size_t>(capacity / kNumShards, 1)) {}
+
+  ~PCRECache() {
+    // only destroyed before any request runs (see pcre_reinit)
+    for (auto& shard : m_shards) {
+      for (auto n : shard.clock) {
+        delete n->entry;
+        n->key->destruct();
+        delete n;
+      }
+    }
+  }
+
+  /*
+   * Returns the cached entry, and sets jitCandidate when the entry has
+   * just become hot enough to be recompiled with PCRE JIT.
+   */
+  const pcre_cache_entry* find(const StringData* regex, bool& jitCandidate) {
+    Shard& shard = shardFor(regex);
+    ReadLock lock(shard.lock, false);
+    auto it = shard.map.find(regex);
+    if (it == shard.map.end()) return nullptr;
+    Node* n = it->second;
+    if (!n->referenced.load(std::memory_order_relaxed)) {
+      n->referenced.store(true, std::memory_order_relaxed);
+    }
+    jitCandidate = !n->entry->jitted &&
+      RuntimeOption::EvalPCREJitThreshold > 0 &&
+      n->hits.fetch_add(1, std::memory_order_relaxed) + 1 ==
+      RuntimeOption::EvalPCREJitThreshold;
+    return n->entry;
+  }
+
+  /*
+   * Inserts or replaces the entry for regex, taking ownership of ent.
+   * Returns the entry now in the cache, which is ent unless another thread
+   * raced us with a non-replacing insert.
+   */
+  const pcre_cache_entry* insert(const StringData* regex,
+                                 const pcre_cache_entry* ent,
+                                 bool replace) {
+    Shard& shard = shardFor(regex);
+    WriteLock lock(shard.lock, false);
+    auto it = shard.map.find(regex);
+    if (it != shard.map.end()) {
+      Node* n = it->second;
+      if (!replace) {
+        delete ent;
+        return n->entry;
+      }
+      Node* fresh = new Node(n->key, ent);
+      it->second = fresh;
+      std::replace(shard.clock.begin(), shard.clock.end(), n, fresh);
+      // the key moved to the fresh node; only retire the old entry
+      n->key = nullptr;
+      retire(n);
+      return ent;
+    }
+
+    Node* n = new Node(StringData::MakeMalloced(regex->data(),
+                                                regex->size()), ent);
+    if (shard.clock.size() < m_shardCapacity) {
+      shard.clock.push_back(n);
+    } else {
+      for (;;) {
+        Node*& victim = shard.clock[shard.hand];
+        shard.hand = (shard.hand + 1) % shard.clock.size();
+        if (victim->referenced.load(std::memory_order_relaxed)) {
+          victim->referenced.store(false, std::memory_order_relaxed);
+          continue;
+        }
+        shard.map.erase(victim->key);
+        retire(victim);
+        ++s_pcreEvictions;
+        victim = n;
+        break;
+      }
+    }
+    shard.map[n->key] = n;
+    return ent;
+  }
+
+  size_t size() {
+    size_t total = 0;
+    for (auto& shard : m_shards) {
+      ReadLock lock(shard.lock, false);
+      total += shard.map.size();
+    }
+    return total;
+  }
+
+private:
+  Shard& shardFor(const StringData* regex) {
+    return m_shards[regex->hash() & (kNumShards - 1)];
+  }
+
+  static void retire(Node* n) {
+    Treadmill::WorkItem::enqueue(new FreeNodeTrigger(n));
+  }
+
+  size_t m_shardCapacity;
+  Shard m_shards[kNumShards];
+};
+
+static PCRECache* s_pcreLRUCache;
+
+static bool pcre_use_lru_cache() {
+  return RuntimeOption::EvalPCRECacheType == "lru";
+}
+
 void pcre_init() {
   if (!s_pcreCacheMap) {
     PCREStringMap::Config config;
@@ -107,9 +285,20 @@ void pcre_reinit() {
     PCREStringMap::destroy(s_pcreCacheMap);
   }
   s_pcreCacheMap = newMap;
+
+  delete s_pcreLRUCache;
+  s_pcreLRUCache = nullptr;
+  if (pcre_use_lru_cache()) {
+    s_pcreLRUCache = new PCRECache(RuntimeOption::EvalPCRETableSize);
+  }
 }
 
-static const pcre_cache_entry* lookup_cached_pcre(const String& regex) {
+static const pcre_cache_entry* lookup_cached_pcre(const String& regex,
+                                                  bool& jitCandidate) {
+  jitCandidate = false;
+  if (s_pcreLRUCache) {
+    return s_pcreLRUCache->find(regex.get(), jitCandidate);
+  }
   assert(s_pcreCacheMap);
   PCREStringMap::iterator it;
   if ((it = s_pcreCacheMap->find(regex.get())) != s_pcreCacheMap->end()) {
@@ -119,7 +308,11 @@ static const pcre_cache_entry* lookup_cached_pcre(const String& regex) {
 }
 
 static const pcre_cache_entry*
-insert_cached_pcre(const String& regex, const pcre_cache_entry* ent) {
+insert_cached_pcre(const String& regex, const pcre_cache_entry* ent,
+                   bool replace = false) {
+  if (s_pcreLRUCache) {
+    return s_pcreLRUCache->insert(regex.get(), ent, replace);
+  }
   assert(s_pcreCacheMap);
   auto pair = s_pcreCacheMap->insert(
     PCREEntry(makeStaticString(regex.get()), ent));
@@ -146,6 +339,23 @@ static __thread pcre_extra t_extra_data;
 // The last pcre error code is available for the whole thread.
 static __thread int t_last_error_code;
 
+#ifdef PCRE_STUDY_JIT_COMPILE
+/*
+ * JIT-compiled patterns run on this thread's own stack instead of the 32KiB
+ * machine stack PCRE falls back to. It is allocated the first time the
+ * thread runs a jitted pattern and lives as long as the thread does.
+ */
+static __thread pcre_jit_stack* t_jit_stack;
+
+static pcre_jit_stack* pcre_thread_jit_stack(void* /*data*/) {
+  if (!t_jit_stack) {
+    int maxSize = RuntimeOption::EvalPCREJitStackSize;
+    t_jit_stack = pcre_jit_stack_alloc(std::min(32 * 1024, maxSize), maxSize);
+  }
+  return t_jit_stack;
+}
+#endif
+
 namespace {
 
 void preg_init_thread_locals() {
@@ -172,14 +382,8 @@ private:
 typedef FreeHelperImpl<true> SmartFreeHelper;
 }
 
-static const pcre_cache_entry*
-pcre_get_compiled_regex_cache(const String& regex) {
-  /* Try to lookup the cached regex entry, and if successful, just pass
-     back the compiled pattern, otherwise go on and compile it. */
-  if (const pcre_cache_entry* pce = lookup_cached_pcre(regex)) {
-    return pce;
-  }
-
+static pcre_cache_entry*
+pcre_compile_regex(const String& regex, bool jit) {
   /* Parse through the leading whitespace, and display a warning if we
      get to the end without encountering a delimiter. */
   const char *p = regex.data();
@@ -303,12 +507,23 @@ pcre_get_compiled_regex_cache(const String& regex) {
   /* If study option was specified, study the pattern and
      store the result in extra for passing to pcre_exec. */
   pcre_extra *extra = nullptr;
-  if (do_study) {
+#ifndef PCRE_STUDY_JIT_COMPILE
+  jit = false;
+#endif
+  if (do_study || jit) {
     int soptions = 0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+    if (jit) soptions |= PCRE_STUDY_JIT_COMPILE;
+#endif
     extra = pcre_study(re, soptions, &error);
     if (extra) {
       extra->flags |= PCRE_EXTRA_MATCH_LIMIT |
         PCRE_EXTRA_MATCH_LIMIT_RECURSION;
+#ifdef PCRE_STUDY_JIT_COMPILE
+      // The callback hands out a per-thread stack, so it is safe to install
+      // on an extra shared by every thread using the cache entry.
+      if (jit) pcre_assign_jit_stack(extra, pcre_thread_jit_stack, nullptr);
+#endif
     }
     if (error != nullptr) {
       try {
@@ -320,13 +535,50 @@ pcre_get_compiled_regex_cache(const String& regex) {
     }
   }
 
-  /* Store the compiled pattern and extra info in the cache. */
   pcre_cache_entry *new_entry = new pcre_cache_entry();
   new_entry->re = re;
   new_entry->extra = extra;
   new_entry->preg_options = poptions;
   new_entry->compile_options = coptions;
-  return insert_cached_pcre(regex, new_entry);
+  new_entry->jitted = jit;
+  return new_entry;
+}
+
+static pcre_cache_entry* pcre_timed_compile(const String& regex, bool jit) {
+  timespec begin, end;
+  Timer::GetMonotonicTime(begin);
+  pcre_cache_entry* pce = pcre_compile_regex(regex, jit);
+  Timer::GetMonotonicTime(end);
+  ++s_pcreCompiles;
+  if (jit) ++s_pcreJitCompiles;
+  s_pcreCompileUs += gettime_diff_us(begin, end);
+  return pce;
+}
+
+static const pcre_cache_entry*
+pcre_get_compiled_regex_cache(const String& regex) {
+  /* Try to lookup the cached regex entry, and if successful, just pass
+     back the compiled pattern, otherwise go on and compile it. */
+  bool jitCandidate;
+  if (const pcre_cache_entry* pce = lookup_cached_pcre(regex, jitCandidate)) {
+    ++s_pcreHits;
+    if (jitCandidate) {
+      // Exactly one thread sees the threshold crossing; it recompiles with
+      // the JIT and swaps the entry in. The old one goes to the treadmill.
+      if (pcre_cache_entry* hot = pcre_timed_compile(regex, true)) {
+        return insert_cached_pcre(regex, hot, true);
+      }
+    }
+    return pce;
+  }
+  ++s_pcreMisses;
+
+  /* Store the compiled pattern and extra info in the cache. */
+  pcre_cache_entry* pce =
+    pcre_timed_compile(regex, s_pcreLRUCache != nullptr &&
+                              RuntimeOption::EvalPCREJitThreshold == 1);
+  if (!pce) return nullptr;
+  return insert_cached_pcre(regex, pce);
 }
 
 static void set_extra_limits(pcre_extra*& extra) {
@@ -340,6 +592,29 @@ static void set_extra_limits(pcre_extra*& extra) {
   extra->match_limit_recursion = g_context->m_preg_recursion_limit;
 }
 
+/*
+ * pcre_exec(), except that a jitted pattern which runs out of JIT stack is
+ * retried with the interpreter, which is only bound by the backtrack and
+ * recursion limits.
+ */
+static int pcre_exec_safe(const pcre* re, const pcre_extra* extra,
+                          const char* subject, int length, int start_offset,
+                          int options, int* offsets, int size_offsets) {
+  int count = pcre_exec(re, extra, subject, length, start_offset, options,
+                        offsets, size_offsets);
+#ifdef PCRE_STUDY_JIT_COMPILE
+  if (count == PCRE_ERROR_JIT_STACKLIMIT && extra &&
+      (extra->flags & PCRE_EXTRA_EXECUTABLE_JIT)) {
+    ++s_pcreJitStackFallbacks;
+    pcre_extra interp = *extra;
+    interp.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+    count = pcre_exec(re, &interp, subject, length, start_offset, options,
+                      offsets, size_offsets);
+  }
+#endif
+  return count;
+}
+
 static int *create_offset_array(const pcre_cache_entry *pce,
                                 int &size_offsets) {
   pcre_extra *extra = pce->extra;
@@ -466,8 +741,8 @@ Variant preg_grep(const String& pattern, CArrRef input, int flags /* = 0 */) {
     String entry = iter.second().toString();
 
     /* Perform the match */
-    int count = pcre_exec(pce->re, extra, entry.data(), entry.size(),
-                          0, 0, offsets, size_offsets);
+    int count = pcre_exec_safe(pce->re, extra, entry.data(), entry.size(),
+                               0, 0, offsets, size_offsets);
 
     /* Check for too many substrings condition. */
     if (count == 0) {
@@ -610,8 +885,8 @@ static Variant preg_match_impl(const String& pattern, const String& subject,
   int i;
   do {
     /* Execute the regular expression. */
-    int count = pcre_exec(pce->re, extra, subject.data(), subject.size(),
-                          start_offset, g_notempty, offsets, size_offsets);
+    int count = pcre_exec_safe(pce->re, extra, subject.data(), subject.size(),
+                               start_offset, g_notempty, offsets, size_offsets);
 
     /* Check for too many substrings condition. */
     if (count == 0) {
@@ -894,8 +1169,9 @@ static String php_pcre_replace(const String& pattern, const String& subject,
     int g_notempty = 0; // If the match should not be empty
     while (1) {
       /* Execute the regular expression. */
-      int count = pcre_exec(pce->re, extra, subject.data(), subject.size(),
-                            start_offset, g_notempty, offsets, size_offsets);
+      int count = pcre_exec_safe(pce->re, extra, subject.data(),
+                                 subject.size(), start_offset, g_notempty,
+                                 offsets, size_offsets);
 
       /* Check for too many substrings condition. */
       if (count == 0) {
@@ -1208,9 +1484,9 @@ Variant preg_split(CVarRef pattern, CVarRef subject, int limit /* = -1 */,
   pcre *re_bump = nullptr; /* Regex instance for empty matches */
   pcre_extra *extra_bump = nullptr; /* Almost dummy */
   while ((limit == -1 || limit > 1)) {
-    int count = pcre_exec(pce->re, extra, ssubject.data(), ssubject.size(),
-                          start_offset, g_notempty | utf8_check,
-                          offsets, size_offsets);
+    int count = pcre_exec_safe(pce->re, extra, ssubject.data(), ssubject.size(),
+                               start_offset, g_notempty | utf8_check,
+                               offsets, size_offsets);
 
     /* Check for too many substrings condition. */
     if (count == 0) {
@@ -1281,9 +1557,9 @@ Variant preg_split(CVarRef pattern, CVarRef subject, int limit /* = -1 */,
               return false;
             }
           }
-          count = pcre_exec(re_bump, extra_bump, ssubject.data(),
-                            ssubject.size(), start_offset,
-                            0, offsets, size_offsets);
+          count = pcre_exec_safe(re_bump, extra_bump, ssubject.data(),
+                                 ssubject.size(), start_offset,
+                                 0, offsets, size_offsets);
           if (count < 1) {
             raise_warning("Unknown error");
             offsets[0] = start_offset;
@@ -1408,9 +1684,24 @@ int preg_last_error() {
 }
 
 size_t preg_pcre_cache_size() {
+  if (s_pcreLRUCache) return s_pcreLRUCache->size();
   return (size_t)s_pcreCacheMap->size();
 }
 
+void preg_pcre_cache_stats(std::ostream& out) {
+  out << "type: " << (s_pcreLRUCache ? "lru" : "static") << std::endl
+      << "size: " << preg_pcre_cache_size() << std::endl
+      << "capacity: " << RuntimeOption::EvalPCRETableSize << std::endl
+      << "hits: " << s_pcreHits.load() << std::endl
+      << "misses: " << s_pcreMisses.load() << std::endl
+      << "evictions: " << s_pcreEvictions.load() << std::endl
+      << "compiles: " << s_pcreCompiles.load() << std::endl
+      << "jit-compiles: " << s_pcreJitCompiles.load() << std::endl
+      << "jit-stack-fallbacks: " << s_pcreJitStackFallbacks.load()
+      << std::endl
+      << "compile-time-us: " << s_pcreCompileUs.load() << std::endl;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // regexec
 
@@ -20,6 +20,8 @@
 #include "hphp/runtime/base/types.h"
 #include "hphp/runtime/base/complex-types.h"
 
+#include <iosfwd>
+
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -56,6 +58,7 @@ Variant php_split(const String& spliton, const String& str, int count,
 int preg_last_error();
 
 size_t preg_pcre_cache_size();
+void preg_pcre_cache_stats(std::ostream& out);
 
 ///////////////////////////////////////////////////////////////////////////////
 }
@@ -69,6 +69,7 @@
 
 #include "hphp/runtime/vm/runtime.h"
 #include "hphp/runtime/vm/repo.h"
+#include "hphp/runtime/vm/flat-repo.h"
 #include "hphp/runtime/vm/jit/translator.h"
 #include "hphp/compiler/builtin_symbols.h"
 
@@ -114,6 +115,7 @@ struct ProgramOptions {
   int        xhprofFlags;
   string     show;
   string     parse;
+  string     convertRepo;
 
   Eval::DebuggerClientOptions debugger_options;
 };
@@ -927,6 +929,9 @@ static int execute_program_impl(int argc, char** argv) {
      "output specified file and do nothing else")
     ("parse", value<string>(&po.parse),
      "parse specified file and dump the AST")
+    ("convert-repo", value<string>(&po.convertRepo),
+     "write Repo.Central.Path out as a flat repo at the specified path"
+     " and do nothing else")
     ("temp-file",
      "file specified is temporary and removed after execution")
     ("count", value<int>(&po.count)->default_value(1),
@@ -1137,6 +1142,16 @@ static int execute_program_impl(int argc, char** argv) {
   // Initialize compiler state
   compile_file(0, 0, MD5(), 0);
 
+  if (!po.convertRepo.empty()) {
+    std::string error;
+    if (!FlatRepo::Convert(RuntimeOption::RepoCentralPath, po.convertRepo,
+                           error)) {
+      Logger::Error("Unable to convert repo: %s", error.c_str());
+      return 1;
+    }
+    return 0;
+  }
+
   if (!po.lint.empty()) {
     if (po.isTempFile) {
       tempFile = po.lint;
@@ -1410,6 +1425,7 @@ void hphp_process_init() {
   int64_t save = RuntimeOption::SerializationSizeLimit;
   RuntimeOption::SerializationSizeLimit = StringData::MaxSize;
   apc_load(apcExtension::LoadThread);
+  apc_load_snapshot(apcExtension::LoadThread);
   RuntimeOption::SerializationSizeLimit = save;
 
   Transl::TargetCache::requestExit();
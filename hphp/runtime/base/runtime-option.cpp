@@ -88,6 +88,7 @@ int64_t RuntimeOption::StringOffsetLimit = 10 * 1024 * 1024; // 10MB
 
 std::string RuntimeOption::AccessLogDefaultFormat;
 std::vector<AccessLogFileData> RuntimeOption::AccessLogs;
+int RuntimeOption::AccessLogQueueSize = 0;
 
 std::string RuntimeOption::AdminLogFormat;
 std::string RuntimeOption::AdminLogFile;
@@ -129,8 +130,10 @@ int RuntimeOption::PspTimeoutSeconds = 0;
 size_t RuntimeOption::ServerMemoryHeadRoom = 0;
 int64_t RuntimeOption::RequestMemoryMaxBytes =
   std::numeric_limits<int64_t>::max();
+int64_t RuntimeOption::RequestArenaMaxBytes = 0;
 int64_t RuntimeOption::ImageMemoryMaxBytes = 0;
 int RuntimeOption::ResponseQueueCount;
+int RuntimeOption::ServerEventLoopCount = 1;
 int RuntimeOption::ServerGracefulShutdownWait;
 bool RuntimeOption::ServerHarshShutdown = true;
 bool RuntimeOption::ServerEvilShutdown = true;
@@ -213,6 +216,7 @@ bool RuntimeOption::EnableStaticContentCache = true;
 bool RuntimeOption::EnableStaticContentFromDisk = true;
 bool RuntimeOption::EnableOnDemandUncompress = true;
 bool RuntimeOption::EnableStaticContentMMap = true;
+std::string RuntimeOption::StaticContentCacheFile;
 
 bool RuntimeOption::Utf8izeReplace = true;
 
@@ -414,6 +418,11 @@ size_t RuntimeOption::VMTranslGDataSize  = RuntimeOption::VMTranslASize >> 2;
 std::string RuntimeOption::RepoLocalMode;
 std::string RuntimeOption::RepoLocalPath;
 std::string RuntimeOption::RepoCentralPath;
+std::string RuntimeOption::RepoFlatPath;
+bool RuntimeOption::RepoPreload = false;
+int RuntimeOption::RepoPreloadThreads = 0;
+std::string RuntimeOption::RepoPreloadFileList;
+bool RuntimeOption::RepoPreloadMerge = true;
 std::string RuntimeOption::RepoEvalMode;
 std::string RuntimeOption::RepoJournal;
 bool RuntimeOption::RepoCommit = true;
@@ -622,6 +631,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
 
     AccessLogDefaultFormat = logger["AccessLogDefaultFormat"].
       getString("%h %l %u %t \"%r\" %>s %b");
+    AccessLogQueueSize = logger["AccessLogQueueSize"].getInt32(0);
     {
       Hdf access = logger["Access"];
       for (Hdf hdf = access.firstChild(); hdf.exists();
@@ -722,11 +732,14 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     ServerMemoryHeadRoom = server["MemoryHeadRoom"].getInt64(0);
     RequestMemoryMaxBytes = server["RequestMemoryMaxBytes"].
       getInt64(std::numeric_limits<int64_t>::max());
+    RequestArenaMaxBytes = server["RequestArenaMaxBytes"].getInt64(0);
     ResponseQueueCount = server["ResponseQueueCount"].getInt32(0);
     if (ResponseQueueCount <= 0) {
       ResponseQueueCount = ServerThreadCount / 10;
       if (ResponseQueueCount <= 0) ResponseQueueCount = 1;
     }
+    ServerEventLoopCount = server["EventLoopCount"].getInt32(1);
+    if (ServerEventLoopCount <= 0) ServerEventLoopCount = 1;
     ServerGracefulShutdownWait = server["GracefulShutdownWait"].getInt16(0);
     ServerHarshShutdown = server["HarshShutdown"].getBool(true);
     ServerEvilShutdown = server["EvilShutdown"].getBool(true);
@@ -804,6 +817,7 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
     if (EnableStaticContentMMap) {
       EnableOnDemandUncompress = true;
     }
+    StaticContentCacheFile = server["StaticContentCacheFile"].getString();
     Utf8izeReplace = server["Utf8izeReplace"].getBool(true);
 
     StartupDocument = server["StartupDocument"].getString();
@@ -1200,6 +1214,15 @@ void RuntimeOption::Load(Hdf &config, StringVec *overwrites /* = NULL */,
         // Repo.Central.Path.
         RepoCentralPath = repoCentral["Path"].getString();
       }
+      RepoFlatPath = repo["FlatPath"].getString();
+      {
+        Hdf repoPreload = repo["Preload"];
+        RepoPreload = repoPreload["Enable"].getBool(false);
+        RepoPreloadThreads =
+          repoPreload["Threads"].getInt32(Process::GetCPUCount());
+        RepoPreloadFileList = repoPreload["FileList"].getString();
+        RepoPreloadMerge = repoPreload["Merge"].getBool(true);
+      }
       {
         Hdf repoEval = repo["Eval"];
         // Repo.Eval.Mode.
@@ -83,6 +83,7 @@ public:
 
   static std::string AccessLogDefaultFormat;
   static std::vector<AccessLogFileData> AccessLogs;
+  static int AccessLogQueueSize;
 
   static std::string AdminLogFormat;
   static std::string AdminLogFile;
@@ -120,8 +121,10 @@ public:
   static int PspTimeoutSeconds;
   static size_t ServerMemoryHeadRoom;
   static int64_t RequestMemoryMaxBytes;
+  static int64_t RequestArenaMaxBytes;
   static int64_t ImageMemoryMaxBytes;
   static int ResponseQueueCount;
+  static int ServerEventLoopCount;
   static int ServerGracefulShutdownWait;
   static int ServerDanglingWait;
   static bool ServerHarshShutdown;
@@ -205,6 +208,7 @@ public:
   static bool EnableStaticContentFromDisk;
   static bool EnableOnDemandUncompress;
   static bool EnableStaticContentMMap;
+  static std::string StaticContentCacheFile;
 
   static bool Utf8izeReplace;
 
@@ -377,6 +381,7 @@ public:
   F(bool, JitTrampolines,              true)                            \
   F(string, JitProfilePath,            string(""))                      \
   F(bool, JitTypePrediction,           true)                            \
+  F(bool, JitInferredReturnTypes,      true)                            \
   F(int32_t, JitStressTypePredPercent, 0)                               \
   F(uint32_t, JitWarmupRequests,       kDefaultWarmupRequests)          \
   F(bool, JitProfileRecord,            false)                           \
@@ -388,6 +393,19 @@ public:
   F(bool, JitDisabledByHphpd,          false)                           \
   F(bool, ThreadingJit,                false)                           \
   F(bool, JitTransCounters,            false)                           \
+  /* reuse the code of dead translations after a treadmill round */     \
+  F(bool, JitReclaimTC,                false)                           \
+  /* every N requests, retranslate the hottest code into ahot; needs */ \
+  /* JitTransCounters and a translation DB (DumpTC); 0 = off */         \
+  F(uint32_t, JitRelayoutInterval,     0)                               \
+  F(uint32_t, JitRelayoutMaxTrans,     64)                              \
+  /* relayout stops once this many SrcKeys have been moved into ahot */ \
+  F(uint32_t, JitRelayoutMaxSrcKeys,   4096)                            \
+  /* receiver classes checked inline at each object method call site */ \
+  /* before the slow path; 1 = the old monomorphic method cache */      \
+  F(uint32_t, JitPICSize,              4)                               \
+  /* count hits and misses per call site, for /vm-pic-stats */          \
+  F(bool, JitPICStats,                 false)                           \
   F(bool, HHIRGenericDtorHelper,       true)                            \
   F(bool, HHIRCse,                     true)                            \
   F(bool, HHIRSimplification,          true)                            \
@@ -409,6 +427,8 @@ public:
   F(bool, HHIRDirectExit,              true)                            \
   F(bool, HHIRDeadCodeElim,            true)                            \
   F(bool, HHIRPredictionOpts,          true)                            \
+  F(bool, HHIRScalarReplacement,       true)                            \
+  F(bool, HHIRIntrinsics,              true)                            \
   F(bool, HHIRStressCodegenBlocks,     false)                           \
   /* Region compiler flags */                                           \
   F(string,   JitRegionSelector,       regionSelectorDefault())         \
@@ -416,6 +436,13 @@ public:
   F(uint64_t, JitPGOThreshold,         kDefaultJitPGOThreshold)         \
   F(bool,     JitPGOHotOnly,           ServerExecutionMode())           \
   F(bool,     JitPGOUsePostConditions, true)                            \
+  /* back-edges of hot traces that loop to their own entry jump */      \
+  /* past its guards when the types there already satisfy them */       \
+  F(bool,     JitPGOLoops,             true)                            \
+  /* regions saved by /vm-dump-jit-profile, loaded at startup if set */ \
+  F(string,   JitPGOProfileFile,       string(""))                      \
+  /* >0: run JitPGO optimizing retranslations on background threads */  \
+  F(uint32_t, JitWorkerThreads,        0)                               \
   F(bool, HHIRRelaxGuards,             hhirRelaxGuardsDefault())        \
   F(bool, HHBCRelaxGuards,             hhbcRelaxGuardsDefault())        \
   /* DumpBytecode =1 dumps user php, =2 dumps systemlib & user php */   \
@@ -433,6 +460,12 @@ public:
   F(uint32_t, InitialNamedEntityTableSize,  30000)                      \
   F(uint32_t, InitialStaticStringTableSize, 100000)                     \
   F(uint32_t, PCRETableSize, kPCREInitialTableSize)                     \
+  /* "static" never evicts, "lru" evicts past PCRETableSize entries */ \
+  F(string, PCRECacheType,             string("static"))                \
+  /* lru only: recompile with PCRE JIT after this many hits, 0 = off */ \
+  F(uint32_t, PCREJitThreshold,        0)                               \
+  /* per-thread JIT stack limit, past which matches rerun uncompiled */ \
+  F(uint32_t, PCREJitStackSize,        1 << 20)                         \
   F(bool, EnableNuma, ServerExecutionMode())                            \
   F(bool, EnableNumaLocal, ServerExecutionMode())                       \
   /* */                                                                 \
@@ -457,6 +490,11 @@ public:
   static std::string RepoLocalMode;
   static std::string RepoLocalPath;
   static std::string RepoCentralPath;
+  static std::string RepoFlatPath;
+  static bool RepoPreload;
+  static int RepoPreloadThreads;
+  static std::string RepoPreloadFileList;
+  static bool RepoPreloadMerge;
   static std::string RepoEvalMode;
   static std::string RepoJournal;
   static bool RepoCommit;
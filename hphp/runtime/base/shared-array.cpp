@@ -25,21 +25,41 @@ namespace HPHP {
 
 //////////////////////////////////////////////////////////////////////
 
+inline TypedValue* SharedArray::cacheSlot(ssize_t pos) const {
+  assert(unsigned(pos) < m_cap);
+  static_assert(KindOfUninit == 0, "must be 0 since we use smart_calloc");
+  if (UNLIKELY(m_localCache == nullptr)) {
+    m_localCache = (TypedValue**)smart_calloc(
+      (m_cap + kCacheChunk - 1) / kCacheChunk, sizeof(TypedValue*));
+  }
+  TypedValue*& chunk = m_localCache[pos / kCacheChunk];
+  if (UNLIKELY(chunk == nullptr)) {
+    chunk = (TypedValue*)smart_calloc(chunkSize(pos / kCacheChunk),
+                                      sizeof(TypedValue));
+  }
+  return &chunk[pos % kCacheChunk];
+}
+
 HOT_FUNC
 CVarRef SharedArray::getValueRef(ssize_t pos) const {
+  if (m_flat) {
+    auto val = m_flat->valAt(pos);
+    if (!IS_REFCOUNTED_TYPE(val->m_type)) return tvAsCVarRef(val);
+    TypedValue* tv = cacheSlot(pos);
+    if (tv->m_type != KindOfUninit) return tvAsCVarRef(tv);
+    if (val->m_type == KindOfString) {
+      tvAsVariant(tv) = m_flat->stringAt(pos);
+    } else {
+      tvAsVariant(tv) = SharedArray::Make(m_arr, m_flat->arrayAt(pos));
+    }
+    assert(tv->m_type != KindOfUninit);
+    return tvAsCVarRef(tv);
+  }
   SharedVariant *sv = m_arr->getValue(pos);
   DataType t = sv->getType();
   if (!IS_REFCOUNTED_TYPE(t)) return sv->asCVarRef();
-  if (LIKELY(m_localCache != nullptr)) {
-    assert(unsigned(pos) < m_arr->arrCap());
-    TypedValue* tv = &m_localCache[pos];
-    if (tv->m_type != KindOfUninit) return tvAsCVarRef(tv);
-  } else {
-    static_assert(KindOfUninit == 0, "must be 0 since we use smart_calloc");
-    unsigned cap = m_arr->arrCap();
-    m_localCache = (TypedValue*) smart_calloc(cap, sizeof(TypedValue));
-  }
-  TypedValue* tv = &m_localCache[pos];
+  TypedValue* tv = cacheSlot(pos);
+  if (tv->m_type != KindOfUninit) return tvAsCVarRef(tv);
   tvAsVariant(tv) = sv->toLocal();
   assert(tv->m_type != KindOfUninit);
   return tvAsCVarRef(tv);
@@ -52,18 +72,25 @@ CVarRef SharedArray::GetValueRef(const ArrayData* ad, ssize_t pos) {
 SharedVariant* SharedArray::GetSharedVariant(const ArrayData* ad) {
   auto a = asSharedArray(ad);
   if (a->m_arr->shouldCache()) return nullptr;
+  // a subarray of a flat value has no SharedVariant of its own
+  if (a->m_flat != a->m_arr->flatArray()) return nullptr;
   return a->m_arr;
 }
 
 ALWAYS_INLINE SharedArray::~SharedArray() {
   if (m_localCache) {
-    for (TypedValue* tv = m_localCache, *end = tv + m_arr->arrCap();
-         tv < end; ++tv) {
-      tvRefcountedDecRef(tv);
+    for (uint32_t c = 0, n = (m_cap + kCacheChunk - 1) / kCacheChunk;
+         c < n; ++c) {
+      TypedValue* chunk = m_localCache[c];
+      if (!chunk) continue;
+      for (TypedValue* tv = chunk, *end = tv + chunkSize(c); tv < end; ++tv) {
+        tvRefcountedDecRef(tv);
+      }
+      smart_free(chunk);
     }
     smart_free(m_localCache);
   }
-  m_arr->decRef();
+  m_arr->requestDecRef();
 }
 
 HOT_FUNC
@@ -102,11 +129,11 @@ bool SharedArray::ExistsInt(const ArrayData* ad, int64_t k) {
 }
 
 ssize_t SharedArray::getIndex(int64_t k) const {
-  return m_arr->getIndex(k);
+  return m_flat ? m_flat->indexOf(k) : m_arr->getIndex(k);
 }
 
 ssize_t SharedArray::getIndex(const StringData* k) const {
-  return m_arr->getIndex(k);
+  return m_flat ? m_flat->indexOf(k) : m_arr->getIndex(k);
 }
 
 /* if a2 is modified copy of a1 (i.e. != a1), then release a1 and return a2 */
@@ -205,9 +232,29 @@ ArrayData *SharedArray::Prepend(ArrayData* ad, CVarRef v, bool copy) {
   return releaseIfCopied(escalated, escalated->prepend(v, false));
 }
 
+ArrayData* SharedArray::loadFlatElems() const {
+  ArrayData* elems;
+  if (m_flat->isPacked()) {
+    PackedArrayInit ai(m_size);
+    for (uint i = 0; i < m_size; i++) {
+      ai.append(getValueRef(i));
+    }
+    elems = ai.create();
+  } else {
+    ArrayInit ai(m_size);
+    for (uint i = 0; i < m_size; i++) {
+      ai.add(m_flat->keyAt(i), getValueRef(i), true);
+    }
+    elems = ai.create();
+  }
+  if (elems->isStatic()) elems = elems->copy();
+  return elems;
+}
+
 ArrayData *SharedArray::Escalate(const ArrayData* ad) {
   auto smap = asSharedArray(ad);
-  auto ret = smap->m_arr->loadElems(*smap);
+  auto ret = smap->m_flat ? smap->loadFlatElems()
+                          : smap->m_arr->loadElems(*smap);
   assert(!ret->isStatic());
   return ret;
 }
@@ -228,7 +275,7 @@ TypedValue* SharedArray::NvGetStr(const ArrayData* ad, const StringData* key) {
 
 void SharedArray::NvGetKey(const ArrayData* ad, TypedValue* out, ssize_t pos) {
   auto a = asSharedArray(ad);
-  Variant k = a->m_arr->getKey(pos);
+  Variant k = a->getKey(pos);
   TypedValue* tv = k.asTypedValue();
   // copy w/out clobbering out->_count.
   out->m_type = tv->m_type;
@@ -238,7 +285,7 @@ void SharedArray::NvGetKey(const ArrayData* ad, TypedValue* out, ssize_t pos) {
 
 ArrayData* SharedArray::EscalateForSort(ArrayData* ad) {
   auto a = asSharedArray(ad);
-  auto ret = a->m_arr->loadElems(*a);
+  auto ret = a->m_flat ? a->loadFlatElems() : a->m_arr->loadElems(*a);
   assert(!ret->isStatic());
   return ret;
 }
@@ -278,12 +325,14 @@ bool SharedArray::AdvanceFullPos(ArrayData* ad, FullPos& fp) {
 
 void SharedArray::getChildren(std::vector<TypedValue *> &out) {
   if (m_localCache) {
-    TypedValue *localCacheEnd = m_localCache + m_size;
-    for (TypedValue *tv = m_localCache;
-         tv < localCacheEnd;
-         ++tv) {
-      if (tv->m_type != KindOfUninit) {
-        out.push_back(tv);
+    for (uint32_t c = 0, n = (m_cap + kCacheChunk - 1) / kCacheChunk;
+         c < n; ++c) {
+      TypedValue* chunk = m_localCache[c];
+      if (!chunk) continue;
+      for (TypedValue* tv = chunk, *end = tv + chunkSize(c); tv < end; ++tv) {
+        if (tv->m_type != KindOfUninit) {
+          out.push_back(tv);
+        }
       }
     }
   }
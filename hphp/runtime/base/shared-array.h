@@ -33,9 +33,24 @@ class SharedArray : public ArrayData, Sweepable {
   explicit SharedArray(SharedVariant* source)
     : ArrayData(kSharedKind)
     , m_arr(source)
-    , m_localCache(nullptr) {
+    , m_flat(source->flatArray())
+    , m_localCache(nullptr)
+    , m_cap(source->arrCap()) {
     m_size = m_arr->arrSize();
-    source->incRef();
+    source->requestIncRef();
+  }
+
+  /*
+   * A subarray of a flat SharedVariant. Keeps the root alive.
+   */
+  SharedArray(SharedVariant* root, const FlatArray* sub)
+    : ArrayData(kSharedKind)
+    , m_arr(root)
+    , m_flat(sub)
+    , m_localCache(nullptr)
+    , m_cap(sub->size()) {
+    m_size = sub->size();
+    root->requestIncRef();
   }
 
   ~SharedArray();
@@ -61,7 +76,7 @@ public:
   using ArrayData::remove;
 
   Variant getKey(ssize_t pos) const {
-    return m_arr->getKey(pos);
+    return m_flat ? m_flat->keyAt(pos) : m_arr->getKey(pos);
   }
 
   CVarRef getValueRef(ssize_t pos) const;
@@ -118,18 +133,34 @@ public:
   static ArrayData* EscalateForSort(ArrayData*);
 
   // implements Sweepable.sweep()
-  void sweep() FOLLY_OVERRIDE { m_arr->decRef(); }
+  void sweep() FOLLY_OVERRIDE { m_arr->requestDecRef(); }
 
 private:
   ssize_t getIndex(int64_t k) const;
   ssize_t getIndex(const StringData* k) const;
+  TypedValue* cacheSlot(ssize_t pos) const;
+  // The last (or only) chunk is cut down to the slots that exist.
+  uint32_t chunkSize(uint32_t chunk) const {
+    uint32_t left = m_cap - chunk * kCacheChunk;
+    return left < kCacheChunk ? left : kCacheChunk;
+  }
+  ArrayData* loadFlatElems() const;
   static SharedArray* asSharedArray(ArrayData* ad);
   static const SharedArray* asSharedArray(const ArrayData* ad);
 
 public:
   void getChildren(std::vector<TypedValue *> &out);
   SharedVariant *m_arr;
-  mutable TypedValue* m_localCache;
+  // Non-null when m_arr is flat; points at the (sub)array we expose.
+  const FlatArray* m_flat;
+  // Materialized refcounted values, in chunks of kCacheChunk slots that
+  // are only allocated once something in them is read.
+  static const uint32_t kCacheChunk = 64;
+  mutable TypedValue** m_localCache;
+  // With SharedVariant::BorrowOnFetch, m_arr may already be gone by the
+  // time a SharedArray is released late in request teardown, so
+  // releasing must not look at it.
+  uint32_t m_cap;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -57,6 +57,10 @@ void SharedStores::create() {
       case apcExtension::TableTypes::ConcurrentTable:
         m_stores[i] = new ConcurrentTableSharedStore(i);
         break;
+      case apcExtension::TableTypes::ShardedTable:
+        m_stores[i] = new ConcurrentTableSharedStore(
+          i, apcExtension::TableShardCount);
+        break;
       default:
         assert(false);
     }
@@ -247,6 +247,12 @@ std::atomic<int32_t> SharedStoreStats::s_expireCount(0);
 
 int32_t SharedStoreStats::s_expireQueueSize = 0;
 std::atomic<int64_t> SharedStoreStats::s_purgingTime(0);
+std::atomic<int64_t> SharedStoreStats::s_evictCount(0);
+std::atomic<int64_t> SharedStoreStats::s_evictSize(0);
+std::atomic<int64_t> SharedStoreStats::s_evictingTime(0);
+
+SharedStoreStats::ShardStats* SharedStoreStats::s_shardStats = nullptr;
+int SharedStoreStats::s_shardCount = 0;
 
 ReadWriteMutex SharedStoreStats::s_rwlock;
 
@@ -270,7 +276,9 @@ string SharedStoreStats::report_basic() {
   writeEntryInt(out, "Delete_Count", s_deleteCount, false, 1, true);
   writeEntryInt(out, "Expire_Count", s_expireCount, false, 1, true);
   writeEntryInt(out, "Expire_Queue_Size", s_expireQueueSize, false, 1, true);
-  writeEntryInt(out, "Purging_Time", s_purgingTime, true, 1, true);
+  writeEntryInt(out, "Purging_Time", s_purgingTime, false, 1, true);
+  writeEntryInt(out, "Evict_Count", s_evictCount, false, 1, true);
+  writeEntryInt(out, "Evict_Size", s_evictSize, true, 1, true);
   out << "}\n";
   return out.str();
 }
@@ -289,10 +297,45 @@ string SharedStoreStats::report_basic_flat() {
       << ", " << "\"hphp.apc.expire_count\":" << s_expireCount
       << ", " << "\"hphp.apc.expire_queue_size\":" << s_expireQueueSize
       << ", " << "\"hphp.apc.purging_time\":" << s_purgingTime
+      << ", " << "\"hphp.apc.evict_count\":" << s_evictCount
+      << ", " << "\"hphp.apc.evict_size\":" << s_evictSize
       << "}\n";
   return out.str();
 }
 
+string SharedStoreStats::report_shards() {
+  ostringstream out;
+  out << "[\n";
+  for (int i = 0; i < s_shardCount; i++) {
+    ShardStats& ss = s_shardStats[i];
+    out << "  {";
+    writeEntryInt(out, "Shard", i);
+    writeEntryInt(out, "Key_Count", ss.keyCount);
+    writeEntryInt(out, "Expire_Queue_Size", ss.expireQueueSize);
+    writeEntryInt(out, "Expire_Count", ss.expireCount);
+    writeEntryInt(out, "Purge_Count", ss.purgeCount);
+    writeEntryInt(out, "Purging_Time", ss.purgingTime);
+    writeEntryInt(out, "Evict_Count", ss.evictCount);
+    writeEntryInt(out, "Evict_Size", ss.evictSize, true);
+    out << (i + 1 < s_shardCount ? "},\n" : "}\n");
+  }
+  out << "]\n";
+  return out.str();
+}
+
+string SharedStoreStats::report_evictions(int64_t memoryUsage,
+                                          int64_t memoryLimit) {
+  ostringstream out;
+  out << "{\n";
+  writeEntryInt(out, "Memory_Usage", memoryUsage, false, 1, true);
+  writeEntryInt(out, "Memory_Limit", memoryLimit, false, 1, true);
+  writeEntryInt(out, "Evict_Count", s_evictCount, false, 1, true);
+  writeEntryInt(out, "Evict_Size", s_evictSize, false, 1, true);
+  writeEntryInt(out, "Evicting_Time", s_evictingTime, true, 1, true);
+  out << "}\n";
+  return out.str();
+}
+
 string SharedStoreStats::report_keys() {
   ostringstream out;
   ReadLock l(s_rwlock);
@@ -419,6 +462,37 @@ void SharedStoreStats::addPurgingTime(int64_t purgingTime) {
   s_purgingTime.fetch_add(purgingTime, std::memory_order_relaxed);
 }
 
+void SharedStoreStats::setShardCount(int count) {
+  // only called when APC is created; the old array may still be read by a
+  // concurrent report, so it is leaked rather than freed
+  if (count == s_shardCount) return;
+  s_shardStats = new ShardStats[count];
+  s_shardCount = count;
+}
+
+void SharedStoreStats::onShardPurge(int shard, int32_t keyCount,
+                                    int64_t queueSize, int32_t expired,
+                                    int64_t purgingTime) {
+  if (shard >= s_shardCount) return;
+  ShardStats& ss = s_shardStats[shard];
+  ss.keyCount = keyCount;
+  ss.expireQueueSize = queueSize;
+  ss.expireCount.fetch_add(expired, std::memory_order_relaxed);
+  ss.purgeCount.fetch_add(1, std::memory_order_relaxed);
+  ss.purgingTime.fetch_add(purgingTime, std::memory_order_relaxed);
+}
+
+void SharedStoreStats::onShardEvict(int shard, int32_t count, int64_t bytes,
+                                    int64_t evictingTime) {
+  s_evictCount.fetch_add(count, std::memory_order_relaxed);
+  s_evictSize.fetch_add(bytes, std::memory_order_relaxed);
+  s_evictingTime.fetch_add(evictingTime, std::memory_order_relaxed);
+  if (shard >= s_shardCount) return;
+  ShardStats& ss = s_shardStats[shard];
+  ss.evictCount.fetch_add(count, std::memory_order_relaxed);
+  ss.evictSize.fetch_add(bytes, std::memory_order_relaxed);
+}
+
 void SharedStoreStats::onDelete(const StringData *key, const SharedVariant *var,
                                 bool replace, bool noTTL) {
   char normalizedKey[MAX_KEY_LEN + 1];
@@ -110,6 +110,19 @@ public:
   }
   static void addPurgingTime(int64_t purgingTime);
 
+  // per-shard stats of the sharded APC table
+  static void setShardCount(int count);
+  static void onShardPurge(int shard, int32_t keyCount, int64_t queueSize,
+                           int32_t expired, int64_t purgingTime);
+  static std::string report_shards();
+
+  // evictions under apcExtension::MemoryLimit; these are counted even
+  // without EnableAPCSizeStats
+  static void onShardEvict(int shard, int32_t count, int64_t bytes,
+                           int64_t evictingTime);
+  static std::string report_evictions(int64_t memoryUsage,
+                                      int64_t memoryLimit);
+
 protected:
   static ReadWriteMutex s_rwlock;
 
@@ -131,6 +144,24 @@ protected:
 
   static int32_t s_expireQueueSize;
   static std::atomic<int64_t> s_purgingTime;
+  static std::atomic<int64_t> s_evictCount;
+  static std::atomic<int64_t> s_evictSize;
+  static std::atomic<int64_t> s_evictingTime;
+
+  struct ShardStats {
+    ShardStats() : keyCount(0), expireQueueSize(0), expireCount(0),
+                   purgeCount(0), purgingTime(0), evictCount(0),
+                   evictSize(0) {}
+    std::atomic<int32_t> keyCount; // as of the last purge
+    std::atomic<int64_t> expireQueueSize;
+    std::atomic<int32_t> expireCount;
+    std::atomic<int32_t> purgeCount;
+    std::atomic<int64_t> purgingTime;
+    std::atomic<int64_t> evictCount;
+    std::atomic<int64_t> evictSize;
+  };
+  static ShardStats* s_shardStats;
+  static int s_shardCount;
 
   static void remove(SharedValueProfile *svp, bool replace);
   static void add(SharedValueProfile *svp);
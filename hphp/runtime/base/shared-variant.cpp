@@ -23,6 +23,7 @@
 #include "hphp/runtime/base/immutable-obj.h"
 #include "hphp/runtime/base/runtime-option.h"
 #include "hphp/runtime/base/static-string-table.h"
+#include "hphp/runtime/vm/treadmill.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -95,6 +96,14 @@ StringCase:
           m_data.str = StringData::MakeMalloced(s.data(), s.size());
           break;
         }
+
+        if (FlatArrayThreshold && arr->size() >= FlatArrayThreshold) {
+          if (FlatArray* flat = FlatArray::Create(arr)) {
+            setFlat();
+            m_data.flat = flat;
+            break;
+          }
+        }
       }
 
       if (arr->isVectorData()) {
@@ -179,7 +188,7 @@ StringData* StringData::MakeSVSlowPath(SharedVariant* shared, uint32_t len) {
 
   sd->sharedPayload()->shared = shared;
   sd->enlist();
-  shared->incRef();
+  shared->requestIncRef();
 
   assert(sd->m_len == len);
   assert(sd->m_count == 0);
@@ -345,6 +354,8 @@ SharedVariant::~SharedVariant() {
 
       if (isPacked()) {
         delete m_data.packed;
+      } else if (isFlat()) {
+        FlatArray::Destroy(m_data.flat);
       } else {
         ImmutableArray::Destroy(m_data.array);
       }
@@ -355,17 +366,59 @@ SharedVariant::~SharedVariant() {
   }
 }
 
+bool SharedVariant::BorrowOnFetch = false;
+uint32_t SharedVariant::FlatArrayThreshold = 0;
+
+namespace {
+
+/*
+ * SharedVariants released during a ReclaimTrigger (the children of the
+ * ones it deletes) go into this batch rather than getting a trigger
+ * each.  They can't be deleted on the spot: a child may also be a
+ * top-level value that a request borrowed after this trigger was queued.
+ */
+__thread std::vector<SharedVariant*>* tl_reclaimBatch;
+
+struct ReclaimTrigger : Treadmill::WorkItem {
+  explicit ReclaimTrigger(std::vector<SharedVariant*>&& svars)
+    : m_svars(std::move(svars)) {}
+
+  virtual void operator()() {
+    std::vector<SharedVariant*> next;
+    tl_reclaimBatch = &next;
+    for (auto svar : m_svars) delete svar;
+    tl_reclaimBatch = nullptr;
+    if (!next.empty()) {
+      Treadmill::WorkItem::enqueue(new ReclaimTrigger(std::move(next)));
+    }
+  }
+
+private:
+  std::vector<SharedVariant*> m_svars;
+};
+
+}
+
+void SharedVariant::deferredRelease() {
+  if (tl_reclaimBatch) {
+    tl_reclaimBatch->push_back(this);
+    return;
+  }
+  Treadmill::WorkItem::enqueue(
+    new ReclaimTrigger(std::vector<SharedVariant*>(1, this)));
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 HOT_FUNC
 int SharedVariant::getIndex(const StringData* key) {
-  assert(is(KindOfArray));
+  assert(is(KindOfArray) && !isFlat());
   if (isPacked()) return -1;
   return m_data.array->indexOf(key);
 }
 
 int SharedVariant::getIndex(int64_t key) {
-  assert(is(KindOfArray));
+  assert(is(KindOfArray) && !isFlat());
   if (isPacked()) {
     if (key < 0 || (size_t) key >= m_data.packed->size()) return -1;
     return key;
@@ -374,7 +427,7 @@ int SharedVariant::getIndex(int64_t key) {
 }
 
 Variant SharedVariant::getKey(ssize_t pos) const {
-  assert(is(KindOfArray));
+  assert(is(KindOfArray) && !isFlat());
   if (isPacked()) {
     assert(pos < (ssize_t) m_data.packed->size());
     return pos;
@@ -384,7 +437,7 @@ Variant SharedVariant::getKey(ssize_t pos) const {
 
 HOT_FUNC
 SharedVariant* SharedVariant::getValue(ssize_t pos) const {
-  assert(is(KindOfArray));
+  assert(is(KindOfArray) && !isFlat());
   if (isPacked()) {
     assert(pos < (ssize_t) m_data.packed->size());
     return m_data.packed->vals()[pos];
@@ -393,7 +446,7 @@ SharedVariant* SharedVariant::getValue(ssize_t pos) const {
 }
 
 ArrayData* SharedVariant::loadElems(const SharedArray &array) {
-  assert(is(KindOfArray));
+  assert(is(KindOfArray) && !isFlat());
   auto count = arrSize();
   ArrayData* elems;
   if (isPacked()) {
@@ -416,7 +469,7 @@ ArrayData* SharedVariant::loadElems(const SharedArray &array) {
 
 int SharedVariant::countReachable() const {
   int count = 1;
-  if (getType() == KindOfArray) {
+  if (getType() == KindOfArray && !isFlat()) {
     int size = arrSize();
     if (!isPacked()) {
       count += size; // for keys
@@ -434,9 +487,13 @@ SharedVariant *SharedVariant::Create
  bool unserializeObj /* = false*/) {
   SharedVariant *wrapped = source.getSharedVariant();
   if (wrapped && !unserializeObj) {
-    wrapped->incRef();
-    // static cast should be enough
-    return (SharedVariant *)wrapped;
+    // With BorrowOnFetch the wrapper holds no reference of its own, so
+    // the SharedVariant may have been released already; copy it then.
+    if (!BorrowOnFetch) {
+      wrapped->incRef();
+      return wrapped;
+    }
+    if (wrapped->tryIncRef()) return wrapped;
   }
   return new SharedVariant(source, serialized, inner, unserializeObj);
 }
@@ -476,6 +533,8 @@ int32_t SharedVariant::getSpaceUsage() const {
     assert(is(KindOfArray));
     if (getSerializedArray()) {
       size += sizeof(StringData) + m_data.str->size();
+    } else if (isFlat()) {
+      size += m_data.flat->bytes();
     } else if (isPacked()) {
       auto size = m_data.packed->size();
       size += sizeof(ImmutablePackedArray) + size * sizeof(SharedVariant*);
@@ -530,6 +589,11 @@ void SharedVariant::getStats(SharedVariantStats *stats) const {
                              stats->dataSize;
       break;
     }
+    if (isFlat()) {
+      stats->dataSize = m_data.flat->bytes();
+      stats->dataTotalSize = sizeof(SharedVariant) + stats->dataSize;
+      break;
+    }
     if (isPacked()) {
       stats->dataTotalSize = sizeof(SharedVariant) +
                              sizeof(ImmutablePackedArray);
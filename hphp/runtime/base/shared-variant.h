@@ -23,6 +23,7 @@
 #include "hphp/util/atomic.h"
 #include "hphp/runtime/base/complex-types.h"
 #include "hphp/runtime/base/immutable-array.h"
+#include "hphp/runtime/base/flat-array.h"
 
 #if (defined(__APPLE__) || defined(__APPLE_CC__)) && (defined(__BIG_ENDIAN__) || defined(__LITTLE_ENDIAN__))
 # if defined(__LITTLE_ENDIAN__)
@@ -56,6 +57,13 @@ public:
                                bool inner = false,
                                bool unserializeObj = false);
 
+  /*
+   * Wrap a FlatArray read back from an APC snapshot; takes ownership.
+   */
+  static SharedVariant* CreateFlat(FlatArray* flat) {
+    return new SharedVariant(flat);
+  }
+
   bool is(DataType d) const { return m_type == d; }
   DataType getType() const { return (DataType)m_type; }
   CVarRef asCVarRef() const {
@@ -75,7 +83,7 @@ public:
     assert(m_count.load());
     if (IS_REFCOUNTED_TYPE(m_type)) {
       if (--m_count == 0) {
-        delete this;
+        release();
       }
     } else {
       assert(m_count.load() == 1);
@@ -83,6 +91,43 @@ public:
     }
   }
 
+  /*
+   * Apc.BorrowOnFetch: request-local wrappers of a SharedVariant
+   * (SharedArray and shared-mode StringData) borrow it rather than hold
+   * a reference, so fetching a hot key doesn't bounce m_count between
+   * cores.  In exchange, a refcounted SharedVariant whose count drops
+   * to zero is deleted from the Treadmill once every request that was
+   * running at the time has finished.
+   *
+   * Wrappers must use requestIncRef/requestDecRef and must not look at
+   * the SharedVariant when they are released: Treadmill::finishRequest
+   * runs before the request's globals are freed.  The flag must not
+   * change while any wrappers are live.
+   */
+  static bool BorrowOnFetch;
+
+  void requestIncRef() {
+    if (!BorrowOnFetch) incRef();
+  }
+
+  void requestDecRef() {
+    if (!BorrowOnFetch) decRef();
+  }
+
+  /*
+   * Take a reference only if someone else still holds one.  A borrowed
+   * SharedVariant may already be at zero and queued for deletion, and
+   * must not be brought back.
+   */
+  bool tryIncRef() {
+    assert(IS_REFCOUNTED_TYPE(m_type));
+    auto count = m_count.load(std::memory_order_relaxed);
+    while (count != 0) {
+      if (m_count.compare_exchange_weak(count, count + 1)) return true;
+    }
+    return false;
+  }
+
   Variant toLocal();
 
   int64_t intData() const {
@@ -108,15 +153,27 @@ public:
   size_t arrSize() const {
     assert(is(KindOfArray));
     if (isPacked()) return m_data.packed->size();
+    if (isFlat()) return m_data.flat->size();
     return m_data.array->size();
   }
 
   size_t arrCap() const {
     assert(is(KindOfArray));
     if (isPacked()) return m_data.packed->size();
+    if (isFlat()) return m_data.flat->size();
     return m_data.array->capacity();
   }
 
+  /*
+   * Non-null if this array is stored as a FlatArray, in which case
+   * SharedArray reads it directly and the per-element accessors below
+   * must not be used.
+   */
+  const FlatArray* flatArray() const {
+    assert(is(KindOfArray));
+    return isFlat() ? m_data.flat : nullptr;
+  }
+
   int getIndex(int64_t key);
   int getIndex(const StringData* key);
 
@@ -142,7 +199,26 @@ public:
 
   int countReachable() const;
 
+  /*
+   * Apc.FlatArrayThreshold: top-level arrays with at least this many
+   * elements, holding only scalars, strings and arrays, are stored as
+   * a FlatArray.  0 disables it.
+   */
+  static uint32_t FlatArrayThreshold;
+
 private:
+  explicit SharedVariant(FlatArray* flat)
+    : m_shouldCache(false), m_flags(IsFlat) {
+    m_count = 1;
+    m_type = KindOfArray;
+    m_data.flat = flat;
+  }
+
+  void release() {
+    if (UNLIKELY(BorrowOnFetch)) return deferredRelease();
+    delete this;
+  }
+  void deferredRelease();
 
   /*
    * Keep the object layout binary compatible with Variant for primitive types.
@@ -160,6 +236,7 @@ private:
     ImmutableArray* array;
     ImmutablePackedArray* packed;
     ImmutableObj* obj;
+    FlatArray* flat;
   };
 
 #if PACKED_TV
@@ -191,6 +268,7 @@ private:
   const static uint8_t IsPacked = (1<<1);
   const static uint8_t IsObj = (1<<2);
   const static uint8_t ObjAttempted = (1<<3);
+  const static uint8_t IsFlat = (1<<4);
 
   bool getSerializedArray() const { return (bool)(m_flags & SerializedArray); }
   void setSerializedArray() { m_flags |= SerializedArray; }
@@ -203,6 +281,9 @@ private:
 
   bool getObjAttempted() const { return (bool)(m_flags & ObjAttempted); }
   void setObjAttempted() { m_flags |= ObjAttempted; }
+
+  bool isFlat() const { return (bool)(m_flags & IsFlat); }
+  void setFlat() { m_flags |= IsFlat; }
 };
 
 class SharedVariantStats {
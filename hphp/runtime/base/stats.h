@@ -180,6 +180,11 @@ namespace Stats {
   STAT(Switch_Generic) \
   STAT(Switch_Integer) \
   STAT(Switch_String) \
+  /* JIT intrinsics for builtins */ \
+  STAT(Intrinsic_count) \
+  STAT(Intrinsic_ord) \
+  STAT(Intrinsic_chr) \
+  STAT(Intrinsic_in_array) \
 
 enum StatCounter {
 #define STAT(name) \
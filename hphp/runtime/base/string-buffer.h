@@ -61,6 +61,15 @@ struct StringBuffer {
     m_maxBytes = maxBytes > 0 ? maxBytes : kDefaultOutputLimit;
   }
 
+  /*
+   * Returns whether `additionalBytes' more bytes fit under the output
+   * limit.  appendCursor() doesn't check the limit, so callers that
+   * reserve ahead should check this first.
+   */
+  bool fitsOutputLimit(int64_t additionalBytes) const {
+    return m_len + additionalBytes <= m_maxBytes;
+  }
+
   /*
    * Access the current state of the string.
    *
@@ -139,7 +139,7 @@ void StringData::sweepAll() {
                    - sizeof(StringData)
     );
     assert(s->isShared());
-    s->sharedPayload()->shared->decRef();
+    s->sharedPayload()->shared->requestDecRef();
   }
   head.next = head.prev = &head;
 }
@@ -239,7 +239,7 @@ void StringData::releaseDataSlowPath() {
   assert(isShared());
   assert(checkSane());
 
-  sharedPayload()->shared->decRef();
+  sharedPayload()->shared->requestDecRef();
   delist();
   freeForSize(this, sizeof(StringData) + sizeof(SharedPayload));
 }
@@ -159,6 +159,7 @@ struct StringData {
    * Offset accessor for the JIT compiler.
    */
   static std::ptrdiff_t sizeOffset() { return offsetof(StringData, m_len); }
+  static std::ptrdiff_t dataOffset() { return offsetof(StringData, m_data); }
 
   /*
    * Shared StringData's have a sweep list running through them for
@@ -550,7 +550,8 @@ void String::serialize(VariableSerializer *serializer) const {
 
 void String::unserialize(VariableUnserializer *uns,
                          char delimiter0 /* = '"' */,
-                         char delimiter1 /* = '"' */) {
+                         char delimiter1 /* = '"' */,
+                         bool intern /* = false */) {
   int64_t size = uns->readInt();
   if (size >= RuntimeOption::MaxSerializedStringSize) {
     throw Exception("Size of serialized string (%d) exceeds max", int(size));
@@ -560,27 +561,23 @@ void String::unserialize(VariableUnserializer *uns,
                     int(size));
   }
 
-  char ch = uns->readChar();
-  if (ch != ':') {
-    throw Exception("Expected ':' but got '%c'", ch);
-  }
-  ch = uns->readChar();
-  if (ch != delimiter0) {
-    throw Exception("Expected '%c' but got '%c'", delimiter0, ch);
+  uns->expectChar(':');
+  uns->expectChar(delimiter0);
+  if (intern && size <= VariableUnserializer::kMaxInternedSize &&
+      size_t(size) <= uns->remaining()) {
+    operator=(uns->readInterned(size));
+  } else {
+    StringData *px = StringData::Make(int(size));
+    auto const buf = px->bufferSlice();
+    assert(size <= buf.len);
+    uns->read(buf.ptr, size);
+    px->setSize(size);
+    if (m_px) decRefStr(m_px);
+    m_px = px;
+    px->setRefCount(1);
   }
-  StringData *px = StringData::Make(int(size));
-  auto const buf = px->bufferSlice();
-  assert(size <= buf.len);
-  uns->read(buf.ptr, size);
-  px->setSize(size);
-  if (m_px) decRefStr(m_px);
-  m_px = px;
-  px->setRefCount(1);
 
-  ch = uns->readChar();
-  if (ch != delimiter1) {
-    throw Exception("Expected '%c' but got '%c'", delimiter1, ch);
-  }
+  uns->expectChar(delimiter1);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
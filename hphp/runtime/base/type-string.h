@@ -414,7 +414,7 @@ public:
    */
   void serialize(VariableSerializer *serializer) const;
   void unserialize(VariableUnserializer *uns, char delimiter0 = '"',
-                   char delimiter1 = '"');
+                   char delimiter1 = '"', bool intern = false);
 
   /**
    * Debugging
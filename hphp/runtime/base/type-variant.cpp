@@ -1649,7 +1649,8 @@ void Variant::serialize(VariableSerializer *serializer,
     // Ugly, but behavior is different for serialize
     if (serializer->getType() == VariableSerializer::Type::Serialize ||
         serializer->getType() == VariableSerializer::Type::APCSerialize ||
-        serializer->getType() == VariableSerializer::Type::DebuggerSerialize) {
+        serializer->getType() == VariableSerializer::Type::DebuggerSerialize ||
+        serializer->getType() == VariableSerializer::Type::BinarySerialize) {
       if (serializer->incNestedLevel(m_data.pref->var())) {
         serializer->writeOverflow(m_data.pref->var());
       } else {
@@ -1724,22 +1725,18 @@ static void unserializeProp(VariableUnserializer *uns,
 void Variant::unserialize(VariableUnserializer *uns,
                           Uns::Mode mode /* = Uns::Mode::Value */) {
 
-  char type, sep;
-  type = uns->readChar();
-  sep = uns->readChar();
+  char type = uns->readChar();
 
   if (type != 'R') {
     uns->add(this, mode);
   }
 
   if (type == 'N') {
-    if(sep != ';') throw Exception("Expected ';' but got '%c'", sep);
+    uns->expectChar(';');
     setNull(); // NULL *IS* the value, without we get undefined warnings
     return;
   }
-  if (sep != ':') {
-    throw Exception("Expected ':' but got '%c'", sep);
-  }
+  uns->expectChar(':');
 
   switch (type) {
   case 'r':
@@ -1767,6 +1764,10 @@ void Variant::unserialize(VariableUnserializer *uns,
   case 'd':
     {
       double v;
+      if (uns->getType() == VariableUnserializer::Type::BinarySerialize) {
+        operator=(uns->readDouble());
+        break;
+      }
       char ch = uns->peek();
       bool negative = false;
       char buf[4];
@@ -1796,7 +1797,8 @@ void Variant::unserialize(VariableUnserializer *uns,
   case 's':
     {
       String v;
-      v.unserialize(uns);
+      v.unserialize(uns, '"', '"',
+                    mode == Uns::Mode::Key || mode == Uns::Mode::ColKey);
       operator=(v);
     }
     break;
@@ -1823,20 +1825,11 @@ void Variant::unserialize(VariableUnserializer *uns,
   case 'L':
     {
       int64_t id = uns->readInt();
-      sep = uns->readChar();
-      if (sep != ':') {
-        throw Exception("Expected ':' but got '%c'", sep);
-      }
+      uns->expectChar(':');
       String rsrcName;
       rsrcName.unserialize(uns);
-      sep = uns->readChar();
-      if (sep != '{') {
-        throw Exception("Expected '{' but got '%c'", sep);
-      }
-      sep = uns->readChar();
-      if (sep != '}') {
-        throw Exception("Expected '}' but got '%c'", sep);
-      }
+      uns->expectChar('{');
+      uns->expectChar('}');
       DummyResource* rsrc = NEWOBJ(DummyResource);
       rsrc->o_setResourceId(id);
       rsrc->m_class_name = rsrcName;
@@ -1851,21 +1844,12 @@ void Variant::unserialize(VariableUnserializer *uns,
       String clsName;
       clsName.unserialize(uns);
 
-      sep = uns->readChar();
-      if (sep != ':') {
-        throw Exception("Expected ':' but got '%c'", sep);
-      }
+      uns->expectChar(':');
       int64_t size = uns->readInt();
-      char sep = uns->readChar();
-      if (sep != ':') {
-        throw Exception("Expected ':' but got '%c'", sep);
-      }
-      sep = uns->readChar();
-      if (sep != '{') {
-        throw Exception("Expected '{' but got '%c'", sep);
-      }
+      uns->expectChar(':');
+      uns->expectChar('{');
 
-      Class* cls = Unit::loadClass(clsName.get());
+      Class* cls = uns->loadClass(clsName);
       Object obj;
       if (RuntimeOption::UnserializationWhitelistCheck &&
           !uns->isWhitelistedClass(clsName)) {
@@ -1957,10 +1941,7 @@ void Variant::unserialize(VariableUnserializer *uns,
           collectionUnserialize(obj.get(), uns, size, type);
         }
       }
-      sep = uns->readChar();
-      if (sep != '}') {
-        throw Exception("Expected '}' but got '%c'", sep);
-      }
+      uns->expectChar('}');
 
       obj->invokeWakeup();
       return; // object has '}' terminating
@@ -1971,10 +1952,7 @@ void Variant::unserialize(VariableUnserializer *uns,
       String clsName;
       clsName.unserialize(uns);
 
-      sep = uns->readChar();
-      if (sep != ':') {
-        throw Exception("Expected ':' but got '%c'", sep);
-      }
+      uns->expectChar(':');
       String serialized;
       serialized.unserialize(uns, '{', '}');
 
@@ -2001,10 +1979,7 @@ void Variant::unserialize(VariableUnserializer *uns,
   default:
     throw Exception("Unknown type '%c'", type);
   }
-  sep = uns->readChar();
-  if (sep != ';') {
-    throw Exception("Expected ';' but got '%c'", sep);
-  }
+  uns->expectChar(';');
 }
 
 SharedVariant *Variant::getSharedVariant() const {
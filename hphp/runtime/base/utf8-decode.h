@@ -38,6 +38,21 @@ public:
   UTF8To16Decoder(const char *utf8, int length, bool loose);
   int decode();
 
+  /*
+   * Raw access to the input, for callers that consume runs of plain
+   * ASCII themselves.  Only valid between characters, i.e. when no low
+   * surrogate of an astral character is still pending.
+   */
+  bool atCharBoundary() const { return !m_low_surrogate; }
+  const char* cursor() const {
+    return m_decode.the_input + m_decode.the_index;
+  }
+  int remaining() const { return m_decode.the_length - m_decode.the_index; }
+  void skip(int n) {
+    m_decode.the_index += n;
+    m_decode.the_char += n;
+  }
+
 private:
   json_utf8_decode m_decode;
   int m_loose; // Faceook: json_utf8_loose
@@ -23,6 +23,9 @@
 #include "hphp/runtime/base/zend-string.h"
 #include <math.h>
 #include <cmath>
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
 #include "hphp/runtime/base/runtime-option.h"
 #include "hphp/runtime/base/array-iterator.h"
 #include "hphp/runtime/base/request-local.h"
@@ -41,15 +44,18 @@ const StaticString
 
 ///////////////////////////////////////////////////////////////////////////////
 
+const int kStreamChunkSize = 64 * 1024;
+
 VariableSerializer::VariableSerializer(Type type, int option /* = 0 */,
                                        int maxRecur /* = 3 */)
   : m_type(type), m_option(option), m_buf(nullptr), m_indent(0),
     m_valueCount(0), m_referenced(false), m_refCount(1), m_maxCount(maxRecur),
-    m_levelDebugger(0) {
+    m_levelDebugger(0), m_streaming(false) {
   m_maxLevelDebugger = g_context->getDebuggerPrintLevel();
   if (type == Type::Serialize ||
       type == Type::APCSerialize ||
-      type == Type::DebuggerSerialize) {
+      type == Type::DebuggerSerialize ||
+      type == Type::BinarySerialize) {
     m_arrayIds = new SmartPtrCtrMap();
   } else {
     m_arrayIds = nullptr;
@@ -84,7 +90,10 @@ String VariableSerializer::serialize(CVarRef v, bool ret) {
     buf.setOutputLimit(StringData::MaxSize);
   }
   m_valueCount = 1;
+  m_streaming = !ret && m_type == Type::JSON;
+  if (m_type == Type::BinarySerialize) m_buf->append(kBinaryMarker);
   write(v);
+  m_streaming = false;
   if (ret) {
     return m_buf->detach();
   } else {
@@ -101,13 +110,15 @@ String VariableSerializer::serializeValue(CVarRef v, bool limit) {
     buf.setOutputLimit(RuntimeOption::SerializationSizeLimit);
   }
   m_valueCount = 1;
+  if (m_type == Type::BinarySerialize) m_buf->append(kBinaryMarker);
   write(v);
   return m_buf->detach();
 }
 
 String VariableSerializer::serializeWithLimit(CVarRef v, int limit) {
   if (m_type == Type::Serialize || m_type == Type::JSON ||
-      m_type == Type::APCSerialize || m_type == Type::DebuggerSerialize) {
+      m_type == Type::APCSerialize || m_type == Type::DebuggerSerialize ||
+      m_type == Type::BinarySerialize) {
     assert(false);
     return null_string;
   }
@@ -152,6 +163,10 @@ void VariableSerializer::write(bool v) {
   case Type::DebuggerSerialize:
     m_buf->append(v ? "b:1;" : "b:0;");
     break;
+  case Type::BinarySerialize:
+    m_buf->append('b');
+    writeVarInt(v);
+    break;
   default:
     assert(false);
     break;
@@ -188,6 +203,10 @@ void VariableSerializer::write(int64_t v) {
     m_buf->append(v);
     m_buf->append(';');
     break;
+  case Type::BinarySerialize:
+    m_buf->append('i');
+    writeVarInt(v);
+    break;
   default:
     assert(false);
     break;
@@ -258,6 +277,10 @@ void VariableSerializer::write(double v) {
     }
     m_buf->append(';');
     break;
+  case Type::BinarySerialize:
+    m_buf->append('d');
+    m_buf->append(reinterpret_cast<const char*>(&v), sizeof v);
+    break;
   default:
     assert(false);
     break;
@@ -270,6 +293,48 @@ uint16_t reverse16(uint16_t us) {
     (((us >> 8) & 0xf) << 4) | ((us >> 12) & 0xf);
 }
 
+static bool isJsonSpecial(unsigned char ch) {
+  switch (ch) {
+  case '"': case '\\': case '/': case '<': case '>':
+  case '&': case '\'': case '@': case '%':
+    return true;
+  default:
+    return false;
+  }
+}
+
+/*
+ * Length of the run at the start of p that json_encode copies verbatim
+ * under any set of options: printable ASCII other than the characters
+ * that some option escapes.  Everything else goes through the decoder.
+ */
+static int jsonPlainRun(const char* p, int len) {
+  int i = 0;
+#if defined(__x86_64__)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i specials[] = {
+    _mm_set1_epi8('"'), _mm_set1_epi8('\\'), _mm_set1_epi8('/'),
+    _mm_set1_epi8('<'), _mm_set1_epi8('>'), _mm_set1_epi8('&'),
+    _mm_set1_epi8('\''), _mm_set1_epi8('@'), _mm_set1_epi8('%'),
+  };
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+    // A signed compare catches both control characters and bytes >= 0x80.
+    __m128i stop = _mm_cmplt_epi8(v, space);
+    for (auto const& sp : specials) {
+      stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, sp));
+    }
+    int mask = _mm_movemask_epi8(stop);
+    if (mask) return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < len; ++i) {
+    unsigned char ch = p[i];
+    if (ch < ' ' || ch >= 0x80 || isJsonSpecial(ch)) break;
+  }
+  return i;
+}
+
 static void appendJsonEscape(StringBuffer& sb,
                              const char *s,
                              int len,
@@ -281,11 +346,20 @@ static void appendJsonEscape(StringBuffer& sb,
 
   static const char digits[] = "0123456789abcdef";
 
+  // Most strings need no escaping at all; reserve for that case up front.
+  if (sb.fitsOutputLimit(len + 2)) sb.appendCursor(len + 2);
   auto const start = sb.size();
   sb.append('"');
 
   UTF8To16Decoder decoder(s, len, options & k_JSON_FB_LOOSE);
   for (;;) {
+    if (decoder.atCharBoundary()) {
+      int n = jsonPlainRun(decoder.cursor(), decoder.remaining());
+      if (n) {
+        sb.append(decoder.cursor(), n);
+        decoder.skip(n);
+      }
+    }
     int c = decoder.decode();
     if (c == UTF8_END) {
       sb.append('"');
@@ -428,6 +502,11 @@ void VariableSerializer::write(const char *v, int len /* = -1 */,
     m_buf->append(v, len);
     m_buf->append("\";");
     break;
+  case Type::BinarySerialize:
+    m_buf->append('s');
+    writeVarInt(len);
+    m_buf->append(v, len);
+    break;
   case Type::JSON: {
     if (m_option & k_JSON_NUMERIC_CHECK) {
       int64_t lval; double dval;
@@ -532,9 +611,86 @@ void VariableSerializer::write(CVarRef v, bool isArrayKey /* = false */) {
     write(v.toObject());
     return;
   }
+  if (m_type == Type::JSON && !isArrayKey && v.isArray() &&
+      writeJsonScalarVector(v.getArrayData())) {
+    return;
+  }
   v.serialize(this, isArrayKey);
 }
 
+static int jsonIntLength(int64_t n) {
+  uint64_t mag = n < 0 ? uint64_t(-(n + 1)) + 1 : uint64_t(n);
+  int len = n < 0 ? 2 : 1;
+  while (mag >= 10) {
+    mag /= 10;
+    ++len;
+  }
+  return len;
+}
+
+/*
+ * json_encode of a packed array holding only ints, bools and nulls.  The
+ * exact size of the output is known after one pass over the elements, so
+ * the second pass writes straight into the buffer without any per-element
+ * dispatch.  Returns false, having written nothing, for anything else.
+ */
+bool VariableSerializer::writeJsonScalarVector(const ArrayData* arr) {
+  assert(m_type == Type::JSON);
+  if (!arr->isPacked() || arr->empty() || !m_objClass.empty() ||
+      (m_option & (k_JSON_PRETTY_PRINT | k_JSON_FORCE_OBJECT))) {
+    return false;
+  }
+
+  int64_t size = arr->size() + 1; // brackets and commas
+  for (ArrayIter iter(arr); iter; ++iter) {
+    CVarRef v = iter.secondRef();
+    switch (v.getRawType()) {
+    case KindOfNull:    size += 4; break;
+    case KindOfBoolean: size += v.asBooleanVal() ? 4 : 5; break;
+    case KindOfInt64:   size += jsonIntLength(v.asInt64Val()); break;
+    default:            return false;
+    }
+  }
+  if (!m_buf->fitsOutputLimit(size)) return false;
+
+  char* const out = m_buf->appendCursor(size);
+  char* p = out;
+  *p++ = '[';
+  for (ArrayIter iter(arr); iter; ++iter) {
+    if (p != out + 1) *p++ = ',';
+    CVarRef v = iter.secondRef();
+    switch (v.getRawType()) {
+    case KindOfNull:
+      memcpy(p, "null", 4);
+      p += 4;
+      break;
+    case KindOfBoolean:
+      if (v.asBooleanVal()) {
+        memcpy(p, "true", 4);
+        p += 4;
+      } else {
+        memcpy(p, "false", 5);
+        p += 5;
+      }
+      break;
+    default: {
+      int64_t n = v.asInt64Val();
+      int len = jsonIntLength(n);
+      int isNegative;
+      int written;
+      conv_10(n, &isNegative, p + len, &written);
+      assert(written == len);
+      p += len;
+      break;
+    }
+    }
+  }
+  *p++ = ']';
+  assert(p - out == size);
+  m_buf->resize(m_buf->size() + size);
+  return true;
+}
+
 void VariableSerializer::writeNull() {
   switch (m_type) {
   case Type::PrintR:
@@ -556,6 +712,9 @@ void VariableSerializer::writeNull() {
   case Type::DebuggerSerialize:
     m_buf->append("N;");
     break;
+  case Type::BinarySerialize:
+    m_buf->append('N');
+    break;
   case Type::JSON:
   case Type::DebuggerDump:
     m_buf->append("null");
@@ -615,6 +774,19 @@ void VariableSerializer::writeOverflow(void* ptr, bool isObject /* = false */) {
       }
     }
     break;
+  case Type::BinarySerialize:
+    {
+      assert(m_arrayIds);
+      SmartPtrCtrMap::const_iterator iter = m_arrayIds->find(ptr);
+      assert(iter != m_arrayIds->end());
+      if (isObject || wasRef) {
+        m_buf->append(isObject ? 'r' : 'R');
+        writeVarInt(iter->second);
+      } else {
+        m_buf->append('N');
+      }
+    }
+    break;
   case Type::JSON:
     raise_warning("json_encode(): recursion detected");
     m_buf->append("null");
@@ -742,6 +914,16 @@ void VariableSerializer::writeArrayHeader(int size, bool isVectorData) {
       m_buf->append(":{");
     }
     break;
+  case Type::BinarySerialize:
+    if (!m_objClass.empty()) {
+      m_buf->append(m_objCode);
+      writeVarInt(m_objClass.size());
+      m_buf->append(m_objClass);
+    } else {
+      m_buf->append('a');
+    }
+    writeVarInt(size);
+    break;
   case Type::JSON:
     info.is_vector =
       (m_objClass.empty() || m_objCode == 'V' || m_objCode == 'K') &&
@@ -857,6 +1039,7 @@ void VariableSerializer::writeArrayKey(Variant key) {
   case Type::APCSerialize:
   case Type::Serialize:
   case Type::DebuggerSerialize:
+  case Type::BinarySerialize:
     write(key);
     break;
 
@@ -899,7 +1082,7 @@ void VariableSerializer::writeArrayKey(Variant key) {
 
 void VariableSerializer::writeCollectionKey(CVarRef key) {
   if (m_type == Type::Serialize || m_type == Type::APCSerialize ||
-      m_type == Type::DebuggerSerialize) {
+      m_type == Type::DebuggerSerialize || m_type == Type::BinarySerialize) {
     m_valueCount++;
   }
   writeArrayKey(key);
@@ -917,6 +1100,7 @@ void VariableSerializer::writeCollectionKeylessPrefix() {
   case Type::APCSerialize:
   case Type::Serialize:
   case Type::DebuggerSerialize:
+  case Type::BinarySerialize:
     break;
   case Type::JSON:
   case Type::DebuggerDump: {
@@ -939,7 +1123,8 @@ void VariableSerializer::writeCollectionKeylessPrefix() {
 void VariableSerializer::writeArrayValue(CVarRef value) {
   // Do not count referenced values after the first
   if ((m_type == Type::Serialize || m_type == Type::APCSerialize ||
-       m_type == Type::DebuggerSerialize) &&
+       m_type == Type::DebuggerSerialize ||
+       m_type == Type::BinarySerialize) &&
       !(value.isReferenced() &&
         m_arrayIds->find(value.getRefData()) != m_arrayIds->end())) {
     m_valueCount++;
@@ -961,6 +1146,13 @@ void VariableSerializer::writeArrayValue(CVarRef value) {
 
   ArrayInfo &info = m_arrayInfos.back();
   info.first_element = false;
+
+  // Between elements nothing already written can be taken back, so this
+  // is where streaming output is handed off.
+  if (m_streaming && m_buf->size() >= kStreamChunkSize) {
+    g_context->write(m_buf->data(), m_buf->size());
+    m_buf->clear();
+  }
 }
 
 void VariableSerializer::writeArrayFooter() {
@@ -1004,6 +1196,8 @@ void VariableSerializer::writeArrayFooter() {
   case Type::DebuggerSerialize:
     m_buf->append('}');
     break;
+  case Type::BinarySerialize:
+    break;
   case Type::JSON:
     if (m_type == Type::JSON && m_option & k_JSON_PRETTY_PRINT) {
       m_buf->append("\n");
@@ -1025,6 +1219,14 @@ void VariableSerializer::writeArrayFooter() {
 
 void VariableSerializer::writeSerializableObject(const String& clsname,
                                                  const String& serialized) {
+  if (m_type == Type::BinarySerialize) {
+    m_buf->append('C');
+    writeVarInt(clsname.size());
+    m_buf->append(clsname.data(), clsname.size());
+    writeVarInt(serialized.size());
+    m_buf->append(serialized.data(), serialized.size());
+    return;
+  }
   m_buf->append("C:");
   m_buf->append(clsname.size());
   m_buf->append(":\"");
@@ -1038,6 +1240,19 @@ void VariableSerializer::writeSerializableObject(const String& clsname,
 
 ///////////////////////////////////////////////////////////////////////////////
 
+void VariableSerializer::writeVarInt(int64_t v) {
+  // Zigzag, so small negative numbers stay short, then LEB128.
+  uint64_t u = (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+  char buf[10];
+  int n = 0;
+  while (u >= 0x80) {
+    buf[n++] = char(u | 0x80);
+    u >>= 7;
+  }
+  buf[n++] = char(u);
+  m_buf->append(buf, n);
+}
+
 void VariableSerializer::indent() {
   for (int i = 0; i < m_indent; i++) {
     m_buf->append(' ');
@@ -1066,6 +1281,7 @@ bool VariableSerializer::incNestedLevel(void *ptr,
     // fall through
   case Type::Serialize:
   case Type::APCSerialize:
+  case Type::BinarySerialize:
     {
       assert(m_arrayIds);
       int ct = ++m_counts[ptr];
@@ -48,8 +48,33 @@ public:
     APCSerialize, //used in APC serialization (controlled by switch)
     DebuggerSerialize, //used by hphp debugger for client<->proxy communication
     PHPOutput, //used by compiler to output scalar values into byte code
+    BinarySerialize, // binary form of Serialize, see below
   };
 
+  /**
+   * BinarySerialize has the same structure as serialize() output, with
+   * the same one-character type tags, but no separators, integers as
+   * zigzag LEB128 varints and doubles as their 8 raw bytes:
+   *
+   *   N                          null
+   *   b <varint>                 bool
+   *   i <varint>                 int
+   *   d <8 bytes>                double, in host byte order
+   *   s <varint n> <n bytes>     string
+   *   a <varint n> <n keys and values>
+   *   O <varint n> <n bytes of class name> <varint m> <m properties>
+   *   V, K                       collections, laid out like O
+   *   C <varint n> <class name> <varint m> <m bytes from serialize()>
+   *   r, R <varint id>           back references, as in serialize()
+   *
+   * The top-level value is preceded by kBinaryMarker, which serialize()
+   * output never starts with, so stored data can say which format it is
+   * in.  Objects go through __sleep()/__wakeup() and Serializable exactly
+   * as they do for serialize().  Read it back with
+   * VariableUnserializer::Type::BinarySerialize.
+   */
+  static const char kBinaryMarker = '\xb5';
+
   /**
    * Constructor and destructor.
    */
@@ -59,7 +84,9 @@ public:
   }
 
   /**
-   * Top level entry function called by f_ functions.
+   * Top level entry function called by f_ functions.  With ret false,
+   * JSON output is written to the output buffer in chunks as it is
+   * produced, so a large value is never held as one string.
    */
   String serialize(CVarRef v, bool ret);
   String serializeValue(CVarRef v, bool limit);
@@ -128,6 +155,7 @@ private:
   int m_maxCount;                // for max recursive levels
   int m_levelDebugger;           // keep track of levels for DebuggerSerialize
   int m_maxLevelDebugger;        // for max level of DebuggerSerialize
+  bool m_streaming;              // flush m_buf to output between elements
 
   struct ArrayInfo {
     bool is_object;     // nested arrays or objects
@@ -138,6 +166,8 @@ private:
   smart::vector<ArrayInfo> m_arrayInfos;
 
   void writePropertyKey(const String& prop);
+  void writeVarInt(int64_t v);
+  bool writeJsonScalarVector(const ArrayData* arr);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -16,14 +16,21 @@
 
 #include "hphp/runtime/base/variable-unserializer.h"
 #include "hphp/runtime/base/complex-types.h"
+#include "hphp/runtime/base/variable-serializer.h"
 #include "hphp/runtime/base/zend-strtod.h"
 #include "hphp/runtime/base/array-iterator.h"
 #include "hphp/runtime/ext/ext_class.h"
+#include "hphp/runtime/vm/unit.h"
+#include "hphp/util/hash.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
 Variant VariableUnserializer::unserialize() {
+  if (m_type == Type::BinarySerialize &&
+      readChar() != VariableSerializer::kBinaryMarker) {
+    throw Exception("Not in the binary serialization format");
+  }
   Variant v;
   v.unserialize(this);
   return v;
@@ -37,6 +44,22 @@ Variant VariableUnserializer::unserializeKey() {
 
 int64_t VariableUnserializer::readInt() {
   check();
+  if (m_type == Type::BinarySerialize) return readVarInt();
+  // Nearly every int here is plain decimal that fits in 18 digits; parse
+  // those inline and leave anything unusual to strtoll().
+  const char* p = m_buf;
+  bool negative = *p == '-';
+  if (negative) ++p;
+  const char* digits = p;
+  uint64_t n = 0;
+  while (p < m_end && p - digits < 18 && *p >= '0' && *p <= '9') {
+    n = n * 10 + (*p++ - '0');
+  }
+  if (p > digits && (p == m_end || *p < '0' || *p > '9')) {
+    m_buf = p;
+    return negative ? -int64_t(n) : int64_t(n);
+  }
+
   char *newBuf;
   int64_t r = strtoll(m_buf, &newBuf, 10);
   m_buf = newBuf;
@@ -45,23 +68,65 @@ int64_t VariableUnserializer::readInt() {
 
 double VariableUnserializer::readDouble() {
   check();
+  if (m_type == Type::BinarySerialize) {
+    double r;
+    if (remaining() < sizeof r) {
+      throw Exception("Unexpected end of buffer during unserialization");
+    }
+    memcpy(&r, m_buf, sizeof r);
+    m_buf += sizeof r;
+    return r;
+  }
   const char *newBuf;
   double r = zend_strtod(m_buf, &newBuf);
   m_buf = newBuf;
   return r;
 }
 
+int64_t VariableUnserializer::readVarInt() {
+  uint64_t u = 0;
+  for (int shift = 0; ; shift += 7) {
+    if (shift > 63) throw Exception("Malformed varint");
+    unsigned char b = readChar();
+    u |= uint64_t(b & 0x7f) << shift;
+    if (!(b & 0x80)) break;
+  }
+  return int64_t(u >> 1) ^ -int64_t(u & 1);
+}
+
 void VariableUnserializer::read(char *buf, uint n) {
-  check();
+  if (remaining() < n) {
+    throw Exception("Unexpected end of buffer during unserialization");
+  }
+  memcpy(buf, m_buf, n);
+  m_buf += n;
+}
 
-  /* compute copy boundaries in a more efficient manner,
-     by using min(...) operation rather than complex conditional
-     in a loop guard */
-  const size_t BUFFER_SIZE = m_end - m_buf;
-  const size_t BUFFER_LIMIT = std::min(BUFFER_SIZE, size_t(n));
+String VariableUnserializer::readInterned(int len) {
+  assert(len <= kMaxInternedSize && size_t(len) <= remaining());
+  const int kSlots = 256;
+  if (m_interned.empty()) m_interned.resize(kSlots);
+  String& slot = m_interned[hash_string_inline(m_buf, len) & (kSlots - 1)];
+  if (slot.isNull() || slot.size() != len ||
+      memcmp(slot.data(), m_buf, len)) {
+    slot = String(m_buf, len, CopyString);
+  }
+  m_buf += len;
+  return slot;
+}
 
-  memcpy(buf, m_buf, BUFFER_LIMIT);
-  m_buf += BUFFER_LIMIT;
+Class* VariableUnserializer::loadClass(String& clsName) {
+  if (m_lastClass && clsName.size() == m_lastClassName.size() &&
+      !memcmp(clsName.data(), m_lastClassName.data(), clsName.size())) {
+    clsName = m_lastClassName;
+    return m_lastClass;
+  }
+  Class* cls = Unit::loadClass(clsName.get());
+  if (cls) {
+    m_lastClassName = clsName;
+    m_lastClass = cls;
+  }
+  return cls;
 }
 
 Variant &VariableUnserializer::addVar() {
@@ -70,7 +135,8 @@ Variant &VariableUnserializer::addVar() {
 }
 
 bool VariableUnserializer::isWhitelistedClass(const String& cls_name) const {
-  if (m_type != Type::Serialize || m_classWhiteList.isNull()) {
+  if ((m_type != Type::Serialize && m_type != Type::BinarySerialize) ||
+      m_classWhiteList.isNull()) {
     return true;
   }
   if (!m_classWhiteList.isNull() && !m_classWhiteList.empty()) {
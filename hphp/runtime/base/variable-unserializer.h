@@ -19,6 +19,7 @@
 
 #include "hphp/runtime/base/types.h"
 #include "hphp/runtime/base/smart-containers.h"
+#include "hphp/runtime/base/complex-types.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -31,6 +32,7 @@ public:
   enum class Type {
     Serialize,
     APCSerialize,
+    BinarySerialize, // see VariableSerializer::Type::BinarySerialize
   };
 
 public:
@@ -44,18 +46,19 @@ public:
                        CArrRef class_whitelist = null_array)
       : m_type(type), m_buf(str), m_end(str + len),
         m_unknownSerializable(allowUnknownSerializableClass),
-        m_classWhiteList(class_whitelist) {}
+        m_classWhiteList(class_whitelist), m_lastClass(nullptr) {}
   VariableUnserializer(const char *str, const char *end, Type type,
                        bool allowUnknownSerializableClass = false,
                        CArrRef class_whitelist = null_array)
       : m_type(type), m_buf(str), m_end(end),
         m_unknownSerializable(allowUnknownSerializableClass),
-        m_classWhiteList(class_whitelist) {}
+        m_classWhiteList(class_whitelist), m_lastClass(nullptr) {}
 
   Type getType() const { return m_type;}
   bool allowUnknownSerializableClass() const { return m_unknownSerializable;}
   bool isWhitelistedClass(const String& cls_name) const;
 
+  // One top-level value; with BinarySerialize, marker included.
   Variant unserialize();
   Variant unserializeKey();
   void add(Variant* v, Uns::Mode mode) {
@@ -104,14 +107,38 @@ public:
     check();
     return *(m_buf++);
   }
+  // Consume the separator c, which the binary format leaves out.
+  void expectChar(char c) {
+    if (m_type == Type::BinarySerialize) return;
+    char ch = readChar();
+    if (ch != c) {
+      throw Exception("Expected '%c' but got '%c'", c, ch);
+    }
+  }
   void read(char *buf, uint n);
   char peek() {
     check();
     return *m_buf;
   }
   const char *head() { return m_buf; }
+  size_t remaining() const { return m_end - m_buf; }
   Variant &addVar();
 
+  /*
+   * The next len bytes as a string, shared with any identical string
+   * read earlier through this function.  Used for array keys and property
+   * names, which repeat in every element of a list of records.
+   */
+  static const int kMaxInternedSize = 64;
+  String readInterned(int len);
+
+  /*
+   * Class for an object record.  A list of objects names the same class
+   * over and over, so the last class found is remembered, and clsName is
+   * switched to the copy of the name that went with it.
+   */
+  Class* loadClass(String& clsName);
+
  private:
   struct RefInfo {
     explicit RefInfo(Variant* v) : m_data(reinterpret_cast<uintptr_t>(v)) {}
@@ -135,7 +162,11 @@ public:
   smart::list<Variant> m_vars;
   bool m_unknownSerializable;
   CArrRef m_classWhiteList;    // classes allowed to be unserialized
+  smart::vector<String> m_interned; // direct-mapped by hash; see readInterned
+  String m_lastClassName;
+  Class* m_lastClass;
 
+  int64_t readVarInt();
   void check() {
     if (m_buf >= m_end) {
       throw Exception("Unexpected end of buffer during unserialization");
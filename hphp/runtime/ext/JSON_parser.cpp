@@ -37,6 +37,10 @@ SOFTWARE.
 #include "hphp/runtime/ext/ext_json.h"
 #include "hphp/runtime/ext/ext_collections.h"
 
+#if defined(__x86_64__)
+#include <emmintrin.h>
+#endif
+
 #define MAX_LENGTH_OF_LONG 20
 static const char long_min_digits[] = "9223372036854775808";
 
@@ -390,6 +394,49 @@ static int pop(json_parser *json, int mode) {
   return true;
 }
 
+/*
+ * The number of bytes at p (up to len) that a quoted string copies to its
+ * value unchanged: printable ASCII other than '"', '\\' and, when parsing
+ * loosely, '\''.  Anything else, including all non-ASCII bytes, is left
+ * to the state machine.
+ */
+static int plain_string_run(const char* p, int len, bool loose) {
+  int i = 0;
+#if defined(__x86_64__)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i dquote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i squote = _mm_set1_epi8(loose ? '\'' : '"');
+  for (; i + 16 <= len; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(p + i));
+    // A signed compare catches both control characters and bytes >= 0x80.
+    __m128i stop = _mm_cmplt_epi8(v, space);
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, dquote));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, backslash));
+    stop = _mm_or_si128(stop, _mm_cmpeq_epi8(v, squote));
+    int mask = _mm_movemask_epi8(stop);
+    if (mask) return i + __builtin_ctz(mask);
+  }
+#endif
+  for (; i < len; ++i) {
+    unsigned char ch = p[i];
+    if (ch < ' ' || ch >= 0x80 || ch == '"' || ch == '\\' ||
+        (loose && ch == '\'')) {
+      break;
+    }
+  }
+  return i;
+}
+
+static int whitespace_run(const char* p, int len) {
+  int i = 0;
+  while (i < len &&
+         (p[i] == ' ' || p[i] == '\n' || p[i] == '\r' || p[i] == '\t')) {
+    ++i;
+  }
+  return i;
+}
+
 static int dehexchar(char c) {
   if (c >= '0' && c <= '9') return c - '0';
   if (c >= 'A' && c <= 'F') return c - ('A' - 10);
@@ -531,10 +578,13 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
   bool collections = stable_maps || (options & k_JSON_FB_COLLECTIONS);
   int qchr = 0;
   int const *byte_class;
+  const int (*transitions)[31];
   if (loose) {
     byte_class = loose_ascii_class;
+    transitions = loose_state_transition_table;
   } else {
     byte_class = ascii_class;
+    transitions = state_transition_table;
   }
   /*</fb>*/
 
@@ -550,6 +600,28 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
 
   UTF8To16Decoder decoder(p, length, loose);
   for (;;) {
+    /*
+      Fast paths for the two kinds of run the automaton would otherwise
+      step through a byte at a time without doing anything interesting:
+      plain characters inside a string, which are just appended to it,
+      and whitespace in a state that loops on whitespace.
+    */
+    if (decoder.atCharBoundary()) {
+      if (the_state == 3) {
+        if (type == KindOfString) {
+          int n = plain_string_run(decoder.cursor(), decoder.remaining(),
+                                   loose);
+          if (n) {
+            buf->append(decoder.cursor(), n);
+            decoder.skip(n);
+          }
+        }
+      } else if (transitions[the_state][S_SPA] == the_state &&
+                 transitions[the_state][S_WSP] == the_state) {
+        decoder.skip(whitespace_run(decoder.cursor(), decoder.remaining()));
+      }
+    }
+
     b = decoder.decode();
     if (b == UTF8_END) break; // UTF-8 decoding finishes successfully.
     if (b == UTF8_ERROR) {
@@ -574,11 +646,7 @@ bool JSON_parser(Variant &z, const char *p, int length, bool assoc/*<fb>*/,
     */
 
     /*<fb>*/
-    if (loose) {
-      s = loose_state_transition_table[the_state][c];
-    } else {
-      s = state_transition_table[the_state][c];
-    }
+    s = transitions[the_state][c];
 
     if (s == -4) {
       if (b != qchr) {
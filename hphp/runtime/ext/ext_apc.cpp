@@ -20,6 +20,7 @@
 #include "hphp/runtime/ext/ext_fb.h"
 #include "hphp/runtime/base/runtime-option.h"
 #include "hphp/util/async-job.h"
+#include "hphp/util/logger.h"
 #include "hphp/util/timer.h"
 #include <dlfcn.h>
 #include "hphp/runtime/base/program-functions.h"
@@ -50,15 +51,33 @@ void apcExtension::moduleLoad(Hdf config) {
   string tblType = apc["TableType"].getString("concurrent");
   if (strcasecmp(tblType.c_str(), "concurrent") == 0) {
     TableType = TableTypes::ConcurrentTable;
+  } else if (strcasecmp(tblType.c_str(), "sharded") == 0) {
+    TableType = TableTypes::ShardedTable;
   } else {
     throw InvalidArgumentException("apc table type", "Invalid table type");
   }
+  TableShardCount = apc["TableShardCount"].getInt32(16);
+  if (TableShardCount <= 0) TableShardCount = 1;
   EnableApcSerialize = apc["EnableApcSerialize"].getBool(true);
+  EnableBinarySerialize = apc["EnableBinarySerialize"].getBool(false);
   ExpireOnSets = apc["ExpireOnSets"].getBool();
   PurgeFrequency = apc["PurgeFrequency"].getInt32(4096);
   PurgeRate = apc["PurgeRate"].getInt32(-1);
+  MemoryLimit = apc["MemoryLimit"].getInt64(0);
+  string evictPolicy = apc["EvictionPolicy"].getString("lru");
+  if (strcasecmp(evictPolicy.c_str(), "lru") == 0) {
+    EvictionPolicy = EvictionPolicies::LRU;
+  } else if (strcasecmp(evictPolicy.c_str(), "tinylfu") == 0) {
+    EvictionPolicy = EvictionPolicies::TinyLFU;
+  } else {
+    throw InvalidArgumentException("apc eviction policy",
+                                   "Invalid eviction policy");
+  }
 
   AllowObj = apc["AllowObject"].getBool();
+  SharedVariant::BorrowOnFetch = apc["BorrowOnFetch"].getBool(false);
+  SharedVariant::FlatArrayThreshold =
+    apc["FlatArrayThreshold"].getUInt32(0);
   TTLLimit = apc["TTLLimit"].getInt32(-1);
 
   Hdf fileStorage = apc["FileStorage"];
@@ -76,6 +95,11 @@ void apcExtension::moduleLoad(Hdf config) {
   KeyFrequencyUpdatePeriod = apc["KeyFrequencyUpdatePeriod"].getInt32(1000);
 
   apc["NoTTLPrefix"].get(NoTTLPrefix);
+
+  Hdf snapshot = apc["Snapshot"];
+  SnapshotFile = snapshot["File"].getString();
+  SnapshotLoadOnStartup = snapshot["LoadOnStartup"].getBool();
+  SnapshotSaveOnShutdown = snapshot["SaveOnShutdown"].getBool();
 }
 
 void apcExtension::moduleInit() {
@@ -106,13 +130,18 @@ int apcExtension::LoadThread = 1;
 std::set<std::string> apcExtension::CompletionKeys;
 apcExtension::TableTypes apcExtension::TableType =
   TableTypes::ConcurrentTable;
+int apcExtension::TableShardCount = 16;
 bool apcExtension::EnableApcSerialize = true;
+bool apcExtension::EnableBinarySerialize = false;
 time_t apcExtension::KeyMaturityThreshold = 20;
 size_t apcExtension::MaximumCapacity = 0;
 int apcExtension::KeyFrequencyUpdatePeriod = 1000;
 bool apcExtension::ExpireOnSets = false;
 int apcExtension::PurgeFrequency = 4096;
 int apcExtension::PurgeRate = -1;
+int64_t apcExtension::MemoryLimit = 0;
+apcExtension::EvictionPolicies apcExtension::EvictionPolicy =
+  EvictionPolicies::LRU;
 bool apcExtension::AllowObj = false;
 int apcExtension::TTLLimit = -1;
 bool apcExtension::UseFileStorage = false;
@@ -124,6 +153,9 @@ std::string apcExtension::FileStorageFlagKey;
 bool apcExtension::ConcurrentTableLockFree = false;
 bool apcExtension::FileStorageKeepFileLinked = false;
 std::vector<std::string> apcExtension::NoTTLPrefix;
+std::string apcExtension::SnapshotFile;
+bool apcExtension::SnapshotLoadOnStartup = false;
+bool apcExtension::SnapshotSaveOnShutdown = false;
 
 static apcExtension s_apc_extension;
 
@@ -1202,6 +1234,7 @@ int apc_rfc1867_progress(apc_rfc1867_data *rfc1867ApcData,
 // apc serialization
 
 String apc_serialize(CVarRef value) {
+  if (apcExtension::EnableBinarySerialize) return binary_serialize(value);
   VariableSerializer::Type sType =
     apcExtension::EnableApcSerialize ?
       VariableSerializer::Type::APCSerialize :
@@ -1210,12 +1243,19 @@ String apc_serialize(CVarRef value) {
   return vs.serialize(value, true);
 }
 
+VariableUnserializer::Type apc_unserialize_type(const char* data, int len) {
+  // Binary data is recognized by its marker regardless of the current
+  // setting, so entries primed or snapshotted in either format still load.
+  if (is_binary_serialized(data, len)) {
+    return VariableUnserializer::Type::BinarySerialize;
+  }
+  return apcExtension::EnableApcSerialize ?
+    VariableUnserializer::Type::APCSerialize :
+    VariableUnserializer::Type::Serialize;
+}
+
 Variant apc_unserialize(const char* data, int len) {
-  VariableUnserializer::Type sType =
-    apcExtension::EnableApcSerialize ?
-      VariableUnserializer::Type::APCSerialize :
-      VariableUnserializer::Type::Serialize;
-  return unserialize_ex(data, len, sType);
+  return unserialize_ex(data, len, apc_unserialize_type(data, len));
 }
 
 void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
@@ -1361,7 +1401,8 @@ void reserialize(VariableUnserializer *uns, StringBuffer &buf) {
 
 String apc_reserialize(const String& str) {
   if (str.empty() ||
-      !apcExtension::EnableApcSerialize) return str;
+      !apcExtension::EnableApcSerialize ||
+      is_binary_serialized(str.data(), str.size())) return str;
 
   VariableUnserializer uns(str.data(), str.size(),
                            VariableUnserializer::Type::APCSerialize);
@@ -1385,5 +1426,41 @@ bool apc_dump(const char *filename, bool keyOnly, int waitSeconds) {
   return true;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// snapshots
+
+static ApcSnapshotInfo s_snapshot_load_info;
+
+void apc_load_snapshot(int threads) {
+  if (!apcExtension::Enable || !apcExtension::SnapshotLoadOnStartup ||
+      apcExtension::SnapshotFile.empty()) {
+    return;
+  }
+  ApcSnapshotInfo info;
+  if (s_apc_store[0].loadSnapshot(apcExtension::SnapshotFile, threads,
+                                  info)) {
+    Logger::Info("Loaded %" PRId64 " APC entries (%" PRId64 " skipped) "
+                 "from snapshot %s in %" PRId64 " ms",
+                 info.entries, info.skipped,
+                 apcExtension::SnapshotFile.c_str(), info.usec / 1000);
+    s_snapshot_load_info = info;
+  }
+}
+
+bool apc_save_snapshot(const std::string& path, int waitSeconds,
+                       ApcSnapshotInfo& info) {
+  if (!apcExtension::Enable || path.empty()) return false;
+  if (!s_apc_store[0].saveSnapshot(path, waitSeconds, info)) return false;
+  Logger::Info("Saved %" PRId64 " APC entries (%" PRId64 " skipped, "
+               "%" PRId64 " bytes) to snapshot %s in %" PRId64 " ms",
+               info.entries, info.skipped, info.bytes, path.c_str(),
+               info.usec / 1000);
+  return true;
+}
+
+const ApcSnapshotInfo& apc_snapshot_load_info() {
+  return s_snapshot_load_info;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 }
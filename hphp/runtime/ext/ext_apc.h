@@ -36,16 +36,25 @@ class apcExtension : public Extension {
   static int LoadThread;
   static std::set<std::string> CompletionKeys;
   enum class TableTypes {
-    ConcurrentTable
+    ConcurrentTable,
+    ShardedTable
   };
   static TableTypes TableType;
+  static int TableShardCount;
   static bool EnableApcSerialize;
+  static bool EnableBinarySerialize;
   static time_t KeyMaturityThreshold;
   static size_t MaximumCapacity;
   static int KeyFrequencyUpdatePeriod;
   static bool ExpireOnSets;
   static int PurgeFrequency;
   static int PurgeRate;
+  enum class EvictionPolicies {
+    LRU,
+    TinyLFU
+  };
+  static int64_t MemoryLimit;
+  static EvictionPolicies EvictionPolicy;
   static bool AllowObj;
   static int TTLLimit;
   static bool UseFileStorage;
@@ -57,6 +66,9 @@ class apcExtension : public Extension {
   static bool ConcurrentTableLockFree;
   static bool FileStorageKeepFileLinked;
   static std::vector<std::string> NoTTLPrefix;
+  static std::string SnapshotFile;
+  static bool SnapshotLoadOnStartup;
+  static bool SnapshotSaveOnShutdown;
 
   virtual void moduleLoad(Hdf config);
   virtual void moduleInit();
@@ -165,6 +177,7 @@ static_assert(sizeof(int64_t) == sizeof(long long),
 // apc serialization
 
 String apc_serialize(CVarRef value);
+VariableUnserializer::Type apc_unserialize_type(const char* data, int len);
 Variant apc_unserialize(const char* data, int len);
 String apc_reserialize(const String& str);
 
@@ -172,6 +185,21 @@ String apc_reserialize(const String& str);
 // debugging support
 
 bool apc_dump(const char *filename, bool keyOnly, int waitSeconds);
+
+///////////////////////////////////////////////////////////////////////////////
+// snapshots
+
+typedef ConcurrentTableSharedStore::SnapshotInfo ApcSnapshotInfo;
+
+/*
+ * Load Snapshot.File into the application cache, if Snapshot.LoadOnStartup
+ * is set. Called after the prime library has been loaded.
+ */
+void apc_load_snapshot(int threads);
+bool apc_save_snapshot(const std::string& path, int waitSeconds,
+                       ApcSnapshotInfo& info);
+// What apc_load_snapshot did; all zeroes if it didn't load anything.
+const ApcSnapshotInfo& apc_snapshot_load_info();
 size_t get_const_map_size();
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -16,6 +16,7 @@
 */
 
 #include "hphp/runtime/ext/ext_collections.h"
+#include "hphp/runtime/base/hphp-array.h"
 #include "hphp/runtime/base/variable-serializer.h"
 #include "hphp/runtime/base/sort-helpers.h"
 #include "hphp/runtime/ext/ext_array.h"
@@ -165,12 +166,8 @@ void c_Vector::reserve(int64_t sz) {
 }
 
 Array c_Vector::toArrayImpl() const {
-  PackedArrayInit ai(m_size);
-  uint sz = m_size;
-  for (uint i = 0; i < sz; ++i) {
-    ai.append(tvAsCVarRef(&m_data[i]));
-  }
-  return ai.toArray();
+  if (!m_size) return Array::Create();
+  return Array::attach(HphpArray::MakePackedCopy(m_size, m_data));
 }
 
 c_Vector* c_Vector::Clone(ObjectData* obj) {
@@ -187,6 +184,17 @@ c_Vector* c_Vector::Clone(ObjectData* obj) {
 }
 
 void c_Vector::init(CVarRef t) {
+  if (t.isArray() && t.getArrayData()->isPacked()) {
+    // Packed arrays hold their values in order; copy them in one pass.
+    ArrayData* ad = t.getArrayData();
+    uint sz = ad->size();
+    if (!sz) return;
+    ++m_version;
+    reserve(m_size + sz);
+    HphpArray::CopyPackedCells(ad, m_data + m_size);
+    m_size += sz;
+    return;
+  }
   size_t sz;
   ArrayIter iter = getArrayIterHelper(t, sz);
   if (sz) {
@@ -687,6 +695,10 @@ Object c_Vector::ti_fromarray(CVarRef arr) {
   target->m_capacity = target->m_size = sz;
   TypedValue* data;
   target->m_data = data = (TypedValue*)smart_malloc(sz * sizeof(TypedValue));
+  if (ad->isPacked()) {
+    HphpArray::CopyPackedCells(ad, data);
+    return ret;
+  }
   ssize_t pos = ad->iter_begin();
   for (uint i = 0; i < sz; ++i, pos = ad->iter_advance(pos)) {
     assert(pos != ArrayData::invalid_index);
@@ -4668,6 +4680,7 @@ void collectionSerialize(ObjectData* obj, VariableSerializer* serializer) {
     if (serializer->getType() == VariableSerializer::Type::Serialize ||
         serializer->getType() == VariableSerializer::Type::APCSerialize ||
         serializer->getType() == VariableSerializer::Type::DebuggerSerialize ||
+        serializer->getType() == VariableSerializer::Type::BinarySerialize ||
         serializer->getType() == VariableSerializer::Type::VarExport ||
         serializer->getType() == VariableSerializer::Type::PHPOutput) {
       // For the 'V' serialization format, we don't print out keys
@@ -689,6 +689,18 @@ Variant f_fb_compact_unserialize(CVarRef thing, VRefParam success,
 
 ///////////////////////////////////////////////////////////////////////////////
 
+String f_fb_binary_serialize(CVarRef thing) {
+  return binary_serialize(thing);
+}
+
+Variant f_fb_binary_unserialize(const String& thing,
+                                CArrRef class_whitelist /* = empty_array */) {
+  return unserialize_ex(thing, VariableUnserializer::Type::BinarySerialize,
+                        class_whitelist);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 const StaticString
   s_affected("affected"),
   s_result("result"),
@@ -28,6 +28,9 @@ Variant f_fb_unserialize(CVarRef thing, VRefParam success);
 Variant f_fb_compact_serialize(CVarRef thing);
 Variant f_fb_compact_unserialize(CVarRef thing, VRefParam success,
                                  VRefParam errcode = null_variant);
+String f_fb_binary_serialize(CVarRef thing);
+Variant f_fb_binary_unserialize(const String& thing,
+                                CArrRef class_whitelist = empty_array);
 bool f_fb_could_include(const String& file);
 bool f_fb_intercept(const String& name, CVarRef handler,
                     CVarRef data = null_variant);
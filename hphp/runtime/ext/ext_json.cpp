@@ -61,16 +61,26 @@ String f_json_last_error_msg() {
   return json_get_last_error_msg();
 }
 
-String f_json_encode(CVarRef value, CVarRef options /* = 0 */) {
+static int64_t json_encode_options(CVarRef options) {
   int64_t json_options = options.toInt64();
   if (options.isBoolean() && options.toBooleanVal()) {
     json_options = k_JSON_FB_LOOSE;
   }
+  return json_options;
+}
 
+String f_json_encode(CVarRef value, CVarRef options /* = 0 */) {
+  int64_t json_options = json_encode_options(options);
   VariableSerializer vs(VariableSerializer::Type::JSON, json_options);
   return vs.serializeValue(value, !(json_options & k_JSON_FB_UNLIMITED));
 }
 
+void f_json_encode_output(CVarRef value, CVarRef options /* = 0 */) {
+  VariableSerializer vs(VariableSerializer::Type::JSON,
+                        json_encode_options(options));
+  vs.serialize(value, false);
+}
+
 Variant f_json_decode(const String& json, bool assoc /* = false */,
                       CVarRef options /* = 0 */) {
 
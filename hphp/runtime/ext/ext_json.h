@@ -26,6 +26,7 @@ namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
 String f_json_encode(CVarRef value, CVarRef options = 0);
+void f_json_encode_output(CVarRef value, CVarRef options = 0);
 Variant f_json_decode(const String& json, bool assoc = false,
                       CVarRef options = 0);
 int f_json_last_error();
@@ -40,6 +40,7 @@ IMPLEMENT_THREAD_LOCAL(c_Memcached::ImplMap, c_Memcached::s_persistentMap);
 #define MEMC_VAL_IS_SERIALIZED 4
 #define MEMC_VAL_IS_IGBINARY   5
 #define MEMC_VAL_IS_JSON       6
+#define MEMC_VAL_IS_HHVM_BINARY 8
 
 #define MEMC_VAL_COMPRESSED    (1<<4)
 
@@ -161,6 +162,7 @@ const int64_t q_Memcached$$RES_PAYLOAD_FAILURE = -1001;
 const int64_t q_Memcached$$SERIALIZER_PHP      = 1;
 const int64_t q_Memcached$$SERIALIZER_IGBINARY = 2;
 const int64_t q_Memcached$$SERIALIZER_JSON     = 3;
+const int64_t q_Memcached$$SERIALIZER_HHVM_BINARY = 6;
 
 // Flags
 const int64_t q_Memcached$$GET_PRESERVE_ORDER = 1;
@@ -862,6 +864,7 @@ bool c_Memcached::t_setoption(int option, CVarRef value) {
       switch (iValue) {
       case q_Memcached$$SERIALIZER_PHP:
       case q_Memcached$$SERIALIZER_JSON:
+      case q_Memcached$$SERIALIZER_HHVM_BINARY:
         m_impl->serializer = iValue;
         break;
       default:
@@ -933,6 +936,10 @@ void c_Memcached::toPayload(CVarRef value, vector<char> &payload,
       encoded = f_json_encode(value);
       flags = MEMC_VAL_IS_JSON;
       break;
+    case q_Memcached$$SERIALIZER_HHVM_BINARY:
+      encoded = binary_serialize(value);
+      flags = MEMC_VAL_IS_HHVM_BINARY;
+      break;
     default:
       encoded = f_serialize(value);
       flags = MEMC_VAL_IS_SERIALIZED;
@@ -1003,6 +1010,10 @@ bool c_Memcached::toObject(Variant& value, const memcached_result_st &result) {
   case MEMC_VAL_IS_SERIALIZED:
     value = unserialize_from_string(decompPayload);
     break;
+  case MEMC_VAL_IS_HHVM_BINARY:
+    value = unserialize_ex(decompPayload,
+                           VariableUnserializer::Type::BinarySerialize);
+    break;
   case MEMC_VAL_IS_IGBINARY:
     raise_warning("could not unserialize value, no igbinary support");
     return false;
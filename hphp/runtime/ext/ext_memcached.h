@@ -29,6 +29,7 @@ extern const int64_t q_Memcached$$OPT_SERIALIZER;
 extern const int64_t q_Memcached$$SERIALIZER_PHP;
 extern const int64_t q_Memcached$$SERIALIZER_IGBINARY;
 extern const int64_t q_Memcached$$SERIALIZER_JSON;
+extern const int64_t q_Memcached$$SERIALIZER_HHVM_BINARY;
 extern const int64_t q_Memcached$$OPT_PREFIX_KEY;
 extern const int64_t q_Memcached$$OPT_HASH;
 extern const int64_t q_Memcached$$HASH_DEFAULT;
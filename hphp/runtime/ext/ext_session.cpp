@@ -1105,6 +1105,49 @@ public:
 };
 static PhpSessionSerializer s_php_session_serializer;
 
+/**
+ * The whole session as one array in VariableSerializer's binary format, so
+ * references between session variables survive a round trip.
+ */
+class HhvmBinarySessionSerializer : public SessionSerializer {
+public:
+  HhvmBinarySessionSerializer() : SessionSerializer("hhvm_binary") {}
+
+  virtual String encode() {
+    Array vars = Array::Create();
+    GlobalVariables *g = get_global_variables();
+    for (ArrayIter iter(g->get(s__SESSION).toArray()); iter; ++iter) {
+      Variant key = iter.first();
+      if (key.isString()) {
+        vars.setWithRef(key, iter.secondRef());
+      } else {
+        raise_notice("Skipping numeric key %" PRId64, key.toInt64());
+      }
+    }
+    return binary_serialize(vars);
+  }
+
+  virtual bool decode(const String& value) {
+    if (value.empty()) return true;
+    VariableUnserializer vu(value.data(), value.size(),
+                            VariableUnserializer::Type::BinarySerialize);
+    Variant vars;
+    try {
+      vars = vu.unserialize();
+    } catch (Exception &e) {
+      return false;
+    }
+    if (!vars.isArray()) return false;
+    GlobalVariables *g = get_global_variables();
+    Variant &session = g->getRef(s__SESSION);
+    for (ArrayIter iter(vars.toArray()); iter; ++iter) {
+      session.lvalAt(iter.first()).setWithRef(iter.secondRef());
+    }
+    return true;
+  }
+};
+static HhvmBinarySessionSerializer s_hhvm_binary_session_serializer;
+
 ///////////////////////////////////////////////////////////////////////////////
 
 #define SESSION_CHECK_ACTIVE_STATE                                      \
@@ -17,6 +17,7 @@
 #include "hphp/runtime/base/datetime.h"
 #include "hphp/runtime/base/timestamp.h"
 #include <time.h>
+#include <sys/uio.h>
 #include "hphp/runtime/base/runtime-option.h"
 #include "hphp/runtime/server/server-note.h"
 #include "hphp/runtime/server/server-stats.h"
@@ -28,6 +29,8 @@
 #include "hphp/util/util.h"
 #include "hphp/runtime/base/hardware-counter.h"
 
+#include "folly/String.h"
+
 using std::endl;
 
 namespace HPHP {
@@ -35,6 +38,7 @@ namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
 AccessLog::~AccessLog() {
+  stopWriter();
   signal(SIGCHLD, SIG_DFL);
   for (uint i = 0; i < m_output.size(); ++i) {
     if (m_output[i].log) {
@@ -56,6 +60,7 @@ void AccessLog::init(const string &defaultFormat,
   m_defaultFormat = defaultFormat;
   m_files = files;
   openFiles(username);
+  startWriter();
 }
 
 void AccessLog::init(const string &format,
@@ -70,6 +75,7 @@ void AccessLog::init(const string &format,
     m_files.push_back(AccessLogFileData(file, symLink, format));
   }
   openFiles(username);
+  startWriter();
 }
 
 void AccessLog::openFiles(const string &username) {
@@ -117,31 +123,152 @@ void AccessLog::log(Transport *transport, const VirtualHost *vhost) {
     int bytes = writeLog(transport, vhost, threadLog, m_defaultFormat.c_str());
     threadData->flusher.recordWriteAndMaybeDropCaches(threadLog, bytes);
   }
+
+  if (m_queue) {
+    // Format here, where the transport is still live, and leave the
+    // I/O and any log rotation to the writer thread.
+    Record *rec = new Record;
+    rec->lines.reserve(m_files.size());
+    for (uint i = 0; i < m_files.size(); ++i) {
+      rec->lines.push_back(
+        formatLog(transport, vhost, m_files[i].format.c_str()));
+    }
+    if (!m_queue->write(rec)) {
+      delete rec;
+      ++m_dropped;
+    }
+    return;
+  }
+
+  for (uint i = 0; i < m_files.size(); ++i) {
+    FILE *outFile = getOutputFile(i);
+    if (!outFile) continue;
+    const char *format = m_files[i].format.c_str();
+    int bytes = writeLog(transport, vhost, outFile, format);
+    recordWrite(i, outFile, bytes);
+  }
+}
+
+FILE *AccessLog::getOutputFile(uint i) {
+  if (Logger::UseCronolog) {
+    return m_cronOutput[i]->getOutputFile();
+  }
+  return m_output[i].log;
+}
+
+void AccessLog::recordWrite(uint i, FILE *outFile, int bytes) {
   if (Logger::UseCronolog) {
-    for (uint i = 0; i < m_cronOutput.size(); ++i) {
-      Cronolog &cronOutput = *m_cronOutput[i];
-      FILE *outFile = cronOutput.getOutputFile();
-      if (!outFile) continue;
-      const char *format = m_files[i].format.c_str();
-      int bytes = writeLog(transport, vhost, outFile, format);
-      cronOutput.flusher.recordWriteAndMaybeDropCaches(outFile, bytes);
+    m_cronOutput[i]->flusher.recordWriteAndMaybeDropCaches(outFile, bytes);
+  } else if (m_files[i].file[0] != '|') {
+    m_output[i].flusher.recordWriteAndMaybeDropCaches(outFile, bytes);
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// async writer
+
+static const size_t kMaxWriteBatch = 256;
+
+static bool writevFully(int fd, struct iovec *iov, int cnt) {
+  while (cnt > 0) {
+    ssize_t n = writev(fd, iov, cnt);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return false;
     }
-  } else {
-    for (uint i = 0; i < m_output.size(); ++i) {
-      LogFileData& output = m_output[i];
-      FILE *outFile = output.log;
-      if (!outFile) continue;
-      const char *format = m_files[i].format.c_str();
-      int bytes = writeLog(transport, vhost, outFile, format);
-      if (m_files[i].file[0] != '|') {
-        output.flusher.recordWriteAndMaybeDropCaches(outFile, bytes);
-      }
+    while (cnt > 0 && size_t(n) >= iov->iov_len) {
+      n -= iov->iov_len;
+      ++iov;
+      --cnt;
+    }
+    if (cnt > 0) {
+      iov->iov_base = (char*)iov->iov_base + n;
+      iov->iov_len -= n;
     }
   }
+  return true;
+}
+
+void AccessLog::startWriter() {
+  if (RuntimeOption::AccessLogQueueSize <= 0 || m_files.empty()) return;
+  assert(!m_writer);
+  m_queue.reset(new RecordQueue(RuntimeOption::AccessLogQueueSize));
+  m_writer.reset(new AsyncFunc<AccessLog>(this, &AccessLog::writerThread));
+  m_writer->start();
+}
+
+void AccessLog::stopWriter() {
+  if (!m_writer) return;
+  // A null record tells the writer to flush what it has and exit.
+  m_queue->blockingWrite(nullptr);
+  m_writer->waitForEnd();
+  m_writer.reset();
+  m_queue.reset();
+}
+
+int64_t AccessLog::queueDepth() const {
+  if (!m_queue) return 0;
+  ssize_t size = m_queue->sizeGuess();
+  return size > 0 ? size : 0;
+}
+
+void AccessLog::writerThread() {
+  std::vector<Record*> batch;
+  batch.reserve(kMaxWriteBatch);
+  bool done = false;
+  while (!done) {
+    Record *rec;
+    m_queue->blockingRead(rec);
+    while (rec) {
+      batch.push_back(rec);
+      if (batch.size() == kMaxWriteBatch || !m_queue->read(rec)) break;
+    }
+    done = !rec;
+    writeBatch(batch);
+  }
 }
 
+void AccessLog::writeBatch(std::vector<Record*> &batch) {
+  if (batch.empty()) return;
+  struct iovec iov[kMaxWriteBatch];
+  for (uint i = 0; i < m_files.size(); ++i) {
+    // Cronolog rotates inside getOutputFile(), so this is the only
+    // thread that ever opens or switches access log files.
+    FILE *outFile = getOutputFile(i);
+    if (!outFile) continue;
+    int bytes = 0;
+    for (size_t j = 0; j < batch.size(); ++j) {
+      const std::string &line = batch[j]->lines[i];
+      iov[j].iov_base = (void*)line.data();
+      iov[j].iov_len = line.size();
+      bytes += line.size();
+    }
+    if (!writevFully(fileno(outFile), iov, batch.size())) {
+      Logger::Error("Failed to write access log file %s: %s",
+                    m_files[i].file.c_str(),
+                    folly::errnoStr(errno).c_str());
+      continue;
+    }
+    recordWrite(i, outFile, bytes);
+  }
+  for (size_t j = 0; j < batch.size(); ++j) {
+    delete batch[j];
+  }
+  batch.clear();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
 int AccessLog::writeLog(Transport *transport, const VirtualHost *vhost,
                         FILE *outFile, const char *format) {
+  string output = formatLog(transport, vhost, format);
+  int nbytes = fprintf(outFile, "%s", output.c_str());
+  fflush(outFile);
+  return nbytes;
+}
+
+string AccessLog::formatLog(Transport *transport, const VirtualHost *vhost,
+                            const char *format) {
    char c;
    std::ostringstream out;
    while ((c = *format++)) {
@@ -161,10 +288,7 @@ int AccessLog::writeLog(Transport *transport, const VirtualHost *vhost,
      }
    }
    out << endl;
-   string output = out.str();
-   int nbytes = fprintf(outFile, "%s", output.c_str());
-   fflush(outFile);
-   return nbytes;
+   return out.str();
 }
 
 bool AccessLog::parseConditions(const char* &format, int code) {
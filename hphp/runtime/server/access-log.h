@@ -22,6 +22,9 @@
 #include "hphp/util/lock.h"
 #include "hphp/util/cronolog.h"
 #include "hphp/util/util.h"
+#include "hphp/util/async-func.h"
+
+#include "folly/MPMCQueue.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -63,7 +66,7 @@ public:
   };
   typedef ThreadData* (*GetThreadDataFunc)();
   explicit AccessLog(GetThreadDataFunc f) :
-      m_initialized(false), m_fGetThreadData(f) {}
+      m_initialized(false), m_fGetThreadData(f), m_dropped(0) {}
   ~AccessLog();
   void init(const std::string &defaultFormat,
             std::vector<AccessLogFileData> &files,
@@ -76,15 +79,46 @@ public:
   void onNewRequest();
   std::string &defaultFormat() { return m_defaultFormat; }
   std::vector<AccessLogFileData> &files() { return m_files; }
+
+  /*
+   * Counters for the async writer (Log.AccessLogQueueSize > 0): records
+   * waiting for the writer thread, and records dropped because the
+   * queue was full.  Both are zero in synchronous mode.
+   */
+  int64_t queueDepth() const;
+  int64_t droppedRecords() const { return m_dropped.load(); }
+
+  /*
+   * Write out everything still queued and stop the writer thread.  Any
+   * later log() calls write inline.  Call only once nothing else is
+   * logging, e.g. after the servers have stopped.
+   */
+  void stopWriter();
+
 private:
+  /*
+   * One formatted line per output file, in m_files order.
+   */
+  struct Record {
+    std::vector<std::string> lines;
+  };
+  typedef folly::MPMCQueue<Record*> RecordQueue;
+
   bool parseConditions(const char* &format, int code);
   std::string parseArgument(const char* &format);
   bool genField(std::ostringstream &out, const char* &format,
                 Transport *transport, const VirtualHost *vhost,
                 const std::string &arg);
   void skipField(const char* &format);
+  std::string formatLog(Transport *transport, const VirtualHost *vhost,
+                        const char *format);
   int writeLog(Transport *transport, const VirtualHost *vhost,
                FILE *outFile, const char *format);
+  FILE *getOutputFile(uint i);
+  void recordWrite(uint i, FILE *outFile, int bytes);
+  void startWriter();
+  void writerThread();
+  void writeBatch(std::vector<Record*> &batch);
 
   std::vector<LogFileData> m_output;
   std::vector<CronologPtr> m_cronOutput;
@@ -95,6 +129,10 @@ private:
 
   void openFiles(const std::string &username);
   Mutex m_lock;
+
+  std::unique_ptr<RecordQueue> m_queue;
+  std::unique_ptr<AsyncFunc<AccessLog>> m_writer;
+  std::atomic<int64_t> m_dropped;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
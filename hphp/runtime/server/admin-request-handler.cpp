@@ -16,8 +16,10 @@
 
 #include "hphp/runtime/server/admin-request-handler.h"
 #include "hphp/runtime/base/file-repository.h"
+#include "hphp/runtime/server/http-request-handler.h"
 #include "hphp/runtime/server/http-server.h"
 #include "hphp/runtime/server/pagelet-server.h"
+#include "hphp/runtime/server/repo-preload.h"
 #include "hphp/runtime/base/http-client.h"
 #include "hphp/runtime/server/server-stats.h"
 #include "hphp/runtime/base/runtime-option.h"
@@ -34,6 +36,8 @@
 #include "hphp/runtime/base/shared-store-stats.h"
 #include "hphp/runtime/vm/repo.h"
 #include "hphp/runtime/vm/jit/translator.h"
+#include "hphp/runtime/vm/jit/prof-data.h"
+#include "hphp/runtime/vm/jit/target-cache.h"
 #include "hphp/util/alloc.h"
 #include "hphp/util/timer.h"
 #include "hphp/util/repo-schema.h"
@@ -176,6 +180,7 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
 
         "/apc-ss:          get apc size stats\n"
         "/apc-ss-flat:     get apc size stats in flat format\n"
+        "/apc-ss-shards:   get per-shard stats of the sharded apc table\n"
         "/apc-ss-keys:     get apc size break-down on keys\n"
         "/apc-ss-dump:     dump the size info on each key to /tmp/APC_details\n"
         "                  only valid when EnableAPCSizeDetail is true\n"
@@ -184,11 +189,17 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
         "/const-ss:        get const_map_size\n"
         "/static-strings:  get number of static strings\n"
         "/dump-apc:        dump all current value in APC to /tmp/apc_dump\n"
+        "/dump-apc-evict:  get APC memory usage against APC MemoryLimit and\n"
+        "                  eviction counters\n"
+        "/save-apc-snapshot: write the APC snapshot file\n"
+        "    file          optional, instead of APC Snapshot.File\n"
+        "    waitseconds   as for /dump-apc\n"
         "/dump-const:      dump all constant value in constant map to\n"
         "                  /tmp/const_map_dump\n"
         "/dump-file-repo:  dump file repository to /tmp/file_repo_dump\n"
 
         "/pcre-cache-size: get pcre cache map size\n"
+        "/pcre-cache-stats: get pcre cache hit/miss/eviction/compile stats\n"
 
 #ifdef GOOGLE_CPU_PROFILER
         "/prof-cpu-on:     turn on CPU profiler\n"
@@ -201,7 +212,13 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
         "/vm-dump-tc:      dump translation cache to /tmp/tc_dump_a and\n"
         "                  /tmp/tc_dump_astub\n"
         "/vm-tcreset:      throw away translations and start over\n"
+        "/vm-dump-jit-profile: save the regions JitPGO has chosen so far to\n"
+        "                  Eval.JitPGOProfileFile, for a restarted server\n"
+        "    file          optional, write to this file instead\n"
         "/vm-namedentities:show size of the NamedEntityTable\n"
+        "/vm-pic-stats:    show the busiest method call sites and how often\n"
+        "                  their inline caches hit; needs Eval.JitPICStats\n"
+        "    limit         optional, number of call sites, default 50\n"
         ;
 #ifdef USE_TCMALLOC
         if (MallocExtensionInstance) {
@@ -335,6 +352,13 @@ void AdminRequestHandler::handleRequest(Transport *transport) {
       break;
     }
 
+    if (cmd == "pcre-cache-stats") {
+      std::ostringstream stats;
+      preg_pcre_cache_stats(stats);
+      transport->sendString(stats.str());
+      break;
+    }
+
 #ifdef USE_TCMALLOC
     if (MallocExtensionInstance) {
       if (cmd == "free-mem") {
@@ -587,6 +611,20 @@ bool AdminRequestHandler::handleCheckRequest(const std::string &cmd,
     appendStat("targetcache", tx->getTargetCacheSize());
     appendStat("units", Eval::FileRepository::getLoadedFiles());
     appendStat("Funcs", Func::nextFuncId());
+    AccessLog& accessLog = HttpRequestHandler::GetAccessLog();
+    appendStat("accesslog-queued", accessLog.queueDepth());
+    appendStat("accesslog-dropped", accessLog.droppedRecords());
+    const ApcSnapshotInfo& snapshot = apc_snapshot_load_info();
+    appendStat("apc-snapshot-loaded", snapshot.entries);
+    appendStat("apc-snapshot-load-ms", snapshot.usec / 1000);
+    if (RuntimeOption::RepoPreload) {
+      RepoPreloadProgress preload = repoPreloadProgress();
+      appendStat("repo-preload-total", preload.total);
+      appendStat("repo-preload-loaded", preload.loaded);
+      appendStat("repo-preload-failed", preload.failed);
+      appendStat("repo-preload-done", preload.done);
+      appendStat("repo-preload-ms", preload.usec / 1000);
+    }
     out << "}" << endl;
     transport->sendString(out.str());
     return true;
@@ -806,6 +844,11 @@ bool AdminRequestHandler::handleAPCSizeRequest (const std::string &cmd,
     transport->sendString(result);
     return true;
   }
+  if (cmd == "apc-ss-shards") {
+    std::string result = SharedStoreStats::report_shards();
+    transport->sendString(result);
+    return true;
+  }
   if (cmd == "apc-ss-keys") {
     if (!RuntimeOption::EnableAPCSizeGroup) {
       transport->sendString("Not Enabled\n");
@@ -870,6 +913,16 @@ bool AdminRequestHandler::handleVMRequest(const std::string &cmd,
     transport->sendString(Transl::Translator::Get()->getUsage());
     return true;
   }
+  if (cmd == "vm-pic-stats") {
+    if (!RuntimeOption::EvalJitPICStats) {
+      transport->sendString("Eval.JitPICStats is off\n");
+      return true;
+    }
+    int limit = transport->getIntParam("limit");
+    transport->sendString(
+      Transl::TargetCache::MethodPIC::dumpProfiles(limit > 0 ? limit : 50));
+    return true;
+  }
   if (cmd == "vm-namedentities") {
     std::ostringstream result;
     result << Unit::GetNamedEntityTableSize();
@@ -884,6 +937,21 @@ bool AdminRequestHandler::handleVMRequest(const std::string &cmd,
     }
     return true;
   }
+  if (cmd == "vm-dump-jit-profile") {
+    auto profData = Transl::Translator::Get()->profData();
+    string file = transport->getParam("file");
+    if (file.empty()) file = RuntimeOption::EvalJitPGOProfileFile;
+    if (!profData) {
+      transport->sendString("JitPGO is off\n");
+    } else if (file.empty()) {
+      transport->sendString("No file given\n");
+    } else if (profData->write(file)) {
+      transport->sendString("Done\n");
+    } else {
+      transport->sendString("Error writing " + file + "\n");
+    }
+    return true;
+  }
   if (cmd == "vm-tcreset") {
     int64_t start = Timer::GetCurrentTimeMicros();
     if (Transl::Translator::Get()->replace()) {
@@ -937,6 +1005,44 @@ bool AdminRequestHandler::handleDumpCacheRequest(const std::string &cmd,
     transport->sendString("Done");
     return true;
   }
+  if (cmd == "save-apc-snapshot") {
+    if (!apcExtension::Enable) {
+      transport->sendString("No APC\n");
+      return true;
+    }
+    string file = transport->getParam("file");
+    if (file.empty()) file = apcExtension::SnapshotFile;
+    if (file.empty()) {
+      transport->sendString("No snapshot file\n");
+      return true;
+    }
+    int waitSeconds = transport->getIntParam("waitseconds");
+    if (!waitSeconds) {
+      waitSeconds = RuntimeOption::RequestTimeoutSeconds > 0 ?
+                    RuntimeOption::RequestTimeoutSeconds : 10;
+    }
+    ApcSnapshotInfo info;
+    if (!apc_save_snapshot(file, waitSeconds, info)) {
+      transport->sendString("Failed\n");
+      return true;
+    }
+    std::ostringstream out;
+    out << "Saved " << info.entries << " entries (" << info.skipped
+        << " skipped, " << info.bytes << " bytes) to " << file << " in "
+        << info.usec / 1000 << " ms\n";
+    transport->sendString(out.str());
+    return true;
+  }
+  if (cmd == "dump-apc-evict") {
+    if (!apcExtension::Enable) {
+      transport->sendString("No APC\n");
+      return true;
+    }
+    std::string result = SharedStoreStats::report_evictions(
+      s_apc_store[0].memoryUsage(), apcExtension::MemoryLimit);
+    transport->sendString(result);
+    return true;
+  }
   if (cmd == "dump-file-repo") {
     if (file_dump) {
       (*file_dump)("/tmp/file_repo_dump");
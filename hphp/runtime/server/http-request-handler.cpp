@@ -208,7 +208,9 @@ void HttpRequestHandler::handleRequest(Transport *transport) {
           compressed = false;
         }
         sendStaticContent(transport, data, len, 0, compressed, path, ext);
-        StaticContentCache::TheFileCache->adviseOutMemory();
+        if (StaticContentCache::TheFileCache) {
+          StaticContentCache::TheFileCache->adviseOutMemory();
+        }
         ServerStats::LogPage(path, 200);
         GetAccessLog().log(transport, vhost);
         return;
@@ -28,6 +28,7 @@
 #include "hphp/runtime/server/admin-request-handler.h"
 #include "hphp/runtime/server/http-request-handler.h"
 #include "hphp/runtime/server/replay-transport.h"
+#include "hphp/runtime/server/repo-preload.h"
 #include "hphp/runtime/server/server-stats.h"
 #include "hphp/runtime/server/static-content-cache.h"
 #include "hphp/runtime/server/warmup-request-handler.h"
@@ -232,15 +233,31 @@ void HttpServer::run() {
     m_serviceThreads[i]->waitForStarted();
   }
 
+  // When preloading the repo, bring the admin server up first so the
+  // preload's progress can be watched through /check-health.
+  bool preload = RuntimeOption::RepoPreload &&
+                 RuntimeOption::RepoAuthoritative;
+  if (preload) {
+    if (RuntimeOption::AdminServerPort) {
+      if (!startServer(false)) {
+        Logger::Error("Unable to start admin server");
+        return;
+      }
+      Logger::Info("admin server started");
+    }
+    preloadRepo();
+  }
+
   if (RuntimeOption::ServerPort) {
     if (!startServer(true)) {
       Logger::Error("Unable to start page server");
+      if (preload && RuntimeOption::AdminServerPort) m_adminServer->stop();
       return;
     }
     Logger::Info("page server started");
   }
 
-  if (RuntimeOption::AdminServerPort) {
+  if (RuntimeOption::AdminServerPort && !preload) {
     if (!startServer(false)) {
       Logger::Error("Unable to start admin server");
       abortServers();
@@ -315,6 +332,14 @@ void HttpServer::run() {
     m_serviceThreads[i]->waitForEnd();
   }
 
+  // nothing is serving requests anymore; write out queued access log lines
+  HttpRequestHandler::GetAccessLog().stopWriter();
+
+  if (apcExtension::SnapshotSaveOnShutdown) {
+    ApcSnapshotInfo info;
+    apc_save_snapshot(apcExtension::SnapshotFile, 0, info);
+  }
+
   hphp_process_exit();
   m_watchDog.waitForEnd();
   Logger::Info("all servers stopped");
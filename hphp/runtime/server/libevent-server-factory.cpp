@@ -17,6 +17,7 @@
 #include "hphp/runtime/server/libevent-server.h"
 #include "hphp/runtime/server/libevent-server-with-fd.h"
 #include "hphp/runtime/server/libevent-server-with-takeover.h"
+#include "hphp/runtime/base/runtime-option.h"
 
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,7 +46,8 @@ ServerPtr LibEventServerFactory::createServer(const ServerOptions& options) {
   }
 
   return std::make_shared<LibEventServer>(options.m_address, options.m_port,
-                                            options.m_numThreads);
+                                          options.m_numThreads,
+                                          RuntimeOption::ServerEventLoopCount);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -27,6 +27,18 @@
 #include "hphp/util/logger.h"
 #include "hphp/util/timer.h"
 
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include "folly/Conv.h"
+#include "folly/String.h"
+
+#ifndef SO_REUSEPORT
+#define SO_REUSEPORT 15
+#endif
+
+#define SHUT_FBLISTEN 3
+
 ///////////////////////////////////////////////////////////////////////////////
 // static handler
 
@@ -35,6 +47,11 @@ static void on_request(struct evhttp_request *request, void *obj) {
   ((HPHP::LibEventServer*)obj)->onRequest(request);
 }
 
+static void on_loop_request(struct evhttp_request *request, void *obj) {
+  assert(obj);
+  ((HPHP::LibEventLoop*)obj)->onRequest(request);
+}
+
 static void on_response(int fd, short what, void *obj) {
   assert(obj);
   ((HPHP::PendingResponseQueue*)obj)->process();
@@ -66,7 +83,11 @@ LibEventTransportTraits::LibEventTransportTraits(LibEventJobPtr job,
                                                  int id) :
     server_((LibEventServer*)opaque),
     request_(job->request),
-    transport_(server_, request_, id) {
+    transport_(server_, request_, id, job->eventLoop) {
+  if (server_->getEventLoopCount() > 1) {
+    ServerStats::Log("evloop." + folly::to<std::string>(job->eventLoop) +
+                     ".hit", 1);
+  }
 
 #ifdef _EVENT_USE_OPENSSL
   if (evhttp_is_connection_ssl(request_->evcon)) {
@@ -79,7 +100,7 @@ LibEventTransportTraits::LibEventTransportTraits(LibEventJobPtr job,
 // constructor and destructor
 
 LibEventServer::LibEventServer(const std::string &address, int port,
-                               int thread)
+                               int thread, int eventLoops /* = 1 */)
   : Server(address, port, thread),
     m_accept_sock(-1),
     m_accept_sock_ssl(-1),
@@ -99,6 +120,10 @@ LibEventServer::LibEventServer(const std::string &address, int port,
   evhttp_set_read_limit(m_server, RuntimeOption::RequestBodyReadLimit);
 #endif
   m_responseQueue.create(m_eventBase);
+  for (int i = 1; i < eventLoops; i++) {
+    m_eventLoops.push_back(std::unique_ptr<LibEventLoop>(
+                             new LibEventLoop(this, i)));
+  }
 }
 
 LibEventServer::~LibEventServer() {
@@ -110,14 +135,66 @@ LibEventServer::~LibEventServer() {
   // process exits, so we're probably fine.
   if (getStatus() != RunStatus::STOPPING) {
     event_base_free(m_eventBase);
+    for (auto &loop : m_eventLoops) {
+      loop->free();
+    }
   }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
 // implementing HttpServer
 
+int LibEventServer::CreateReusePortSocket(const std::string &address,
+                                          int port) {
+  struct addrinfo hints, *ai = nullptr;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  std::string portStr = folly::to<std::string>(port);
+  int ret = getaddrinfo(address.empty() ? nullptr : address.c_str(),
+                        portStr.c_str(), &hints, &ai);
+  if (ret != 0) {
+    Logger::Error("getaddrinfo(%s): %s", address.c_str(), gai_strerror(ret));
+    return -1;
+  }
+
+  int fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+  if (fd < 0) {
+    freeaddrinfo(ai);
+    return -1;
+  }
+  int on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0 ||
+      bind(fd, ai->ai_addr, ai->ai_addrlen) != 0 ||
+      listen(fd, RuntimeOption::ServerBacklog) != 0) {
+    Logger::Error("Fail to bind port %d with SO_REUSEPORT: %s", port,
+                  folly::errnoStr(errno).c_str());
+    close(fd);
+    freeaddrinfo(ai);
+    return -1;
+  }
+  freeaddrinfo(ai);
+  return fd;
+}
+
 int LibEventServer::getAcceptSocket() {
   int ret;
+  if (!m_eventLoops.empty()) {
+    // all loops must bind with SO_REUSEPORT, including this one
+    ret = CreateReusePortSocket(m_address, m_port);
+    if (ret < 0) return -1;
+    if (evhttp_accept_socket(m_server, ret) < 0) {
+      Logger::Error("evhttp_accept_socket: %s",
+                    folly::errnoStr(errno).c_str());
+      close(ret);
+      return -1;
+    }
+    m_accept_sock = ret;
+    return 0;
+  }
+
   const char *address = m_address.empty() ? nullptr : m_address.c_str();
   ret = evhttp_bind_socket_backlog_fd(m_server, address,
                                       m_port, RuntimeOption::ServerBacklog);
@@ -130,7 +207,11 @@ int LibEventServer::getAcceptSocket() {
 }
 
 int LibEventServer::getLibEventConnectionCount() {
-  return evhttp_get_connection_count(m_server);
+  int count = evhttp_get_connection_count(m_server);
+  for (auto &loop : m_eventLoops) {
+    count += loop->getConnectionCount();
+  }
+  return count;
 }
 
 void LibEventServer::start() {
@@ -139,6 +220,11 @@ void LibEventServer::start() {
   if (getAcceptSocket() != 0) {
     throw FailedToListenException(m_address, m_port);
   }
+  for (auto &loop : m_eventLoops) {
+    if (loop->getAcceptSocket(m_address, m_port) != 0) {
+      throw FailedToListenException(m_address, m_port);
+    }
+  }
 
   if (m_server_ssl != nullptr && m_accept_sock_ssl != -2) {
     // m_accept_sock_ssl here serves as a flag to indicate whether it is
@@ -154,27 +240,46 @@ void LibEventServer::start() {
   setStatus(RunStatus::RUNNING);
   m_dispatcher.start();
   m_dispatcherThread.start();
+  for (auto &loop : m_eventLoops) {
+    loop->start();
+  }
+  if (!m_eventLoops.empty()) {
+    Logger::Info("LibEventServer running %d event loops on port %d",
+                 getEventLoopCount(), m_port);
+  }
 }
 
 void LibEventServer::waitForEnd() {
   m_dispatcherThread.waitForEnd();
 }
 
-void LibEventServer::dispatchWithTimeout(int timeoutSeconds) {
+PendingResponseQueue &LibEventServer::getResponseQueue(int eventLoop) {
+  if (eventLoop == 0) return m_responseQueue;
+  assert(eventLoop > 0 && eventLoop <= (int)m_eventLoops.size());
+  return m_eventLoops[eventLoop - 1]->getResponseQueue();
+}
+
+// Runs one more pass over base's events, for at most timeoutSeconds,
+// so connections already handed a response get to write it out.
+static void dispatch_with_timeout(event_base *base, int timeoutSeconds) {
   struct timeval timeout;
   timeout.tv_sec = timeoutSeconds;
   timeout.tv_usec = 0;
 
   event eventTimeout;
-  event_set(&eventTimeout, -1, 0, on_timer, m_eventBase);
-  event_base_set(m_eventBase, &eventTimeout);
+  event_set(&eventTimeout, -1, 0, on_timer, base);
+  event_base_set(base, &eventTimeout);
   event_add(&eventTimeout, &timeout);
 
-  event_base_loop(m_eventBase, EVLOOP_ONCE);
+  event_base_loop(base, EVLOOP_ONCE);
 
   event_del(&eventTimeout);
 }
 
+void LibEventServer::dispatchWithTimeout(int timeoutSeconds) {
+  dispatch_with_timeout(m_eventBase, timeoutSeconds);
+}
+
 void LibEventServer::dispatch() {
   m_pipeStop.open();
   event_set(&m_eventStop, m_pipeStop.getOut(), EV_READ|EV_PERSIST,
@@ -204,7 +309,6 @@ void LibEventServer::stop() {
   Lock lock(m_mutex);
   if (getStatus() != RunStatus::RUNNING || m_server == nullptr) return;
 
-#define SHUT_FBLISTEN 3
   /*
    * Modifications to the Linux kernel to support shutting down a listen
    * socket for new connections only, but anything which has completed
@@ -214,6 +318,9 @@ void LibEventServer::stop() {
    */
   if (RuntimeOption::ServerShutdownListenWait > 0 &&
       m_accept_sock != -1 && shutdown(m_accept_sock, SHUT_FBLISTEN) == 0) {
+    for (auto &loop : m_eventLoops) {
+      loop->shutdownListen();
+    }
     int noWorkCount = 0;
     for (int i = 0; i < RuntimeOption::ServerShutdownListenWait; i++) {
       // Give the acceptor thread time to clean out all requests
@@ -248,10 +355,20 @@ void LibEventServer::stop() {
   if (write(m_pipeStop.getIn(), "", 1) < 0) {
     // an error occured but we're in shutdown already, so ignore
   }
+  // wake every loop up first so they all flush in parallel
+  for (auto &loop : m_eventLoops) {
+    loop->stop();
+  }
   m_dispatcherThread.waitForEnd();
+  for (auto &loop : m_eventLoops) {
+    loop->waitForEnd();
+  }
 
   evhttp_free(m_server);
   m_server = nullptr;
+  for (auto &loop : m_eventLoops) {
+    loop->freeHttp();
+  }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -330,7 +447,8 @@ int LibEventServer::getAcceptSocketSSL() {
 ///////////////////////////////////////////////////////////////////////////////
 // request/response handling
 
-void LibEventServer::onRequest(struct evhttp_request *request) {
+void LibEventServer::onRequest(struct evhttp_request *request,
+                               int eventLoop /* = 0 */) {
   // If we are in the process of crashing, we want to reject incoming work.
   // This will prompt the load balancers to choose another server. Using
   // shutdown rather than close has the advantage that it makes fewer changes
@@ -347,6 +465,9 @@ void LibEventServer::onRequest(struct evhttp_request *request) {
       shutdown(m_accept_sock_ssl, SHUT_FBLISTEN);
       m_accept_sock_ssl = -1;
     }
+    for (auto &loop : m_eventLoops) {
+      loop->shutdownListen();
+    }
     return;
   }
 
@@ -359,7 +480,8 @@ void LibEventServer::onRequest(struct evhttp_request *request) {
   }
   if (getStatus() == RunStatus::RUNNING) {
     RequestPriority priority = getRequestPriority(request);
-    m_dispatcher.enqueue(LibEventJobPtr(new LibEventJob(request)), priority);
+    m_dispatcher.enqueue(LibEventJobPtr(new LibEventJob(request, eventLoop)),
+                         priority);
   } else {
     Logger::Error("throwing away one new request while shutting down");
   }
@@ -395,18 +517,22 @@ void LibEventServer::onResponse(int worker, evhttp_request *request,
     transport->onFlushBegin(totalSize);
     transport->onFlushProgress(nwritten, delay);
   }
-  m_responseQueue.enqueue(worker, request, code, nwritten);
+  getResponseQueue(transport->getEventLoop())
+    .enqueue(worker, request, code, nwritten);
 }
 
 void LibEventServer::onChunkedResponse(int worker, evhttp_request *request,
                                        int code, evbuffer *chunk,
-                                       bool firstChunk) {
-  m_responseQueue.enqueue(worker, request, code, chunk, firstChunk);
+                                       bool firstChunk,
+                                       int eventLoop /* = 0 */) {
+  getResponseQueue(eventLoop).enqueue(worker, request, code, chunk,
+                                      firstChunk);
 }
 
 void LibEventServer::onChunkedResponseEnd(int worker,
-                                          evhttp_request *request) {
-  m_responseQueue.enqueue(worker, request);
+                                          evhttp_request *request,
+                                          int eventLoop /* = 0 */) {
+  getResponseQueue(eventLoop).enqueue(worker, request);
 }
 
 LibEventServer::RequestPriority LibEventServer::getRequestPriority(
@@ -419,6 +545,113 @@ LibEventServer::RequestPriority LibEventServer::getRequestPriority(
   return PRIORITY_HIGH;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+// LibEventLoop
+
+LibEventLoop::LibEventLoop(LibEventServer *server, int id)
+  : m_server(server), m_id(id), m_accept_sock(-1),
+    m_thread(this, &LibEventLoop::dispatch) {
+  m_eventBase = event_base_new();
+  m_http = evhttp_new(m_eventBase);
+  evhttp_set_connection_limit(m_http, RuntimeOption::ServerConnectionLimit);
+  evhttp_set_gencb(m_http, on_loop_request, this);
+#ifdef EVHTTP_PORTABLE_READ_LIMITING
+  evhttp_set_read_limit(m_http, RuntimeOption::RequestBodyReadLimit);
+#endif
+  m_responseQueue.create(m_eventBase);
+}
+
+LibEventLoop::~LibEventLoop() {
+  // event_base is freed by LibEventServer through free(), since it cannot
+  // be freed while the server is still shutting down on it
+}
+
+void LibEventLoop::freeHttp() {
+  if (m_http) {
+    // also closes the listen socket, so the kernel stops handing this
+    // loop connections
+    evhttp_free(m_http);
+    m_http = nullptr;
+    m_accept_sock = -1;
+  }
+}
+
+void LibEventLoop::free() {
+  freeHttp();
+  if (m_eventBase) {
+    event_base_free(m_eventBase);
+    m_eventBase = nullptr;
+  }
+}
+
+int LibEventLoop::getAcceptSocket(const std::string &address, int port) {
+  int fd = LibEventServer::CreateReusePortSocket(address, port);
+  if (fd < 0) return -1;
+  if (evhttp_accept_socket(m_http, fd) < 0) {
+    Logger::Error("evhttp_accept_socket (event loop %d): %s", m_id,
+                  folly::errnoStr(errno).c_str());
+    close(fd);
+    return -1;
+  }
+  m_accept_sock = fd;
+  return 0;
+}
+
+int LibEventLoop::getConnectionCount() {
+  return m_http ? evhttp_get_connection_count(m_http) : 0;
+}
+
+void LibEventLoop::start() {
+  m_thread.start();
+}
+
+void LibEventLoop::shutdownListen() {
+  if (m_accept_sock != -1) {
+    shutdown(m_accept_sock, SHUT_FBLISTEN);
+  }
+}
+
+void LibEventLoop::stop() {
+  // server status is already STOPPED, so the loop exits after this wakeup
+  if (write(m_pipeStop.getIn(), "", 1) < 0) {
+    // an error occured but we're in shutdown already, so ignore
+  }
+}
+
+void LibEventLoop::waitForEnd() {
+  m_thread.waitForEnd();
+}
+
+void LibEventLoop::onRequest(evhttp_request *request) {
+  m_server->onRequest(request, m_id);
+}
+
+void LibEventLoop::dispatch() {
+  m_pipeStop.open();
+  event_set(&m_eventStop, m_pipeStop.getOut(), EV_READ|EV_PERSIST,
+            on_thread_stop, m_eventBase);
+  event_base_set(m_eventBase, &m_eventStop);
+  event_add(&m_eventStop, nullptr);
+
+  while (m_server->getStatus() != Server::RunStatus::STOPPED) {
+    event_base_loop(m_eventBase, EVLOOP_ONCE);
+  }
+
+  event_del(&m_eventStop);
+
+  // flushing all responses
+  if (!m_responseQueue.empty()) {
+    m_responseQueue.process();
+  }
+  m_responseQueue.close();
+
+  // flushing all remaining events, same as the server's own loop
+  if (RuntimeOption::ServerGracefulShutdownWait) {
+    dispatch_with_timeout(m_eventBase,
+                          RuntimeOption::ServerGracefulShutdownWait);
+  }
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // PendingResponseQueue
 
@@ -25,6 +25,9 @@
 #include "hphp/runtime/server/server-worker.h"
 #include "hphp/util/process.h"
 
+#include <memory>
+#include <vector>
+
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -35,11 +38,13 @@ namespace HPHP {
 DECLARE_BOOST_TYPES(LibEventJob);
 class LibEventJob : public ServerJob {
 public:
-  explicit LibEventJob(evhttp_request *req) : request(req) {}
+  explicit LibEventJob(evhttp_request *req, int loop = 0)
+    : request(req), eventLoop(loop) {}
 
   void getRequestStart(struct timespec *reqStart);
 
   evhttp_request *request;
+  int eventLoop; // which event loop accepted this request
 };
 
 class LibEventTransportTraits;
@@ -92,16 +97,64 @@ private:
   void enqueue(int worker, ResponsePtr response);
 };
 
+class LibEventServer;
+
+/**
+ * An additional event loop for LibEventServer. Each one owns an event_base,
+ * an evhttp bound to its own SO_REUSEPORT listening socket, a response queue
+ * and a thread running the loop, so the kernel spreads accepts across loops
+ * and no single thread parses headers or flushes responses for the whole
+ * server. Requests are handed to the server's shared job queue.
+ */
+class LibEventLoop {
+public:
+  LibEventLoop(LibEventServer *server, int id);
+  ~LibEventLoop();
+
+  int getId() const { return m_id; }
+  int getAcceptSocket(const std::string &address, int port);
+  int getConnectionCount();
+  void start();
+  void stop();        // wake the loop up to exit; doesn't wait
+  void waitForEnd();  // wait for it to finish flushing and exit
+  void shutdownListen(); // stop accepting, see SHUT_FBLISTEN
+  void freeHttp();    // close the evhttp and its socket once stopped
+  void free();
+
+  void onRequest(evhttp_request *request);
+  PendingResponseQueue &getResponseQueue() { return m_responseQueue; }
+
+private:
+  LibEventServer *m_server;
+  int m_id;
+  int m_accept_sock;
+  event_base *m_eventBase;
+  evhttp *m_http;
+
+  event m_eventStop;
+  CPipe m_pipeStop;
+
+  PendingResponseQueue m_responseQueue;
+  AsyncFunc<LibEventLoop> m_thread;
+
+  // loop thread runs this function
+  void dispatch();
+};
+
 /**
  * Implementing an evhttp based HTTP server with JobQueueDispatcher. This
- * server will have one dispather thread and multiple worker threads.
+ * server will have one dispather thread and multiple worker threads. With
+ * more than one event loop, the dispatcher thread runs loop 0 and each
+ * additional LibEventLoop runs its own thread, all listening on the same
+ * port through SO_REUSEPORT.
  */
 class LibEventServer : public Server {
 public:
   /**
    * Constructor and destructor.
    */
-  LibEventServer(const std::string &address, int port, int thread);
+  LibEventServer(const std::string &address, int port, int thread,
+                 int eventLoops = 1);
   ~LibEventServer();
 
   // implementing Server
@@ -118,11 +171,12 @@ public:
     return m_dispatcher.getQueuedJobs();
   }
   int getLibEventConnectionCount();
+  int getEventLoopCount() const { return m_eventLoops.size() + 1; }
 
   /**
    * Request handler called by evhttp library.
    */
-  void onRequest(evhttp_request *request);
+  void onRequest(evhttp_request *request, int eventLoop = 0);
   void onChunkedRead();
 
   /**
@@ -131,8 +185,10 @@ public:
   void onResponse(int worker, evhttp_request *request, int code,
                   LibEventTransport* transport);
   void onChunkedResponse(int worker, evhttp_request *request, int code,
-                         evbuffer *chunk, bool firstChunk);
-  void onChunkedResponseEnd(int worker, evhttp_request *request);
+                         evbuffer *chunk, bool firstChunk,
+                         int eventLoop = 0);
+  void onChunkedResponseEnd(int worker, evhttp_request *request,
+                            int eventLoop = 0);
   void onChunkedRequest(evhttp_request *request);
 
   /**
@@ -141,6 +197,11 @@ public:
    */
   virtual bool enableSSL(int port);
 
+  /**
+   * Returns a listening socket bound with SO_REUSEPORT, or -1 on failure.
+   */
+  static int CreateReusePortSocket(const std::string &address, int port);
+
 protected:
   virtual int getAcceptSocket();
   virtual int getAcceptSocketSSL();
@@ -175,6 +236,11 @@ private:
 
   PendingResponseQueue m_responseQueue;
 
+  // event loops 1..N-1; loop 0 is m_eventBase run by m_dispatcherThread
+  std::vector<std::unique_ptr<LibEventLoop>> m_eventLoops;
+
+  PendingResponseQueue &getResponseQueue(int eventLoop);
+
   // dispatcher thread runs this function
   void dispatch();
 
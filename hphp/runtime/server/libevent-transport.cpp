@@ -31,9 +31,9 @@ struct m_evkeyvalq {
 
 LibEventTransport::LibEventTransport(LibEventServer *server,
                                      evhttp_request *request,
-                                     int workerId)
+                                     int workerId, int eventLoop)
   : m_server(server), m_request(request), m_eventBasePostData(nullptr),
-    m_workerId(workerId), m_sendStarted(false), m_sendEnded(false) {
+    m_workerId(workerId), m_eventLoop(eventLoop), m_sendStarted(false), m_sendEnded(false) {
   // HttpProtocol::PrepareSystemVariables needs this
   evbuffer *buf = m_request->input_buffer;
   assert(buf);
@@ -282,7 +282,7 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
      */
     onChunkedProgress(size);
     m_server->onChunkedResponse(m_workerId, m_request, code, chunk,
-                               !m_sendStarted);
+                               !m_sendStarted, m_eventLoop);
   } else {
     if (m_method != Method::HEAD) {
       evbuffer_add(m_request->output_buffer, data, size);
@@ -300,7 +300,7 @@ void LibEventTransport::sendImpl(const void *data, int size, int code,
 
 void LibEventTransport::onSendEndImpl() {
   if (m_chunkedEncoding) {
-    m_server->onChunkedResponseEnd(m_workerId, m_request);
+    m_server->onChunkedResponseEnd(m_workerId, m_request, m_eventLoop);
     m_sendEnded = true;
   } else {
     assert(m_sendEnded); // otherwise, we didn't call send for this request
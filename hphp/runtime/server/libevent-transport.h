@@ -27,7 +27,7 @@ class LibEventServer;
 class LibEventTransport : public Transport {
 public:
   LibEventTransport(LibEventServer *server, evhttp_request *request,
-                    int workerId);
+                    int workerId, int eventLoop = 0);
 
   /**
    * Implementing Transport...
@@ -52,12 +52,15 @@ public:
   virtual bool isServerStopping();
   virtual int getRequestSize() const;
 
+  int getEventLoop() const { return m_eventLoop; }
+
 private:
   LibEventServer *m_server;
   evhttp_request *m_request;
   struct event_base *m_eventBasePostData;
   struct event m_moreDataRead;
   int m_workerId;
+  int m_eventLoop;
   std::string m_url;
   std::string m_remote_host;
   uint16_t m_remote_port;
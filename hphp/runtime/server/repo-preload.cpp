@@ -0,0 +1,163 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/server/repo-preload.h"
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/base/file-repository.h"
+#include "hphp/runtime/base/program-functions.h"
+#include "hphp/runtime/base/runtime-option.h"
+#include "hphp/runtime/vm/repo.h"
+#include "hphp/util/job-queue.h"
+#include "hphp/util/logger.h"
+#include "hphp/util/timer.h"
+#include "hphp/util/trace.h"
+
+namespace HPHP {
+
+TRACE_SET_MOD(hhbc);
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+// Units per job; each job runs in one throwaway request.
+const int kBatchSize = 64;
+
+std::vector<std::string> s_paths;
+std::atomic<int64_t> s_total(0);
+std::atomic<int64_t> s_loaded(0);
+std::atomic<int64_t> s_failed(0);
+std::atomic<int64_t> s_usec(0);
+std::atomic<bool> s_done(false);
+
+bool preloadUnit(const std::string& path) {
+  std::string fullPath = path[0] == '/' ? path :
+    RuntimeOption::SourceRoot + path;
+  try {
+    Eval::PhpFile* efile = g_vmContext->lookupPhpFile(
+      makeStaticString(fullPath), "", nullptr);
+    if (!efile) {
+      TRACE(1, "repo preload: no unit for %s\n", fullPath.c_str());
+      return false;
+    }
+    if (RuntimeOption::RepoPreloadMerge) efile->unit()->merge();
+    return true;
+  } catch (const std::exception& e) {
+    // Typically a unit that only merges after something else has been
+    // included; it will be merged by the first request that needs it.
+    TRACE(1, "repo preload: %s: %s\n", fullPath.c_str(), e.what());
+    return false;
+  }
+}
+
+struct PreloadWorker : JobQueueWorker<int> {
+  virtual void doJob(int batch) {
+    size_t begin = size_t(batch) * kBatchSize;
+    size_t end = std::min(begin + kBatchSize, s_paths.size());
+    hphp_session_init();
+    hphp_context_init();
+    for (size_t i = begin; i < end; ++i) {
+      if (preloadUnit(s_paths[i])) {
+        ++s_loaded;
+      } else {
+        ++s_failed;
+      }
+    }
+    hphp_context_exit(g_context.getNoCheck(), false);
+    hphp_session_exit();
+  }
+
+  virtual void onThreadExit() {
+    hphp_thread_exit();
+  }
+};
+
+bool readFileList(const std::string& listPath,
+                  std::vector<std::string>& paths) {
+  std::ifstream in(listPath.c_str());
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (!line.empty()) paths.push_back(line);
+  }
+  return true;
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////
+
+void preloadRepo() {
+  if (!RuntimeOption::RepoPreload || !RuntimeOption::RepoAuthoritative) {
+    return;
+  }
+
+  struct timespec tsBegin, tsEnd;
+  Timer::GetMonotonicTime(tsBegin);
+
+  if (!RuntimeOption::RepoPreloadFileList.empty()) {
+    if (!readFileList(RuntimeOption::RepoPreloadFileList, s_paths)) {
+      Logger::Error("Unable to read Repo.Preload.FileList %s",
+                    RuntimeOption::RepoPreloadFileList.c_str());
+    }
+  } else if (!Repo::get().enumerateFiles(s_paths)) {
+    Logger::Error("Unable to list the files in the repo for preloading");
+  }
+  s_total = s_paths.size();
+
+  if (!s_paths.empty()) {
+    int batches = (s_paths.size() + kBatchSize - 1) / kBatchSize;
+    int threads = std::max(1, std::min(RuntimeOption::RepoPreloadThreads,
+                                       batches));
+    Logger::Info("preloading %zu units on %d threads",
+                 s_paths.size(), threads);
+    JobQueueDispatcher<int, PreloadWorker> dispatcher(
+      threads, false, 0, false, nullptr);
+    for (int i = 0; i < batches; ++i) {
+      dispatcher.enqueue(i);
+    }
+    dispatcher.start();
+    dispatcher.waitEmpty();
+  }
+
+  Timer::GetMonotonicTime(tsEnd);
+  s_usec = gettime_diff_us(tsBegin, tsEnd);
+  s_done = true;
+  Logger::Info("preloaded %" PRId64 " units (%" PRId64 " failed) in %"
+               PRId64 " ms", s_loaded.load(), s_failed.load(),
+               s_usec.load() / 1000);
+
+  std::vector<std::string>().swap(s_paths);
+}
+
+RepoPreloadProgress repoPreloadProgress() {
+  RepoPreloadProgress progress;
+  progress.total = s_total;
+  progress.loaded = s_loaded;
+  progress.failed = s_failed;
+  progress.usec = s_usec;
+  progress.done = s_done;
+  return progress;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}
@@ -0,0 +1,56 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#ifndef incl_HPHP_REPO_PRELOAD_H_
+#define incl_HPHP_REPO_PRELOAD_H_
+
+#include <cstdint>
+
+namespace HPHP {
+
+/*
+ * Startup preload of a RepoAuthoritative repo.
+ *
+ * With Repo.Preload.Enable, the server loads every unit in the repo (or
+ * the ones listed in Repo.Preload.FileList) on a pool of
+ * Repo.Preload.Threads threads before the page server starts listening,
+ * and with Repo.Preload.Merge it also merges each of them once in a
+ * throwaway request, so persistent classes, functions and constants
+ * exist before real traffic arrives.
+ */
+struct RepoPreloadProgress {
+  int64_t total;   // units to preload
+  int64_t loaded;  // units loaded (and merged) so far
+  int64_t failed;  // units that couldn't be found or merged
+  int64_t usec;    // wall time of the whole preload, once it's done
+  bool done;
+};
+
+/*
+ * Run the preload to completion.  Does nothing unless Repo.Preload.Enable
+ * and Repo.Authoritative are set.  Must be called after
+ * hphp_process_init().
+ */
+void preloadRepo();
+
+/*
+ * Progress of the preload, for the admin server; safe to call while
+ * preloadRepo() is running.
+ */
+RepoPreloadProgress repoPreloadProgress();
+
+}
+
+#endif
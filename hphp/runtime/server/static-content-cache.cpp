@@ -22,13 +22,21 @@
 #include "hphp/util/util.h"
 #include "hphp/util/compression.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "folly/String.h"
+
 namespace HPHP {
 ///////////////////////////////////////////////////////////////////////////////
 
 StaticContentCache StaticContentCache::TheCache;
 FileCachePtr StaticContentCache::TheFileCache;
 
-StaticContentCache::StaticContentCache() : m_totalSize(0) {
+StaticContentCache::StaticContentCache()
+  : m_totalSize(0), m_mapped(nullptr), m_mappedSize(0) {
 }
 
 void StaticContentCache::load() {
@@ -74,46 +82,237 @@ void StaticContentCache::load() {
   }
 
   Logger::Info("analyzing %d files under source root...", count);
+  vector<StaticFile> files;
   for (hphp_string_imap<string>::const_iterator iter =
          RuntimeOption::StaticFileExtensions.begin();
        iter != RuntimeOption::StaticFileExtensions.end(); ++iter) {
     if (ext2files.find(iter->first) == ext2files.end()) {
       continue;
     }
-    const vector<string> &out = ext2files[iter->first];
+    // prepare gzipped content, skipping image and swf files
+    bool compressible =
+      iter->second.find("image/") != 0 && iter->first != "swf";
+    for (auto const& name : ext2files[iter->first]) {
+      struct stat st;
+      if (stat(name.c_str(), &st) != 0 || st.st_size == 0) continue;
+      files.push_back({name, name.substr(rootSize + 1), compressible,
+                       (int64_t)st.st_mtime, (int64_t)st.st_size});
+    }
+  }
 
-    int total = 0;
-    for (unsigned int i = 0; i < out.size(); i++) {
-      auto const f = std::make_shared<ResourceFile>();
-
-      auto const sb = std::make_shared<CstrBuffer>(out[i].c_str());
-      if (sb->valid() && sb->size() > 0) {
-        string url = out[i].substr(rootSize + 1);
-        f->file = sb;
-        m_files[url] = f;
-
-        // prepare gzipped content, skipping image and swf files
-        if (iter->second.find("image/") != 0 && iter->first != "swf") {
-          int len = sb->size();
-          char *data = gzencode(sb->data(), len, 9, CODING_GZIP);
-          if (data) {
-            if (unsigned(len) < sb->size()) {
-              f->compressed = std::make_shared<CstrBuffer>(data, len);
-            } else {
-              free(data);
-            }
+  if (!RuntimeOption::StaticContentCacheFile.empty() && loadMapped(files)) {
+    Logger::Info("mapped %" PRId64 " bytes of static content from %s",
+                 m_totalSize, RuntimeOption::StaticContentCacheFile.c_str());
+    return;
+  }
+
+  for (auto const& sf : files) {
+    auto const f = std::make_shared<ResourceFile>();
+
+    auto const sb = std::make_shared<CstrBuffer>(sf.path.c_str());
+    if (sb->valid() && sb->size() > 0) {
+      f->file = sb;
+      f->data = sb->data();
+      f->len = sb->size();
+      m_files[sf.url] = f;
+
+      if (sf.compressible) {
+        int len = sb->size();
+        char *data = gzencode(sb->data(), len, 9, CODING_GZIP);
+        if (data) {
+          if (unsigned(len) < sb->size()) {
+            f->compressed = std::make_shared<CstrBuffer>(data, len);
+            f->cdata = f->compressed->data();
+            f->clen = len;
+          } else {
+            free(data);
           }
         }
+      }
+
+      m_totalSize += sb->size();
+    }
+  }
+  Logger::Info("loaded %" PRId64 " bytes of static content in total",
+               m_totalSize);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// memory-mapped cache file
+
+/*
+ * The cache file starts with kCacheMagic and the number of entries, then
+ * one CacheEntry per file, each followed by its url. File contents and
+ * their gzipped variants follow the index; offsets are from the start of
+ * the file. The file is only ever read back by the machine that wrote it,
+ * so everything is in native byte order.
+ */
+static const char kCacheMagic[] = "HHVM-STATIC-CONTENT-1";
+
+struct CacheEntry {
+  int64_t mtime;
+  int64_t size;
+  uint64_t offset;
+  uint64_t coffset;
+  uint32_t clen;
+  uint32_t urlLen;
+};
+
+bool StaticContentCache::loadMapped(const vector<StaticFile> &files) {
+  const string &path = RuntimeOption::StaticContentCacheFile;
+  if (mapCacheFile(path, files)) return true;
+
+  Logger::Info("building static content cache %s...", path.c_str());
+  return writeCacheFile(path, files) && mapCacheFile(path, files);
+}
+
+bool StaticContentCache::mapCacheFile(const string &path,
+                                      const vector<StaticFile> &files) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void *addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) return false;
+
+  hphp_hash_map<string, const StaticFile*, string_hash> byUrl;
+  for (auto const& sf : files) byUrl[sf.url] = &sf;
 
-        total += sb->size();
+  const char *base = (const char*)addr;
+  const char *p = base;
+  const char *end = base + size;
+  int64_t total = 0;
+  auto fail = [&] {
+    m_files.clear();
+    munmap(addr, size);
+    return false;
+  };
+
+  uint32_t count;
+  if (size_t(end - p) < sizeof(kCacheMagic) + sizeof(count) ||
+      memcmp(p, kCacheMagic, sizeof(kCacheMagic)) != 0) {
+    return fail();
+  }
+  p += sizeof(kCacheMagic);
+  memcpy(&count, p, sizeof(count));
+  p += sizeof(count);
+  if (count != files.size()) return fail();
+
+  for (uint32_t i = 0; i < count; i++) {
+    CacheEntry e;
+    if (size_t(end - p) < sizeof(e)) return fail();
+    memcpy(&e, p, sizeof(e));
+    p += sizeof(e);
+    if (size_t(end - p) < e.urlLen) return fail();
+    string url(p, e.urlLen);
+    p += e.urlLen;
+
+    // anything added, removed or changed on disk means a rebuild
+    auto it = byUrl.find(url);
+    if (it == byUrl.end() || it->second->mtime != e.mtime ||
+        it->second->size != e.size) {
+      return fail();
+    }
+    if (e.offset > size || size - e.offset < uint64_t(e.size) ||
+        e.coffset > size || size - e.coffset < e.clen) {
+      return fail();
+    }
+
+    auto const f = std::make_shared<ResourceFile>();
+    f->data = base + e.offset;
+    f->len = e.size;
+    if (e.clen) {
+      f->cdata = base + e.coffset;
+      f->clen = e.clen;
+    }
+    m_files[url] = f;
+    total += e.size;
+  }
+  if (m_files.size() != files.size()) return fail();
+
+  m_mapped = addr;
+  m_mappedSize = size;
+  m_totalSize = total;
+  return true;
+}
+
+bool StaticContentCache::writeCacheFile(const string &path,
+                                        const vector<StaticFile> &files) {
+  string tmp = path + ".tmp";
+  FILE *f = fopen(tmp.c_str(), "w");
+  if (!f) {
+    Logger::Error("Unable to write static content cache %s: %s",
+                  tmp.c_str(), folly::errnoStr(errno).c_str());
+    return false;
+  }
+
+  uint64_t offset = sizeof(kCacheMagic) + sizeof(uint32_t);
+  for (auto const& sf : files) offset += sizeof(CacheEntry) + sf.url.size();
+
+  // contents first, right after where the index will go
+  vector<CacheEntry> entries(files.size());
+  bool ok = fseek(f, offset, SEEK_SET) == 0;
+  for (size_t i = 0; ok && i < files.size(); i++) {
+    const StaticFile &sf = files[i];
+    CacheEntry &e = entries[i];
+    memset(&e, 0, sizeof(e));
+    e.mtime = sf.mtime;
+    e.size = sf.size;
+    e.urlLen = sf.url.size();
+
+    CstrBuffer sb(sf.path.c_str());
+    if (!sb.valid() || sb.size() != uint64_t(sf.size)) {
+      Logger::Error("%s changed while building the static content cache",
+                    sf.path.c_str());
+      ok = false;
+      break;
+    }
+    e.offset = offset;
+    ok = fwrite(sb.data(), 1, sb.size(), f) == sb.size();
+    offset += sb.size();
+
+    if (ok && sf.compressible) {
+      int len = sb.size();
+      char *data = gzencode(sb.data(), len, 9, CODING_GZIP);
+      if (data) {
+        if (unsigned(len) < sb.size()) {
+          e.coffset = offset;
+          e.clen = len;
+          ok = fwrite(data, 1, len, f) == size_t(len);
+          offset += len;
+        }
+        free(data);
       }
     }
-    Logger::Info("..loaded %d bytes of %s files", total, iter->first.c_str());
-    m_totalSize += total;
   }
-  Logger::Info("loaded %d bytes of static content in total", m_totalSize);
+
+  if (ok) {
+    uint32_t count = files.size();
+    ok = fseek(f, 0, SEEK_SET) == 0 &&
+      fwrite(kCacheMagic, sizeof(kCacheMagic), 1, f) == 1 &&
+      fwrite(&count, sizeof(count), 1, f) == 1;
+    for (size_t i = 0; ok && i < files.size(); i++) {
+      ok = fwrite(&entries[i], sizeof(CacheEntry), 1, f) == 1 &&
+        fwrite(files[i].url.data(), 1, files[i].url.size(), f) ==
+          files[i].url.size();
+    }
+  }
+  ok = fclose(f) == 0 && ok;
+  if (ok && rename(tmp.c_str(), path.c_str()) != 0) ok = false;
+  if (!ok) {
+    Logger::Error("Unable to write static content cache %s", path.c_str());
+    unlink(tmp.c_str());
+  }
+  return ok;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+
 bool StaticContentCache::find(const std::string &name, const char *&data,
                               int &len, bool &compressed) const {
   if (TheFileCache) {
@@ -122,13 +321,13 @@ bool StaticContentCache::find(const std::string &name, const char *&data,
 
   auto const iter = m_files.find(name);
   if (iter != m_files.end()) {
-    if (compressed && iter->second->compressed) {
-      data = iter->second->compressed->data();
-      len = iter->second->compressed->size();
+    if (compressed && iter->second->cdata) {
+      data = iter->second->cdata;
+      len = iter->second->clen;
     } else {
       compressed = false;
-      data = iter->second->file->data();
-      len = iter->second->file->size();
+      data = iter->second->data;
+      len = iter->second->len;
     }
     return true;
   }
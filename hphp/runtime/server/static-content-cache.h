@@ -18,6 +18,8 @@
 #define incl_HPHP_STATIC_CONTENT_CACHE_H_
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "hphp/runtime/base/string-buffer.h"
 #include "hphp/util/file-cache.h"
@@ -45,14 +47,41 @@ public:
             bool &compressed) const;
 
 private:
+  struct StaticFile {
+    std::string path;
+    std::string url;
+    bool compressible;
+    int64_t mtime;
+    int64_t size;
+  };
+
+  /**
+   * With RuntimeOption::StaticContentCacheFile set, every static file and
+   * its gzipped variant are kept in that file and served straight out of a
+   * read-only mapping of it. The file is reused as long as it still matches
+   * the files on disk, so restarts skip compressing everything again.
+   */
+  bool loadMapped(const std::vector<StaticFile> &files);
+  bool mapCacheFile(const std::string &path,
+                    const std::vector<StaticFile> &files);
+  static bool writeCacheFile(const std::string &path,
+                             const std::vector<StaticFile> &files);
+
   struct ResourceFile {
+    // heap buffers when loaded directly, null when mapped
     std::shared_ptr<CstrBuffer> file;
     std::shared_ptr<CstrBuffer> compressed;
+    const char *data = nullptr;
+    int len = 0;
+    const char *cdata = nullptr;
+    int clen = 0;
   };
 
-  int m_totalSize;
+  int64_t m_totalSize;
   hphp_hash_map<std::string,std::shared_ptr<ResourceFile>,string_hash>
     m_files;
+  void *m_mapped;
+  size_t m_mappedSize;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
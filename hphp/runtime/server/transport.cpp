@@ -583,7 +583,8 @@ bool Transport::setCookie(const String& name, const String& value, int64_t expir
 ///////////////////////////////////////////////////////////////////////////////
 
 void Transport::prepareHeaders(bool compressed, bool chunked,
-    const String &response, const String& orig_response) {
+    const void *response, int responseSize,
+    const void *orig_response, int orig_size) {
   for (HeaderMap::const_iterator iter = m_responseHeaders.begin();
        iter != m_responseHeaders.end(); ++iter) {
     const vector<string> &values = iter->second;
@@ -614,14 +615,15 @@ void Transport::prepareHeaders(bool compressed, bool chunked,
       } else {
         string cur_md5 = it->second[0];
         String expected_md5 = StringUtil::Base64Encode(StringUtil::MD5(
-          orig_response, true));
+          String((const char *)orig_response, orig_size, CopyString), true));
         // Can never trust these PHP people...
         if (expected_md5.c_str() != cur_md5) {
           raise_warning("Content-MD5 mismatch. Expected: %s, Got: %s",
             expected_md5.c_str(), cur_md5.c_str());
         }
         addHeaderImpl("Content-MD5", StringUtil::Base64Encode(StringUtil::MD5(
-          response, true)).c_str());
+          String((const char *)response, responseSize, CopyString),
+          true)).c_str());
       }
     }
   }
@@ -668,7 +670,7 @@ void Transport::prepareHeaders(bool compressed, bool chunked,
 
 String Transport::prepareResponse(const void *data, int size, bool &compressed,
                                   bool last) {
-  String response((const char *)data, size, CopyString);
+  String response;
 
   // we don't use chunk encoding to send anything pre-compressed
   assert(!compressed || !m_chunkedEncoding);
@@ -753,6 +755,8 @@ void Transport::sendRawLocked(void *data, int size, int code /* = 200 */,
   // compression handling
   ServerStatsHelper ssh("send");
   String response = prepareResponse(data, size, compressed, !chunked);
+  const void *out = response.isNull() ? data : response.data();
+  int outSize = response.isNull() ? size : response.size();
 
   if (m_responseCode < 0) {
     m_responseCode = code;
@@ -761,20 +765,19 @@ void Transport::sendRawLocked(void *data, int size, int code /* = 200 */,
 
   // HTTP header handling
   if (!m_headerSent) {
-    String orig_response((const char *)data, size, CopyString);
-    prepareHeaders(compressed, chunked, response, orig_response);
+    prepareHeaders(compressed, chunked, out, outSize, data, size);
     m_headerSent = true;
   }
 
-  m_responseSize += response.size();
+  m_responseSize += outSize;
   ServerStats::SetThreadMode(ServerStats::ThreadMode::Writing);
-  sendImpl(response.data(), response.size(), m_responseCode, chunked);
+  sendImpl(out, outSize, m_responseCode, chunked);
   ServerStats::SetThreadMode(ServerStats::ThreadMode::Processing);
 
   ServerStats::LogBytes(size);
   if (RuntimeOption::EnableStats && RuntimeOption::EnableWebStats) {
     ServerStats::Log("network.uncompressed", size);
-    ServerStats::Log("network.compressed", response.size());
+    ServerStats::Log("network.compressed", outSize);
   }
 }
 
@@ -790,6 +793,7 @@ void Transport::onSendEnd() {
   if (m_compressor && m_chunkedEncoding) {
     bool compressed = false;
     String response = prepareResponse("", 0, compressed, true);
+    if (response.isNull()) response = empty_string;
     sendImpl(response.data(), response.size(), m_responseCode, true);
   }
   onSendEndImpl();
@@ -417,13 +417,18 @@ protected:
   static void urlUnescape(char *value);
   bool splitHeader(const String& header, String &name, const char *&value);
 
+  /*
+   * Returns the compressed response, or a null String if data should go
+   * out as it is; the caller's buffer is sent without another copy then.
+   */
   String prepareResponse(const void *data, int size, bool &compressed,
                          bool last);
   bool moveUploadedFileHelper(const String& filename, const String& destination);
 
 private:
-  void prepareHeaders(bool compressed, bool chunked, const String &response,
-    const String& orig_response);
+  void prepareHeaders(bool compressed, bool chunked,
+    const void *response, int responseSize,
+    const void *orig_response, int orig_size);
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -152,6 +152,14 @@ struct BlobEncoder {
     encode(s.get());
   }
 
+  void encode(const std::string& s) {
+    encode(uint32_t(s.size()));
+
+    const size_t start = m_blob.size();
+    m_blob.resize(start + s.size());
+    std::copy(s.begin(), s.end(), m_blob.begin() + start);
+  }
+
   template<class K, class V>
   void encode(const std::pair<K,V>& kv) {
     encode(kv.first);
@@ -246,13 +254,23 @@ struct BlobDecoder {
     tvWriteUninit(&tv);
 
     String s = decodeString();
-    assert(!!s);
+    if (!s) throw std::runtime_error("null TypedValue in BlobDecoder");
     if (s->empty()) return;
 
     tvAsVariant(&tv) = unserialize_from_string(s);
     tvAsVariant(&tv).setEvalScalar();
   }
 
+  void decode(std::string& s) {
+    uint32_t sz;
+    decode(sz);
+    if (m_last - m_p < sz) {
+      throw std::runtime_error("truncated string in BlobDecoder");
+    }
+    s.assign(reinterpret_cast<const char*>(m_p), sz);
+    m_p += sz;
+  }
+
   template<class K, class V>
   void decode(std::pair<K,V>& val) {
     decode(val.first);
@@ -304,9 +322,11 @@ private:
     if (sz == 0) return String();
     sz--;
 
+    if (m_last - m_p < sz) {
+      throw std::runtime_error("truncated string in BlobDecoder");
+    }
     String s = String(sz, ReserveString);
     char* pch = s.bufferSlice().ptr;
-    assert(m_last - m_p >= sz);
     std::copy(m_p, m_p + sz, pch);
     m_p += sz;
     return s.setSize(sz);
@@ -18,6 +18,7 @@
 #include "hphp/runtime/base/types.h"
 #include "hphp/runtime/vm/func.h"
 #include "hphp/runtime/vm/jit/translator-inline.h"
+#include "hphp/runtime/vm/jit/translator-x64.h"
 #include "hphp/runtime/base/builtin-functions.h"
 #include "hphp/runtime/base/complex-types.h"
 #include "hphp/runtime/ext/ext_function.h"
@@ -40,8 +41,15 @@ void EventHook::Disable() {
   ThreadInfo::s_threadInfo->m_reqInjectionData.clearEventHookFlag();
 }
 
+std::atomic<bool> EventHook::s_interceptsRegistered(false);
+
 void EventHook::EnableIntercept() {
   ThreadInfo::s_threadInfo->m_reqInjectionData.setInterceptFlag();
+  if (!InterceptsRegistered() && !s_interceptsRegistered.exchange(true)) {
+    // Code already in the TC may have trusted a callee's proven return
+    // type, which the handler doesn't have to honor.
+    Transl::TranslatorX64::Get()->invalidateInferredReturnTypes();
+  }
 }
 
 void EventHook::DisableIntercept() {
@@ -16,6 +16,8 @@
 #ifndef incl_HPHP_VM_EVENT_HOOK_H_
 #define incl_HPHP_VM_EVENT_HOOK_H_
 
+#include <atomic>
+
 #include "hphp/util/ringbuffer.h"
 #include "hphp/runtime/base/execution-context.h"
 #include "hphp/runtime/vm/bytecode.h"
@@ -35,6 +37,14 @@ class EventHook {
   static void Disable();
   static void EnableIntercept();
   static void DisableIntercept();
+
+  /*
+   * True once any request in this process has registered an intercept
+   * handler.  Never goes back to false.
+   */
+  static bool InterceptsRegistered() {
+    return s_interceptsRegistered.load(std::memory_order_acquire);
+  }
   static ssize_t CheckSurprise();
 
   /*
@@ -82,6 +92,8 @@ private:
   static bool RunInterceptHandler(ActRec* ar);
   static const char* GetFunctionNameForProfiler(const ActRec* ar,
                                                 int funcType);
+
+  static std::atomic<bool> s_interceptsRegistered;
 };
 
 #undef DECLARE_HOOK
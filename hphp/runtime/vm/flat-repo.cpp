@@ -0,0 +1,608 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/vm/flat-repo.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <sqlite3.h>
+
+#include "folly/Range.h"
+#include "folly/ScopeGuard.h"
+
+#include "hphp/runtime/base/runtime-option.h"
+#include "hphp/runtime/ext/ext_variable.h"
+#include "hphp/runtime/vm/blob-helper.h"
+#include "hphp/runtime/vm/repo.h"
+#include "hphp/util/logger.h"
+#include "hphp/util/repo-schema.h"
+#include "hphp/util/trace.h"
+
+namespace HPHP {
+
+TRACE_SET_MOD(hhbc);
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char kFlatRepoMagic[8] = { 'H', 'H', 'F', 'L', 'A', 'T', 'R', 'P' };
+
+struct FlatRepoHeader {
+  char magic[8];
+  char schema[64];   // kRepoSchemaId, NUL padded
+  uint64_t numUnits;
+  uint64_t unitsOff;
+  uint64_t numFiles;
+  uint64_t filesOff;
+};
+
+/*
+ * The rows of one unit, other than the Unit row's bytecode (which is
+ * stored raw, ahead of the record, so it can be copied straight out of
+ * the mapping).  Blob columns are kept exactly as the SQLite repo has
+ * them.
+ */
+struct FlatPreClass {
+  std::string name;
+  int32_t hoistable;
+  std::string extraData;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(name)(hoistable)(extraData);
+  }
+};
+
+struct FlatMergeable {
+  int32_t ix;
+  int32_t kind;
+  int32_t id;
+  std::string value;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(ix)(kind)(id)(value);
+  }
+};
+
+struct FlatFunc {
+  int32_t sn;
+  int32_t preClassId;
+  std::string name;
+  bool top;
+  std::string extraData;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(sn)(preClassId)(name)(top)(extraData);
+  }
+};
+
+struct FlatUnit {
+  std::string bcMeta;
+  std::string mainReturn;
+  bool mergeable;
+  std::string lines;
+  std::string typedefs;
+  std::vector<std::string> litstrs;
+  std::vector<std::string> arrays;
+  std::vector<FlatPreClass> preClasses;
+  std::vector<FlatMergeable> mergeables;
+  std::vector<FlatFunc> funcs;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(bcMeta)(mainReturn)(mergeable)(lines)(typedefs)
+      (litstrs)(arrays)(preClasses)(mergeables)(funcs);
+  }
+};
+
+}
+
+struct FlatRepo::UnitEntry {
+  uint64_t md5[2];
+  int64_t sn;
+  uint64_t bcOff;
+  uint64_t bcLen;
+  uint64_t recordOff;
+  uint64_t recordLen;
+
+  bool operator<(const UnitEntry& o) const {
+    return md5[0] < o.md5[0] || (md5[0] == o.md5[0] && md5[1] < o.md5[1]);
+  }
+};
+
+struct FlatRepo::FileEntry {
+  uint64_t pathOff;
+  uint64_t pathLen;
+  uint64_t md5[2];
+};
+
+//////////////////////////////////////////////////////////////////////
+
+FlatRepo::FlatRepo(const char* base, size_t size)
+  : m_base(base)
+  , m_size(size) {
+  auto header = reinterpret_cast<const FlatRepoHeader*>(base);
+  m_units = reinterpret_cast<const UnitEntry*>(base + header->unitsOff);
+  m_numUnits = header->numUnits;
+  m_files = reinterpret_cast<const FileEntry*>(base + header->filesOff);
+  m_numFiles = header->numFiles;
+}
+
+const FlatRepo* FlatRepo::Open(const std::string& path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    Logger::Error("Unable to open flat repo %s", path.c_str());
+    return nullptr;
+  }
+  struct stat st;
+  void* addr = MAP_FAILED;
+  if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(FlatRepoHeader)) {
+    addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  }
+  close(fd);
+  if (addr == MAP_FAILED) {
+    Logger::Error("Unable to map flat repo %s", path.c_str());
+    return nullptr;
+  }
+
+  size_t size = st.st_size;
+  auto header = static_cast<const FlatRepoHeader*>(addr);
+  if (memcmp(header->magic, kFlatRepoMagic, sizeof header->magic) ||
+      strncmp(header->schema, kRepoSchemaId, sizeof header->schema) ||
+      header->unitsOff > size ||
+      header->numUnits > (size - header->unitsOff) / sizeof(UnitEntry) ||
+      header->filesOff > size ||
+      header->numFiles > (size - header->filesOff) / sizeof(FileEntry)) {
+    Logger::Error("Ignoring flat repo %s: not a flat repo for schema %s",
+                  path.c_str(), kRepoSchemaId);
+    munmap(addr, size);
+    return nullptr;
+  }
+  TRACE(1, "Using flat repo %s (%" PRIu64 " units, %" PRIu64 " files)\n",
+        path.c_str(), header->numUnits, header->numFiles);
+  return new FlatRepo(static_cast<const char*>(addr), size);
+}
+
+const FlatRepo* FlatRepo::Get() {
+  static const FlatRepo* s_repo =
+    RuntimeOption::RepoFlatPath.empty() || !RuntimeOption::RepoAuthoritative
+      ? nullptr : Open(RuntimeOption::RepoFlatPath);
+  return s_repo;
+}
+
+bool FlatRepo::findPath(const char* path, size_t len, MD5& md5) const {
+  auto it = std::lower_bound(
+    m_files, m_files + m_numFiles, folly::StringPiece(path, len),
+    [&] (const FileEntry& e, folly::StringPiece p) {
+      return folly::StringPiece(m_base + e.pathOff, e.pathLen) < p;
+    });
+  if (it == m_files + m_numFiles ||
+      folly::StringPiece(m_base + it->pathOff, it->pathLen) !=
+      folly::StringPiece(path, len)) {
+    return false;
+  }
+  md5.q[0] = it->md5[0];
+  md5.q[1] = it->md5[1];
+  return true;
+}
+
+bool FlatRepo::findFile(const char* path, const std::string& root,
+                        MD5& md5) const {
+  // Same lookups, in the same order, as Repo::findFile.
+  if (*path == '/' && !root.empty() &&
+      !strncmp(root.c_str(), path, root.size()) &&
+      findPath(path + root.size(), strlen(path) - root.size(), md5)) {
+    return true;
+  }
+  return findPath(path, strlen(path), md5);
+}
+
+void FlatRepo::enumerateFiles(std::vector<std::string>& paths) const {
+  for (size_t i = 0; i < m_numFiles; ++i) {
+    paths.emplace_back(m_base + m_files[i].pathOff, m_files[i].pathLen);
+  }
+}
+
+static void decodeValue(const std::string& blob, TypedValue& tv) {
+  unserializeRepoValue(blob.data(), blob.size(), tv);
+}
+
+void FlatRepo::decodeUnit(const UnitEntry& entry, UnitEmitter& ue) const {
+  if (entry.bcOff > m_size || entry.bcLen > m_size - entry.bcOff ||
+      entry.recordOff > m_size || entry.recordLen > m_size - entry.recordOff) {
+    throw std::runtime_error("unit record out of bounds");
+  }
+  FlatUnit unit;
+  BlobDecoder decoder(m_base + entry.recordOff, entry.recordLen);
+  decoder(unit);
+
+  // What UnitRepoProxy::GetUnitStmt does.
+  ue.setRepoId(RepoIdCentral);
+  ue.setSn(entry.sn);
+  ue.setBc((const uchar*)(m_base + entry.bcOff), entry.bcLen);
+  ue.setBcMeta((const uchar*)unit.bcMeta.data(), unit.bcMeta.size());
+  TypedValue value;
+  decodeValue(unit.mainReturn, value);
+  ue.setMainReturn(&value);
+  ue.setMergeOnly(unit.mergeable);
+  {
+    LineTable lines;
+    BlobDecoder linesBlob(unit.lines.data(), unit.lines.size());
+    linesBlob(lines);
+    ue.setLines(lines);
+  }
+  {
+    BlobDecoder typedefsBlob(unit.typedefs.data(), unit.typedefs.size());
+    typedefsBlob(ue.m_typedefs);
+  }
+
+  // GetUnitLitstrsStmt, GetUnitArraysStmt
+  for (auto const& litstr : unit.litstrs) {
+    ue.mergeLitstr(makeStaticString(litstr));
+  }
+  for (auto const& s : unit.arrays) {
+    StringData* array = makeStaticString(s);
+    Variant v = unserialize_from_string(String(array));
+    ue.mergeArray(v.asArrRef().get(), array);
+  }
+
+  // GetPreClassesStmt
+  for (auto const& pc : unit.preClasses) {
+    PreClassEmitter* pce = ue.newPreClassEmitter(
+      makeStaticString(pc.name), (PreClass::Hoistable)pc.hoistable);
+    BlobDecoder extraBlob(pc.extraData.data(), pc.extraData.size());
+    pce->serdeMetaData(extraBlob);
+  }
+
+  // GetUnitMergeablesStmt; flat repos are only used in RepoAuthoritative
+  // mode, so everything is kept.
+  size_t numMergeables = 0;
+  auto checkIx = [&] (int32_t ix) {
+    if (ix < 0 || size_t(ix) > numMergeables++) {
+      throw std::runtime_error("mergeable index out of range");
+    }
+  };
+  for (auto const& m : unit.mergeables) {
+    switch (m.kind) {
+      case UnitMergeKindReqDoc:
+        checkIx(m.ix);
+        ue.insertMergeableInclude(m.ix, (UnitMergeKind)m.kind, m.id);
+        break;
+      case UnitMergeKindPersistentDefine:
+      case UnitMergeKindDefine:
+      case UnitMergeKindGlobal: {
+        checkIx(m.ix);
+        TypedValue mergeableValue;
+        decodeValue(m.value, mergeableValue);
+        ue.insertMergeableDef(m.ix, (UnitMergeKind)m.kind, m.id,
+                              mergeableValue);
+        break;
+      }
+    }
+  }
+
+  // GetFuncsStmt
+  for (auto const& f : unit.funcs) {
+    const StringData* name = makeStaticString(f.name);
+    FuncEmitter* fe;
+    if (f.preClassId < 0) {
+      fe = ue.newFuncEmitter(name);
+    } else {
+      if (size_t(f.preClassId) >= unit.preClasses.size()) {
+        throw std::runtime_error("func preclass id out of range");
+      }
+      PreClassEmitter* pce = ue.pce(f.preClassId);
+      fe = ue.newMethodEmitter(name, pce);
+      if (!pce->addMethod(fe)) {
+        throw std::runtime_error("duplicate method");
+      }
+    }
+    if (fe->sn() != f.sn) {
+      throw std::runtime_error("funcs out of order");
+    }
+    fe->setTop(f.top);
+    BlobDecoder extraBlob(f.extraData.data(), f.extraData.size());
+    fe->serdeMetaData(extraBlob);
+    fe->finish(fe->past(), true);
+    ue.recordFunction(fe);
+  }
+}
+
+Unit* FlatRepo::loadUnit(const std::string& name, const MD5& md5) const {
+  UnitEntry key;
+  key.md5[0] = md5.q[0];
+  key.md5[1] = md5.q[1];
+  auto it = std::lower_bound(m_units, m_units + m_numUnits, key);
+  if (it == m_units + m_numUnits ||
+      it->md5[0] != md5.q[0] || it->md5[1] != md5.q[1]) {
+    TRACE(3, "Flat repo has no '%s' (0x%016" PRIx64 "%016" PRIx64 ")\n",
+          name.c_str(), md5.q[0], md5.q[1]);
+    return nullptr;
+  }
+
+  UnitEmitter ue(md5);
+  ue.setFilepath(makeStaticString(name));
+  try {
+    decodeUnit(*it, ue);
+  } catch (const std::exception& e) {
+    TRACE(0, "Flat repo error loading '%s' (0x%016" PRIx64 "%016" PRIx64
+          "): %s\n", name.c_str(), md5.q[0], md5.q[1], e.what());
+    return nullptr;
+  }
+  TRACE(3, "Flat repo loaded '%s' (0x%016" PRIx64 "%016" PRIx64 ")\n",
+        name.c_str(), md5.q[0], md5.q[1]);
+  return ue.create();
+}
+
+//////////////////////////////////////////////////////////////////////
+// conversion
+
+namespace {
+
+struct SqliteStmt {
+  SqliteStmt(sqlite3* db, const std::string& sql) : m_db(db), m_stmt(nullptr) {
+    if (sqlite3_prepare_v2(db, sql.c_str(), -1, &m_stmt, nullptr) !=
+        SQLITE_OK) {
+      throw RepoExc("Unable to prepare '%s': %s", sql.c_str(),
+                    sqlite3_errmsg(db));
+    }
+  }
+  ~SqliteStmt() { sqlite3_finalize(m_stmt); }
+
+  // Rerun the statement for another unit.
+  void bindUnit(int64_t unitSn) {
+    sqlite3_reset(m_stmt);
+    sqlite3_bind_int64(m_stmt, 1, unitSn);
+  }
+
+  bool step() {
+    int rc = sqlite3_step(m_stmt);
+    if (rc == SQLITE_ROW) return true;
+    if (rc != SQLITE_DONE) {
+      throw RepoExc("Error reading repo: %s", sqlite3_errmsg(m_db));
+    }
+    return false;
+  }
+
+  int64_t getInt(int col) { return sqlite3_column_int64(m_stmt, col); }
+  std::string getBlob(int col) {
+    auto data = static_cast<const char*>(sqlite3_column_blob(m_stmt, col));
+    return std::string(data ? data : "", sqlite3_column_bytes(m_stmt, col));
+  }
+
+ private:
+  sqlite3* m_db;
+  sqlite3_stmt* m_stmt;
+};
+
+struct FlatRepoWriter {
+  explicit FlatRepoWriter(FILE* f) : m_file(f), m_off(0), m_ok(true) {}
+
+  uint64_t write(const void* data, size_t len) {
+    uint64_t off = m_off;
+    if (m_ok && len && fwrite(data, 1, len, m_file) != len) m_ok = false;
+    m_off += len;
+    return off;
+  }
+  void align() {
+    static const char zeros[8] = {};
+    write(zeros, ((m_off + 7) & ~uint64_t(7)) - m_off);
+  }
+
+  FILE* m_file;
+  uint64_t m_off;
+  bool m_ok;
+};
+
+std::string tableName(const char* prefix) {
+  return std::string(prefix) + "_" + kRepoSchemaId;
+}
+
+}
+
+bool FlatRepo::Convert(const std::string& repoPath, const std::string& outPath,
+                       std::string& error) {
+  if (repoPath.empty()) {
+    error = "Repo.Central.Path is not set";
+    return false;
+  }
+  sqlite3* db = nullptr;
+  if (sqlite3_open_v2(repoPath.c_str(), &db, SQLITE_OPEN_READONLY, nullptr) !=
+      SQLITE_OK) {
+    error = "Unable to open " + repoPath + ": " +
+            (db ? sqlite3_errmsg(db) : "out of memory");
+    sqlite3_close(db);
+    return false;
+  }
+  SCOPE_EXIT { sqlite3_close(db); };
+
+  std::string tmpPath = outPath + ".tmp";
+  FILE* f = fopen(tmpPath.c_str(), "wb");
+  if (!f) {
+    error = "Unable to create " + tmpPath;
+    return false;
+  }
+  bool closed = false;
+  SCOPE_EXIT { if (!closed) fclose(f); };
+
+  FlatRepoWriter w(f);
+  FlatRepoHeader header;
+  memset(&header, 0, sizeof header);
+  w.write(&header, sizeof header); // rewritten at the end
+
+  std::vector<UnitEntry> units;
+  std::vector<std::pair<std::string, MD5>> files;
+  try {
+    SqliteStmt unitStmt(db,
+      "SELECT unitSn,md5,bc,bc_meta,mainReturn,mergeable,lines,typedefs FROM "
+      + tableName("Unit") + " ORDER BY unitSn ASC;");
+    SqliteStmt litstrStmt(db,
+      "SELECT litstrId,litstr FROM " + tableName("UnitLitstr") +
+      " WHERE unitSn == ?1 ORDER BY litstrId ASC;");
+    SqliteStmt arrayStmt(db,
+      "SELECT arrayId,array FROM " + tableName("UnitArray") +
+      " WHERE unitSn == ?1 ORDER BY arrayId ASC;");
+    SqliteStmt preClassStmt(db,
+      "SELECT preClassId,name,hoistable,extraData FROM " +
+      tableName("PreClass") + " WHERE unitSn == ?1 ORDER BY preClassId ASC;");
+    SqliteStmt mergeableStmt(db,
+      "SELECT mergeableIx,mergeableKind,mergeableId,mergeableValue FROM " +
+      tableName("UnitMergeables") +
+      " WHERE unitSn == ?1 ORDER BY mergeableIx ASC;");
+    SqliteStmt funcStmt(db,
+      "SELECT funcSn,preClassId,name,top,extraData FROM " +
+      tableName("Func") + " WHERE unitSn == ?1 ORDER BY funcSn ASC;");
+
+    while (unitStmt.step()) {
+      UnitEntry entry;
+      entry.sn = unitStmt.getInt(0);
+      std::string md5 = unitStmt.getBlob(1);
+      if (md5.size() != 16) {
+        throw RepoExc("Unit %" PRId64 " has a bad md5", entry.sn);
+      }
+      MD5 m(md5.data());
+      entry.md5[0] = m.q[0];
+      entry.md5[1] = m.q[1];
+
+      std::string bc = unitStmt.getBlob(2);
+      FlatUnit unit;
+      unit.bcMeta = unitStmt.getBlob(3);
+      unit.mainReturn = unitStmt.getBlob(4);
+      unit.mergeable = unitStmt.getInt(5);
+      unit.lines = unitStmt.getBlob(6);
+      unit.typedefs = unitStmt.getBlob(7);
+
+      litstrStmt.bindUnit(entry.sn);
+      while (litstrStmt.step()) {
+        if (litstrStmt.getInt(0) != (int64_t)unit.litstrs.size()) {
+          throw RepoExc("Unit %" PRId64 " has sparse litstr ids", entry.sn);
+        }
+        unit.litstrs.push_back(litstrStmt.getBlob(1));
+      }
+      arrayStmt.bindUnit(entry.sn);
+      while (arrayStmt.step()) {
+        if (arrayStmt.getInt(0) != (int64_t)unit.arrays.size()) {
+          throw RepoExc("Unit %" PRId64 " has sparse array ids", entry.sn);
+        }
+        unit.arrays.push_back(arrayStmt.getBlob(1));
+      }
+      preClassStmt.bindUnit(entry.sn);
+      while (preClassStmt.step()) {
+        if (preClassStmt.getInt(0) != (int64_t)unit.preClasses.size()) {
+          throw RepoExc("Unit %" PRId64 " has sparse preclass ids", entry.sn);
+        }
+        FlatPreClass pc;
+        pc.name = preClassStmt.getBlob(1);
+        pc.hoistable = preClassStmt.getInt(2);
+        pc.extraData = preClassStmt.getBlob(3);
+        unit.preClasses.push_back(std::move(pc));
+      }
+      mergeableStmt.bindUnit(entry.sn);
+      while (mergeableStmt.step()) {
+        FlatMergeable m;
+        m.ix = mergeableStmt.getInt(0);
+        m.kind = mergeableStmt.getInt(1);
+        m.id = mergeableStmt.getInt(2);
+        m.value = mergeableStmt.getBlob(3);
+        unit.mergeables.push_back(std::move(m));
+      }
+      funcStmt.bindUnit(entry.sn);
+      while (funcStmt.step()) {
+        FlatFunc fn;
+        fn.sn = funcStmt.getInt(0);
+        fn.preClassId = funcStmt.getInt(1);
+        fn.name = funcStmt.getBlob(2);
+        fn.top = funcStmt.getInt(3);
+        fn.extraData = funcStmt.getBlob(4);
+        unit.funcs.push_back(std::move(fn));
+      }
+
+      BlobEncoder record;
+      record(unit);
+      w.align();
+      entry.bcLen = bc.size();
+      entry.bcOff = w.write(bc.data(), bc.size());
+      entry.recordLen = record.size();
+      entry.recordOff = w.write(record.data(), record.size());
+      units.push_back(entry);
+    }
+
+    // Like Repo::GetFileHashStmt: the newest unit for each path wins.
+    SqliteStmt fileStmt(db,
+      "SELECT f.path,f.md5 FROM " + tableName("FileMd5") + " AS f, " +
+      tableName("Unit") + " AS u WHERE f.md5 == u.md5"
+      " ORDER BY f.path ASC, u.unitSn DESC;");
+    while (fileStmt.step()) {
+      std::string path = fileStmt.getBlob(0);
+      std::string md5 = fileStmt.getBlob(1);
+      if (md5.size() != 16) continue;
+      if (!files.empty() && files.back().first == path) continue;
+      files.emplace_back(path, MD5(md5.data()));
+    }
+  } catch (const RepoExc& re) {
+    error = re.msg();
+    return false;
+  }
+
+  std::sort(units.begin(), units.end());
+  // SQLite's default collation compares bytes, as does StringPiece, but
+  // don't depend on it.
+  std::sort(files.begin(), files.end(),
+            [] (const std::pair<std::string, MD5>& a,
+                const std::pair<std::string, MD5>& b) {
+              return folly::StringPiece(a.first) < folly::StringPiece(b.first);
+            });
+
+  std::vector<FileEntry> fileEntries;
+  fileEntries.reserve(files.size());
+  for (auto const& file : files) {
+    FileEntry e;
+    e.pathLen = file.first.size();
+    e.pathOff = w.write(file.first.data(), file.first.size());
+    e.md5[0] = file.second.q[0];
+    e.md5[1] = file.second.q[1];
+    fileEntries.push_back(e);
+  }
+
+  w.align();
+  memcpy(header.magic, kFlatRepoMagic, sizeof header.magic);
+  strncpy(header.schema, kRepoSchemaId, sizeof header.schema);
+  header.numUnits = units.size();
+  header.unitsOff = w.write(units.data(), units.size() * sizeof(UnitEntry));
+  header.numFiles = fileEntries.size();
+  header.filesOff = w.write(fileEntries.data(),
+                            fileEntries.size() * sizeof(FileEntry));
+  if (w.m_ok && fseek(f, 0, SEEK_SET) == 0) {
+    w.write(&header, sizeof header);
+  } else {
+    w.m_ok = false;
+  }
+  closed = true;
+  if (fclose(f) != 0) w.m_ok = false;
+  if (!w.m_ok || rename(tmpPath.c_str(), outPath.c_str()) != 0) {
+    error = "Unable to write " + outPath;
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  Logger::Info("Wrote flat repo %s: %zu units, %zu files",
+               outPath.c_str(), units.size(), fileEntries.size());
+  return true;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}
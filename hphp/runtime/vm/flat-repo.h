@@ -0,0 +1,91 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_VM_FLAT_REPO_H_
+#define incl_HPHP_VM_FLAT_REPO_H_
+
+#include <string>
+#include <vector>
+
+#include "hphp/runtime/base/md5.h"
+
+namespace HPHP {
+
+class Unit;
+class UnitEmitter;
+
+/*
+ * A flat repo is a read-only, single-file copy of a central repo for
+ * RepoAuthoritative servers, set with Repo.FlatPath.  The file is
+ * mapped once per process and read without SQLite or any locks:
+ *
+ *   FlatRepoHeader
+ *   per unit: bytecode, then one BlobEncoder record with the rest of the
+ *             unit's rows (litstrs, arrays, preclasses, mergeables, funcs)
+ *   unit index, sorted by md5
+ *   file index (path -> md5), sorted by path, and the paths it points to
+ *
+ * Units are still only loaded when something first needs them, but a
+ * load is a binary search and a decode of one contiguous record instead
+ * of six SQLite queries.  Build one from an existing repo with
+ *
+ *   hhvm --convert-repo=<flat repo> -v Repo.Central.Path=<hhbc repo>
+ */
+class FlatRepo {
+ public:
+  /*
+   * The process's flat repo, mapped on first use; nullptr unless
+   * Repo.FlatPath is set (and RepoAuthoritative is on) and the file is a
+   * flat repo for this build's repo schema.
+   */
+  static const FlatRepo* Get();
+
+  /*
+   * Map the flat repo at path for the rest of the process; nullptr if it
+   * can't be read or isn't a flat repo for this build's repo schema.
+   */
+  static const FlatRepo* Open(const std::string& path);
+
+  /*
+   * Write the repo at repoPath out as a flat repo at outPath.  On
+   * failure, returns false with a description in error.
+   */
+  static bool Convert(const std::string& repoPath, const std::string& outPath,
+                      std::string& error);
+
+  bool findFile(const char* path, const std::string& root, MD5& md5) const;
+  Unit* loadUnit(const std::string& name, const MD5& md5) const;
+  void enumerateFiles(std::vector<std::string>& paths) const;
+
+ private:
+  struct UnitEntry;
+  struct FileEntry;
+
+  FlatRepo(const char* base, size_t size);
+  bool findPath(const char* path, size_t len, MD5& md5) const;
+  void decodeUnit(const UnitEntry& entry, UnitEmitter& ue) const;
+
+  const char* m_base;
+  size_t m_size;
+  const UnitEntry* m_units;
+  size_t m_numUnits;
+  const FileEntry* m_files;
+  size_t m_numFiles;
+};
+
+}
+
+#endif
@@ -696,7 +696,7 @@ Func::SharedData::SharedData(PreClass* preClass, Id id,
   : m_preClass(preClass), m_id(id), m_base(base),
     m_numLocals(0), m_numIterators(0),
     m_past(past), m_line1(line1), m_line2(line2),
-    m_info(nullptr), m_refBitPtr(0), m_builtinFuncPtr(nullptr),
+    m_provenReturnType(KindOfInvalid), m_info(nullptr), m_refBitPtr(0), m_builtinFuncPtr(nullptr),
     m_docComment(docComment), m_top(top), m_isClosureBody(false),
     m_isGenerator(false), m_isGeneratorFromClosure(false),
     m_isPairGenerator(false), m_hasGeneratorAsBody(false),
@@ -765,6 +765,7 @@ FuncEmitter::FuncEmitter(UnitEmitter& ue, int sn, Id id, const StringData* n)
   , m_nextFreeIterator(0)
   , m_retTypeConstraint(nullptr)
   , m_returnType(KindOfInvalid)
+  , m_provenReturnType(KindOfInvalid)
   , m_top(false)
   , m_isClosureBody(false)
   , m_isGenerator(false)
@@ -791,6 +792,7 @@ FuncEmitter::FuncEmitter(UnitEmitter& ue, int sn, const StringData* n,
   , m_nextFreeIterator(0)
   , m_retTypeConstraint(nullptr)
   , m_returnType(KindOfInvalid)
+  , m_provenReturnType(KindOfInvalid)
   , m_top(false)
   , m_isClosureBody(false)
   , m_isGenerator(false)
@@ -1057,6 +1059,7 @@ Func* FuncEmitter::create(Unit& unit, PreClass* preClass /* = NULL */) const {
 
   f->shared()->m_info = m_info;
   f->shared()->m_returnType = m_returnType;
+  f->shared()->m_provenReturnType = m_provenReturnType;
   std::vector<Func::ParamInfo> pBuilder;
   for (unsigned i = 0; i < m_params.size(); ++i) {
     Func::ParamInfo pi;
@@ -1189,6 +1192,7 @@ void FuncEmitter::serdeMetaData(SerDe& sd) {
     (m_past)
     (m_attrs)
     (m_returnType)
+    (m_provenReturnType)
     (m_docComment)
     (m_numLocals)
     (m_numIterators)
@@ -1212,6 +1216,9 @@ void FuncEmitter::serdeMetaData(SerDe& sd) {
     ;
 }
 
+// The flat repo (flat-repo.cpp) decodes these outside the repo proxies.
+template void FuncEmitter::serdeMetaData<>(BlobDecoder&);
+
 //=============================================================================
 // FuncRepoProxy.
 
@@ -277,6 +277,12 @@ struct Func {
   int line1() const { return shared()->m_line1; }
   int line2() const { return shared()->m_line2; }
   DataType returnType() const { return shared()->m_returnType; }
+  // What every return in the body was proven to return by whole-program
+  // analysis, or KindOfInvalid/KindOfUnknown. Unlike returnType(), never
+  // taken from an (unenforced) return type annotation.
+  DataType provenReturnType() const {
+    return shared()->m_provenReturnType;
+  }
   const SVInfoVec& staticVars() const { return shared()->m_staticVars; }
   const StringData* name() const {
     assert(m_name != nullptr);
@@ -465,6 +471,7 @@ private:
     int m_line1;
     int m_line2;
     DataType m_returnType;
+    DataType m_provenReturnType;
     const ClassInfo::MethodInfo* m_info; // For builtins.
     // bits 64 and up of the reffiness guards (first 64 bits
     // are in Func::m_refBitVal)
@@ -682,6 +689,7 @@ public:
   }
 
   void setReturnType(DataType dt) { m_returnType = dt; }
+  void setProvenReturnType(DataType dt) { m_provenReturnType = dt; }
   void setDocComment(const char *dc) {
     m_docComment = makeStaticString(dc);
   }
@@ -721,6 +729,7 @@ private:
 
   Attr m_attrs;
   DataType m_returnType;
+  DataType m_provenReturnType;
   bool m_top;
   const StringData* m_docComment;
   bool m_isClosureBody;
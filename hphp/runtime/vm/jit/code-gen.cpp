@@ -297,6 +297,8 @@ CALL_OPCODE(RaiseWarning)
 CALL_OPCODE(IncStatGrouped)
 CALL_OPCODE(ClosureStaticLocInit)
 CALL_OPCODE(ArrayIdx)
+CALL_OPCODE(CountArray)
+CALL_OPCODE(ChrInt)
 CALL_OPCODE(LdGblAddrDef)
 
 // Vector instruction helpers
@@ -329,6 +331,7 @@ CALL_STK_OPCODE(SetWithRefElem)
 CALL_STK_OPCODE(SetWithRefNewElem)
 CALL_OPCODE(ArraySet)
 CALL_OPCODE(VectorSet)
+CALL_OPCODE(VectorAppend)
 CALL_OPCODE(MapSet)
 CALL_OPCODE(StableMapSet)
 CALL_OPCODE(ArraySetRef)
@@ -2424,10 +2427,13 @@ void CodeGenerator::cgLdObjMethod(IRInstruction *inst) {
   auto name      = inst->src(1);
   auto actRec    = inst->src(2);
   auto actRecReg = m_regs[actRec].reg();
-  CacheHandle handle = Transl::TargetCache::MethodCache::alloc();
+  auto const numEntries = MethodPIC::numEntries();
+  CacheHandle handle = MethodPIC::alloc(numEntries);
+  MethodPIC::Profile* profile = RuntimeOption::EvalJitPICStats
+    ? MethodPIC::allocProfile(curFunc(), m_curInst->marker().bcOff,
+                              name->getValStr())
+    : nullptr;
 
-  // lookup in the targetcache
-  assert(MethodCache::kNumLines == 1);
   if (debug) {
     MethodCache::Pair p;
     static_assert(sizeof(p.m_value) == 8,
@@ -2436,22 +2442,37 @@ void CodeGenerator::cgLdObjMethod(IRInstruction *inst) {
                   "MethodCache::Pair::m_key assumed to be 8 bytes");
   }
 
-  // preload handle->m_value
-  m_as.loadq(rVmTl[handle + offsetof(MethodCache::Pair, m_value)], m_rScratch);
-  m_as.cmpq (rVmTl[handle + offsetof(MethodCache::Pair, m_key)], clsReg);
-  ifThenElse(CC_E, // if handle->key == cls
-             [&] { // then actReg->m_func = handle->value
+  // Compare cls with each entry's key, preloading the entry's m_value.
+  // Hits jump to the ifThenElse below with the flags from their compare.
+  Label hit;
+  for (int i = 0; i < numEntries; ++i) {
+    auto const pair = handle + i * sizeof(MethodCache::Pair);
+    m_as.loadq(rVmTl[pair + offsetof(MethodCache::Pair, m_value)],
+               m_rScratch);
+    m_as.cmpq (rVmTl[pair + offsetof(MethodCache::Pair, m_key)], clsReg);
+    if (i + 1 < numEntries) m_as.jcc(CC_E, hit);
+  }
+  asm_label(m_as, hit);
+  ifThenElse(CC_E, // if some entry's key == cls
+             [&] { // then actReg->m_func = that entry's value
                m_as.storeq(m_rScratch, actRecReg[AROFF(m_func)]);
+               if (profile) {
+                 m_as.movq(&profile->hits, m_rScratch);
+                 m_as.lock();
+                 m_as.incq(*m_rScratch);
+               }
              },
              [&] { // else call slow path helper
                cgCallHelper(m_as,
-                            CppCall(methodCacheSlowPath),
+                            CppCall(methodPICSlowPath),
                             kVoidDest,
                             SyncOptions::kSyncPoint,
                             ArgGroup(m_regs).addr(rVmTl, handle)
                                             .ssa(actRec)
                                             .ssa(name)
-                                            .ssa(cls));
+                                            .ssa(cls)
+                                            .imm(numEntries)
+                                            .immPtr(profile));
              });
 }
 
@@ -2904,6 +2925,26 @@ void CodeGenerator::cgReqRetranslate(IRInstruction* inst) {
   m_tx64->emitFallbackUncondJmp(m_as, *destSR);
 }
 
+void CodeGenerator::cgLoopHeader(IRInstruction* inst) {
+  assert(!m_state.loopHeader);
+  m_state.loopHeader = m_as.frontier();
+  for (TCA immPtr : m_state.loopHeaderPatches) {
+    ssize_t diff = m_state.loopHeader - (immPtr + sizeof(int32_t));
+    *(int32_t*)immPtr = safe_cast<int32_t>(diff);
+  }
+  m_state.loopHeaderPatches.clear();
+}
+
+void CodeGenerator::cgJmpLoopHeader(IRInstruction* inst) {
+  if (auto addr = m_state.loopHeader) {
+    return m_as.jmpAuto(addr);
+  }
+
+  // Only happens when the block layout is randomized.
+  m_as.jmp(m_as.frontier());
+  m_state.loopHeaderPatches.push_back(m_as.frontier() - 4);
+}
+
 void CodeGenerator::cgIncRefWork(Type type, SSATmp* src) {
   assert(type.maybeCounted());
   auto increfMaybeStatic = [&] {
@@ -4436,6 +4477,24 @@ void CodeGenerator::cgLdVectorSize(IRInstruction* inst) {
              toReg32(m_regs[inst->dst()].reg()));
 }
 
+void CodeGenerator::cgCountArrayFast(IRInstruction* inst) {
+  SSATmp* arr = inst->src(0);
+  assert(arr->type().hasArrayKind() &&
+         (arr->type().getArrayKind() == ArrayData::kPackedKind ||
+          arr->type().getArrayKind() == ArrayData::kMixedKind));
+  auto arrReg = m_regs[arr].reg();
+  m_as.loadl(arrReg[ArrayData::offsetofSize()],
+             toReg32(m_regs[inst->dst()].reg()));
+}
+
+void CodeGenerator::cgOrdStr(IRInstruction* inst) {
+  auto strReg = m_regs[inst->src(0)].reg();
+  auto dstReg = m_regs[inst->dst()].reg();
+  // Strings are always NUL-terminated, so this gives 0 for "".
+  m_as.loadq(strReg[StringData::dataOffset()], dstReg);
+  m_as.loadzbl(dstReg[0], toReg32(dstReg));
+}
+
 void CodeGenerator::cgLdVectorBase(IRInstruction* inst) {
   SSATmp* vec = inst->src(0);
   assert(vec->type().strictSubtypeOf(Type::Obj) &&
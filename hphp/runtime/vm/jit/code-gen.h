@@ -88,6 +88,7 @@ struct CodegenState {
     , lifetime(lifetime)
     , asmInfo(asmInfo)
     , catches(unit, CatchInfo())
+    , loopHeader(nullptr)
   {}
 
   // Each block has a list of addresses to patch, and an address if
@@ -117,6 +118,11 @@ struct CodegenState {
   // Used to pass information about the state of the world at native
   // calls between cgCallHelper and cgBeginCatch.
   StateVector<Block, CatchInfo> catches;
+
+  // Address of the unit's LoopHeader once it's emitted, and the
+  // JmpLoopHeader jumps emitted before it, to be patched then.
+  TCA loopHeader;
+  std::vector<TCA> loopHeaderPatches;
 };
 
 constexpr Reg64  rCgGP  (reg::r11);
@@ -151,7 +151,7 @@ public:
   void recordFixup(CTCA tca, const Fixup& fixup) {
     TRACE(3, "FixupMapImpl::recordFixup: tca %p -> (pcOff %d, spOff %d)\n",
           tca, fixup.m_pcOffset, fixup.m_spOffset);
-    m_fixups.insert(tca, FixupEntry(fixup));
+    m_fixups.insertOrUpdate(tca, FixupEntry(fixup));
   }
 
   bool getFrameRegs(const ActRec* ar, const ActRec* prevAr,
@@ -182,7 +182,7 @@ private:
   void recordIndirectFixup(CTCA tca, const IndirectFixup& indirect) {
     TRACE(2, "FixupMapImpl::recordIndirectFixup: tca %p -> ripOff %d\n",
           tca, indirect.returnIpDisp);
-    m_fixups.insert(tca, FixupEntry(indirect));
+    m_fixups.insertOrUpdate(tca, FixupEntry(indirect));
   }
 
   const Opcode* pc(const ActRec* ar, const Func* f, const Fixup& fixup) const {
@@ -209,6 +209,8 @@ private:
   }
 
 private:
+  // Entries for reclaimed translations are left behind and overwritten if
+  // the code is reused (see TranslatorX64::reclaimTranslations).
   TreadHashMap<CTCA,FixupEntry,ctca_identity_hash> m_fixups;
 
   std::vector<PendingFixup> m_pendingFixups;
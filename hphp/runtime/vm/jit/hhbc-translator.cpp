@@ -81,6 +81,9 @@ HhbcTranslator::HhbcTranslator(Offset startOffset,
   , m_startBcOff(startOffset)
   , m_lastBcOff(false)
   , m_hasExit(false)
+  , m_trustsReturnTypes(false)
+  , m_hasLoopHeader(false)
+  , m_loopHeaderSpOff(0)
   , m_stackDeficit(0)
   , m_evalStack(*m_tb)
 {
@@ -1678,6 +1681,21 @@ void HhbcTranslator::emitIncTransCounter() {
   m_tb->gen(IncTransCounter);
 }
 
+void HhbcTranslator::emitLoopHeader(
+    const std::vector<RegionDesc::TypePred>& guards) {
+  assert(bcOff() == m_startBcOff && !isInlining());
+  assert(!m_hasLoopHeader);
+  for (auto const& guard : guards) {
+    // A back-edge doesn't know anything more about the stack than
+    // the guards' exits do.
+    if (guard.location.tag() != RegionDesc::Location::Tag::Local) return;
+  }
+  m_hasLoopHeader = true;
+  m_loopHeaderSpOff = m_tb->spOffset();
+  m_loopGuards = guards;
+  gen(LoopHeader);
+}
+
 void HhbcTranslator::emitCheckCold(TransID transId) {
   m_tb->gen(CheckCold, makeExitOpt(transId), TransIDData(transId));
 }
@@ -2518,6 +2536,165 @@ void HhbcTranslator::emitFCall(uint32_t numParams,
   if (!m_fpiStack.empty()) {
     m_fpiStack.pop();
   }
+
+  // The compiler proved what every return in the callee returns, so
+  // there's nothing to guard.  inferredReturnType() gives up on callees
+  // that may be intercepted, and the translation is recorded so it can
+  // be thrown away if that changes.
+  auto const retDt = inferredReturnType(callee);
+  if (retDt != KindOfAny) {
+    assertTypeStack(0, Type(retDt));
+    m_trustsReturnTypes = true;
+  }
+}
+
+/*
+ * Builtins we lower to inline IR when the types of their arguments are
+ * known.  (strlen, abs, array_key_exists and the is_* family never get
+ * here; the emitter already turns them into bytecodes of their own.)
+ *
+ * Each emitter looks at the arguments on top of the eval stack, which
+ * include any default values the emitter pushed.  If it can handle
+ * them it pops them, pushes the result and returns true; otherwise it
+ * leaves the stack alone and we make the usual CallBuiltin.
+ */
+namespace {
+// Longest constant haystack in_array() gets unrolled for.
+const size_t kMaxInArrayElems = 8;
+}
+
+bool HhbcTranslator::emitIntrinsic(const Func* callee, uint32_t numArgs) {
+  struct Intrinsic {
+    const char* name;
+    bool (HhbcTranslator::*emit)(uint32_t);
+    Stats::StatCounter hits;
+  };
+  static const Intrinsic intrinsics[] = {
+    { "count",    &HhbcTranslator::emitCountIntrinsic,
+                  Stats::Intrinsic_count },
+    { "sizeof",   &HhbcTranslator::emitCountIntrinsic,
+                  Stats::Intrinsic_count },
+    { "ord",      &HhbcTranslator::emitOrdIntrinsic,
+                  Stats::Intrinsic_ord },
+    { "chr",      &HhbcTranslator::emitChrIntrinsic,
+                  Stats::Intrinsic_chr },
+    { "in_array", &HhbcTranslator::emitInArrayIntrinsic,
+                  Stats::Intrinsic_in_array },
+  };
+
+  for (auto const& intrinsic : intrinsics) {
+    if (strcasecmp(callee->name()->data(), intrinsic.name)) continue;
+    if (!(this->*intrinsic.emit)(numArgs)) {
+      FTRACE(2, "intrinsic {} not lowered\n", intrinsic.name);
+      return false;
+    }
+    emitIncStat(intrinsic.hits, 1);
+    return true;
+  }
+  return false;
+}
+
+bool HhbcTranslator::emitCountIntrinsic(uint32_t numArgs) {
+  // count($var, $mode = COUNT_NORMAL)
+  if (numArgs != 2) return false;
+  auto const mode = topC(0);
+  if (!mode->isConst() || !mode->isA(Type::Int) || mode->getValInt() != 0) {
+    return false;
+  }
+
+  auto const var = topC(1);
+  auto const type = var->type();
+  SSATmp* result;
+  if (type.subtypeOf(Type::Arr)) {
+    if (var->isConst()) {
+      result = cns(int64_t(var->getValArr()->size()));
+    } else if (type.hasArrayKind() &&
+               (type.getArrayKind() == ArrayData::kPackedKind ||
+                type.getArrayKind() == ArrayData::kMixedKind)) {
+      m_tb->constrainValue(var, DataTypeSpecialized);
+      result = gen(CountArrayFast, var);
+    } else {
+      result = gen(CountArray, var);
+    }
+  } else if (type.isNull()) {
+    result = cns(0);
+  } else if (type.subtypeOfAny(Type::Bool, Type::Int, Type::Dbl, Type::Str)) {
+    result = cns(1);
+  } else {
+    // Objects may implement Countable.
+    return false;
+  }
+
+  popC();
+  popC();
+  push(result);
+  gen(DecRef, var);
+  return true;
+}
+
+bool HhbcTranslator::emitOrdIntrinsic(uint32_t numArgs) {
+  if (numArgs != 1) return false;
+  auto const str = topC(0);
+  if (!str->isA(Type::Str)) return false;
+
+  popC();
+  if (str->isConst()) {
+    push(cns(int64_t(uint8_t(str->getValStr()->data()[0]))));
+  } else {
+    push(gen(OrdStr, str));
+    gen(DecRef, str);
+  }
+  return true;
+}
+
+bool HhbcTranslator::emitChrIntrinsic(uint32_t numArgs) {
+  if (numArgs != 1) return false;
+  auto const ascii = topC(0);
+  if (!ascii->isA(Type::Int)) return false;
+
+  popC();
+  if (ascii->isConst()) {
+    push(cns(makeStaticString(char(ascii->getValInt()))));
+  } else {
+    push(gen(ChrInt, ascii));
+  }
+  return true;
+}
+
+bool HhbcTranslator::emitInArrayIntrinsic(uint32_t numArgs) {
+  // in_array($needle, $haystack, $strict = false), for an int needle
+  // and a small literal haystack of ints, where strict and loose
+  // comparison agree.
+  if (numArgs != 3) return false;
+  auto const strict = topC(0);
+  auto const haystack = topC(1);
+  auto const needle = topC(2);
+  if (!strict->isConst() || !strict->isA(Type::Bool)) return false;
+  if (!haystack->isConst() || !haystack->isA(Type::Arr)) return false;
+  if (!needle->isA(Type::Int)) return false;
+
+  auto const arr = haystack->getValArr();
+  if (arr->size() > kMaxInArrayElems) return false;
+  std::vector<int64_t> vals;
+  for (ArrayIter it(arr); it; ++it) {
+    auto const& val = it.secondRef();
+    if (!val.isInteger()) return false;
+    vals.push_back(val.toInt64());
+  }
+
+  // Or together one compare per element; there's no control flow, so
+  // this stays a single block.
+  SSATmp* found = cns(int64_t(0));
+  for (auto val : vals) {
+    auto const eq = gen(ConvBoolToInt, gen(Eq, needle, cns(val)));
+    found = gen(BitOr, found, eq);
+  }
+
+  popC();
+  popC();
+  popC();
+  push(gen(ConvIntToBool, found));
+  return true;
 }
 
 void HhbcTranslator::emitFCallBuiltin(uint32_t numArgs,
@@ -2528,6 +2705,10 @@ void HhbcTranslator::emitFCallBuiltin(uint32_t numArgs,
 
   callee->validate();
 
+  if (RuntimeOption::EvalHHIRIntrinsics && emitIntrinsic(callee, numArgs)) {
+    return;
+  }
+
   // spill args to stack. We need to spill these for two resons:
   // 1. some of the arguments may be passed by reference, for which
   //    case we will pass a stack address.
@@ -4448,12 +4629,48 @@ Block* HhbcTranslator::makeExitImpl(Offset targetBcOff, ExitFlag flag,
 
   if (bcOff() == m_startBcOff && targetBcOff == m_startBcOff) {
     gen(ReqRetranslate);
+  } else if (flag == ExitFlag::JIT && !customFn &&
+             canJmpToLoopHeader(targetBcOff, exitMarker)) {
+    gen(JmpLoopHeader);
   } else {
     gen(ReqBindJmp, BCOffset(targetBcOff));
   }
   return exit;
 }
 
+/*
+ * Whether an exit to targetBcOff can jump straight to this trace's
+ * LoopHeader: it must return to the loop header in the same frame, with
+ * the same stack depth, and with every guarded local known to already
+ * have its guarded type.
+ */
+bool HhbcTranslator::canJmpToLoopHeader(Offset targetBcOff,
+                                        const BCMarker& exitMarker) {
+  if (!m_hasLoopHeader || targetBcOff != m_startBcOff || isInlining() ||
+      exitMarker.spOff != m_loopHeaderSpOff) {
+    return false;
+  }
+
+  // Check without constraining anything first, so a back-edge that
+  // can't skip the guards doesn't keep them from being relaxed.
+  for (auto const& guard : m_loopGuards) {
+    auto const type = m_tb->localType(guard.location.localId(),
+                                      DataTypeGeneric);
+    if (type.equals(Type::None) || !type.subtypeOf(guard.type)) {
+      FTRACE(2, "canJmpToLoopHeader: local {} is {}, not {}\n",
+             guard.location.localId(), type.toString(),
+             guard.type.toString());
+      return false;
+    }
+  }
+  for (auto const& guard : m_loopGuards) {
+    m_tb->localType(guard.location.localId(),
+                    guard.type.isSpecialized() ? DataTypeSpecialized
+                                               : DataTypeSpecific);
+  }
+  return true;
+}
+
 /*
  * Create a catch trace for the current state of the eval stack. This is a
  * trace intended to be invoked by the unwinder while unwinding a frame
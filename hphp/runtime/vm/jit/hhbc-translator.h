@@ -123,6 +123,10 @@ struct HhbcTranslator {
   TraceBuilder& traceBuilder() const { return *m_tb.get(); }
   IRUnit& unit() { return m_unit; }
 
+  // True if an FCall in this trace asserted its callee's inferred
+  // return type instead of checking it.
+  bool trustsReturnTypes() const { return m_trustsReturnTypes; }
+
   // In between each emit* call, irtranslator indicates the new
   // bytecode offset (or whether we're finished) using this API.
   void setBcOff(Offset newOff, bool lastBcOff);
@@ -447,6 +451,7 @@ struct HhbcTranslator {
   void emitStrlen();
   void emitIncStat(int32_t counter, int32_t value, bool force = false);
   void emitIncTransCounter();
+  void emitLoopHeader(const std::vector<RegionDesc::TypePred>& guards);
   void emitCheckCold(Transl::TransID transId);
   void emitRB(Trace::RingBufferType t, SrcKey sk);
   void emitRB(Trace::RingBufferType t, std::string msg) {
@@ -515,6 +520,7 @@ private:
     void emitVectorSet(SSATmp* key, SSATmp* value);
     void emitVectorGet(SSATmp* key);
     void emitVectorIsset();
+    void emitVectorAppend(SSATmp* value);
     void emitPairGet(SSATmp* key);
     void emitPairIsset();
     void emitMapSet(SSATmp* key, SSATmp* value);
@@ -594,7 +600,9 @@ private:
       // simple opcode on Map* (c_StableMap*)
       StableMap,
       // simple opcode on Map* (c_Pair*)
-      Pair
+      Pair,
+      // SetM appending to a Vector* (c_Vector*)
+      VectorAppend
     };
     SimpleOp simpleCollectionOp();
     void constrainSimpleOpBase();
@@ -735,6 +743,11 @@ private:
   SSATmp* staticTVCns(const TypedValue*);
   void emitJmpSurpriseCheck();
   void emitRetSurpriseCheck(SSATmp* retVal);
+  bool emitIntrinsic(const Func* callee, uint32_t numArgs);
+  bool emitCountIntrinsic(uint32_t numArgs);
+  bool emitOrdIntrinsic(uint32_t numArgs);
+  bool emitChrIntrinsic(uint32_t numArgs);
+  bool emitInArrayIntrinsic(uint32_t numArgs);
 
   Type interpOutputType(const NormalizedInstruction&,
                         folly::Optional<Type>&) const;
@@ -790,6 +803,7 @@ private: // Exit trace creation routines.
   typedef std::function<SSATmp* ()> CustomExit;
   Block* makeExitImpl(Offset targetBcOff, ExitFlag flag,
                       std::vector<SSATmp*>& spillValues, const CustomExit&);
+  bool canJmpToLoopHeader(Offset targetBcOff, const BCMarker& exitMarker);
 
 public:
   /*
@@ -918,6 +932,19 @@ private:
   // we'll create a generic ReqBindJmp instruction after we're done.
   bool m_hasExit;
 
+  // See trustsReturnTypes().
+  bool m_trustsReturnTypes;
+
+  /*
+   * Set by emitLoopHeader() when the trace starts at a loop header.  An
+   * exit back to m_startBcOff, in the same frame and with the same stack
+   * depth, whose local types satisfy m_loopGuards jumps to the
+   * LoopHeader instead of going through the entry guards again.
+   */
+  bool m_hasLoopHeader;
+  int32_t m_loopHeaderSpOff;
+  std::vector<RegionDesc::TypePred> m_loopGuards;
+
   /*
    * Tracking of the state of the virtual execution stack:
    *
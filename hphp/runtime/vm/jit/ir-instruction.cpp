@@ -214,6 +214,7 @@ bool IRInstruction::storesCell(uint32_t srcIdx) const {
     case StProp:
     case StPropNT:
     case StElem:
+    case VectorAppend:
       return srcIdx == 2;
 
     case ArraySet:
@@ -446,6 +446,7 @@ O(ReqBindJmp,                       ND, NA,                              T|E) \
 O(ReqInterpret,                     ND, NA,                              T|E) \
 O(ReqRetranslateOpt,                ND, NA,                              T|E) \
 O(ReqRetranslate,                   ND, NA,                              T|E) \
+O(JmpLoopHeader,                    ND, NA,                              T|E) \
 O(SyncABIRegs,                      ND, S(FramePtr) S(StkPtr),             E) \
 O(Mov,                         DofS(0), SUnk,                            C|P) \
 O(LdAddr,                      DofS(0), SUnk,                              C) \
@@ -465,6 +466,7 @@ O(DefInlineFP,             D(FramePtr), S(StkPtr) S(StkPtr) S(FramePtr),  NF) \
 O(InlineReturn,                     ND, S(FramePtr),                       E) \
 O(DefFP,                   D(FramePtr), NA,                                E) \
 O(DefSP,                     D(StkPtr), S(FramePtr),                       E) \
+O(LoopHeader,                       ND, NA,                                E) \
 O(DefInlineSP,               D(StkPtr), S(FramePtr) S(StkPtr),             E) \
 O(ReDefSP,                   D(StkPtr), S(FramePtr) S(StkPtr),            NF) \
 O(PassSP,                    D(StkPtr), S(StkPtr),                         P) \
@@ -499,6 +501,10 @@ O(ConcatStrInt,                 D(Str), S(Str) S(Int),             N|CRc|PRc) \
 O(ConcatCellCell,               D(Str), S(Cell) S(Cell),      N|CRc|PRc|Refs) \
 O(ArrayAdd,                     D(Arr), S(Arr) S(Arr),         N|Mem|CRc|PRc) \
 O(AKExists,                    D(Bool), S(Cell) S(Cell),                 C|N) \
+O(CountArray,                   D(Int), S(Arr),                          C|N) \
+O(CountArrayFast,               D(Int), S(Arr),                            C) \
+O(OrdStr,                       D(Int), S(Str),                            C) \
+O(ChrInt,                 D(StaticStr), S(Int),                          C|N) \
 O(InterpOne,                 D(StkPtr), S(FramePtr) S(StkPtr),                \
                                                              E|N|Mem|Refs|Er) \
 O(InterpOneCF,               D(StkPtr), S(FramePtr) S(StkPtr),                \
@@ -677,6 +683,9 @@ O(VectorSet,                        ND, C(TCA)                                \
                                           S(Obj)                              \
                                           S(Int)                              \
                                           S(Cell),           E|N|Mem|Refs|Er) \
+O(VectorAppend,                     ND, C(TCA)                                \
+                                          S(Obj)                              \
+                                          S(Cell),              E|N|Mem|Refs) \
 O(MapSet,                           ND, C(TCA)                                \
                                           S(Obj)                              \
                                           S(Int,Str)                          \
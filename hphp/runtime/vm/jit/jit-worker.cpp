@@ -0,0 +1,184 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/vm/jit/jit-worker.h"
+
+#include <atomic>
+
+#include <tbb/concurrent_hash_map.h>
+
+#include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/base/program-functions.h"
+#include "hphp/runtime/base/runtime-option.h"
+#include "hphp/runtime/base/thread-init-fini.h"
+#include "hphp/runtime/vm/jit/translator-x64.h"
+#include "hphp/util/job-queue.h"
+#include "hphp/util/logger.h"
+#include "hphp/util/mutex.h"
+#include "hphp/util/trace.h"
+
+namespace HPHP { namespace Transl {
+
+TRACE_SET_MOD(tx64);
+
+//////////////////////////////////////////////////////////////////////
+
+static __thread bool tl_jitWorker = false;
+
+enum class JobState { Pending, Done };
+
+struct JitWorker : JobQueueWorker<TransID> {
+  virtual void onThreadEnter() {
+    tl_jitWorker = true;
+  }
+
+  virtual void doJob(TransID transId);
+
+  virtual void onThreadExit() {
+    hphp_thread_exit();
+  }
+};
+
+/*
+ * Requests look up their job in s_jobs, which only locks the bucket of
+ * that TransID.  s_dispatchLock is taken the first time a TransID is
+ * queued, to start the workers and to keep stopJitWorkers() from deleting
+ * a dispatcher that is being enqueued on.
+ */
+typedef tbb::concurrent_hash_map<TransID, JobState> JobMap;
+static JobMap s_jobs;
+static Mutex s_dispatchLock;
+static JobQueueDispatcher<TransID, JitWorker>* s_dispatcher;
+static std::atomic<bool> s_stopped(false);
+
+void JitWorker::doJob(TransID transId) {
+  TRACE(1, "jit worker: retranslateOpt transId = %u\n", transId);
+  hphp_session_init();
+  hphp_context_init();
+  try {
+    BlockingLeaseHolder writer(Translator::WriteLease());
+    TranslatorX64::Get()->retranslateOpt(transId, false);
+  } catch (const std::exception& e) {
+    Logger::Warning("JIT worker failed on translation %u: %s",
+                    transId, e.what());
+  }
+  {
+    JobMap::accessor acc;
+    if (s_jobs.find(acc, transId)) acc->second = JobState::Done;
+  }
+  hphp_context_exit(g_context.getNoCheck(), false);
+  hphp_session_exit();
+}
+
+struct RelayoutWorker : JobQueueWorker<int> {
+  virtual void doJob(int) {
+    s_relayoutQueued.store(false, std::memory_order_relaxed);
+    TranslatorX64::Get()->relayoutHotTranslations();
+  }
+
+  virtual void onThreadExit() {
+    hphp_thread_exit();
+  }
+
+  static std::atomic<bool> s_relayoutQueued;
+};
+
+std::atomic<bool> RelayoutWorker::s_relayoutQueued(false);
+static JobQueueDispatcher<int, RelayoutWorker>* s_relayoutDispatcher;
+
+static InitFiniNode s_stopWorkers(stopJitWorkers,
+                                  InitFiniNode::When::ProcessExit);
+
+//////////////////////////////////////////////////////////////////////
+
+bool jitWorkersEnabled() {
+  return RuntimeOption::EvalJitWorkerThreads > 0 &&
+         RuntimeOption::EvalJitPGO;
+}
+
+bool isJitWorkerThread() {
+  return tl_jitWorker;
+}
+
+bool enqueueOptTranslation(TransID transId) {
+  assert(!isJitWorkerThread());
+  {
+    JobMap::const_accessor acc;
+    if (s_jobs.find(acc, transId)) return acc->second == JobState::Pending;
+  }
+  if (s_stopped.load(std::memory_order_acquire)) return false;
+  {
+    JobMap::accessor acc;
+    if (!s_jobs.insert(acc, transId)) {
+      // another request beat us to it
+      return acc->second == JobState::Pending;
+    }
+    acc->second = JobState::Pending;
+  }
+
+  Lock l(s_dispatchLock);
+  if (s_stopped.load(std::memory_order_relaxed)) {
+    JobMap::accessor acc;
+    if (s_jobs.find(acc, transId)) acc->second = JobState::Done;
+    return false;
+  }
+  if (!s_dispatcher) {
+    s_dispatcher = new JobQueueDispatcher<TransID, JitWorker>(
+      RuntimeOption::EvalJitWorkerThreads, false, 0, false, nullptr);
+    s_dispatcher->start();
+  }
+  s_dispatcher->enqueue(transId);
+  return true;
+}
+
+void scheduleRelayout() {
+  if (RelayoutWorker::s_relayoutQueued.exchange(true,
+                                                std::memory_order_relaxed)) {
+    return;
+  }
+  Lock l(s_dispatchLock);
+  if (s_stopped.load(std::memory_order_relaxed)) return;
+  if (!s_relayoutDispatcher) {
+    s_relayoutDispatcher = new JobQueueDispatcher<int, RelayoutWorker>(
+      1, false, 0, false, nullptr);
+    s_relayoutDispatcher->start();
+  }
+  s_relayoutDispatcher->enqueue(0);
+}
+
+void stopJitWorkers() {
+  JobQueueDispatcher<TransID, JitWorker>* dispatcher;
+  JobQueueDispatcher<int, RelayoutWorker>* relayoutDispatcher;
+  {
+    Lock l(s_dispatchLock);
+    dispatcher = s_dispatcher;
+    s_dispatcher = nullptr;
+    relayoutDispatcher = s_relayoutDispatcher;
+    s_relayoutDispatcher = nullptr;
+    s_stopped.store(true, std::memory_order_release);
+  }
+  if (dispatcher) {
+    dispatcher->stop();
+    delete dispatcher;
+  }
+  if (relayoutDispatcher) {
+    relayoutDispatcher->stop();
+    delete relayoutDispatcher;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}}
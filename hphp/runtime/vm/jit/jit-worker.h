@@ -0,0 +1,70 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#ifndef incl_HPHP_JIT_WORKER_H_
+#define incl_HPHP_JIT_WORKER_H_
+
+#include "hphp/runtime/vm/jit/types.h"
+
+namespace HPHP { namespace Transl {
+
+/*
+ * Background JIT workers.
+ *
+ * With Eval.JitWorkerThreads > 0, a request that trips the JitPGO
+ * threshold of a profiling translation hands the optimizing
+ * retranslation to a pool of worker threads and carries on in the
+ * interpreter instead of doing region selection, HHIR and codegen
+ * itself.  Optimizing translations are built from the profiled region
+ * alone, so they don't need the request's live frame.
+ *
+ * Workers still emit into the shared code cache under the write lease;
+ * what moves off the request path is the time spent translating.  The
+ * profiling translations stay in place until the optimized one is
+ * published, but their counters have already tripped, so until then a
+ * request entering them goes back through REQ_RETRANSLATE_OPT, finds the
+ * job pending and interprets.
+ */
+bool jitWorkersEnabled();
+
+/*
+ * True on a worker thread.  Code that would normally consult the live
+ * VM frame must not do so when this is set.
+ */
+bool isJitWorkerThread();
+
+/*
+ * Queue an optimizing retranslation of transId.  Returns true if a
+ * worker owns the job (it was just queued, or is still pending), in
+ * which case the caller should just interpret.  Returns false once a
+ * worker has already had its go at transId; if we get here again the
+ * worker didn't manage to replace the profiling translation, so the
+ * caller should retranslate inline as usual.
+ */
+bool enqueueOptTranslation(TransID transId);
+
+/*
+ * Wake the background thread that runs
+ * TranslatorX64::relayoutHotTranslations(), so the request that tripped
+ * Eval.JitRelayoutInterval doesn't pay for it.  Does nothing if a relayout
+ * is already queued.
+ */
+void scheduleRelayout();
+
+void stopJitWorkers();
+
+}}
+
+#endif
@@ -363,13 +363,17 @@ void HhbcTranslator::MInstrTranslator::checkMIState() {
   const bool simpleStringOp = (isCGetM || isIssetM) && isSingle &&
     isSimpleBase() && mcodeMaybeArrayIntKey(m_ni.immVecM[0]) &&
     baseType.subtypeOf(Type::Str);
+  // SetM appending to a Vector
+  const bool simpleVectorAppend = isSetM && isSingle && isSimpleBase() &&
+    m_ni.immVecM[0] == MW && baseType.strictSubtypeOf(Type::Obj) &&
+    baseType.getClass() == c_Vector::classof();
 
   if (simpleProp || singlePropSet ||
       simpleArraySet || simpleArrayGet || simpleCollectionGet ||
       simpleArrayUnset || badUnset || simpleCollectionIsset ||
-      simpleArrayIsset || simpleStringOp) {
+      simpleArrayIsset || simpleStringOp || simpleVectorAppend) {
     setNoMIState();
-    if (simpleCollectionGet || simpleCollectionIsset) {
+    if (simpleCollectionGet || simpleCollectionIsset || simpleVectorAppend) {
       m_tb.constrainValue(baseVal, DataTypeSpecialized);
     } else {
       m_tb.constrainValue(baseVal, DataTypeSpecific);
@@ -652,6 +656,9 @@ HhbcTranslator::MInstrTranslator::simpleCollectionOp() {
             return (klass == c_Vector::classof()) ?
                 SimpleOp::Vector : SimpleOp::Pair;
           }
+        } else if (op == OpSetM && m_ni.immVecM[0] == MW &&
+                   klass == c_Vector::classof()) {
+          return SimpleOp::VectorAppend;
         }
       } else if (klass == c_Map::classof() ||
                  klass == c_StableMap::classof()) {
@@ -680,6 +687,7 @@ void HhbcTranslator::MInstrTranslator::constrainSimpleOpBase() {
     case SimpleOp::Map:
     case SimpleOp::StableMap:
     case SimpleOp::Pair:
+    case SimpleOp::VectorAppend:
       m_tb.constrainValue(m_base, DataTypeSpecialized);
       return;
   }
@@ -1830,6 +1838,9 @@ void HhbcTranslator::MInstrTranslator::emitCGetElem() {
   case SimpleOp::StableMap:
     emitStableMapGet(key);
     break;
+  case SimpleOp::VectorAppend:
+    not_reached();
+    break;
   case SimpleOp::None:
     typedef TypedValue (*OpFunc)(TypedValue*, TypedValue, MInstrState*);
     BUILD_OPTAB_HOT(getKeyType(key));
@@ -2089,6 +2100,9 @@ void HhbcTranslator::MInstrTranslator::emitIssetElem() {
   case SimpleOp::StableMap:
     emitStableMapIsset();
     break;
+  case SimpleOp::VectorAppend:
+    not_reached();
+    break;
   case SimpleOp::None:
     emitIssetEmptyElem(false);
     break;
@@ -2378,6 +2392,7 @@ void HhbcTranslator::MInstrTranslator::emitSetElem() {
     emitArraySet(key, value);
     break;
   case SimpleOp::String:
+  case SimpleOp::VectorAppend:
     not_reached();
     break;
   case SimpleOp::Vector:
@@ -2561,8 +2576,24 @@ void HhbcTranslator::MInstrTranslator::emitVGetNewElem() {
   SPUNT(__func__);
 }
 
+namespace MInstrHelpers {
+HOT_FUNC_VM
+void vectorAppend(c_Vector* vec, Cell value) {
+  vec->add(&value);
+}
+}
+
+void HhbcTranslator::MInstrTranslator::emitVectorAppend(SSATmp* value) {
+  gen(VectorAppend, cns((TCA)MInstrHelpers::vectorAppend), m_base, value);
+  m_result = value;
+}
+
 void HhbcTranslator::MInstrTranslator::emitSetNewElem() {
   SSATmp* value = getValue();
+  if (simpleCollectionOp() == SimpleOp::VectorAppend) {
+    emitVectorAppend(value);
+    return;
+  }
   if (m_base->type().subtypeOf(Type::PtrToArr)) {
     gen(SetNewElemArray, makeCatchSet(), m_base, value);
   } else {
@@ -20,6 +20,7 @@
 #include "hphp/runtime/vm/runtime.h"
 #include "hphp/runtime/vm/runtime-type-profiler.h"
 #include "hphp/runtime/base/stats.h"
+#include "hphp/runtime/base/static-string-table.h"
 #include "hphp/runtime/base/tv-conversions.h"
 #include "hphp/runtime/vm/jit/code-gen-helpers.h"
 #include "hphp/runtime/vm/jit/target-cache.h"
@@ -210,6 +211,10 @@ static CallMap s_callMap {
                            {{SSA, 0}}},
     {ArrayIdx,           fssa(0), DTV, SSync,
                            {{SSA, 1}, {SSA, 2}, {TV, 3}}},
+    {CountArray,         method(&ArrayData::size), DSSA, SNone,
+                           {{SSA, 0}}},
+    {ChrInt,             static_cast<StringData* (*)(char)>(makeStaticString),
+                           DSSA, SNone, {{SSA, 0}}},
     {LdGblAddrDef,       ldGblAddrDefHelper, DSSA, SNone,
                            {{SSA, 0}}},
 
@@ -286,6 +291,7 @@ static CallMap s_callMap {
                  {{SSA, 1}, {SSA, 2}, {TV, 3}}},
     {VectorSet, fssa(0), DNone, SSync,
                  {{SSA, 1}, {SSA, 2}, {TV, 3}}},
+    {VectorAppend, fssa(0), DNone, SSync, {{SSA, 1}, {TV, 2}}},
     {MapSet,   fssa(0), DNone, SSync,
                  {{SSA, 1}, {SSA, 2}, {TV, 3}}},
     {StableMapSet, fssa(0), DNone, SSync,
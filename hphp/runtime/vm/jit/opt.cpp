@@ -134,6 +134,14 @@ void optimize(IRUnit& unit, TraceBuilder& traceBuilder) {
     doPass(optimizePredictions, "prediction opts");
   }
 
+  if (RuntimeOption::EvalHHIRScalarReplacement &&
+      RuntimeOption::EvalHHIRDeadCodeElim) {
+    if (scalarReplaceArrays(unit)) {
+      finishPass("scalar replacement");
+      dce("scalar replacement");
+    }
+  }
+
   if (RuntimeOption::EvalHHIRExtraOptPass
       && (RuntimeOption::EvalHHIRCse
           || RuntimeOption::EvalHHIRSimplification)) {
@@ -34,6 +34,13 @@ void optimizeJumps(IRUnit&);
 void eliminateUnconditionalJump(IRUnit&);
 void eliminateDeadCode(IRUnit&);
 
+/*
+ * Replace packed arrays that never escape the unit with the SSA values
+ * of their elements.  Returns true if it changed anything; the caller
+ * should run dce afterwards to clean up.
+ */
+bool scalarReplaceArrays(IRUnit&);
+
 /*
  * Run all the optimization passes.
  */
@@ -17,7 +17,14 @@
 #include "hphp/runtime/vm/jit/prof-data.h"
 
 #include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
 #include "hphp/util/base.h"
+#include "hphp/util/logger.h"
+#include "hphp/util/repo-schema.h"
+#include "hphp/runtime/base/md5.h"
+#include "hphp/runtime/vm/blob-helper.h"
 #include "hphp/runtime/vm/jit/normalized-instruction.h"
 #include "hphp/runtime/vm/jit/tracelet.h"
 #include "hphp/runtime/vm/jit/translator.h"
@@ -121,7 +128,7 @@ ProfTransRec::ProfTransRec(TransID       id,
     , m_lastBcOff(-1)
     , m_region(nullptr)
     , m_sk(sk) {
-  assert(kind == TransAnchor);
+  assert(kind == TransAnchor || kind == TransOptimize);
 }
 
 ProfTransRec::ProfTransRec(TransID       id,
@@ -185,11 +192,209 @@ PrologueCallersRec* ProfTransRec::prologueCallers() const {
 }
 
 
+///////////   PersistedProfile   //////////
+
+/*
+ * On-disk form of the regions chosen by selectHotRegion.  Everything is
+ * keyed by unit md5 and bytecode offset, which survive a restart of the
+ * same repo, rather than FuncId or TransID, which don't.  Only blocks of
+ * the region's entry Func are kept: a region is cut at its first inlined
+ * call, and known callee Funcs are dropped, since neither can be looked up
+ * reliably before the callee's unit is loaded.
+ */
+struct PersistedTypePred {
+  uint32_t    tag;          // RegionDesc::Location::Tag
+  uint32_t    id;           // local id, or stack offset from sp
+  uint32_t    fpOffset;     // stack offset from fp
+  uint64_t    bits;         // Type::rawBits()
+  std::string clsName;      // specialized class, if any
+  bool        hasArrayKind;
+  uint8_t     arrayKind;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(tag)(id)(fpOffset)(bits)(clsName)(hasArrayKind)(arrayKind);
+  }
+};
+
+struct PersistedRefPred {
+  std::vector<uint8_t> mask;
+  std::vector<uint8_t> vals;
+  int64_t              arSpOffset;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(mask)(vals)(arSpOffset);
+  }
+};
+
+struct PersistedBlock {
+  Offset  start;
+  int32_t length;
+  Offset  initialSpOffset;
+  std::vector<std::pair<Offset,PersistedTypePred>> typePreds;
+  std::vector<std::pair<Offset,bool>>              byRefs;
+  std::vector<std::pair<Offset,PersistedRefPred>>  refPreds;
+  std::vector<PersistedTypePred>                   postConds;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(start)(length)(initialSpOffset)(typePreds)(byRefs)(refPreds)
+      (postConds);
+  }
+};
+
+struct PersistedRegion {
+  int64_t                     count; // executions of the profiling trans
+  std::vector<PersistedBlock> blocks;
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(count)(blocks);
+  }
+};
+
+struct PersistedKey {
+  uint64_t md5Hi;
+  uint64_t md5Lo;
+  Offset   offset;
+
+  bool operator==(const PersistedKey& o) const {
+    return md5Hi == o.md5Hi && md5Lo == o.md5Lo && offset == o.offset;
+  }
+
+  struct Hasher {
+    size_t operator()(const PersistedKey& k) const {
+      return hash_int64_pair(k.md5Hi ^ k.md5Lo, k.offset);
+    }
+  };
+
+  template<class SerDe> void serde(SerDe& sd) {
+    sd(md5Hi)(md5Lo)(offset);
+  }
+};
+
+struct PersistedProfile {
+  typedef std::vector<PersistedRegion> RegionVec;
+  hphp_hash_map<PersistedKey,RegionVec,PersistedKey::Hasher> regions;
+};
+
+static const char kProfileMagic[] = "HHVM-JIT-PROFILE-1";
+
+static PersistedKey persistedKey(const SrcKey& sk) {
+  const MD5& md5 = sk.unit()->md5();
+  return PersistedKey{ md5.q[0], md5.q[1], sk.offset() };
+}
+
+static PersistedTypePred persistTypePred(const RegionDesc::TypePred& pred) {
+  typedef RegionDesc::Location::Tag Tag;
+  PersistedTypePred ret;
+  auto const& loc = pred.location;
+  ret.tag = uint32_t(loc.tag());
+  ret.id = loc.tag() == Tag::Local ? loc.localId() : loc.stackOffset();
+  ret.fpOffset = loc.tag() == Tag::Stack ? loc.stackOffsetFromFp() : 0;
+  ret.bits = pred.type.rawBits();
+  ret.hasArrayKind = false;
+  ret.arrayKind = 0;
+  if (pred.type.canSpecializeClass() && pred.type.getClass()) {
+    ret.clsName = pred.type.getClass()->name()->data();
+  } else if (pred.type.canSpecializeArrayKind() &&
+             pred.type.hasArrayKind()) {
+    ret.hasArrayKind = true;
+    ret.arrayKind = pred.type.getArrayKind();
+  }
+  return ret;
+}
+
+static RegionDesc::TypePred restoreTypePred(const PersistedTypePred& p) {
+  typedef RegionDesc::Location L;
+  Type type = Type::fromRawBits(p.bits);
+  if (!p.clsName.empty() && type.canSpecializeClass()) {
+    // Classes that aren't around yet just leave the prediction unspecialized.
+    auto const ne = Unit::GetNamedEntity(makeStaticString(p.clsName));
+    if (auto const cls = Unit::lookupUniqueClass(ne)) {
+      type = type.specialize(cls);
+    }
+  } else if (p.hasArrayKind && type.canSpecializeArrayKind()) {
+    type = type.specialize(ArrayData::ArrayKind(p.arrayKind));
+  }
+  if (L::Tag(p.tag) == L::Tag::Local) {
+    return RegionDesc::TypePred{L::Local{p.id}, type};
+  }
+  return RegionDesc::TypePred{L::Stack{p.id, p.fpOffset}, type};
+}
+
+static PersistedRegion persistRegion(const RegionDesc& region,
+                                     int64_t count) {
+  PersistedRegion ret;
+  ret.count = count;
+  const Func* func = region.blocks[0]->func();
+  for (auto const& block : region.blocks) {
+    if (block->func() != func) break;
+
+    ret.blocks.emplace_back();
+    PersistedBlock& pb = ret.blocks.back();
+    pb.start = block->start().offset();
+    pb.length = block->length();
+    pb.initialSpOffset = block->initialSpOffset();
+    for (auto const& it : block->typePreds()) {
+      pb.typePreds.emplace_back(it.first.offset(), persistTypePred(it.second));
+    }
+    for (auto const& it : block->paramByRefs()) {
+      pb.byRefs.emplace_back(it.first.offset(), it.second);
+    }
+    for (auto const& it : block->reffinessPreds()) {
+      PersistedRefPred prp;
+      prp.mask.assign(it.second.mask.begin(), it.second.mask.end());
+      prp.vals.assign(it.second.vals.begin(), it.second.vals.end());
+      prp.arSpOffset = it.second.arSpOffset;
+      pb.refPreds.emplace_back(it.first.offset(), prp);
+    }
+    for (auto const& pred : block->postConds()) {
+      pb.postConds.push_back(persistTypePred(pred));
+    }
+
+    // The caller's blocks after an inlined call only make sense with the
+    // callee's blocks in between, so stop here.
+    if (block->inlinedCallee()) break;
+  }
+  return ret;
+}
+
+static RegionDescPtr restoreRegion(const Func* func,
+                                   const PersistedRegion& pr) {
+  auto region = std::make_shared<RegionDesc>();
+  for (auto const& pb : pr.blocks) {
+    auto block = region->addBlock(func, pb.start, pb.length,
+                                  pb.initialSpOffset);
+    for (auto const& it : pb.typePreds) {
+      block->addPredicted(SrcKey(func, it.first), restoreTypePred(it.second));
+    }
+    for (auto const& it : pb.byRefs) {
+      block->setParamByRef(SrcKey(func, it.first), it.second);
+    }
+    for (auto const& it : pb.refPreds) {
+      RegionDesc::ReffinessPred pred;
+      pred.mask.assign(it.second.mask.begin(), it.second.mask.end());
+      pred.vals.assign(it.second.vals.begin(), it.second.vals.end());
+      pred.arSpOffset = it.second.arSpOffset;
+      block->addReffinessPred(SrcKey(func, it.first), pred);
+    }
+    PostConditions pconds;
+    for (auto const& pred : pb.postConds) {
+      pconds.push_back(restoreTypePred(pred));
+    }
+    block->setPostConditions(pconds);
+  }
+  return region;
+}
+
+
 ///////////   ProfData   //////////
 
 ProfData::ProfData()
     : m_numTrans(0)
-    , m_counters(RuntimeOption::EvalJitPGOThreshold) {
+    , m_counters(RuntimeOption::EvalJitPGOThreshold)
+    , m_recorded(new PersistedProfile) {
+}
+
+ProfData::~ProfData() {
 }
 
 uint32_t ProfData::numTrans() const {
@@ -344,6 +549,18 @@ TransID ProfData::addTransAnchor(const SrcKey& sk) {
   return transId;
 }
 
+/*
+ * Record a translation that was made without a Tracelet, i.e. an
+ * optimizing translation built on a JIT worker thread.  Those are never
+ * profiled, so there's nothing to remember beyond their kind and SrcKey.
+ */
+TransID ProfData::addTransNonProf(TransKind kind, const SrcKey& sk) {
+  assert(kind == TransOptimize);
+  TransID transId = m_numTrans++;
+  m_transRecs.emplace_back(new ProfTransRec(transId, kind, sk));
+  return transId;
+}
+
 PrologueCallersRec* ProfData::findPrologueCallersRec(const Func* func,
                                                      int nArgs) const {
   TransID tid = prologueTransId(func, nArgs);
@@ -371,4 +588,119 @@ void ProfData::addPrologueGuardCaller(const Func* func, int nArgs, TCA caller) {
   }
 }
 
+void ProfData::recordOptRegion(TransID transId, const RegionDesc& region) {
+  if (region.blocks.empty()) return;
+  // Counters start at JitPGOThreshold and count down.
+  int64_t count = RuntimeOption::EvalJitPGOThreshold - transCounter(transId);
+  auto key = persistedKey(region.blocks[0]->start());
+  auto pr = persistRegion(region, std::max<int64_t>(count, 0));
+
+  Lock lock(m_recordLock);
+  m_recorded->regions[key].push_back(std::move(pr));
+}
+
+bool ProfData::write(const std::string& path) const {
+  BlobEncoder encoder;
+  {
+    Lock lock(m_recordLock);
+    encoder(std::string(kProfileMagic))
+           (std::string(kRepoSchemaId))
+           (m_recorded->regions);
+  }
+
+  // Write to a temporary file and rename it, so a server starting up never
+  // sees a partial profile.
+  std::string tmpPath = path + ".tmp";
+  FILE* f = fopen(tmpPath.c_str(), "wb");
+  if (!f) return false;
+  bool ok = fwrite(encoder.data(), 1, encoder.size(), f) == encoder.size();
+  ok = (fclose(f) == 0) && ok;
+  if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  FTRACE(1, "wrote JIT profile {} ({} SrcKeys, {} bytes)\n",
+         path, m_recorded->regions.size(), encoder.size());
+  return true;
+}
+
+bool ProfData::read(const std::string& path) {
+  FILE* f = fopen(path.c_str(), "rb");
+  if (!f) return false;
+  SCOPE_EXIT { fclose(f); };
+
+  std::vector<char> buf;
+  char chunk[64 * 1024];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof chunk, f)) > 0) {
+    buf.insert(buf.end(), chunk, chunk + n);
+  }
+  if (ferror(f) || buf.empty()) return false;
+
+  std::unique_ptr<PersistedProfile> profile(new PersistedProfile);
+  try {
+    BlobDecoder decoder(&buf[0], buf.size());
+    std::string magic, schema;
+    decoder(magic)(schema);
+    if (magic != kProfileMagic || schema != kRepoSchemaId) {
+      Logger::Warning("Ignoring JIT profile %s: built for repo schema %s",
+                      path.c_str(), schema.c_str());
+      return false;
+    }
+    decoder(profile->regions);
+  } catch (const std::exception& e) {
+    Logger::Warning("Ignoring JIT profile %s: %s", path.c_str(), e.what());
+    return false;
+  }
+
+  // Keep the hottest regions for each SrcKey, up to the usual limit on
+  // translations per SrcKey.
+  for (auto& it : profile->regions) {
+    auto& vec = it.second;
+    std::stable_sort(vec.begin(), vec.end(),
+                     [] (const PersistedRegion& a, const PersistedRegion& b) {
+                       return a.count > b.count;
+                     });
+    if (vec.size() > RuntimeOption::EvalJitMaxTranslations) {
+      vec.resize(RuntimeOption::EvalJitMaxTranslations);
+    }
+  }
+
+  {
+    // Carry the loaded regions over so a later write() doesn't lose them.
+    Lock lock(m_recordLock);
+    for (auto const& it : profile->regions) {
+      auto& vec = m_recorded->regions[it.first];
+      vec.insert(vec.end(), it.second.begin(), it.second.end());
+    }
+  }
+  FTRACE(1, "read JIT profile {} ({} SrcKeys)\n",
+         path, profile->regions.size());
+  m_persisted = std::move(profile);
+  return true;
+}
+
+bool ProfData::loadedPersistedProfile() const {
+  return m_persisted != nullptr;
+}
+
+size_t ProfData::numPersistedRegions(const SrcKey& sk) const {
+  if (!m_persisted) return 0;
+  auto it = m_persisted->regions.find(persistedKey(sk));
+  return it == m_persisted->regions.end() ? 0 : it->second.size();
+}
+
+RegionDescPtr ProfData::persistedRegion(const SrcKey& sk, int index) const {
+  if (!m_persisted) return nullptr;
+  auto it = m_persisted->regions.find(persistedKey(sk));
+  if (it == m_persisted->regions.end() || index >= it->second.size()) {
+    return nullptr;
+  }
+  auto const& pr = it->second[index];
+  if (pr.blocks.empty()) return nullptr;
+  auto region = restoreRegion(sk.func(), pr);
+  if (RuntimeOption::EvalJitPGOLoops) markLoop(*region);
+  return region;
+}
+
 } }
@@ -17,9 +17,12 @@
 #ifndef incl_HPHP_PROF_TRANS_DATA_H_
 #define incl_HPHP_PROF_TRANS_DATA_H_
 
+#include <memory>
+#include <string>
 #include <vector>
 
 #include "hphp/util/base.h"
+#include "hphp/util/mutex.h"
 #include "hphp/runtime/base/types.h"
 #include "hphp/runtime/vm/func.h"
 #include "hphp/runtime/vm/srckey.h"
@@ -168,12 +171,15 @@ class ProfTransRec {
 
 typedef std::unique_ptr<ProfTransRec> ProfTransRecPtr;
 
+struct PersistedProfile;
+
 /**
  * ProfData encapsulates the profiling data kept by the JIT.
  */
 class ProfData {
 public:
   ProfData();
+  ~ProfData();
 
   ProfData(const ProfData&)            = delete;
   ProfData& operator=(const ProfData&) = delete;
@@ -207,6 +213,7 @@ public:
   TransID                 addTransPrologue(TransKind kind, const SrcKey& sk,
                                            int nArgs);
   TransID                 addTransAnchor(const SrcKey& sk);
+  TransID                 addTransNonProf(TransKind kind, const SrcKey& sk);
   PrologueCallersRec*     findPrologueCallersRec(const Func* func,
                                                  int nArgs) const;
   void                    addPrologueMainCaller(const Func* func, int nArgs,
@@ -217,6 +224,23 @@ public:
   bool                    optimized(const SrcKey& sk) const;
   void                    setOptimized(const SrcKey& sk);
 
+  /*
+   * Persisted profiles.  recordOptRegion() remembers the region chosen
+   * for an optimizing retranslation of transId; write() saves every
+   * region remembered so far, and read() loads a file written by a
+   * previous process built with the same repo schema, so that a restarted
+   * server can skip profiling for those SrcKeys.  persistedRegion()
+   * rebuilds the index'th hottest of the numPersistedRegions(sk) regions
+   * loaded for sk, or returns nullptr if there isn't one.
+   */
+  void                    recordOptRegion(TransID transId,
+                                          const RegionDesc& region);
+  bool                    write(const std::string& path) const;
+  bool                    read(const std::string& path);
+  bool                    loadedPersistedProfile() const;
+  size_t                  numPersistedRegions(const SrcKey& sk) const;
+  RegionDescPtr           persistedRegion(const SrcKey& sk, int index) const;
+
 private:
   uint32_t                m_numTrans;
   vector<ProfTransRecPtr> m_transRecs;
@@ -225,6 +249,9 @@ private:
   PrologueToTransMap      m_prologueDB;  // maps (Func,nArgs) => prolog TransID
   PrologueToTransMap      m_dvFuncletDB; // maps (Func,nArgs) => DV funclet
                                          //                      TransID
+  std::unique_ptr<PersistedProfile> m_recorded;  // regions for write()
+  std::unique_ptr<PersistedProfile> m_persisted; // regions from read()
+  mutable Mutex           m_recordLock;
 };
 
 } }
@@ -428,6 +428,28 @@ RegionDescPtr selectRegion(const RegionContext& context,
   return region;
 }
 
+void markLoop(RegionDesc& region) {
+  region.loop = false;
+  if (region.blocks.empty()) return;
+
+  auto const entry = region.blocks.front()->start();
+  auto const unit = entry.unit();
+  auto const bcStart = (const Op*)unit->entry();
+  for (auto const& block : region.blocks) {
+    if (block->func() != entry.func()) continue;
+    auto sk = block->start();
+    for (int i = 0; i < block->length(); ++i, sk.advance(unit)) {
+      if (!instrIsNonCallControlFlow(*(Op*)unit->at(sk.offset()))) continue;
+      if (instrJumpTarget(bcStart, sk.offset()) == entry.offset()) {
+        FTRACE(2, "markLoop: {} jumps back to the region entry\n",
+               showShort(sk));
+        region.loop = true;
+        return;
+      }
+    }
+  }
+}
+
 RegionDescPtr selectHotRegion(TransID transId,
                               TranslatorX64* tx64) {
 
@@ -449,6 +471,7 @@ RegionDescPtr selectHotRegion(TransID transId,
       break;
     case RegionMode::HotTrace:
       region = selectHotTrace(transId, profData, cfg, selectedTIDs);
+      if (RuntimeOption::EvalJitPGOLoops) markLoop(*region);
       break;
     case RegionMode::OneBC:
     case RegionMode::Method:
@@ -601,8 +624,9 @@ std::string show(const RegionDesc::Block& b) {
 
 std::string show(const RegionDesc& region) {
   return folly::format(
-    "Region ({} blocks):\n{}",
+    "Region ({} blocks{}):\n{}",
     region.blocks.size(),
+    region.loop ? ", loop" : "",
     [&]{
       std::string ret;
       for (auto& b : region.blocks) {
@@ -50,6 +50,11 @@ using boost::container::flat_multimap;
  *
  * The first block is the entry point, and the remaining blocks must
  * be sorted in a reverse post order.
+ *
+ * A region is a loop if it jumps back to its own entry (see
+ * markLoop()).  The entry is then the loop header, and
+ * Translator::translateRegion lets those back-edges skip the entry
+ * guards.
  */
 struct RegionDesc {
   struct Block;
@@ -58,6 +63,8 @@ struct RegionDesc {
   struct ReffinessPred;
   typedef std::shared_ptr<Block> BlockPtr;
 
+  RegionDesc() : loop(false) {}
+
   template<typename... Args>
   Block* addBlock(Args&&... args) {
     blocks.push_back(
@@ -66,6 +73,7 @@ struct RegionDesc {
   }
 
   std::vector<BlockPtr> blocks;
+  bool loop;
 };
 
 typedef std::shared_ptr<RegionDesc> RegionDescPtr;
@@ -352,6 +360,12 @@ RegionDescPtr selectHotRegion(Transl::TransID transId,
 RegionDescPtr selectTraceletLegacy(const RegionContext&    rCtx,
                                    const Transl::Tracelet& tlet);
 
+/*
+ * Set region.loop if an instruction in one of the region's blocks from
+ * its entry Func jumps back to the region's entry.
+ */
+void markLoop(RegionDesc& region);
+
 /*
  * Debug stringification for various things.
  */
@@ -0,0 +1,397 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "hphp/runtime/vm/jit/cfg.h"
+#include "hphp/runtime/vm/jit/ir-instruction.h"
+#include "hphp/runtime/vm/jit/ir-unit.h"
+#include "hphp/runtime/vm/jit/mutation.h"
+#include "hphp/runtime/vm/jit/opt.h"
+#include "hphp/runtime/vm/jit/ssa-tmp.h"
+
+namespace HPHP { namespace JIT {
+
+TRACE_SET_MOD(hhir);
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/*
+ * Only small tuples are worth it: every element stays live in a
+ * register (or spill slot) for as long as the array would have.
+ */
+const int64_t kMaxElems = 8;
+
+/*
+ * How far past a StLoc of the array we'll look for the store that
+ * overwrites it again.
+ */
+const int kMaxStoreWindow = 64;
+
+typedef std::vector<SSATmp*> Elems;
+typedef std::unordered_map<const SSATmp*, std::vector<IRInstruction*>> UseMap;
+
+struct Candidate {
+  explicit Candidate(IRInstruction* alloc) : alloc(alloc) {}
+
+  IRInstruction* alloc;
+  Elems elems;
+
+  // Every instruction that touches the array or one of its aliases,
+  // all of which get rewritten.
+  std::unordered_set<IRInstruction*> rewrites;
+  std::vector<IRInstruction*> stores;
+  std::unordered_set<const Block*> catches;
+  std::unordered_set<const SSATmp*> aliases;
+};
+
+UseMap findUses(const IRUnit& unit) {
+  UseMap uses;
+  forEachTraceInst(unit, [&](IRInstruction* inst) {
+    for (auto src : inst->srcs()) uses[src].push_back(inst);
+  });
+  return uses;
+}
+
+/*
+ * The frame a FramePtr really refers to, looking through the
+ * instructions that only refine what we know about its locals.
+ */
+const IRInstruction* frameOf(const SSATmp* fp) {
+  auto inst = fp->inst();
+  while (inst->is(GuardLoc, CheckLoc, AssertLoc, PassFP)) {
+    inst = inst->src(0)->inst();
+  }
+  return inst;
+}
+
+bool isLocalAccess(const IRInstruction& inst) {
+  return inst.is(LdLoc, LdLocAddr, StLoc, StLocNT);
+}
+
+uint32_t localId(const IRInstruction& inst) {
+  return inst.is(StLoc, StLocNT) ? inst.extra<LocalId>()->locId
+                                 : inst.extra<LdLocData>()->locId;
+}
+
+/*
+ * A NewPackedArray takes its values from the stack, and they're
+ * almost always put there by the SpillStack that defines its sp.
+ * Find the SSA value of each element, or return false if any of them
+ * was already on the stack.
+ */
+bool findElems(Candidate& c) {
+  auto const n = c.alloc->src(0)->getValInt();
+  if (n < 1 || n > kMaxElems) return false;
+
+  auto const spill = c.alloc->src(1)->inst();
+  if (spill->op() != SpillStack) return false;
+  auto const vals = spill->srcs().subpiece(2);
+  if (vals.size() < size_t(n)) return false;
+
+  // vals[0] is the top of the stack, which is the last element.
+  for (int64_t k = 0; k < n; ++k) {
+    auto const val = vals[n - 1 - k];
+    if (val->type() == Type::None || !val->isA(Type::Cell)) {
+      return false;
+    }
+    c.elems.push_back(val);
+  }
+  return true;
+}
+
+bool isElemRead(const IRInstruction& inst, const SSATmp* arr, size_t n) {
+  if (inst.op() != ArrayGet || inst.src(1) != arr) return false;
+  auto const key = inst.src(2);
+  return key->isConst() && key->isA(Type::Int) &&
+    key->getValInt() >= 0 && key->getValInt() < int64_t(n);
+}
+
+/*
+ * Collect every use of the array, following the copies IncRef, Mov
+ * and Unbox make of it.  Returns false if any of them lets the array
+ * escape: anything but refcounting, constant-index reads, and stores
+ * to locals.
+ */
+bool findUsesOf(Candidate& c, const UseMap& uses) {
+  std::vector<IRInstruction*> unknown;
+  std::unordered_set<const SSATmp*> released;
+  std::vector<const SSATmp*> work{c.alloc->dst()};
+  c.aliases.insert(c.alloc->dst());
+
+  // The reference a Mov or Unbox of an alias carries is its source's.
+  auto owner = [](const SSATmp* alias) {
+    while (alias->inst()->is(Mov, Unbox)) alias = alias->inst()->src(0);
+    return alias;
+  };
+
+  while (!work.empty()) {
+    auto const alias = work.back();
+    work.pop_back();
+
+    auto it = uses.find(alias);
+    if (it == uses.end()) continue;
+
+    for (auto use : it->second) {
+      switch (use->op()) {
+      case IncRef:
+      case Mov:
+        c.rewrites.insert(use);
+        if (c.aliases.insert(use->dst()).second) work.push_back(use->dst());
+        break;
+
+      case Unbox:
+        if (use->taken()) return false;
+        c.rewrites.insert(use);
+        if (c.aliases.insert(use->dst()).second) work.push_back(use->dst());
+        break;
+
+      case DecRef:
+      case DecRefNZ:
+        c.rewrites.insert(use);
+        released.insert(owner(alias));
+        break;
+
+      case StLoc:
+      case StLocNT:
+        if (use->src(1) != alias) return false;
+        c.rewrites.insert(use);
+        c.stores.push_back(use);
+        break;
+
+      case ArrayGet:
+        if (!isElemRead(*use, alias, c.elems.size())) return false;
+        c.rewrites.insert(use);
+        if (auto const catchBlock = use->taken()) {
+          c.catches.insert(catchBlock);
+        }
+        break;
+
+      default:
+        unknown.push_back(use);
+        break;
+      }
+    }
+  }
+
+  // The IncRefs we emit for the elements of an IncRef'd alias have to
+  // be consumed by a DecRef of it, or dce will object.
+  for (auto alias : c.aliases) {
+    if (alias->inst()->op() == IncRef && !released.count(alias)) {
+      return false;
+    }
+  }
+
+  // Uses inside the catch blocks of the reads we're turning into
+  // IncRefs go away with those blocks.
+  for (auto use : unknown) {
+    auto const block = use->block();
+    if (!c.catches.count(block) || block->numPreds() != 1) {
+      FTRACE(3, "scalar replacement: {} escapes at {}\n",
+             c.alloc->toString(), use->toString());
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+ * Storing the array to a local is fine as long as nothing can look at
+ * the local before it's overwritten again: the unnamed temporary that
+ * list() assignment uses is the case we care about.  Walk forward
+ * from the store over instructions we know can't observe the local or
+ * leave the trace.
+ */
+bool storeIsTransient(const Candidate& c, IRInstruction* store) {
+  auto const id = localId(*store);
+  auto const frame = frameOf(store->src(0));
+
+  auto block = store->block();
+  auto it = block->iteratorTo(store);
+  ++it;
+  for (int steps = 0; steps < kMaxStoreWindow; ++steps) {
+    while (it == block->end()) {
+      auto const next = block->next();
+      if (!next || next->numPreds() != 1) return false;
+      block = next;
+      it = block->begin();
+    }
+    auto& inst = *it;
+    ++it;
+
+    if (isLocalAccess(inst) && localId(inst) == id) {
+      if (frameOf(inst.src(0)) != frame) return false;
+      return inst.is(StLoc, StLocNT) && !c.aliases.count(inst.src(1));
+    }
+    if (c.rewrites.count(&inst)) continue;
+    if (inst.taken()) return false;
+
+    switch (inst.op()) {
+    case DefLabel:
+    case Nop:
+    case IncRef:
+    case DecRefNZ:
+    case LdLoc:
+    case StLoc:
+    case StLocNT:
+      continue;
+    case DecRef:
+      if (inst.src(0)->type().canRunDtor()) return false;
+      continue;
+    default:
+      if (inst.canCSE() && !inst.isNative() && !inst.mayRaiseError()) {
+        continue;
+      }
+      return false;
+    }
+  }
+  return false;
+}
+
+void rewrite(IRUnit& unit, const Candidate& c, const BlockList& blocks) {
+  std::unordered_map<const SSATmp*, Elems> elemsOf;
+  elemsOf[c.alloc->dst()] = c.elems;
+
+  for (auto block : blocks) {
+    for (auto it = block->begin(); it != block->end(); ++it) {
+      auto& inst = *it;
+      if (!c.rewrites.count(&inst)) continue;
+
+      FTRACE(5, "scalar replacement: rewriting {}\n", inst.toString());
+      if (inst.is(StLoc, StLocNT)) {
+        inst.convertToNop();
+        continue;
+      }
+
+      auto const& elems = elemsOf[inst.src(inst.op() == ArrayGet ? 1 : 0)];
+      auto insertEach = [&](Opcode op) {
+        Elems out;
+        for (auto elem : elems) {
+          if (!elem->type().maybeCounted()) {
+            out.push_back(elem);
+            continue;
+          }
+          auto const newInst = unit.gen(op, inst.marker(), elem);
+          block->insert(it, newInst);
+          out.push_back(newInst->dst());
+        }
+        return out;
+      };
+
+      switch (inst.op()) {
+      case IncRef:
+        elemsOf[inst.dst()] = insertEach(IncRef);
+        inst.convertToNop();
+        break;
+
+      case Mov:
+      case Unbox:
+        elemsOf[inst.dst()] = elems;
+        inst.convertToNop();
+        break;
+
+      case DecRef:
+      case DecRefNZ:
+        insertEach(inst.op());
+        inst.convertToNop();
+        break;
+
+      case ArrayGet: {
+        auto const elem = elems[inst.src(2)->getValInt()];
+        if (elem->type().maybeCounted()) {
+          unit.replace(&inst, IncRef, elem);
+        } else {
+          unit.replace(&inst, Mov, elem);
+        }
+        break;
+      }
+
+      default:
+        not_reached();
+      }
+    }
+  }
+
+  c.alloc->convertToNop();
+}
+
+}
+
+//////////////////////////////////////////////////////////////////////
+
+/*
+ * Scalar replacement of short-lived packed arrays.
+ *
+ * A NewPackedArray whose result never escapes the trace---it's only
+ * refcounted, read at constant indices in range, and parked in a local
+ * that nobody can observe before it's overwritten---doesn't need to
+ * exist.  We forward each ArrayGet to the SSA value the element was
+ * built from and turn refcounting of the array into refcounting of
+ * its elements, which keeps every element alive exactly as long as
+ * the array would have.  This is what list($a, $b) = array(...) looks
+ * like once the callee returning the tuple has been inlined.
+ *
+ * Returns true if anything changed; the catch blocks of the rewritten
+ * ArrayGets become unreachable and are left for dce.
+ */
+bool scalarReplaceArrays(IRUnit& unit) {
+  FTRACE(5, "ScalarReplacement:vvvvvvvvvvvvvvvvvvvvv\n");
+  SCOPE_EXIT { FTRACE(5, "ScalarReplacement:^^^^^^^^^^^^^^^^^^^^^\n"); };
+
+  std::vector<IRInstruction*> allocs;
+  forEachTraceInst(unit, [&](IRInstruction* inst) {
+    if (inst->op() == NewPackedArray) allocs.push_back(inst);
+  });
+  if (allocs.empty()) return false;
+
+  auto const uses = findUses(unit);
+  auto const blocks = rpoSortCfg(unit);
+  bool changed = false;
+
+  for (auto alloc : allocs) {
+    Candidate c(alloc);
+    if (!findElems(c) || !findUsesOf(c, uses)) continue;
+
+    bool transient = true;
+    for (auto store : c.stores) {
+      if (!storeIsTransient(c, store)) {
+        FTRACE(3, "scalar replacement: {} escapes through {}\n",
+               alloc->toString(), store->toString());
+        transient = false;
+        break;
+      }
+    }
+    if (!transient) continue;
+
+    FTRACE(2, "scalar replacement: replacing {}\n", alloc->toString());
+    rewrite(unit, c, blocks);
+    changed = true;
+  }
+
+  if (changed) {
+    auto const sorted = rpoSortCfg(unit);
+    reflowTypes(sorted.front(), sorted);
+  }
+  return changed;
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}}
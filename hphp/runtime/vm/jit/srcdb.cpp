@@ -180,8 +180,15 @@ void SrcRec::replaceOldTranslations() {
    *
    * If we ever change that we'll have to change this to patch to
    * some sort of rebind requests.
+   *
+   * PGO, TC relayout and dropping translations that trusted inferred
+   * return types do use this in RepoAuthoritative mode; that is fine
+   * because the first new translation re-points every incoming branch
+   * at itself (see newTranslation()).
    */
-  assert(!RuntimeOption::RepoAuthoritative || RuntimeOption::EvalJitPGO);
+  assert(!RuntimeOption::RepoAuthoritative || RuntimeOption::EvalJitPGO ||
+         RuntimeOption::EvalJitRelayoutInterval ||
+         RuntimeOption::EvalJitInferredReturnTypes);
   patchIncomingBranches(m_anchorTranslation);
 }
 
@@ -222,6 +222,16 @@ struct SrcRec {
     m_inProgressTailJumps.clear();
   }
 
+  /*
+   * Forgets the incoming and tail fallback branches for which
+   * inDeadCode(toSmash) is true, so code that is about to be freed and
+   * reused is never smashed on behalf of this SrcRec.
+   */
+  template<class F> void removeDeadBranches(F inDeadCode) {
+    filterBranches(m_incomingBranches, inDeadCode);
+    filterBranches(m_tailFallbackJumps, inDeadCode);
+  }
+
   /*
    * There is an unlikely race in retranslate, where two threads
    * could simultaneously generate the same translation for a
@@ -241,6 +251,21 @@ struct SrcRec {
   }
 
 private:
+  template<class F>
+  static void filterBranches(GrowableVectorWrapper<IncomingBranch>& branches,
+                             F inDeadCode) {
+    GrowableVectorWrapper<IncomingBranch> live;
+    for (auto& br : branches) {
+      if (!inDeadCode(br.toSmash())) live.push_back(br);
+    }
+    if (live.size() == branches.size()) {
+      live.clear();
+      return;
+    }
+    branches.swap(live);
+    live.clear();
+  }
+
   TCA getFallbackTranslation() const;
   void patch(IncomingBranch branch, TCA dest);
   void patchIncomingBranches(TCA newStart);
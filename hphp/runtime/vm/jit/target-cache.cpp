@@ -31,7 +31,11 @@
 #include "hphp/util/base.h"
 #include "hphp/util/maphuge.h"
 
+#include <algorithm>
+#include <map>
 #include <string>
+#include <tuple>
+#include <vector>
 #include <stdio.h>
 #include <sys/mman.h>
 
@@ -593,6 +597,89 @@ void methodCacheSlowPath(MethodCache::Pair* mce,
   }
 }
 
+//=============================================================================
+// MethodPIC
+
+// Keyed by call site: file, calling function and bytecode offset.
+typedef std::tuple<const StringData*, const StringData*, Offset> PICSite;
+static Mutex s_picProfileMutex(false /*recursive*/, RankLeaf);
+static std::map<PICSite, MethodPIC::Profile> s_picProfiles;
+
+int MethodPIC::numEntries() {
+  return std::max(1, std::min(int(RuntimeOption::EvalJitPICSize),
+                              kMaxEntries));
+}
+
+CacheHandle MethodPIC::alloc(int numEntries) {
+  assert(numEntries >= 1 && numEntries <= kMaxEntries);
+  return namedAlloc<NSInvalid>(nullptr,
+                               numEntries * sizeof(MethodCache::Pair),
+                               sizeof(MethodCache::Pair));
+}
+
+MethodPIC::Profile* MethodPIC::allocProfile(const Func* func, Offset offset,
+                                            const StringData* name) {
+  auto const file = func->unit()->filepath();
+  auto const funcName = func->fullName();
+  Lock l(s_picProfileMutex);
+  auto it = s_picProfiles.find(PICSite(file, funcName, offset));
+  if (it == s_picProfiles.end()) {
+    Profile profile { file, func->unit()->getLineNumber(offset), funcName,
+                      name, 0, 0 };
+    it = s_picProfiles.insert(
+      std::make_pair(PICSite(file, funcName, offset), profile)).first;
+  }
+  return &it->second;
+}
+
+std::string MethodPIC::dumpProfiles(int limit) {
+  std::vector<Profile> sites;
+  {
+    Lock l(s_picProfileMutex);
+    sites.reserve(s_picProfiles.size());
+    for (auto const& kv : s_picProfiles) sites.push_back(kv.second);
+  }
+  std::sort(sites.begin(), sites.end(),
+            [] (const Profile& a, const Profile& b) {
+              return a.hits + a.misses > b.hits + b.misses;
+            });
+  if (sites.size() > size_t(limit)) sites.resize(limit);
+
+  std::string out;
+  for (auto const& p : sites) {
+    uint64_t calls = p.hits + p.misses;
+    std::string line;
+    Util::string_printf(line, "%s:%d %s->%s calls %" PRIu64 " hit %.1f%%\n",
+                        p.file->data(), p.line, p.funcName->data(),
+                        p.name->data(), calls,
+                        calls ? 100.0 * p.hits / calls : 0.0);
+    out += line;
+  }
+  return out;
+}
+
+HOT_FUNC_VM
+void methodPICSlowPath(MethodCache::Pair* pic,
+                       ActRec* ar,
+                       StringData* name,
+                       Class* cls,
+                       int64_t numEntries,
+                       MethodPIC::Profile* profile) {
+  if (profile) __sync_fetch_and_add(&profile->misses, 1);
+
+  // An entry for cls can still be here with its magic or static bit set,
+  // which the inline compare never matches.
+  MethodCache::Pair* mce = &pic[numEntries - 1];
+  for (int i = 0; i < numEntries; ++i) {
+    auto const key = pic[i].m_key;
+    if (!key || (key & ~uintptr_t(0x3)) == uintptr_t(cls)) {
+      mce = &pic[i];
+      break;
+    }
+  }
+  methodCacheSlowPath(mce, ar, name, cls);
+}
+
 template<>
 HOT_FUNC_VM
 void
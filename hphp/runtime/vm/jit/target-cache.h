@@ -360,6 +360,52 @@ void methodCacheSlowPath(MethodCache::Pair* mce,
                          StringData* name,
                          Class* cls);
 
+/*
+ * Polymorphic inline cache for an FPushObjMethodD call site.
+ *
+ * A PIC is numEntries() consecutive MethodCache::Pairs. The translated
+ * code compares the receiver's class with each key in turn and stores the
+ * matching Func straight into the ActRec (see cgLdObjMethod). On a miss,
+ * methodPICSlowPath fills the first free entry. Once every entry is taken,
+ * the last one acts like a plain MethodCache and is replaced on each miss.
+ *
+ * The entries live in the target cache and are not patched into the code.
+ * Class*s are only permanent for persistent classes (as in RepoAuthoritative
+ * mode); others go away with their unit and their addresses get reused, and
+ * patched keys would then need the translation invalidated.
+ */
+struct MethodPIC {
+  static const int kMaxEntries = 8;
+
+  // Per-call-site counts, kept when Eval.JitPICStats is set.  Every
+  // translation of a call site shares one Profile, which lives for the
+  // rest of the process.  Only static strings are kept, so the Func and
+  // Unit of the call may go away.
+  struct Profile {
+    const StringData* file;      // containing the call
+    int line;
+    const StringData* funcName;  // full name of the calling function
+    const StringData* name;      // method name
+    uint64_t hits;               // incremented by the translated code
+    uint64_t misses;
+  };
+
+  // Eval.JitPICSize, clamped to [1, kMaxEntries].
+  static int numEntries();
+  static CacheHandle alloc(int numEntries);
+  static Profile* allocProfile(const Func* func, Offset offset,
+                               const StringData* name);
+  // The `limit' busiest call sites, one per line.
+  static std::string dumpProfiles(int limit);
+};
+
+void methodPICSlowPath(MethodCache::Pair* pic,
+                       ActRec* ar,
+                       StringData* name,
+                       Class* cls,
+                       int64_t numEntries,
+                       MethodPIC::Profile* profile);
+
 } } }
 
 #endif
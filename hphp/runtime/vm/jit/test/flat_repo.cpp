@@ -0,0 +1,170 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/vm/flat-repo.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "folly/ScopeGuard.h"
+
+#include "hphp/runtime/base/program-functions.h"
+#include "hphp/runtime/base/runtime-option.h"
+#include "hphp/runtime/vm/repo.h"
+#include "hphp/runtime/vm/runtime.h"
+#include "hphp/runtime/vm/unit.h"
+#include "hphp/util/async-func.h"
+
+namespace HPHP {
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char kCode[] =
+  "<?php\n"
+  "const FLAT_REPO_K = 3;\n"
+  "function flat_repo_f($a, $b = array(1, 'two')) {\n"
+  "  try {\n"
+  "    return $a + count($b) + FLAT_REPO_K;\n"
+  "  } catch (Exception $e) {\n"
+  "    return 'caught';\n"
+  "  }\n"
+  "}\n"
+  "class FlatRepoC {\n"
+  "  const X = 'x';\n"
+  "  public $p = array('k' => 4);\n"
+  "  function m() { return self::X . $this->p['k']; }\n"
+  "}\n";
+
+std::string tempPath() {
+  char path[] = "/tmp/flat_repo_XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_NE(-1, fd);
+  close(fd);
+  return path;
+}
+
+/*
+ * Runs body in a request on a thread of its own, so it gets a Repo of its
+ * own: each thread opens one on first use, and the main thread's was opened
+ * at startup with no writable central repo.
+ */
+struct RequestThread {
+  explicit RequestThread(std::function<void()> body) : m_body(body) {}
+
+  void run() {
+    hphp_session_init();
+    hphp_context_init();
+    m_body();
+    hphp_context_exit(g_context.getNoCheck(), false);
+    hphp_session_exit();
+  }
+
+  std::function<void()> m_body;
+};
+
+void runInRequestThread(std::function<void()> body) {
+  RequestThread t(body);
+  AsyncFunc<RequestThread> func(&t, &RequestThread::run);
+  func.start();
+  func.waitForEnd();
+}
+
+}
+
+static void checkConvertedUnit() {
+  Unit* unit = compile_string(kCode, sizeof kCode - 1);
+  ASSERT_TRUE(unit != nullptr);
+  ASSERT_EQ(RepoIdCentral, unit->repoId());
+
+  auto path = tempPath();
+  std::string error;
+  ASSERT_TRUE(FlatRepo::Convert(Repo::get().repoName(RepoIdCentral), path,
+                                error)) << error;
+  const FlatRepo* flat = FlatRepo::Open(path);
+  ASSERT_TRUE(flat != nullptr);
+  unlink(path.c_str());
+
+  Unit* sqlite = Repo::get().loadUnit("", unit->md5());
+  Unit* fromFlat = flat->loadUnit("", unit->md5());
+  ASSERT_TRUE(sqlite != nullptr);
+  ASSERT_TRUE(fromFlat != nullptr);
+
+  EXPECT_EQ(sqlite->sn(), fromFlat->sn());
+  ASSERT_EQ(sqlite->bclen(), fromFlat->bclen());
+  EXPECT_EQ(0, memcmp(sqlite->entry(), fromFlat->entry(), sqlite->bclen()));
+  EXPECT_EQ(sqlite->isMergeOnly(), fromFlat->isMergeOnly());
+
+  ASSERT_EQ(sqlite->numLitstrs(), fromFlat->numLitstrs());
+  for (Id id = 0; id < Id(sqlite->numLitstrs()); ++id) {
+    EXPECT_TRUE(sqlite->lookupLitstrId(id)->same(
+                  fromFlat->lookupLitstrId(id)));
+  }
+  ASSERT_EQ(sqlite->numArrays(), fromFlat->numArrays());
+  for (Id id = 0; id < Id(sqlite->numArrays()); ++id) {
+    // arrays are static, so equal ones are the same ArrayData
+    EXPECT_EQ(sqlite->lookupArrayId(id), fromFlat->lookupArrayId(id));
+  }
+  for (Offset off = 0; off < sqlite->bclen(); ++off) {
+    EXPECT_EQ(sqlite->getLineNumber(off), fromFlat->getLineNumber(off));
+  }
+
+  // Preclasses, funcs, their metadata and the disassembled bytecode.
+  EXPECT_EQ(sqlite->toString(), fromFlat->toString());
+}
+
+TEST(FlatRepo, ConvertedUnitMatchesSqlite) {
+  // Commit evaled code to a central repo of our own, and nothing else.
+  auto central = tempPath();
+  auto savedCentral = RuntimeOption::RepoCentralPath;
+  auto savedLocal = RuntimeOption::RepoLocalMode;
+  auto savedEval = RuntimeOption::RepoEvalMode;
+  auto savedCommit = RuntimeOption::RepoCommit;
+  SCOPE_EXIT {
+    RuntimeOption::RepoCentralPath = savedCentral;
+    RuntimeOption::RepoLocalMode = savedLocal;
+    RuntimeOption::RepoEvalMode = savedEval;
+    RuntimeOption::RepoCommit = savedCommit;
+    unlink(central.c_str());
+  };
+  RuntimeOption::RepoCentralPath = central;
+  RuntimeOption::RepoLocalMode = "--";
+  RuntimeOption::RepoEvalMode = "central";
+  RuntimeOption::RepoCommit = true;
+
+  runInRequestThread(checkConvertedUnit);
+}
+
+TEST(FlatRepo, RejectsOtherFiles) {
+  auto path = tempPath();
+  FILE* f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f != nullptr);
+  fputs("not a flat repo, but long enough to hold a flat repo header", f);
+  fclose(f);
+
+  EXPECT_TRUE(FlatRepo::Open(path) == nullptr);
+  EXPECT_TRUE(FlatRepo::Open(path + ".missing") == nullptr);
+  unlink(path.c_str());
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}
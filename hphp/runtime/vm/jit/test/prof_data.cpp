@@ -0,0 +1,138 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+#include "hphp/runtime/vm/jit/prof-data.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "hphp/runtime/base/runtime-option.h"
+#include "hphp/runtime/vm/jit/region-selection.h"
+#include "hphp/runtime/vm/runtime.h"
+#include "hphp/runtime/vm/unit.h"
+
+namespace HPHP { namespace JIT {
+
+//////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const char kCode[] =
+  "<?php\n"
+  "function pgo_persisted($a) { $b = $a + 1; return $b * 2; }\n";
+
+const Func* compileFunc() {
+  Unit* unit = compile_string(kCode, sizeof kCode - 1);
+  EXPECT_TRUE(unit != nullptr);
+  for (auto range = unit->funcs(); !range.empty(); ) {
+    const Func* func = range.popFront();
+    if (!strcmp(func->name()->data(), "pgo_persisted")) return func;
+  }
+  ADD_FAILURE() << "pgo_persisted not found";
+  return nullptr;
+}
+
+RegionDescPtr makeRegion(const Func* func, Type localType, int length) {
+  auto region = std::make_shared<RegionDesc>();
+  auto block = region->addBlock(func, func->base(), length, 0);
+  block->addPredicted(SrcKey(func, func->base()),
+                      RegionDesc::TypePred{RegionDesc::Location::Local{0},
+                                           localType});
+  return region;
+}
+
+// Profiles a transId for sk as if it had been run hits times.
+TransID profiledTrans(ProfData& pd, const SrcKey& sk, int64_t hits) {
+  TransID id = pd.addTransNonProf(Transl::TransOptimize, sk);
+  *pd.transCounterAddr(id) -= hits;
+  return id;
+}
+
+std::string tempPath() {
+  char path[] = "/tmp/jit_profile_XXXXXX";
+  int fd = mkstemp(path);
+  EXPECT_NE(-1, fd);
+  close(fd);
+  return path;
+}
+
+}
+
+TEST(ProfData, PersistedRegionsRoundTrip) {
+  const Func* func = compileFunc();
+  ASSERT_TRUE(func != nullptr);
+  SrcKey sk(func, func->base());
+  auto path = tempPath();
+
+  {
+    ProfData pd;
+    EXPECT_FALSE(pd.loadedPersistedProfile());
+    pd.recordOptRegion(profiledTrans(pd, sk, 10),
+                       *makeRegion(func, Type::Dbl, 1));
+    pd.recordOptRegion(profiledTrans(pd, sk, 1000),
+                       *makeRegion(func, Type::Int, 2));
+    ASSERT_TRUE(pd.write(path));
+  }
+
+  // A new process only sees the file.
+  ProfData pd;
+  ASSERT_TRUE(pd.read(path));
+  EXPECT_TRUE(pd.loadedPersistedProfile());
+  EXPECT_EQ(2, pd.numPersistedRegions(sk));
+  EXPECT_EQ(0, pd.numPersistedRegions(SrcKey(func, func->base() + 1)));
+
+  // The hottest region comes back first, with its blocks and predictions.
+  auto hot = pd.persistedRegion(sk, 0);
+  ASSERT_TRUE(hot != nullptr);
+  ASSERT_EQ(1, hot->blocks.size());
+  EXPECT_EQ(func, hot->blocks[0]->func());
+  EXPECT_EQ(sk, hot->blocks[0]->start());
+  EXPECT_EQ(2, hot->blocks[0]->length());
+  auto const& preds = hot->blocks[0]->typePreds();
+  ASSERT_EQ(1, preds.size());
+  EXPECT_EQ(Type::Int, preds.begin()->second.type);
+
+  auto cold = pd.persistedRegion(sk, 1);
+  ASSERT_TRUE(cold != nullptr);
+  EXPECT_EQ(1, cold->blocks[0]->length());
+  EXPECT_EQ(Type::Dbl, cold->blocks[0]->typePreds().begin()->second.type);
+  EXPECT_TRUE(pd.persistedRegion(sk, 2) == nullptr);
+
+  unlink(path.c_str());
+}
+
+TEST(ProfData, RejectsForeignProfile) {
+  auto path = tempPath();
+  FILE* f = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(f != nullptr);
+  fputs("not a JIT profile", f);
+  fclose(f);
+
+  ProfData pd;
+  EXPECT_FALSE(pd.read(path));
+  EXPECT_FALSE(pd.loadedPersistedProfile());
+  EXPECT_FALSE(pd.read(path + ".missing"));
+
+  unlink(path.c_str());
+}
+
+//////////////////////////////////////////////////////////////////////
+
+}}
@@ -46,4 +46,24 @@ TEST(TreadHashMap, Iteration) {
   }
 }
 
+TEST(TreadHashMap, InsertOrUpdate) {
+  TreadHashMap<int64_t,int64_t,int64_hash> thm(64);
+
+  for (int i = 1; i < 256; ++i) {
+    thm.insertOrUpdate(i, i);
+  }
+  for (int i = 1; i < 256; i += 2) {
+    thm.insertOrUpdate(i, -i);
+  }
+
+  int count = 0;
+  for (auto& k : thm) {
+    EXPECT_EQ(k.second, k.first % 2 ? -k.first : k.first);
+    ++count;
+  }
+  EXPECT_EQ(count, 255);
+  EXPECT_EQ(*thm.find(7), -7);
+  EXPECT_EQ(*thm.find(8), 8);
+}
+
 }
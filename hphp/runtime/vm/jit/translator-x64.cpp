@@ -25,6 +25,7 @@
 #include <stdarg.h>
 #include <string>
 #include <queue>
+#include <algorithm>
 #include <unwind.h>
 #include <unordered_set>
 #ifdef __FreeBSD__
@@ -94,6 +95,7 @@
 #include "hphp/runtime/vm/jit/code-gen.h"
 #include "hphp/runtime/vm/jit/hhbc-translator.h"
 #include "hphp/runtime/vm/jit/ir-translator.h"
+#include "hphp/runtime/vm/jit/jit-worker.h"
 #include "hphp/runtime/vm/jit/normalized-instruction.h"
 #include "hphp/runtime/vm/jit/opt.h"
 #include "hphp/runtime/vm/jit/print.h"
@@ -115,6 +117,9 @@ namespace Transl {
 
 using namespace reg;
 using namespace Util;
+
+// Room we insist on before starting a translation in a bounded code area.
+static const int kMaxTranslationBytes = 8192;
 using namespace Trace;
 using namespace JIT::X64;
 using std::max;
@@ -243,6 +248,15 @@ TCA TranslatorX64::retranslate(const TranslArgs& args) {
   SKTRACE(1, args.m_sk, "retranslate\n");
   if (m_mode == TransInvalid) {
     m_mode = profileSrcKey(args.m_sk) ? TransProfile : TransLive;
+    // If a previous process saved regions for this SrcKey, translate them
+    // directly instead of profiling it all over again; translateWork picks
+    // the next region that hasn't been translated yet.
+    if (shouldPGOFunc(args.m_sk.func()) &&
+        sr->translations().size() <
+          m_profData->numPersistedRegions(args.m_sk)) {
+      m_profData->setOptimized(args.m_sk);
+      m_mode = TransOptimize;
+    }
   }
   return translate(args);
 }
@@ -255,13 +269,19 @@ TCA TranslatorX64::retranslate(const TranslArgs& args) {
  * retranslated/optimized.
  */
 bool TranslatorX64::prologuesWereRegenerated(const Func* func) {
+  // Entries that come from a persisted profile are never profiled, so
+  // their prologues don't need to be either.
+  auto optimized = [&] (const SrcKey& sk) {
+    return m_profData->optimized(sk) || m_profData->numPersistedRegions(sk);
+  };
+
   // Check if main body was already optimized.
-  if (m_profData->optimized(SrcKey(func, func->base()))) return true;
+  if (optimized(SrcKey(func, func->base()))) return true;
 
   // Check if any DVFunclet was already optimized.
   for (auto funcletPair : func->getDVFunclets()) {
     Offset funcletOffset = funcletPair.second;
-    if (m_profData->optimized(SrcKey(func, funcletOffset))) {
+    if (optimized(SrcKey(func, funcletOffset))) {
       return true;
     }
   }
@@ -269,6 +289,13 @@ bool TranslatorX64::prologuesWereRegenerated(const Func* func) {
 }
 
 TCA TranslatorX64::retranslateOpt(TransID transId, bool align) {
+  // Let a background worker do the heavy lifting; the caller keeps
+  // interpreting until the optimized translation shows up.
+  if (jitWorkersEnabled() && !isJitWorkerThread() &&
+      enqueueOptTranslation(transId)) {
+    return nullptr;
+  }
+
   LeaseHolder writer(s_writeLease);
   if (!writer) return nullptr;
 
@@ -287,16 +314,12 @@ TCA TranslatorX64::retranslateOpt(TransID transId, bool align) {
   // the same SrcKey hit the optimization threshold.  Only the first
   // time around we want to invalidate the existing translations.
   bool alreadyOptimized = m_profData->optimized(sk);
-  m_profData->setOptimized(sk);
 
   bool setFuncBody = (!alreadyOptimized &&
                       func->base() == sk.offset() &&
                       func->getDVFunclets().size() == 0);
 
-  if (!alreadyOptimized) {
-    if (setFuncBody) func->setFuncBody(uniqueStubs.funcBodyHelperThunk);
-    invalidateSrcKey(sk);
-  } else {
+  if (alreadyOptimized) {
     // Bail if we already reached the maximum number of translations per SrcKey.
     // Note that this can only happen with multi-threading.
     SrcRec* srcRec = getSrcRec(sk);
@@ -308,8 +331,15 @@ TCA TranslatorX64::retranslateOpt(TransID transId, bool align) {
   m_mode = TransOptimize;
   auto translArgs = TranslArgs(sk, align).transId(transId);
   if (setFuncBody) translArgs.setFuncBody();
-
-  return retranslate(translArgs);
+  // The profiling translations keep running until the optimized one is
+  // ready; translateWork() retires them when it publishes it.
+  if (!alreadyOptimized) translArgs.replaceOld();
+
+  TCA start = retranslate(translArgs);
+  // A worker that couldn't translate the region left the profiling
+  // translations alone; let the next request have a go inline.
+  if (start || !isJitWorkerThread()) m_profData->setOptimized(sk);
+  return start;
 }
 
 /*
@@ -474,7 +504,9 @@ TranslatorX64::translate(const TranslArgs& args) {
   Func* func = const_cast<Func*>(args.m_sk.func());
   CodeBlockSelector asmSel(CodeBlockSelector::Args(this)
                            .profile(m_mode == TransProfile)
-                           .hot(func->attrs() & AttrHot));
+                           .hot((func->attrs() & AttrHot) ||
+                                m_relayoutSrcKeys.count(args.m_sk)));
+  ReclaimedCodeSelector reclaimSel(this);
 
   if (args.m_align) {
     moveToAlign(mainCode, kNonFallthroughAlign);
@@ -482,7 +514,21 @@ TranslatorX64::translate(const TranslArgs& args) {
 
   TCA start = mainCode.frontier();
 
-  translateWork(args);
+  bool published;
+  try {
+    published = translateWork(args);
+  } catch (const DataBlockFull&) {
+    if (!reclaimSel.active()) throw;
+    // Too big for the reclaimed range; translateWork() rolled everything
+    // back, so start over at the frontier.
+    reclaimSel.abandon();
+    if (args.m_align) {
+      moveToAlign(mainCode, kNonFallthroughAlign);
+    }
+    start = mainCode.frontier();
+    published = translateWork(args);
+  }
+  if (!published) return nullptr;
 
   if (args.m_setFuncBody) {
     func->setFuncBody(start);
@@ -1544,6 +1590,24 @@ class FreeRequestStubTrigger : public Treadmill::WorkItem {
   }
 };
 
+class FreeTranslationsTrigger : public Treadmill::WorkItem {
+  std::vector<std::pair<TCA,uint32_t>> m_ranges;
+ public:
+  explicit FreeTranslationsTrigger(std::vector<std::pair<TCA,uint32_t>> ranges)
+    : m_ranges(std::move(ranges)) {
+    TRACE(3, "FreeTranslationsTrigger @ %p, %zu translations\n",
+          this, m_ranges.size());
+  }
+  virtual void operator()() {
+    TRACE(3, "FreeTranslationsTrigger: Firing @ %p\n", this);
+    if (TranslatorX64::Get()->reclaimTranslations(m_ranges) != true) {
+      // If we can't get the write lease, enqueue again to retry.
+      TRACE(3, "FreeTranslationsTrigger: write lease failed, requeueing\n");
+      enqueue(new FreeTranslationsTrigger(std::move(m_ranges)));
+    }
+  }
+};
+
 #ifdef DEBUG
 
 struct DepthGuard {
@@ -1988,6 +2052,102 @@ TCA TranslatorX64::getFreeStub() {
   return ret;
 }
 
+/*
+ * Support for reclaiming the code of dead translations.
+ */
+void TCFreeList::add(TCA start, size_t len) {
+  // coalesce with the neighbouring ranges
+  auto next = m_byAddr.lower_bound(start);
+  if (next != m_byAddr.begin()) {
+    auto prev = std::prev(next);
+    assert(prev->first + prev->second <= start);
+    if (prev->first + prev->second == start) {
+      start = prev->first;
+      len += prev->second;
+      erase(prev);
+    }
+  }
+  if (next != m_byAddr.end()) {
+    assert(start + len <= next->first);
+    if (start + len == next->first) {
+      len += next->second;
+      erase(next);
+    }
+  }
+  m_byAddr[start] = len;
+  m_bySize.insert(std::make_pair(len, start));
+  m_bytes += len;
+  m_ranges++;
+}
+
+bool TCFreeList::take(size_t minLen, TCA& start, size_t& len) {
+  auto it = m_bySize.lower_bound(minLen);
+  if (it == m_bySize.end()) return false;
+  start = it->second;
+  len = it->first;
+  erase(m_byAddr.find(start));
+  return true;
+}
+
+void TCFreeList::erase(std::map<TCA, size_t>::iterator it) {
+  auto sizes = m_bySize.equal_range(it->second);
+  for (auto s = sizes.first; s != sizes.second; ++s) {
+    if (s->second == it->first) {
+      m_bySize.erase(s);
+      break;
+    }
+  }
+  m_bytes -= it->second;
+  m_ranges--;
+  m_byAddr.erase(it);
+}
+
+bool
+TranslatorX64::reclaimTranslations(
+  const std::vector<std::pair<TCA,uint32_t>>& ranges) {
+  LeaseHolder writer(s_writeLease);
+  /*
+   * If we can't acquire the write lock, the caller
+   * (FreeTranslationsTrigger) retries
+   */
+  if (!writer) return false;
+
+  auto sorted = ranges;
+  std::sort(sorted.begin(), sorted.end());
+  auto inDeadCode = [&] (TCA addr) {
+    auto r = std::upper_bound(sorted.begin(), sorted.end(),
+                              std::make_pair(addr, UINT32_MAX));
+    return r != sorted.begin() &&
+      addr < std::prev(r)->first + std::prev(r)->second;
+  };
+
+  // Jumps out of the dead code are still on the incoming and fallback
+  // lists of the SrcRecs they target; drop them before the space can be
+  // reused, or the next patch of those SrcRecs smashes live code.
+  for (SrcDB::iterator it = m_srcDB.begin(); it != m_srcDB.end(); ++it) {
+    it->second->removeDeadBranches(inDeadCode);
+  }
+
+  // Forget the profiling jumps in the dead code, so they aren't mistaken
+  // for jumps later emitted at the same addresses.
+  for (auto it = m_jmpToTransID.begin(); it != m_jmpToTransID.end(); ) {
+    if (inDeadCode(it->first)) {
+      it = m_jmpToTransID.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (auto& r : ranges) {
+    TRACE(1, "reclaim %u bytes of dead translation @%p\n", r.second, r.first);
+    assert(isValidCodeAddress(r.first));
+    // Trap if anything still jumps in here
+    memset(r.first, 0xcc, r.second);
+    m_freeCode.add(r.first, r.second);
+  }
+  return true;
+}
+
 TCA
 TranslatorX64::emitTransCounterInc(X64Assembler& a) {
   TCA start = a.frontier();
@@ -2287,11 +2447,13 @@ void dumpTranslationInfo(const Tracelet& t, TCA postGuards) {
   }
 }
 
-void
+bool
 TranslatorX64::translateWork(const TranslArgs& args) {
   auto sk = args.m_sk;
-  std::unique_ptr<Tracelet> tp = analyze(sk);
-  Tracelet& t = *tp;
+  // JIT workers have no live frame to analyze, so they can only
+  // translate regions; see jit-worker.h.
+  const bool worker = isJitWorkerThread();
+  std::unique_ptr<Tracelet> tp = worker ? nullptr : analyze(sk);
 
   SKTRACE(1, sk, "translateWork\n");
   assert(m_srcDB.find(sk));
@@ -2313,6 +2475,15 @@ TranslatorX64::translateWork(const TranslArgs& args) {
     srcRec.clearInProgressTailJumps();
   };
 
+  // Emitting past the end of a reclaimed code range throws DataBlockFull
+  // (see translate()); leave the TC and translator state as we found them.
+  bool emitted = false;
+  SCOPE_EXIT {
+    if (emitted) return;
+    if (m_irTrans) traceFree();
+    resetState();
+  };
+
   auto assertCleanState = [&] {
     assert(mainCode.frontier() == start);
     assert(stubsCode.frontier() == stubStart);
@@ -2322,15 +2493,26 @@ TranslatorX64::translateWork(const TranslArgs& args) {
   };
 
   JIT::PostConditions pconds;
+  bool trustsReturnTypes = false;
 
-  if (!args.m_interp && !reachedTranslationLimit(sk, srcRec)) {
+  // The translations a replacement retires don't count against the limit.
+  if (!args.m_interp &&
+      (args.m_replaceOld || !reachedTranslationLimit(sk, srcRec))) {
     // Attempt to create a region at this SrcKey
     JIT::RegionDescPtr region;
     if (RuntimeOption::EvalJitPGO) {
       if (m_mode == TransOptimize) {
         TransID transId = args.m_transId;
-        assert(transId != InvalidID);
-        region = JIT::selectHotRegion(transId, this);
+        if (transId != InvalidID) {
+          region = JIT::selectHotRegion(transId, this);
+          if (region && region->blocks.size() != 0) {
+            m_profData->recordOptRegion(transId, *region);
+          }
+        } else {
+          // Region saved by a previous process; see retranslate().
+          region = m_profData->persistedRegion(sk,
+                                               srcRec.translations().size());
+        }
         if (region && region->blocks.size() == 0) region = nullptr;
       } else {
         // We always go through the tracelet translator in this case
@@ -2339,15 +2521,16 @@ TranslatorX64::translateWork(const TranslArgs& args) {
       JIT::RegionContext rContext { sk.func(), sk.offset(), liveSpOff() };
       FTRACE(2, "populating live context for region\n");
       populateLiveContext(rContext);
-      region = JIT::selectRegion(rContext, &t);
+      region = JIT::selectRegion(rContext, tp.get());
     }
 
     TranslateResult result = Retry;
     RegionBlacklist regionInterps;
+    if (worker && !region) result = Failure;
     Offset initSpOffset = region ? region->blocks[0]->initialSpOffset()
-                                 : liveSpOff();
+                                 : worker ? 0 : liveSpOff();
     while (result == Retry) {
-      traceStart(sk.offset(), initSpOffset);
+      traceStart(sk.offset(), initSpOffset, sk.func());
 
       // Try translating a region if we have one, then fall back to using the
       // Tracelet.
@@ -2357,17 +2540,21 @@ TranslatorX64::translateWork(const TranslArgs& args) {
           result = translateRegion(*region, regionInterps);
           FTRACE(2, "translateRegion finished with result {}\n",
                  translateResultName(result));
+        } catch (const DataBlockFull&) {
+          throw;
         } catch (const std::exception& e) {
           FTRACE(1, "translateRegion failed with '{}'\n", e.what());
           result = Failure;
         }
         if (result == Failure) {
           traceFree();
-          traceStart(sk.offset(), liveSpOff());
           resetState();
+          if (worker) break;
+          traceStart(sk.offset(), liveSpOff(), sk.func());
         }
       }
       if (!region || result == Failure) {
+        Tracelet& t = *tp;
         FTRACE(1, "trying irTranslateTracelet\n");
         assertCleanState();
         if (m_mode == TransOptimize) {
@@ -2390,6 +2577,8 @@ TranslatorX64::translateWork(const TranslArgs& args) {
         // Translation failed. Free resources for this trace, rollback the
         // translation cache frontiers, and discard any pending fixups.
         resetState();
+      } else {
+        trustsReturnTypes = m_irTrans->hhbcTrans().trustsReturnTypes();
       }
       traceFree();
     }
@@ -2402,7 +2591,15 @@ TranslatorX64::translateWork(const TranslArgs& args) {
     }
   }
 
+  if (worker && transKind == TransInterp) {
+    // Leave sk alone; the next request to get there retranslates it
+    // against its live types.
+    assertCleanState();
+    return false;
+  }
+
   if (transKind == TransInterp) {
+    Tracelet& t = *tp;
     assertCleanState();
     TRACE(1,
           "emitting %d-instr interp request for failed translation\n",
@@ -2417,14 +2614,23 @@ TranslatorX64::translateWork(const TranslArgs& args) {
                              t.m_sk.offset(), t.m_numOpcodes));
     // Fall through.
   }
+  emitted = true;
 
   m_fixupMap.processPendingFixups();
 
-  addTranslation(TransRec(sk, sk.unit()->md5(), transKind, t, start,
-                          mainCode.frontier() - start, stubStart,
-                          stubsCode.frontier() - stubStart,
-                          counterStart, counterLen,
-                          m_bcMap));
+  if (tp) {
+    addTranslation(TransRec(sk, sk.unit()->md5(), transKind, *tp, start,
+                            mainCode.frontier() - start, stubStart,
+                            stubsCode.frontier() - stubStart,
+                            counterStart, counterLen,
+                            m_bcMap));
+  } else {
+    TransRec tr(sk, sk.unit()->md5(), transKind, start,
+                mainCode.frontier() - start, stubStart,
+                stubsCode.frontier() - stubStart);
+    tr.bcMapping = m_bcMap;
+    addTranslation(tr);
+  }
   m_bcMap.clear();
 
   recordGdbTranslation(sk, sk.func(), mainCode, start,
@@ -2432,20 +2638,38 @@ TranslatorX64::translateWork(const TranslArgs& args) {
   recordGdbTranslation(sk, sk.func(), stubsCode, stubStart,
                        false, false);
   if (RuntimeOption::EvalJitPGO) {
-    JIT::RegionContext rContext { sk.func(), sk.offset(), liveSpOff() };
-    populateLiveContext(rContext);
-    m_profData->addTrans(t, rContext, transKind, pconds);
+    if (worker) {
+      m_profData->addTransNonProf(transKind, sk);
+    } else {
+      JIT::RegionContext rContext { sk.func(), sk.offset(), liveSpOff() };
+      populateLiveContext(rContext);
+      m_profData->addTrans(*tp, rContext, transKind, pconds);
+    }
   }
   // SrcRec::newTranslation() makes this code reachable. Do this last;
   // otherwise there's some chance of hitting in the reader threads whose
   // metadata is not yet visible.
   TRACE(1, "newTranslation: %p  sk: (func %d, bcOff %d)\n",
         start, sk.getFuncId(), sk.offset());
+  if (args.m_replaceOld) {
+    invalidateSrcKey(sk);
+  }
+  if (trustsReturnTypes) {
+    m_inferredRetSrcKeys.insert(sk);
+  }
+  // Only code in 'a' is ever reclaimed, so ahot and aprof keep their
+  // layout. 'a' is parked in m_reclaimedCode while mainCode is a reused
+  // range of it.
+  if (RuntimeOption::EvalJitReclaimTC && mainCode.frontier() != start &&
+      (mainCode.base() == aStart || m_reclaimedCode.base() == aStart)) {
+    m_transSizes[start] = mainCode.frontier() - start;
+  }
   srcRec.newTranslation(start);
   TRACE(1, "tx64: %zd-byte tracelet\n", mainCode.frontier() - start);
   if (Trace::moduleEnabledRelease(Trace::tcspace, 1)) {
     Trace::traceRelease("%s", getUsage().c_str());
   }
+  return true;
 }
 
 TranslatorX64::TranslateResult
@@ -2566,6 +2790,8 @@ TranslatorX64::translateTracelet(Tracelet& t) {
       folly::format("{}\n\nActive Trace:\n{}\n",
                     fa.summary, ht.trace()->toString()).str());
     abort();
+  } catch (const DataBlockFull&) {
+    throw;
   } catch (const std::exception& e) {
     FTRACE(1, "HHIR: FAILED with exception: {}\n", e.what());
     assert(0);
@@ -2762,7 +2988,7 @@ TranslatorX64::Get() {
 
 void TranslatorX64::registerCatchTrace(CTCA ip, TCA trace) {
   FTRACE(1, "registerCatchTrace: afterCall: {} trace: {}\n", ip, trace);
-  m_catchTraceMap.insert(ip, trace);
+  m_catchTraceMap.insertOrUpdate(ip, trace);
 }
 
 TCA TranslatorX64::getCatchTrace(CTCA ip) const {
@@ -2786,6 +3012,12 @@ TranslatorX64::requestExit() {
   if (s_writeLease.amOwner()) {
     s_writeLease.drop();
   }
+  if (RuntimeOption::EvalJitRelayoutInterval) {
+    static std::atomic<uint64_t> s_numRequests(0);
+    if (++s_numRequests % RuntimeOption::EvalJitRelayoutInterval == 0) {
+      scheduleRelayout();
+    }
+  }
   TRACE_MOD(txlease, 2, "%" PRIx64 " write lease stats: %15" PRId64
             " kept, %15" PRId64 " grabbed\n",
             Process::GetThreadIdForTrace(), s_writeLease.m_hintKept,
@@ -2926,7 +3158,8 @@ std::string TranslatorX64::getUsage() {
     "tx64: %9zd bytes (%zd%%) in astubs.code\n"
     "tx64: %9zd bytes (%zd%%) in m_globalData\n"
     "tx64: %9zd bytes (%zd%%) in targetCache\n"
-    "tx64: %9zd bytes (%zd%%) in persistentCache\n",
+    "tx64: %9zd bytes (%zd%%) in persistentCache\n"
+    "tx64: %9zd bytes in %zd reclaimed code ranges\n",
     aHotUsage,  100 * aHotUsage / hotCode.capacity(),
     aUsage,     100 * aUsage / mainCode.capacity(),
     aProfUsage, (profCode.capacity() != 0
@@ -2936,7 +3169,8 @@ std::string TranslatorX64::getUsage() {
     tcUsage,
     400 * tcUsage / RuntimeOption::EvalJitTargetCacheSize / 3,
     persistentUsage,
-    400 * persistentUsage / RuntimeOption::EvalJitTargetCacheSize);
+    400 * persistentUsage / RuntimeOption::EvalJitTargetCacheSize,
+    m_freeCode.bytes(), m_freeCode.ranges());
   return usage;
 }
 
@@ -3125,7 +3359,9 @@ bool TranslatorX64::dumpTCData() {
 }
 
 void TranslatorX64::invalidateSrcKey(SrcKey sk) {
-  assert(!RuntimeOption::RepoAuthoritative || RuntimeOption::EvalJitPGO);
+  assert(!RuntimeOption::RepoAuthoritative || RuntimeOption::EvalJitPGO ||
+         RuntimeOption::EvalJitRelayoutInterval ||
+         RuntimeOption::EvalJitInferredReturnTypes);
   assert(s_writeLease.amOwner());
   /*
    * Reroute existing translations for SrcKey to an as-yet indeterminate
@@ -3135,12 +3371,112 @@ void TranslatorX64::invalidateSrcKey(SrcKey sk) {
   assert(sr);
   /*
    * Since previous translations aren't reachable from here, we know we
-   * just created some garbage in the TC. We currently have no mechanism
-   * to reclaim this.
+   * just created some garbage in the TC. Requests that are already
+   * running may still be executing it (or have return addresses into
+   * it), so with Eval.JitReclaimTC it is only put back on the free list
+   * after a Treadmill round.
    */
+  if (RuntimeOption::EvalJitReclaimTC) {
+    std::vector<std::pair<TCA,uint32_t>> ranges;
+    Func* func = Func::isFuncIdValid(sk.getFuncId()) ?
+      const_cast<Func*>(sk.func()) : nullptr;
+    for (TCA start : sr->translations()) {
+      auto it = m_transSizes.find(start);
+      if (it == m_transSizes.end()) continue;
+      ranges.push_back(*it);
+      m_transSizes.erase(it);
+      if (func && func->getFuncBody() == start) {
+        func->setFuncBody(uniqueStubs.funcBodyHelperThunk);
+      }
+    }
+    if (!ranges.empty()) {
+      Treadmill::WorkItem::enqueue(
+        new FreeTranslationsTrigger(std::move(ranges)));
+    }
+  }
   sr->replaceOldTranslations();
 }
 
+/*
+ * Called the first time any request registers an intercept.  The
+ * handler's value comes back to the caller's translation past the point
+ * where it assumed the callee's proven return type, so every translation
+ * that assumed one is retranslated without it (see inferredReturnType()).
+ * Frames that are already running one of them keep the old code.
+ */
+void TranslatorX64::invalidateInferredReturnTypes() {
+  BlockingLeaseHolder writer(s_writeLease);
+  for (auto const& sk : m_inferredRetSrcKeys) {
+    invalidateSrcKey(sk);
+  }
+  m_inferredRetSrcKeys.clear();
+}
+
+/*
+ * Retranslates the hottest translations that live outside ahot, going by
+ * Eval.JitTransCounters, so that they end up packed together in the huge
+ * page backed ahot. Their old code is retired by invalidateSrcKey() like
+ * any other dead translation.
+ */
+void TranslatorX64::relayoutHotTranslations() {
+  if (!RuntimeOption::EvalJitTransCounters || !isTransDBEnabled()) return;
+  if (!hotCode.capacity()) return;
+  LeaseHolder writer(s_writeLease);
+  if (!writer) return;
+
+  struct timespec tsBegin, tsEnd;
+  Timer::GetMonotonicTime(tsBegin);
+
+  std::vector<std::pair<uint64_t, TransID>> candidates;
+  for (TransID id = 0; id < m_translations.size(); ++id) {
+    const TransRec& rec = m_translations[id];
+    if (rec.kind != TransLive && rec.kind != TransOptimize) continue;
+    if (!rec.aLen || hotCode.contains(rec.aStart)) continue;
+    uint64_t count = getTransCounter(id);
+    if (!count) continue;
+    candidates.push_back(std::make_pair(count, id));
+  }
+  std::sort(candidates.rbegin(), candidates.rend());
+
+  size_t room = hotCode.available();
+  uint32_t moved = 0;
+  for (auto& c : candidates) {
+    if (moved >= RuntimeOption::EvalJitRelayoutMaxTrans ||
+        m_relayoutSrcKeys.size() >= RuntimeOption::EvalJitRelayoutMaxSrcKeys) {
+      break;
+    }
+    const TransRec& rec = m_translations[c.second];
+    SrcKey sk = rec.src;
+    if (m_relayoutSrcKeys.count(sk)) continue;
+    if (!Func::isFuncIdValid(sk.getFuncId())) continue;
+    SrcRec* sr = m_srcDB.find(sk);
+    if (!sr || sr->hasDebuggerGuard()) continue;
+
+    // Only move SrcKeys whose live translations include this one, and
+    // leave enough room in ahot for everything else that's marked hot.
+    size_t size = 0;
+    bool live = false;
+    for (TCA start : sr->translations()) {
+      if (start == rec.aStart) live = true;
+      auto it = m_transSizes.find(start);
+      size += it != m_transSizes.end() ? it->second : rec.aLen;
+    }
+    if (!live) continue;
+    if (size + kMaxTranslationBytes > room) break;
+    room -= size;
+
+    TRACE(1, "relayout: moving %s (%" PRIu64 " hits) into ahot\n",
+          showShort(sk).c_str(), c.first);
+    m_relayoutSrcKeys.insert(sk);
+    invalidateSrcKey(sk);
+    ++moved;
+  }
+
+  Timer::GetMonotonicTime(tsEnd);
+  TRACE(1, "relayout: moved %u SrcKeys into ahot in %" PRId64 " us\n",
+        moved, gettime_diff_us(tsBegin, tsEnd));
+}
+
 void TranslatorX64::setJmpTransID(TCA jmp) {
   if (m_mode != TransProfile) return;
 
@@ -3185,14 +3521,52 @@ TranslatorX64::CodeBlockSelector::~CodeBlockSelector() {
   swap();
 }
 
+TranslatorX64::ReclaimedCodeSelector::ReclaimedCodeSelector(
+  TranslatorX64* tx)
+    : m_tx(tx)
+    , m_active(false) {
+  if (!RuntimeOption::EvalJitReclaimTC) return;
+  // ahot and aprof are left alone
+  if (m_tx->mainCode.base() != m_tx->aStart) return;
+
+  TCA start;
+  size_t len;
+  if (!m_tx->m_freeCode.take(kMaxTranslationBytes, start, len)) return;
+  TRACE(1, "reusing %zu bytes of reclaimed code @%p\n", len, start);
+  m_tx->m_reclaimedCode.init(start, len);
+  m_tx->m_reclaimedCode.setThrowWhenFull(true);
+  std::swap(m_tx->mainCode, m_tx->m_reclaimedCode);
+  m_active = true;
+}
+
+TranslatorX64::ReclaimedCodeSelector::~ReclaimedCodeSelector() {
+  if (!m_active) return;
+  std::swap(m_tx->mainCode, m_tx->m_reclaimedCode);
+  CodeBlock& used = m_tx->m_reclaimedCode;
+  if (used.available()) {
+    m_tx->m_freeCode.add(used.frontier(), used.available());
+  }
+  used = CodeBlock();
+}
+
+void TranslatorX64::ReclaimedCodeSelector::abandon() {
+  assert(m_active);
+  std::swap(m_tx->mainCode, m_tx->m_reclaimedCode);
+  CodeBlock& used = m_tx->m_reclaimedCode;
+  TRACE(1, "translation overflowed %zu bytes of reclaimed code @%p\n",
+        used.capacity(), used.base());
+  memset(used.base(), 0xcc, used.capacity());
+  m_tx->m_freeCode.add(used.base(), used.capacity());
+  used = CodeBlock();
+  m_active = false;
+}
+
 TranslatorX64::CodeBlockSelector::Args::Args(TranslatorX64* tx)
     : m_tx(tx)
     , m_select(CodeBlockSelection::Default) {
   assert(m_tx != nullptr);
 }
 
-static const int kMaxTranslationBytes = 8192;
-
 TranslatorX64::CodeBlockSelector::Args&
 TranslatorX64::CodeBlockSelector::Args::hot(bool isHot) {
   // Profile has precedence over Hot.
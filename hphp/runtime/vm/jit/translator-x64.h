@@ -16,6 +16,7 @@
 #ifndef incl_HPHP_RUNTIME_VM_TRANSLATOR_X64_H_
 #define incl_HPHP_RUNTIME_VM_TRANSLATOR_X64_H_
 
+#include <map>
 #include <memory>
 #include <boost/noncopyable.hpp>
 
@@ -69,6 +70,28 @@ struct FreeStubList {
   void push(TCA stub);
 };
 
+/*
+ * Main code of dead translations that has been retired through the
+ * Treadmill and can be handed out again. Adjacent ranges are coalesced.
+ * Protected by the write lease, except for the counters.
+ */
+struct TCFreeList {
+  TCFreeList() : m_bytes(0), m_ranges(0) {}
+  void add(TCA start, size_t len);
+  // Takes the smallest range of at least minLen bytes.
+  bool take(size_t minLen, TCA& start, size_t& len);
+  size_t bytes() const { return m_bytes; }
+  size_t ranges() const { return m_ranges; }
+
+private:
+  void erase(std::map<TCA, size_t>::iterator it);
+
+  std::map<TCA, size_t> m_byAddr;
+  std::multimap<size_t, TCA> m_bySize;
+  size_t m_bytes;
+  size_t m_ranges;
+};
+
 class TranslatorX64;
 extern __thread TranslatorX64* tx64;
 
@@ -102,6 +125,7 @@ class TranslatorX64 : public Translator
   friend class SrcDB;  // For write lock and code invalidation.
   friend class Tx64Reaper;
   friend class HPHP::JIT::CodeGenerator;
+  friend struct JitWorker; // For background retranslateOpt.
 
   typedef X64Assembler Asm;
 
@@ -136,6 +160,30 @@ class TranslatorX64 : public Translator
     CodeBlockSelection   m_select;
   };
 
+  /*
+   * With Eval.JitReclaimTC, points mainCode at a range of reclaimed code
+   * for the duration of one translation, if there is one big enough and
+   * mainCode hasn't already been swapped for ahot or aprof. The real 'a'
+   * is parked in m_reclaimedCode meanwhile. Whatever the translation
+   * leaves unused goes back on the free list.
+   *
+   * A translation that doesn't fit throws DataBlockFull; translate() then
+   * calls abandon(), which puts the whole range back on the free list and
+   * mainCode back on the frontier, and translates again.
+   */
+  class ReclaimedCodeSelector {
+   public:
+    explicit ReclaimedCodeSelector(TranslatorX64* tx);
+    ~ReclaimedCodeSelector();
+
+    bool active() const { return m_active; }
+    void abandon();
+
+   private:
+    TranslatorX64* m_tx;
+    bool           m_active;
+  };
+
   TCA                    tcStart;
   TCA                    aStart;
 
@@ -173,6 +221,21 @@ private:
 
   FreeStubList m_freeStubs;
 
+  // Dead translation code, and the main code size of each live
+  // translation keyed by its start. Only maintained with
+  // Eval.JitReclaimTC.
+  TCFreeList m_freeCode;
+  hphp_hash_map<TCA, uint32_t> m_transSizes;
+  CodeBlock m_reclaimedCode; // see ReclaimedCodeSelector
+
+  // SrcKeys picked by relayoutHotTranslations(); they are retranslated
+  // into ahot
+  hphp_hash_set<SrcKey,SrcKey::Hasher> m_relayoutSrcKeys;
+
+  // SrcKeys whose translations assumed a callee's inferred return type;
+  // see invalidateInferredReturnTypes()
+  hphp_hash_set<SrcKey,SrcKey::Hasher> m_inferredRetSrcKeys;
+
   // asize + astubssize + gdatasize + trampolinesblocksize
   size_t m_totalSize;
 
@@ -260,7 +323,7 @@ public:
            mainCode.base() != stubsCode.base() &&
            hotCode.base()  != stubsCode.base());
     return codeBlockChoose(addr, mainCode, hotCode, profCode, stubsCode,
-                           trampolinesCode);
+                           trampolinesCode, m_reclaimedCode);
   }
 private:
 
@@ -269,6 +332,18 @@ private:
 private:
   void invalidateSrcKey(SrcKey sk);
 
+public:
+  // Runs on the relayout thread; see scheduleRelayout() in jit-worker.h.
+  void relayoutHotTranslations();
+
+  // Called from EventHook::EnableIntercept() the first time any request
+  // registers an intercept.
+  void invalidateInferredReturnTypes();
+
+  // Called from the Treadmill once no request can be running the
+  // translations in ranges any more.
+  bool reclaimTranslations(const std::vector<std::pair<TCA,uint32_t>>& ranges);
+
 public:
   FixupMap& fixupMap() { return m_fixupMap; }
 
@@ -321,7 +396,9 @@ private:
   TCA createTranslation(const TranslArgs& args);
   TCA retranslate(const TranslArgs& args);
   TCA translate(const TranslArgs& args);
-  void translateWork(const TranslArgs& args);
+  // Returns false if nothing was published, which only happens on a JIT
+  // worker that couldn't translate the region.
+  bool translateWork(const TranslArgs& args);
 
   TCA lookupTranslation(SrcKey sk) const;
   TCA retranslateOpt(TransID transId, bool align);
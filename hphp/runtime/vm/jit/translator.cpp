@@ -39,6 +39,7 @@
 #include "hphp/runtime/ext/ext_collections.h"
 #include "hphp/runtime/vm/hhbc.h"
 #include "hphp/runtime/vm/bytecode.h"
+#include "hphp/runtime/vm/event-hook.h"
 #include "hphp/runtime/vm/jit/annotation.h"
 #include "hphp/runtime/vm/jit/hhbc-translator.h"
 #include "hphp/runtime/vm/jit/ir-unit.h"
@@ -715,6 +716,16 @@ getDynLocType(const SrcKey startSk,
     CS(OutResource,    KindOfResource);
 #undef CS
     case OutPred: {
+      // ni->funcd is exact, so a return type the compiler proved for it
+      // needs no guard; emitFCall tells the IR about it.
+      if (ni->op() == OpFCall) {
+        auto const dt = inferredReturnType(ni->funcd);
+        if (dt != KindOfAny) {
+          FTRACE(1, "FCall to {}: inferred return type {}\n",
+                 ni->funcd->fullName()->data(), tname(dt));
+          return RuntimeType(dt);
+        }
+      }
       auto dt = predictOutputs(startSk, ni);
       if (dt != KindOfAny) ni->outputPredicted = true;
       return RuntimeType(dt);
@@ -1367,6 +1378,10 @@ bool outputIsPredicted(SrcKey startSk,
                        NormalizedInstruction& inst) {
   auto const& iInfo = getInstrInfo(inst.op());
   auto doPrediction = iInfo.type == OutPred && !inst.breaksTracelet;
+  if (inst.op() == OpFCall && inferredReturnType(inst.funcd) != KindOfAny) {
+    // emitFCall asserts the type instead.
+    doPrediction = false;
+  }
   if (doPrediction) {
     // All OutPred ops except for SetM have a single stack output for now.
     assert(iInfo.out == Stack1 || inst.op() == OpSetM);
@@ -1381,6 +1396,33 @@ bool outputIsPredicted(SrcKey startSk,
   return doPrediction;
 }
 
+DataType inferredReturnType(const Func* callee) {
+  if (!callee || callee->isBuiltin() ||
+      !RuntimeOption::RepoAuthoritative ||
+      !RuntimeOption::EvalJitInferredReturnTypes) {
+    return KindOfAny;
+  }
+  // An fb_intercept handler can return anything in place of the body.
+  // maybeIntercepted() is -1 until the callee is first looked up as an
+  // intercept target, so also give up once any handler exists at all.
+  if (callee->maybeIntercepted() > 0 || EventHook::InterceptsRegistered()) {
+    return KindOfAny;
+  }
+  switch (callee->provenReturnType()) {
+    case KindOfNull:
+    case KindOfBoolean:
+    case KindOfInt64:
+    case KindOfDouble:
+    case KindOfString:
+    case KindOfArray:
+    case KindOfObject:
+    case KindOfResource:
+      return callee->provenReturnType();
+    default:
+      return KindOfAny;
+  }
+}
+
 /*
  * For MetaData information that affects whether we want to even put a
  * value in the ni->inputs, we need to look at it before we call
@@ -3466,6 +3508,9 @@ Translator::Translator()
   initInstrInfo();
   if (RuntimeOption::EvalJitPGO) {
     m_profData = new ProfData();
+    if (!RuntimeOption::EvalJitPGOProfileFile.empty()) {
+      m_profData->read(RuntimeOption::EvalJitPGOProfileFile);
+    }
   }
 }
 
@@ -3703,7 +3748,8 @@ bool instrMustInterp(const NormalizedInstruction& inst) {
   }
 }
 
-void Translator::traceStart(Offset initBcOffset, Offset initSpOffset) {
+void Translator::traceStart(Offset initBcOffset, Offset initSpOffset,
+                            const Func* func) {
   assert(!m_irTrans);
 
   FTRACE(1, "{}{:-^40}{}\n",
@@ -3711,8 +3757,7 @@ void Translator::traceStart(Offset initBcOffset, Offset initSpOffset) {
          " HHIR during translation ",
          color(ANSI_COLOR_END));
 
-  m_irTrans.reset(new JIT::IRTranslator(initBcOffset, initSpOffset,
-                                        liveFunc()));
+  m_irTrans.reset(new JIT::IRTranslator(initBcOffset, initSpOffset, func));
 }
 
 void Translator::traceEnd() {
@@ -3757,6 +3802,7 @@ Translator::translateRegion(const RegionDesc& region,
       // region the guards will go to a retranslate request. Otherwise, they'll
       // go to a side exit.
       bool isFirstRegionInstr = block == region.blocks.front() && i == 0;
+      std::vector<RegionDesc::TypePred> entryGuards;
       while (typePreds.hasNext(sk)) {
         auto const& pred = typePreds.next();
         auto type = pred.type;
@@ -3765,9 +3811,11 @@ Translator::translateRegion(const RegionDesc& region,
           // Do not generate guards for class; instead assert the type
           assert(loc.tag() == JIT::RegionDesc::Location::Tag::Stack);
           ht.assertTypeLocation(loc, type);
+          if (isFirstRegionInstr) entryGuards.push_back(pred);
         } else if (isFirstRegionInstr) {
           bool checkOuterTypeOnly = m_mode != TransProfile;
           ht.guardTypeLocation(loc, type, checkOuterTypeOnly);
+          entryGuards.push_back(pred);
         } else {
           ht.checkTypeLocation(loc, type, sk.offset());
         }
@@ -3775,10 +3823,18 @@ Translator::translateRegion(const RegionDesc& region,
 
       // Emit reffiness guards. For now, we only support reffiness guards at
       // the beginning of the region.
+      bool hasRefGuards = false;
       while (refPreds.hasNext(sk)) {
         assert(sk == startSk);
         auto const& pred = refPreds.next();
         ht.guardRefs(pred.arSpOffset, pred.mask, pred.vals);
+        hasRefGuards = true;
+      }
+
+      // Back-edges of a loop region come back to just past its entry
+      // guards when they can.
+      if (isFirstRegionInstr && region.loop && !hasRefGuards) {
+        ht.emitLoopHeader(entryGuards);
       }
 
       if (RuntimeOption::EvalJitTransCounters && isFirstRegionInstr) {
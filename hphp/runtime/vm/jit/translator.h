@@ -314,6 +314,7 @@ struct TranslArgs {
       , m_align(align)
       , m_interp(false)
       , m_setFuncBody(false)
+      , m_replaceOld(false)
       , m_transId(InvalidID)
     {}
 
@@ -337,6 +338,14 @@ struct TranslArgs {
     m_setFuncBody = true;
     return *this;
   }
+  /*
+   * The new translation replaces every existing one for m_sk, which stay
+   * reachable until it is published.
+   */
+  TranslArgs& replaceOld() {
+    m_replaceOld = true;
+    return *this;
+  }
   TranslArgs& transId(TransID transId) {
     m_transId = transId;
     return *this;
@@ -347,6 +356,7 @@ struct TranslArgs {
   bool m_align;
   bool m_interp;
   bool m_setFuncBody;
+  bool m_replaceOld;
   TransID m_transId;
 };
 
@@ -409,7 +419,8 @@ protected:
     Success
   };
   static const char* translateResultName(TranslateResult r);
-  void traceStart(Offset initBcOffset, Offset initSpOffset);
+  void traceStart(Offset initBcOffset, Offset initSpOffset,
+                  const Func* func);
   virtual void traceCodeGen() = 0;
   void traceEnd();
   void traceFree();
@@ -716,6 +727,15 @@ void getInputsImpl(SrcKey startSk, NormalizedInstruction* inst,
                    int& currentStackOffset, InputInfos& inputs,
                    const Func* func, const LocalTypeFn& localType);
 bool outputIsPredicted(SrcKey startSk, NormalizedInstruction& inst);
+
+/*
+ * The type the static compiler proved every return of callee has, or
+ * KindOfAny if it didn't prove one or we can't rely on it.  Only
+ * RepoAuthoritative repos carry these, and they stop being used once a
+ * request registers an intercept (see
+ * TranslatorX64::invalidateInferredReturnTypes()).
+ */
+DataType inferredReturnType(const Func* callee);
 bool callDestroysLocals(const NormalizedInstruction& inst,
                         const Func* caller);
 int locPhysicalOffset(Location l, const Func* f = nullptr);
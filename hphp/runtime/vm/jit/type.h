@@ -579,6 +579,18 @@ public:
     return Type(m_bits);
   }
 
+  /*
+   * The unspecialized bits of a Type, for writing it to disk (see
+   * ProfData::write).  The encoding is only meaningful to the same build.
+   */
+  uint64_t rawBits() const {
+    return m_bits;
+  }
+
+  static Type fromRawBits(uint64_t bits) {
+    return Type(bits);
+  }
+
   Type specialize(ArrayData::ArrayKind arrayKind) const {
     assert(canSpecializeArrayKind());
     return Type(m_bits, arrayKind);
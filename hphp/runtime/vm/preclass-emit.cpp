@@ -262,6 +262,9 @@ template<class SerDe> void PreClassEmitter::serdeMetaData(SerDe& sd) {
     ;
 }
 
+// The flat repo (flat-repo.cpp) decodes these outside the repo proxies.
+template void PreClassEmitter::serdeMetaData<>(BlobDecoder&);
+
 //=============================================================================
 // PreClassRepoProxy.
 
@@ -342,6 +342,10 @@ void RepoQuery::getTypedValue(int iCol, TypedValue& tv) {
   const void* blob;
   size_t size;
   getBlob(iCol, blob, size);
+  unserializeRepoValue(blob, size, tv);
+}
+
+void unserializeRepoValue(const void* blob, size_t size, TypedValue& tv) {
   tvWriteUninit(&tv);
   if (size > 0) {
     String s = String((const char*)blob, size, CopyString);
@@ -207,6 +207,12 @@ class RepoProxy {
   Repo& m_repo;
 };
 
+/*
+ * Decode a TypedValue column as written by RepoQuery::bindTypedValue (an
+ * empty blob is Uninit).  Strings and arrays come back static.
+ */
+void unserializeRepoValue(const void* blob, size_t size, TypedValue& tv);
+
 }
 
 #endif
@@ -15,6 +15,8 @@
 */
 
 #include "hphp/runtime/vm/repo.h"
+
+#include "hphp/runtime/vm/flat-repo.h"
 #include "hphp/util/logger.h"
 #include "hphp/util/trace.h"
 #include "hphp/util/repo-schema.h"
@@ -110,6 +112,9 @@ void Repo::setCliFile(const std::string& cliFile) {
 }
 
 Unit* Repo::loadUnit(const std::string& name, const MD5& md5) {
+  if (auto flat = FlatRepo::Get()) {
+    return flat->loadUnit(name, md5);
+  }
   if (m_dbc == nullptr) {
     return nullptr;
   }
@@ -157,7 +162,35 @@ bool Repo::GetFileHashStmt::get(const char *path, MD5& md5) {
   return false;
 }
 
+bool Repo::GetFilePathsStmt::get(std::vector<std::string>& paths) {
+  try {
+    RepoTxn txn(m_repo);
+    if (!prepared()) {
+      std::stringstream ssSelect;
+      ssSelect << "SELECT DISTINCT path FROM "
+               << m_repo.table(m_repoId, "FileMd5")
+               << " ORDER BY path ASC;";
+      txn.prepare(*this, ssSelect.str());
+    }
+    RepoTxnQuery query(txn, *this);
+    do {
+      query.step();
+      if (query.row()) {
+        const char* path; size_t size; /**/ query.getText(0, path, size);
+        paths.emplace_back(path, size);
+      }
+    } while (!query.done());
+    txn.commit();
+    return true;
+  } catch (RepoExc& re) {
+    return false;
+  }
+}
+
 bool Repo::findFile(const char *path, const string &root, MD5& md5) {
+  if (auto flat = FlatRepo::Get()) {
+    return flat->findFile(path, root, md5);
+  }
   if (m_dbc == nullptr) {
     return false;
   }
@@ -180,6 +213,17 @@ bool Repo::findFile(const char *path, const string &root, MD5& md5) {
   return false;
 }
 
+bool Repo::enumerateFiles(std::vector<std::string>& paths) {
+  if (auto flat = FlatRepo::Get()) {
+    flat->enumerateFiles(paths);
+    return true;
+  }
+  if (m_dbc == nullptr) {
+    return false;
+  }
+  return getFilePaths(RepoIdCentral).get(paths);
+}
+
 bool Repo::insertMd5(UnitOrigin unitOrigin, UnitEmitter* ue, RepoTxn& txn) {
   const StringData* path = ue->getFilepath();
   const MD5& md5 = ue->md5();
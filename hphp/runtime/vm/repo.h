@@ -77,6 +77,9 @@ class Repo : public RepoProxy {
 
   Unit* loadUnit(const std::string& name, const MD5& md5);
   bool findFile(const char* path, const std::string& root, MD5& md5);
+  // Append the path of every file in the central repo (relative to the
+  // source root it was built from, as findFile looks them up).
+  bool enumerateFiles(std::vector<std::string>& paths);
   bool insertMd5(UnitOrigin unitOrigin, UnitEmitter* ue, RepoTxn& txn);
   void commitMd5(UnitOrigin unitOrigin, UnitEmitter *ue);
 
@@ -84,7 +87,8 @@ class Repo : public RepoProxy {
 #define RP_GOP(o) RP_OP(Get##o, get##o)
 #define RP_OPS \
   RP_IOP(FileHash) \
-  RP_GOP(FileHash)
+  RP_GOP(FileHash) \
+  RP_GOP(FilePaths)
   class InsertFileHashStmt : public RepoProxy::Stmt {
     public:
       InsertFileHashStmt(Repo& repo, int repoId) : Stmt(repo, repoId) {}
@@ -95,6 +99,11 @@ class Repo : public RepoProxy {
       GetFileHashStmt(Repo& repo, int repoId) : Stmt(repo, repoId) {}
       bool get(const char* path, MD5& md5);
   };
+  class GetFilePathsStmt : public RepoProxy::Stmt {
+    public:
+      GetFilePathsStmt(Repo& repo, int repoId) : Stmt(repo, repoId) {}
+      bool get(std::vector<std::string>& paths);
+  };
 #define RP_OP(c, o) \
  public: \
   c##Stmt& o(int repoId) { return *m_##o[repoId]; } \
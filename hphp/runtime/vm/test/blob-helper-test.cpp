@@ -16,6 +16,8 @@
 #include "hphp/runtime/vm/blob-helper.h"
 #include <gtest/gtest.h>
 #include <limits>
+#include <string>
+#include <vector>
 #include <iostream>
 #include <utility>
 
@@ -72,4 +74,38 @@ TEST(BlobHelperTest, TestInputs) {
 
 }
 
+TEST(BlobHelperTest, TruncatedInputThrows) {
+  BlobEncoder encoder;
+  std::vector<std::string> strs = { "hello", "world" };
+  encoder(std::string("flat repo record"))(strs)(uint64_t(1) << 40);
+
+  // Every proper prefix runs out somewhere: inside a varint, a string
+  // body, or the vector's elements.
+  for (size_t len = 0; len < encoder.size(); ++len) {
+    BlobDecoder decoder(encoder.data(), len);
+    std::string s;
+    std::vector<std::string> v;
+    uint64_t n;
+    EXPECT_ANY_THROW(decoder(s)(v)(n)) << "prefix of " << len << " bytes";
+  }
+
+  BlobDecoder decoder(encoder.data(), encoder.size());
+  std::string s;
+  std::vector<std::string> v;
+  uint64_t n;
+  decoder(s)(v)(n);
+  EXPECT_EQ("flat repo record", s);
+  EXPECT_EQ(strs, v);
+  EXPECT_EQ(uint64_t(1) << 40, n);
+}
+
+TEST(BlobHelperTest, BadLengthThrows) {
+  // A string claiming more bytes than the blob has left.
+  BlobEncoder encoder;
+  encoder(uint32_t(1000));
+  BlobDecoder decoder(encoder.data(), encoder.size());
+  std::string s;
+  EXPECT_ANY_THROW(decoder(s));
+}
+
 }
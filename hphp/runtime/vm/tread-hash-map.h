@@ -46,7 +46,7 @@ namespace Treadmill { void deferredFree(void*); }
  * empty key).
  *
  * Insertions must be unique.  It is an error to insert the same key
- * more than once.
+ * more than once, except through insertOrUpdate().
  *
  * Uses the treadmill to collect garbage.
  */
@@ -151,6 +151,20 @@ public:
     return insertImpl(acquireAndGrowIfNeeded(), key, val);
   }
 
+  /*
+   * Like insert(), but overwrites the value if key is already present.
+   * The value is written in place, so this is only safe when no reader
+   * can be looking key up concurrently (e.g. the address of translation
+   * cache code that has been reclaimed and is being reused).
+   */
+  Val* insertOrUpdate(Key key, Val val) {
+    if (Val* existing = find(key)) {
+      *existing = val;
+      return existing;
+    }
+    return insert(key, val);
+  }
+
   Val* find(Key key) const {
     assert(key != 0);
 
@@ -17,6 +17,7 @@
 #include "hphp/runtime/base/runtime-option.h"
 #include "hphp/runtime/base/stats.h"
 #include "hphp/runtime/vm/jit/translator.h"
+#include "hphp/runtime/vm/jit/prof-data.h"
 #include "hphp/util/trace.h"
 
 #include "folly/String.h"
@@ -157,12 +158,24 @@ profileInit() {
  * the EvalJitWarmupRequests'th req.
  */
 bool __thread profileOn = false;
+
+/*
+ * A JIT profile saved by a warmed-up server already says what to optimize,
+ * so there is no point in interpreting the first requests to warm up.
+ */
+static bool persistedProfileLoaded() {
+  if (!RuntimeOption::EvalJitPGO) return false;
+  auto profData = Transl::Translator::Get()->profData();
+  return profData && profData->loadedPersistedProfile();
+}
+
 static int64_t numRequests;
 
 static inline bool warmedUp() {
   return (numRequests >= RuntimeOption::EvalJitWarmupRequests) ||
     (RuntimeOption::ClientExecutionMode() &&
-     !RuntimeOption::EvalJitProfileRecord);
+     !RuntimeOption::EvalJitProfileRecord) ||
+    persistedProfileLoaded();
 }
 
 static inline bool profileThisRequest() {
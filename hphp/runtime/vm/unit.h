@@ -746,6 +746,7 @@ private:
 
 class UnitEmitter {
   friend class UnitRepoProxy;
+  friend class FlatRepo;
   friend class ::HPHP::Compiler::Peephole;
  public:
   explicit UnitEmitter(const MD5& md5);
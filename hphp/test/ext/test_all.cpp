@@ -22,6 +22,7 @@
 #include "hphp/test/ext/test_util.h"
 #include "hphp/test/ext/test_ext.h"
 #include "hphp/test/ext/test_server.h"
+#include "hphp/test/ext/test_apc_bench.h"
 #include "hphp/compiler/option.h"
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -35,6 +36,10 @@ void Test::RunTestsImpl(bool &allPassed, std::string &suite,
     RUN_TESTSUITE(TestServer);
     return;
   }
+  if (suite == "TestApcBench") {
+    RUN_TESTSUITE(TestApcBench);
+    return;
+  }
 
   // set based tests with many suites
   if (set == "TestUnit") {
@@ -0,0 +1,374 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#include "hphp/test/ext/test_apc_bench.h"
+#include "hphp/runtime/base/array-init.h"
+#include "hphp/runtime/base/execution-context.h"
+#include "hphp/runtime/base/flat-array.h"
+#include "hphp/runtime/base/program-functions.h"
+#include "hphp/runtime/base/shared-store-base.h"
+#include "hphp/util/async-func.h"
+#include "hphp/util/process.h"
+#include "hphp/util/timer.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+const int64_t kFetchesPerThread = 500000;
+
+const StaticString
+  s_hotArray("apc_bench_hot_array"),
+  s_hotString("apc_bench_hot_string"),
+  s_overwrite("apc_bench_overwrite"),
+  s_restored("apc_bench_restored"),
+  s_flat("apc_bench_flat"),
+  s_missing("missing");
+
+ConcurrentTableSharedStore& store() {
+  return s_apc_store[SHARED_STORE_APPLICATION_CACHE];
+}
+
+struct RequestScope {
+  RequestScope() {
+    hphp_session_init();
+    hphp_context_init();
+  }
+  ~RequestScope() {
+    hphp_context_exit(g_context.getNoCheck(), false);
+    hphp_session_exit();
+  }
+};
+
+struct FetchWorker {
+  FetchWorker() : hits(0) {}
+
+  void run() {
+    RequestScope request;
+    for (int64_t i = 0; i < kFetchesPerThread; ++i) {
+      Variant v;
+      if (store().get(i & 1 ? s_hotString : s_hotArray, v)) ++hits;
+    }
+  }
+
+  int64_t hits;
+};
+
+/*
+ * Run `threads' FetchWorkers concurrently and return the total number of
+ * fetches per second, or -1 if any fetch missed.
+ */
+double runFetchers(int threads) {
+  std::vector<std::unique_ptr<FetchWorker>> workers;
+  std::vector<std::unique_ptr<AsyncFunc<FetchWorker>>> funcs;
+  for (int i = 0; i < threads; ++i) {
+    workers.emplace_back(new FetchWorker);
+    funcs.emplace_back(
+      new AsyncFunc<FetchWorker>(workers.back().get(), &FetchWorker::run));
+  }
+
+  timespec begin, end;
+  Timer::GetMonotonicTime(begin);
+  for (auto& f : funcs) f->start();
+  for (auto& f : funcs) f->waitForEnd();
+  Timer::GetMonotonicTime(end);
+
+  for (auto& w : workers) {
+    if (w->hits != kFetchesPerThread) return -1;
+  }
+  int64_t us = std::max<int64_t>(gettime_diff_us(begin, end), 1);
+  return double(kFetchesPerThread) * threads * 1000000 / us;
+}
+/*
+ * Read everything in a FlatArray, the way SharedArray would.
+ */
+void readFlat(const FlatArray* flat) {
+  for (uint32_t i = 0; i < flat->size(); ++i) {
+    Variant key = flat->keyAt(i);
+    if (key.isInteger()) {
+      flat->indexOf(key.toInt64());
+    } else {
+      flat->indexOf(key.getStringData());
+    }
+    switch (flat->valAt(i)->m_type) {
+    case KindOfString:
+      String(flat->stringAt(i));
+      break;
+    case KindOfArray:
+      readFlat(flat->arrayAt(i));
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+
+}
+
+///////////////////////////////////////////////////////////////////////////////
+
+TestApcBench::TestApcBench() {
+}
+
+bool TestApcBench::RunTests(const std::string &which) {
+  bool ret = true;
+  RUN_TEST(TestBorrowedSurvivesOverwrite);
+  RUN_TEST(TestStoreBorrowedAfterRelease);
+  RUN_TEST(TestFlatArray);
+  RUN_TEST(TestFlatArrayCorrupt);
+  RUN_TEST(TestSnapshotRoundTrip);
+  RUN_TEST(TestSnapshotEntryExpires);
+  RUN_TEST(BenchFetchScaling);
+  return ret;
+}
+
+bool TestApcBench::TestBorrowedSurvivesOverwrite() {
+  bool saved = SharedVariant::BorrowOnFetch;
+  SharedVariant::BorrowOnFetch = true;
+  SCOPE_EXIT { SharedVariant::BorrowOnFetch = saved; };
+
+  RequestScope request;
+  String big(std::string(4096, 'x'));
+  store().store(s_overwrite, make_packed_array(1, 2, big), 0);
+
+  // Replace and then erase the value while this request still borrows
+  // it; the old SharedVariant must stay intact until the request ends.
+  Variant fetched;
+  VERIFY(store().get(s_overwrite, fetched));
+  Variant str;
+  VERIFY(store().store(s_overwrite, big, 0));
+  VERIFY(store().get(s_overwrite, str));
+  VERIFY(store().store(s_overwrite, 42, 0));
+  VERIFY(store().erase(s_overwrite));
+
+  VERIFY(fetched.toArray().size() == 3);
+  VERIFY(equal(fetched.toArray().rvalAt(1), 2));
+  VERIFY(equal(fetched.toArray().rvalAt(2), big));
+  VERIFY(equal(str, big));
+  return Count(true);
+}
+
+bool TestApcBench::TestStoreBorrowedAfterRelease() {
+  bool saved = SharedVariant::BorrowOnFetch;
+  SharedVariant::BorrowOnFetch = true;
+  SCOPE_EXIT { SharedVariant::BorrowOnFetch = saved; };
+
+  String big(std::string(4096, 'x'));
+  {
+    RequestScope request;
+    store().store(s_overwrite, make_packed_array(1, 2, big), 0);
+
+    // Erasing the key drops the last reference, so the SharedVariant the
+    // fetched array borrows is only waiting for the treadmill.  Storing
+    // the array again has to copy it rather than revive it.
+    Variant fetched;
+    VERIFY(store().get(s_overwrite, fetched));
+    SharedVariant* released = fetched.getSharedVariant();
+    VERIFY(released != nullptr);
+    VERIFY(store().erase(s_overwrite));
+    VERIFY(store().store(s_restored, fetched, 0));
+
+    Variant restored;
+    VERIFY(store().get(s_restored, restored));
+    VERIFY(restored.getSharedVariant() != released);
+  }
+
+  // Let the treadmill free the released value before reading the copy.
+  { RequestScope request; }
+  {
+    RequestScope request;
+    Variant restored;
+    VERIFY(store().get(s_restored, restored));
+    VERIFY(restored.toArray().size() == 3);
+    VERIFY(equal(restored.toArray().rvalAt(2), big));
+    VERIFY(store().erase(s_restored));
+  }
+  return Count(true);
+}
+
+bool TestApcBench::TestFlatArray() {
+  uint32_t saved = SharedVariant::FlatArrayThreshold;
+  SharedVariant::FlatArrayThreshold = 1;
+  SCOPE_EXIT { SharedVariant::FlatArrayThreshold = saved; };
+
+  RequestScope request;
+  Array arr;
+  for (int i = 0; i < 1000; ++i) {
+    arr.set(String("key") + String(i), i);
+  }
+  arr.set(7, 1.5);
+  arr.set(String("str"), String("hello"));
+  arr.set(String("vec"), make_packed_array(1, String("two"), uninit_null()));
+  VERIFY(store().store(s_flat, arr, 0));
+
+  Variant fetched;
+  VERIFY(store().get(s_flat, fetched));
+  Array got = fetched.toArray();
+  VERIFY(got->kind() == ArrayData::kSharedKind);
+  VERIFY(got.size() == arr.size());
+  VERIFY(equal(got.rvalAt(String("key999")), 999));
+  VERIFY(equal(got.rvalAt(7), 1.5));
+  VERIFY(equal(got.rvalAt(String("str")), String("hello")));
+  VERIFY(!got.exists(s_missing));
+  VERIFY(!got.exists(8));
+  Array vec = got.rvalAt(String("vec")).toArray();
+  VERIFY(vec.size() == 3);
+  VERIFY(equal(vec.rvalAt(1), String("two")));
+  VERIFY(vec.rvalAt(2).isNull());
+  VERIFY(equal(got, arr));
+
+  // writes go to a private copy
+  got.set(String("str"), 0);
+  VERIFY(equal(got.rvalAt(String("str")), 0));
+  Variant again;
+  VERIFY(store().get(s_flat, again));
+  VERIFY(equal(again.toArray().rvalAt(String("str")), String("hello")));
+
+  VERIFY(store().erase(s_flat));
+  return Count(true);
+}
+
+bool TestApcBench::TestFlatArrayCorrupt() {
+  RequestScope request;
+  Array arr = make_map_array("a", 1, "b", String("two"),
+                             "c", make_map_array("d", String("three"),
+                                                 "e", make_packed_array(4)));
+  FlatArray* flat = FlatArray::Create(arr.get());
+  VERIFY(flat != nullptr);
+  std::string bytes(reinterpret_cast<const char*>(flat), flat->bytes());
+  FlatArray::Destroy(flat);
+
+  flat = FlatArray::FromBytes(bytes.data(), bytes.size());
+  VERIFY(flat != nullptr);
+  FlatArray::Destroy(flat);
+  VERIFY(!FlatArray::FromBytes(bytes.data(), bytes.size() - 8));
+
+  // Whatever a damaged byte does to the offsets, hash chains or types,
+  // FromBytes either rejects the block or returns one that reads safely.
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    for (char flip : { char(0x01), char(0x80), char(0xff) }) {
+      std::string bad = bytes;
+      bad[i] ^= flip;
+      if (FlatArray* f = FlatArray::FromBytes(bad.data(), bad.size())) {
+        readFlat(f);
+        FlatArray::Destroy(f);
+      }
+    }
+  }
+  return Count(true);
+}
+
+bool TestApcBench::TestSnapshotRoundTrip() {
+  uint32_t saved = SharedVariant::FlatArrayThreshold;
+  SharedVariant::FlatArrayThreshold = 2;
+  SCOPE_EXIT { SharedVariant::FlatArrayThreshold = saved; };
+
+  RequestScope request;
+  std::string path = "/tmp/test_apc_snapshot." +
+                     boost::lexical_cast<std::string>(getpid());
+  SCOPE_EXIT { unlink(path.c_str()); };
+
+  Array flat = make_map_array(String("a"), 1, String("b"), String("two"));
+  ConcurrentTableSharedStore src(SHARED_STORE_APPLICATION_CACHE, 4);
+  VERIFY(src.store(String("int"), 42, 0));
+  VERIFY(src.store(String("str"), String("hello"), 0));
+  VERIFY(src.store(String("ttl"), 1.5, 3600));
+  VERIFY(src.store(String("flat"), flat, 0));
+  VERIFY(src.store(String("vec"), make_packed_array(1), 0));
+
+  ConcurrentTableSharedStore::SnapshotInfo out;
+  VERIFY(src.saveSnapshot(path, 0, out));
+  VERIFY(out.entries == 5 && out.skipped == 0);
+
+  ConcurrentTableSharedStore dst(SHARED_STORE_APPLICATION_CACHE, 2);
+  VERIFY(dst.store(String("int"), 7, 0)); // present keys are kept
+  ConcurrentTableSharedStore::SnapshotInfo in;
+  VERIFY(dst.loadSnapshot(path, 2, in));
+  VERIFY(in.entries == 4 && in.skipped == 1);
+
+  Variant v;
+  VERIFY(dst.get(String("int"), v) && equal(v, 7));
+  VERIFY(dst.get(String("str"), v) && equal(v, String("hello")));
+  VERIFY(dst.get(String("ttl"), v) && equal(v, 1.5));
+  VERIFY(dst.get(String("flat"), v) && equal(v, flat));
+  VERIFY(dst.get(String("vec"), v) && equal(v, make_packed_array(1)));
+  return Count(true);
+}
+
+bool TestApcBench::TestSnapshotEntryExpires() {
+  RequestScope request;
+  std::string path = "/tmp/test_apc_snapshot_ttl." +
+                     boost::lexical_cast<std::string>(getpid());
+  SCOPE_EXIT { unlink(path.c_str()); };
+
+  ConcurrentTableSharedStore src(SHARED_STORE_APPLICATION_CACHE, 4);
+  VERIFY(src.store(String("cold"), String("stale"), 2));
+  VERIFY(src.store(String("warm"), String("stale"), 2));
+  VERIFY(src.store(String("keep"), String("fresh"), 0));
+  ConcurrentTableSharedStore::SnapshotInfo out;
+  VERIFY(src.saveSnapshot(path, 0, out));
+
+  ConcurrentTableSharedStore dst(SHARED_STORE_APPLICATION_CACHE, 4);
+  ConcurrentTableSharedStore::SnapshotInfo in;
+  VERIFY(dst.loadSnapshot(path, 1, in));
+  VERIFY(in.entries == 3);
+
+  Variant v;
+  VERIFY(dst.get(String("warm"), v) && equal(v, String("stale")));
+  sleep(3);
+  // Neither the snapshot copy nor the fetched one may come back.
+  VERIFY(!dst.get(String("cold"), v));
+  VERIFY(!dst.get(String("cold"), v));
+  VERIFY(!dst.get(String("warm"), v));
+  VERIFY(!dst.get(String("warm"), v));
+  VERIFY(dst.get(String("keep"), v) && equal(v, String("fresh")));
+  return Count(true);
+}
+
+bool TestApcBench::BenchFetchScaling() {
+  {
+    RequestScope request;
+    Array arr;
+    for (int i = 0; i < 64; ++i) {
+      arr.set(String("key") + String(i), String(std::string(32, 'a' + i % 26)));
+    }
+    VERIFY(store().store(s_hotArray, arr, 0));
+    VERIFY(store().store(s_hotString, String(std::string(1024, 'z')), 0));
+  }
+
+  bool saved = SharedVariant::BorrowOnFetch;
+  int maxThreads = std::max(Process::GetCPUCount(), 1);
+  for (int borrow = 0; borrow < 2; ++borrow) {
+    SharedVariant::BorrowOnFetch = borrow;
+    printf("BorrowOnFetch = %s\n", borrow ? "true" : "false");
+    for (int threads = 1; ; threads = std::min(threads * 2, maxThreads)) {
+      double rate = runFetchers(threads);
+      VERIFY(rate > 0);
+      printf("  %3d threads: %12.0f fetches/sec, %10.0f per thread\n",
+             threads, rate, rate / threads);
+      if (threads == maxThreads) break;
+    }
+  }
+  SharedVariant::BorrowOnFetch = saved;
+
+  {
+    RequestScope request;
+    store().erase(s_hotArray);
+    store().erase(s_hotString);
+  }
+  return Count(true);
+}
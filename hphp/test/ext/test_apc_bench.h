@@ -0,0 +1,52 @@
+/*
+   +----------------------------------------------------------------------+
+   | HipHop for PHP                                                       |
+   +----------------------------------------------------------------------+
+   | Copyright (c) 2010-2013 Facebook, Inc. (http://www.facebook.com)     |
+   +----------------------------------------------------------------------+
+   | This source file is subject to version 3.01 of the PHP license,      |
+   | that is bundled with this package in the file LICENSE, and is        |
+   | available through the world-wide-web at the following url:           |
+   | http://www.php.net/license/3_01.txt                                  |
+   | If you did not receive a copy of the PHP license and are unable to   |
+   | obtain it through the world-wide-web, please send a note to          |
+   | license@php.net so we can mail you a copy immediately.               |
+   +----------------------------------------------------------------------+
+*/
+
+#ifndef incl_HPHP_TEST_APC_BENCH_H_
+#define incl_HPHP_TEST_APC_BENCH_H_
+
+#include "hphp/test/ext/test_base.h"
+
+///////////////////////////////////////////////////////////////////////////////
+
+/**
+ * APC fetch microbenchmark. Not part of any set; run it on its own with
+ *
+ *   test TestApcBench
+ *
+ * on an otherwise idle machine. It reports fetch throughput of a hot
+ * array and a hot long string at 1, 2, 4, ... threads up to the CPU
+ * count, with and without Apc.BorrowOnFetch.  It also checks that
+ * arrays stored under Apc.FlatArrayThreshold read back unchanged, and
+ * that a snapshot of the store loads back into a fresh one.
+ */
+class TestApcBench : public TestBase {
+ public:
+  TestApcBench();
+
+  virtual bool RunTests(const std::string &which);
+
+  bool TestBorrowedSurvivesOverwrite();
+  bool TestStoreBorrowedAfterRelease();
+  bool TestFlatArray();
+  bool TestFlatArrayCorrupt();
+  bool TestSnapshotRoundTrip();
+  bool TestSnapshotEntryExpires();
+  bool BenchFetchScaling();
+};
+
+///////////////////////////////////////////////////////////////////////////////
+
+#endif // incl_HPHP_TEST_APC_BENCH_H_
@@ -30,7 +30,11 @@
 #include "hphp/runtime/base/runtime-option.h"
 #include "hphp/runtime/server/libevent-server.h"
 
+#include "folly/ScopeGuard.h"
+
 #include <memory>
+#include <netinet/in.h>
+#include <sys/socket.h>
 
 using namespace HPHP;
 
@@ -144,12 +148,15 @@ void TestServer::RunServer() {
     lexical_cast<string>(s_rpc_port);
   string fd = lexical_cast<string>(inherit_fd);
 
-  const char *argv[] = {
+  std::vector<const char*> argv = {
     "", "--mode=server", "--config=test/ext/config-server.hdf",
     portConfig.c_str(), adminConfig.c_str(), rpcConfig.c_str(),
     "--port-fd", fd.c_str(),
-    NULL
   };
+  for (auto& opt : m_serverOptions) {
+    argv.push_back(opt.c_str());
+  }
+  argv.push_back(nullptr);
 
   if (Option::EnableEval < Option::FullEval) {
     argv[0] = "runtime/tmp/TestServer/test";
@@ -157,7 +164,7 @@ void TestServer::RunServer() {
     argv[0] = HHVM_PATH;
   }
 
-  Process::Exec(argv[0], argv, NULL, out, &err);
+  Process::Exec(argv[0], argv.data(), NULL, out, &err);
 }
 
 void TestServer::StopServer() {
@@ -227,9 +234,11 @@ bool TestServer::RunTests(const std::string &which) {
   RUN_TEST(TestSetCookie);
   //RUN_TEST(TestRequestHandling);
   RUN_TEST(TestHttpClient);
+  RUN_TEST(TestLibeventServerEventLoops);
   RUN_TEST(TestRPCServer);
   RUN_TEST(TestXboxServer);
   RUN_TEST(TestPageletServer);
+  RUN_TEST(TestAccessLog);
 
   return ret;
 }
@@ -648,6 +657,99 @@ bool TestServer::TestHttpClient() {
   return Count(true);
 }
 
+class SlowHandler : public RequestHandler {
+public:
+  explicit SlowHandler(int timeout) : RequestHandler(timeout) {}
+  // implementing RequestHandler
+  virtual void handleRequest(Transport *transport) {
+    usleep(500 * 1000);
+    transport->sendString("done");
+  }
+};
+
+/*
+ * A bare HTTP/1.0 GET over a new connection, so each one is accepted
+ * separately and SO_REUSEPORT can hand it to any of the event loops.
+ */
+class RawGet {
+public:
+  explicit RawGet(int port) : m_port(port) {}
+
+  void run() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(m_port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    static const char req[] = "GET /slow HTTP/1.0\r\n\r\n";
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+        write(fd, req, sizeof(req) - 1) == sizeof(req) - 1) {
+      char buf[4096];
+      ssize_t n;
+      while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        m_response.append(buf, n);
+      }
+    }
+    close(fd);
+  }
+
+  int m_port;
+  string m_response;
+};
+
+bool TestServer::TestLibeventServerEventLoops() {
+  static const int kLoops = 4;
+  static const int kClients = 16;
+
+  ServerPtr server;
+  int port;
+  for (port = PORT_MIN; port <= PORT_MAX; port++) {
+    try {
+      server = std::make_shared<LibEventServer>(
+          "127.0.0.1", port, kClients, kLoops);
+      server->setRequestHandlerFactory<SlowHandler>(0);
+      server->start();
+      break;
+    } catch (const FailedToListenException& e) {
+      if (port == PORT_MAX) throw;
+    }
+  }
+  VS(static_cast<LibEventServer*>(server.get())->getEventLoopCount(),
+     kLoops);
+
+  int oldWait = RuntimeOption::ServerGracefulShutdownWait;
+  RuntimeOption::ServerGracefulShutdownWait = 2;
+
+  std::vector<std::unique_ptr<RawGet>> gets;
+  std::vector<std::unique_ptr<AsyncFunc<RawGet>>> funcs;
+  for (int i = 0; i < kClients; i++) {
+    gets.emplace_back(new RawGet(port));
+    funcs.emplace_back(new AsyncFunc<RawGet>(gets.back().get(),
+                                             &RawGet::run));
+    funcs.back()->start();
+  }
+
+  // Stop while every request is still in its handler; the response each
+  // loop is holding must still make it out.
+  usleep(200 * 1000);
+  server->stop();
+  server->waitForEnd();
+  for (auto& func : funcs) {
+    func->waitForEnd();
+  }
+  RuntimeOption::ServerGracefulShutdownWait = oldWait;
+
+  for (auto& get : gets) {
+    VERIFY(get->m_response.find("200") != string::npos);
+    VERIFY(get->m_response.size() >= 4 &&
+           get->m_response.compare(get->m_response.size() - 4, 4,
+                                   "done") == 0);
+  }
+  return Count(true);
+}
+
 bool TestServer::TestRPCServer() {
   // the simplest case
   VSGETP("<?php\n"
@@ -797,3 +899,47 @@ bool TestServer::TestPageletServer() {
 
   return true;
 }
+
+bool TestServer::TestAccessLog() {
+  static const int kRequests = 16;
+  string logFile = "runtime/tmp/access_log_test.log";
+  unlink(logFile.c_str());
+
+  m_serverOptions = {
+    "-vLog.AccessLogQueueSize=1024",
+    "-vLog.Access.test.File=" + logFile,
+    "-vLog.Access.test.Format=%r",
+  };
+  SCOPE_EXIT { m_serverOptions.clear(); };
+
+  std::vector<string> urlStrs;
+  std::vector<const char*> urls, outputs;
+  for (int i = 0; i < kRequests; i++) {
+    urlStrs.push_back("string?n=" + lexical_cast<string>(i));
+  }
+  for (auto& url : urlStrs) {
+    urls.push_back(url.c_str());
+    outputs.push_back("ok");
+  }
+  // VerifyServerResponse only returns once the server process has exited,
+  // so every queued line must have been written by then.
+  if (!Count(VerifyServerResponse("<?php echo 'ok';", outputs.data(),
+                                  urls.data(), kRequests, "GET", nullptr,
+                                  nullptr, false, __FILE__, __LINE__))) {
+    return false;
+  }
+
+  std::ifstream f(logFile.c_str());
+  VERIFY(f.good());
+  std::vector<string> lines;
+  string line;
+  while (std::getline(f, line)) {
+    lines.push_back(line);
+  }
+  VS((int)lines.size(), kRequests);
+  for (int i = 0; i < kRequests; i++) {
+    VS(lines[i].substr(0, lines[i].rfind(' ')),
+       "GET /" + urlStrs[i]);
+  }
+  return Count(true);
+}
@@ -56,6 +56,9 @@ public:
   // test HttpClient class that proxy server uses
   bool TestHttpClient();
 
+  // test LibEventServer with several SO_REUSEPORT event loops
+  bool TestLibeventServerEventLoops();
+
   // test RPCServer
   bool TestRPCServer();
 
@@ -65,6 +68,9 @@ public:
   // test PageletServer
   bool TestPageletServer();
 
+  // test the async access log writer
+  bool TestAccessLog();
+
 protected:
   void RunServer();
   void StopServer();
@@ -87,6 +93,9 @@ protected:
                             int port = 0);
   bool PreBindSocket();
   void CleanupPreBoundSocket();
+
+  // extra -v options for the next RunServer()
+  std::vector<std::string> m_serverOptions;
 };
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,36 @@
+<?php
+
+// Packed arrays, including ones holding references, into Vectors.
+$x = 1;
+$a = array('a', 2, &$x, array(3));
+$v = new Vector($a);
+$x = 5;
+var_dump($v->toArray());
+var_dump(Vector::fromArray($a)->toArray() === array('a', 2, 5, array(3)));
+
+// Arrays with gaps or string keys still go through the slow path.
+var_dump((new Vector(array(3 => 'x', 'k' => 'y')))->toArray());
+
+// The array is a copy; changing either side leaves the other alone.
+$arr = $v->toArray();
+$arr[] = 'new';
+$v[0] = 'changed';
+var_dump(count($v), $arr[0], $v->toArray()[0]);
+
+// Empty cases.
+var_dump((new Vector(array()))->toArray(), Vector::fromArray(array())->count());
+
+// Appends in a loop, then gets and sets by index.
+function fill($n) {
+  $v = Vector {};
+  for ($i = 0; $i < $n; $i++) {
+    $v[] = $i * 2;
+  }
+  for ($i = 0; $i < $n; $i++) {
+    $v[$i] = $v[$i] + 1;
+  }
+  return $v;
+}
+$v = fill(100);
+var_dump(count($v), $v[0], $v[99]);
+var_dump(array_sum($v->toArray()));
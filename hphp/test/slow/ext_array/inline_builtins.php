@@ -0,0 +1,37 @@
+<?php
+// Builtins the JIT can inline in FCallBuiltin; every call sits in a
+// function so it gets translated with a known argument type.
+
+function count_arr($a) { return count($a); }
+function count_null($n) { return count($n); }
+function count_int($i) { return count($i); }
+function count_str($s) { return sizeof($s); }
+function count_rec($a) { return count($a, COUNT_RECURSIVE); }
+function ord_str($s) { return ord($s); }
+function chr_int($i) { return chr($i); }
+function small_in($x) { return in_array($x, array(2, 4, 8), true); }
+function loose_in($x) { return in_array($x, array(2, 4, 8)); }
+
+for ($i = 0; $i < 2; $i++) {
+  var_dump(count_arr(array()));
+  var_dump(count_arr(array(1, 2, 3)));
+  var_dump(count_arr(array('a' => 1, 'b' => 2)));
+  var_dump(count_arr(array(1, array(2, 3))));
+  var_dump(count_null(null));
+  var_dump(count_int(42));
+  var_dump(count_str(''));
+  var_dump(count_rec(array(1, array(2, 3))));
+
+  var_dump(ord_str('A'));
+  var_dump(ord_str('abc'));
+  var_dump(ord_str(''));
+  var_dump(ord_str("\xff"));
+
+  var_dump(chr_int(65));
+  var_dump(chr_int(321));
+  var_dump(chr_int(-1) === "\xff");
+
+  var_dump(small_in(4));
+  var_dump(small_in(5));
+  var_dump(loose_in('8'));
+}
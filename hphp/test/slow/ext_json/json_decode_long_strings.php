@@ -0,0 +1,33 @@
+<?php
+// Long runs of plain characters and whitespace, broken up by everything
+// that has to go through the parser's state machine.
+$long = str_repeat('abcdefghijklmnop', 8);
+
+var_dump(json_decode('"' . $long . '"') === $long);
+var_dump(json_decode('"' . $long . '\n' . $long . '\u00e9' . $long . '"') ===
+         $long . "\n" . $long . "\xc3\xa9" . $long);
+var_dump(json_decode('"' . $long . "caf\xc3\xa9" . $long . '"') ===
+         $long . "caf\xc3\xa9" . $long);
+var_dump(json_decode('"\ud83d\ude00' . $long . '"') ===
+         "\xf0\x9f\x98\x80" . $long);
+var_dump(json_decode('["' . $long . '\"\\\\\/", "' . $long . '"]', true) ===
+         array($long . '"\\/', $long));
+var_dump(json_decode("{\n    \"a\" : [ 1 ,\t2 ],\r\n  \"b\":  \"x y\"  }  \n",
+                     true) === array('a' => array(1, 2), 'b' => 'x y'));
+var_dump(json_decode("{'a':'it\"s " . $long . "', \"b\":\"don't\"}",
+                     true, JSON_FB_LOOSE) ===
+         array('a' => "it\"s " . $long, 'b' => "don't"));
+
+// The trailing spaces keep json_decode() from falling back to returning
+// the quoted text when parsing fails.
+$bad = array(
+  '"' . $long . "\x01" . '" ',
+  '"' . $long . "\t" . '" ',
+  '"' . $long . "\xff" . '" ',
+  '"' . $long,
+  '["' . $long . '" "' . $long . '"]',
+);
+foreach ($bad as $json) {
+  var_dump(json_decode($json));
+  echo json_last_error_msg(), "\n";
+}
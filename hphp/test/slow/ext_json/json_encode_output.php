@@ -0,0 +1,30 @@
+<?php
+
+// Packed arrays of ints, bools and nulls.
+var_dump(json_encode(array(1, -2, 0, true, false, null,
+                           PHP_INT_MAX, ~PHP_INT_MAX)));
+var_dump(json_encode(array(1, 2), JSON_FORCE_OBJECT));
+var_dump(json_encode(array(1, array(2, 3), 4)));
+
+// Escapes around and between long runs of plain characters.
+$plain = str_repeat("abcdefghij", 4);
+var_dump(json_encode($plain."/<>&'@%\"\\\n".$plain));
+var_dump(json_encode($plain."<>&'@%",
+                     JSON_HEX_TAG | JSON_HEX_AMP | JSON_HEX_APOS |
+                     JSON_FB_EXTRA_ESCAPES | JSON_UNESCAPED_SLASHES));
+var_dump(json_encode($plain."\xC3\xA9".$plain."\xF0\x9F\x98\x80"));
+var_dump(json_encode($plain."\xE0".$plain));
+
+// Streamed output is the same as json_encode's.
+$big = array();
+for ($i = 0; $i < 20000; $i++) {
+  $big[] = array('id' => $i, 'name' => "item $i", 'tags' => array($i, true));
+}
+ob_start();
+json_encode_output($big);
+$out = ob_get_clean();
+var_dump($out === json_encode($big));
+var_dump(strlen($out) > 65536);
+
+json_encode_output(array("a" => 1, "b" => array(true, null)));
+echo "\n";
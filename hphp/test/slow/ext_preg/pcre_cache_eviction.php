@@ -0,0 +1,18 @@
+<?php
+// Many more distinct patterns than the lru cache holds, each matched
+// several times so that some get recompiled with the JIT, some are evicted
+// and then compiled again.
+$ok = true;
+for ($round = 0; $round < 3; $round++) {
+  for ($i = 0; $i < 200; $i++) {
+    $re = "/^p{$i}_(\\d+)$/";
+    if (!preg_match($re, "p{$i}_$round", $m) || $m[1] != $round) {
+      $ok = false;
+    }
+    if (preg_match($re, "p" . ($i + 1) . "_$round")) {
+      $ok = false;
+    }
+  }
+}
+var_dump($ok);
+var_dump(preg_replace('/(\w+) (\w+)/', '$2 $1', 'hello world'));
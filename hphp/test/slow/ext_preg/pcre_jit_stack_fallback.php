@@ -0,0 +1,9 @@
+<?php
+// Each iteration of the group needs JIT stack, so a long subject runs past
+// the tiny JIT stack and has to be matched again without the JIT.
+$s = str_repeat('ab', 500);
+var_dump(preg_match('/^(a|b)*$/', $s, $m));
+var_dump($m[1]);
+var_dump(preg_last_error() === PREG_NO_ERROR);
+var_dump(preg_replace('/^(?:(a)|b)*$/', 'x', $s));
+var_dump(count(preg_split('/(?<=b)(?=a)/', $s)));
@@ -0,0 +1,34 @@
+<?php
+
+// The compiler proves one() always returns an int, so the JIT may skip
+// the type check on its result; an intercept mustn't let that through.
+
+function one() {
+  return 1;
+}
+
+function two() {
+  return 2;
+}
+
+function handler($name, $obj, $params, $data, $done) {
+  return $data;
+}
+
+function main() {
+  return one();
+}
+
+for ($i = 0; $i < 20; $i++) {
+  $r = main();
+}
+var_dump($r);
+
+fb_intercept('one', 'handler', 'intercepted');
+for ($i = 0; $i < 20; $i++) {
+  $r = main();
+}
+var_dump($r);
+
+fb_intercept('two', 'handler', 2.5);
+var_dump(two());
@@ -0,0 +1,47 @@
+<?php
+
+// Hot loops compiled as loop regions.  The back-edges of widen() and
+// flip() carry types their loop header doesn't accept, so they must
+// still go through its guards.
+
+function widen($n) {
+  $x = 0;
+  for ($i = 0; $i < $n; $i++) {
+    $x += ($i == 50) ? 0.5 : 1;
+  }
+  return $x;
+}
+
+function sum($n) {
+  $s = 0;
+  for ($i = 0; $i < $n; $i++) {
+    $s += $i;
+  }
+  return $s;
+}
+
+function flip($n) {
+  $out = '';
+  for ($i = 0; $i < $n; $i++) {
+    $v = ($i % 10 == 9) ? (string)$i : $i;
+    $out .= substr(gettype($v), 0, 1);
+  }
+  return $out;
+}
+
+function collatz($n) {
+  $steps = 0;
+  do {
+    $n = ($n % 2) ? 3 * $n + 1 : $n / 2;
+    $steps++;
+  } while ($n != 1);
+  return $steps;
+}
+
+for ($k = 0; $k < 200; $k++) {
+  $a = widen(1000);
+  $b = sum(1000);
+  $c = flip(30);
+  $d = collatz(27);
+}
+var_dump($a, $b, $c, $d);
@@ -0,0 +1,58 @@
+<?php
+
+class D {
+  public $n;
+  function __construct($n) { $this->n = $n; }
+  function __destruct() { echo "~D{$this->n}\n"; }
+}
+
+function pair($a, $b) { return array($a, $b); }
+
+function sum_pairs($n) {
+  $total = 0;
+  for ($i = 0; $i < $n; $i++) {
+    list($q, $r) = pair((int)($i / 7), $i % 7);
+    $total += $q * 7 + $r;
+  }
+  return $total;
+}
+
+function swap_strings($n) {
+  $a = 'left';
+  $b = 'right';
+  for ($i = 0; $i < $n; $i++) {
+    list($a, $b) = array($b, $a);
+  }
+  return "$a $b";
+}
+
+function cow() {
+  $inner = array(1, 2, 3);
+  list($x, $y) = array($inner, 5);
+  $x[] = 4;
+  return array(count($inner), count($x), $y);
+}
+
+function dtor_order() {
+  list($a, $b) = array(new D(1), new D(2));
+  echo "assigned\n";
+  $a = null;
+  echo "a cleared\n";
+  $b = null;
+  echo "b cleared\n";
+}
+
+function dropped() {
+  list(, $b) = array(new D(3), new D(4));
+  echo "kept {$b->n}\n";
+}
+
+for ($j = 0; $j < 20; $j++) {
+  $s = sum_pairs(100);
+  $w = swap_strings(11);
+}
+var_dump($s, $w);
+var_dump(cow());
+dtor_order();
+dropped();
+echo "done\n";
@@ -0,0 +1,16 @@
+<?php
+
+// Every string below frees the previous one.  In arena mode those blocks
+// are never reused, so they have to keep counting against the limit.
+ini_set('memory_limit', '16M');
+
+$before = memory_get_usage();
+for ($i = 0; $i < 1000; $i++) {
+  $s = str_repeat('x', 100) . $i;
+}
+var_dump(memory_get_usage() > $before);
+
+for ($i = 0; $i < 1000000; $i++) {
+  $s = str_repeat('x', 100) . $i;
+}
+echo "not reached\n";
@@ -0,0 +1,36 @@
+<?php
+
+// One call site seeing more receiver classes than the inline cache holds,
+// including inherited, overridden, static and __call methods.
+
+class A { function f() { return 'A'; } }
+class B extends A { }
+class C extends A { function f() { return 'C'; } }
+class D { static function f() { return 'D'; } }
+class E { function __call($name, $args) { return "E::$name"; } }
+class F { private $n; function __construct($n) { $this->n = $n; }
+          function f() { return "F{$this->n}"; } }
+class G extends C { }
+class H { function f() { return 'H'; } }
+class I { function f() { return 'I'; } }
+
+function call_f($o) {
+  return $o->f();
+}
+
+$objs = array(new A, new B, new C, new D, new E, new F(1), new G, new H,
+              new I, new F(2));
+for ($round = 0; $round < 3; $round++) {
+  $out = array();
+  foreach ($objs as $o) {
+    $out[] = call_f($o);
+  }
+  echo implode(' ', $out), "\n";
+}
+
+// Mostly one class, with an occasional other one.
+$sum = '';
+for ($i = 0; $i < 20; $i++) {
+  $sum .= call_f($i % 7 ? new A : new E);
+}
+echo $sum, "\n";
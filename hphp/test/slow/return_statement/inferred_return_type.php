@@ -0,0 +1,57 @@
+<?hh
+
+// Each function returns one type on every path (or doesn't), and the
+// callers use the result right away, so a wrong return type recorded
+// for any of them shows up as a wrong answer.
+
+function always_int($a) {
+  if ($a) return 1;
+  return 2;
+}
+function int_or_null($a) {
+  if ($a) return 1;
+}
+function int_or_string($a) {
+  if ($a) return 1;
+  return "2";
+}
+function always_string($a) {
+  if ($a) return "x";
+  return "yy";
+}
+function always_double($a) {
+  return $a ? 1.5 : 2.5;
+}
+function always_null($a) {
+  if ($a) return;
+}
+// Return type annotations aren't enforced, so this one proves nothing.
+function annotated_int($a): int {
+  return $a;
+}
+
+class C {
+  function get($a) { return $a ? array(1) : array(1, 2); }
+}
+
+function main() {
+  $sum = 0;
+  $s = '';
+  $c = new C;
+  for ($i = 0; $i < 4; $i++) {
+    $sum += always_int($i % 2);
+    $sum += int_or_null($i % 2);
+    $sum += int_or_string($i % 2);
+    $s .= always_string($i % 2);
+    $sum += always_double($i % 2);
+    $sum += count($c->get($i % 2));
+    var_dump(always_null($i % 2));
+  }
+  var_dump($sum, $s);
+  var_dump(int_or_null(0), int_or_string(0));
+  for ($i = 0; $i < 4; $i++) {
+    $t = annotated_int($i % 2 ? "odd" : null);
+  }
+  var_dump($t, annotated_int("str"), annotated_int(null));
+}
+main();
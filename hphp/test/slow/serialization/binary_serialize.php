@@ -0,0 +1,81 @@
+<?php
+
+function rt($v) {
+  return fb_binary_unserialize(fb_binary_serialize($v));
+}
+
+// Scalars, including the edges of the varint and double encodings.
+var_dump(rt(null), rt(true), rt(false));
+var_dump(rt(0), rt(-1), rt(127), rt(128), rt(PHP_INT_MAX), rt(-PHP_INT_MAX - 1));
+var_dump(rt(1.5), rt(-0.0), rt(INF), rt(-INF), is_nan(rt(NAN)));
+var_dump(rt(""), rt("a\0b"), rt(str_repeat('x', 300)) === str_repeat('x', 300));
+
+// Nested arrays with mixed keys.
+$a = array(1, 'k' => array('x' => 1.25, 2 => null), -5 => "s", 'e' => array());
+var_dump(rt($a) === $a);
+
+// References within the value survive.
+$x = 1;
+$r = array(&$x, &$x);
+$r2 = rt($r);
+$r2[0] = 42;
+var_dump($r2[1]);
+
+// A repeated object stays one object.
+class P {
+  public $pub = 1;
+  protected $pro = 2;
+  private $pri = 3;
+  function get() { return array($this->pub, $this->pro, $this->pri); }
+}
+$p = new P;
+$objs = rt(array($p, $p));
+$objs[0]->pub = 7;
+var_dump(get_class($objs[1]), $objs[1]->get());
+
+// __sleep and __wakeup.
+class S {
+  public $keep = 'k';
+  public $drop = 'd';
+  public $woke = false;
+  function __sleep() { return array('keep'); }
+  function __wakeup() { $this->woke = true; }
+}
+$s = rt(new S);
+var_dump($s->keep, $s->drop, $s->woke);
+
+// Serializable.
+class Ser implements Serializable {
+  public $data;
+  function __construct($d = null) { $this->data = $d; }
+  function serialize() { return strrev($this->data); }
+  function unserialize($s) { $this->data = strrev($s); }
+}
+var_dump(rt(new Ser('abc'))->data);
+
+// Collections.
+function show_collection($c) {
+  $elems = array();
+  if ($c instanceof Set) {
+    foreach ($c as $v) $elems[] = $v;
+  } else {
+    foreach ($c as $k => $v) $elems[] = "$k=$v";
+  }
+  echo get_class($c), ': ', implode(', ', $elems), "\n";
+}
+show_collection(rt(Vector {1, 2, 3}));
+show_collection(rt(Map {'a' => 1, 2 => 'b'}));
+show_collection(rt(Set {'x', 4}));
+show_collection(rt(Pair {'p', 9}));
+
+// Binary data is smaller than serialize()'s for typical data.
+$rows = array();
+for ($i = 0; $i < 100; $i++) {
+  $rows[] = array('id' => $i * 1000, 'score' => $i / 3, 'ok' => true);
+}
+var_dump(strlen(fb_binary_serialize($rows)) < strlen(serialize($rows)));
+
+// Truncated or foreign data fails like unserialize().
+$s = fb_binary_serialize($a);
+var_dump(@fb_binary_unserialize(substr($s, 0, strlen($s) - 3)));
+var_dump(@fb_binary_unserialize(serialize($a)));
@@ -0,0 +1,28 @@
+<?php
+
+// Integers on both sides of the 18-digit inline parse, and forms that
+// only strtoll() accepts.
+var_dump(unserialize('i:123456789012345678;'));
+var_dump(unserialize('i:-123456789012345678;'));
+var_dump(unserialize('i:9223372036854775807;'));
+var_dump(unserialize('i:-9223372036854775808;'));
+var_dump(unserialize('i:+5;'));
+var_dump(unserialize('a:2:{i:0;i:-0;i:1;i:007;}'));
+
+// Repeated keys share one string; changing one value must not leak.
+$rows = unserialize(serialize(array(
+  array('name' => 'a', 'id' => 1),
+  array('name' => 'b', 'id' => 2),
+)));
+$rows[0]['name'] .= 'x';
+var_dump($rows);
+var_dump(array_keys($rows[1]));
+
+// Objects of one class, with private and protected properties.
+class C {
+  public $a = 1;
+  protected $b = 2;
+  private $c = 3;
+}
+$objs = unserialize(serialize(array(new C, new C, new C)));
+var_dump(count($objs), get_class($objs[2]), $objs[2] == new C);
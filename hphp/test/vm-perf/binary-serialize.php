@@ -0,0 +1,47 @@
+<?php
+// serialize()/unserialize() against fb_binary_serialize() and
+// fb_binary_unserialize() over the same memcache-shaped payload.
+
+class Item {
+  public $id;
+  public $name;
+  protected $tags;
+  private $score;
+
+  function __construct($i) {
+    $this->id = $i;
+    $this->name = "item $i";
+    $this->tags = array('alpha', 'beta', 'gamma');
+    $this->score = $i / 4;
+  }
+}
+
+function make_payload($n) {
+  $rows = array();
+  for ($i = 0; $i < $n; $i++) {
+    $rows[] = array(
+      'id'      => $i,
+      'user_id' => 1000000 + $i * 7,
+      'title'   => str_repeat('lorem ipsum ', 4) . $i,
+      'flags'   => array($i % 2 == 0, $i % 3 == 0, null),
+      'ratio'   => $i / 7,
+      'item'    => new Item($i),
+    );
+  }
+  return $rows;
+}
+
+function bench($label, $ser, $unser, $payload, $iters) {
+  for ($i = 0; $i < $iters; $i++) {
+    $blob = $ser($payload);
+    $value = $unser($blob);
+  }
+  echo $label, ': ', $value == $payload ? 'ok' : 'mismatch', "\n";
+  return strlen($blob);
+}
+
+$payload = make_payload(5000);
+$text = bench('text', 'serialize', 'unserialize', $payload, 20);
+$binary = bench('binary', 'fb_binary_serialize', 'fb_binary_unserialize',
+                $payload, 20);
+echo 'binary smaller: ', $binary < $text ? 'yes' : 'no', "\n";
@@ -0,0 +1,37 @@
+<?php
+// count(), ord(), chr() and in_array() on a small literal haystack, all
+// of which the JIT can inline instead of calling the builtin.
+
+function counts($a, $rounds) {
+  $sum = 0;
+  for ($i = 0; $i < $rounds; $i++) {
+    $sum += count($a) + sizeof($a);
+  }
+  return $sum;
+}
+
+function chars($s, $rounds) {
+  $n = strlen($s);
+  $sum = 0;
+  for ($i = 0; $i < $rounds; $i++) {
+    $sum += ord(chr(ord($s[$i % $n]) + 1));
+  }
+  return $sum;
+}
+
+function members($rounds) {
+  $hits = 0;
+  for ($i = 0; $i < $rounds; $i++) {
+    if (in_array($i % 16, array(1, 3, 5, 7, 9, 11, 13, 15), true)) {
+      $hits++;
+    }
+  }
+  return $hits;
+}
+
+$a = array(1, 2, 3, 4, 5);
+echo 'count: ', counts($a, 5000000) == 50000000 ? 'ok' : 'mismatch', "\n";
+// 'abcd' bumped by one is 98 + 99 + 100 + 101 per four rounds.
+echo 'ord/chr: ', chars('abcd', 4000000) == 398000000 ? 'ok' : 'mismatch',
+  "\n";
+echo 'in_array: ', members(16000000) == 8000000 ? 'ok' : 'mismatch', "\n";
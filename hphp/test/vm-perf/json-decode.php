@@ -0,0 +1,38 @@
+<?php
+// json_decode() over API-response-shaped payloads: long string fields,
+// escapes, non-ASCII text, numbers, and the same document pretty-printed.
+
+function make_payload($n) {
+  $items = array();
+  for ($i = 0; $i < $n; $i++) {
+    $items[] = array(
+      'id'    => $i,
+      'name'  => "item $i",
+      'text'  => str_repeat('lorem ipsum dolor sit amet ', 20) .
+                 "\"quoted\"\n\tcaf\xc3\xa9 \xe2\x82\xac" . $i,
+      'tags'  => array('alpha', 'beta', 'gamma'),
+      'score' => $i / 4,
+      'ok'    => ($i % 2) == 0,
+    );
+  }
+  return array('count' => $n, 'items' => $items);
+}
+
+function bench($label, $json, $expect, $iters) {
+  for ($i = 0; $i < $iters; $i++) {
+    $decoded = json_decode($json, true);
+  }
+  $last = $decoded['items'][$decoded['count'] - 1];
+  echo $label, ': ', count($decoded['items']), ' items, ',
+    $last === $expect ? 'ok' : 'mismatch', "\n";
+}
+
+$payload = make_payload(2000);
+$compact = json_encode($payload);
+$pretty = str_replace(array('{', ',"', '[', ']'),
+                      array("{\n    ", ",\n    \"", "[\n      ", "\n    ]"),
+                      $compact);
+$expect = $payload['items'][1999];
+
+bench('compact', $compact, $expect, 50);
+bench('pretty', $pretty, $expect, 50);
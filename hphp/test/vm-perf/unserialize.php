@@ -0,0 +1,44 @@
+<?php
+// unserialize() over memcache-shaped blobs: long lists of records with
+// the same keys, nested lists, and lists of objects of one class.
+
+class Item {
+  public $id;
+  public $name;
+  protected $tags;
+  private $score;
+
+  function __construct($i) {
+    $this->id = $i;
+    $this->name = "item $i";
+    $this->tags = array('alpha', 'beta', 'gamma');
+    $this->score = $i / 4;
+  }
+}
+
+function make_payload($n) {
+  $rows = array();
+  $objs = array();
+  for ($i = 0; $i < $n; $i++) {
+    $rows[] = array(
+      'id'      => $i,
+      'user_id' => 1000000 + $i * 7,
+      'title'   => str_repeat('lorem ipsum ', 4) . $i,
+      'flags'   => array($i % 2 == 0, $i % 3 == 0, null),
+      'counts'  => array('likes' => $i * 3, 'shares' => $i, 'views' => -$i),
+    );
+    $objs[] = new Item($i);
+  }
+  return array('rows' => $rows, 'objs' => $objs);
+}
+
+function bench($label, $blob, $expect, $iters) {
+  for ($i = 0; $i < $iters; $i++) {
+    $value = unserialize($blob);
+  }
+  echo $label, ': ', $value == $expect ? 'ok' : 'mismatch', "\n";
+}
+
+$payload = make_payload(5000);
+bench('rows', serialize($payload['rows']), $payload['rows'], 40);
+bench('objects', serialize($payload['objs']), $payload['objs'], 40);
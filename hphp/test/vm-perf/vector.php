@@ -0,0 +1,36 @@
+<?php
+// Vector appends, int-key gets and sets, and conversions to and from
+// packed arrays.
+
+function build($n) {
+  $v = Vector {};
+  for ($i = 0; $i < $n; $i++) {
+    $v[] = $i;
+  }
+  return $v;
+}
+
+function bump($v, $rounds) {
+  $n = count($v);
+  for ($r = 0; $r < $rounds; $r++) {
+    for ($i = 0; $i < $n; $i++) {
+      $v[$i] = $v[$i] + 1;
+    }
+  }
+}
+
+function convert($v, $rounds) {
+  $sum = 0;
+  for ($r = 0; $r < $rounds; $r++) {
+    $a = $v->toArray();
+    $w = new Vector($a);
+    $sum += count($w);
+  }
+  return $sum;
+}
+
+$v = build(1000000);
+echo 'append: ', count($v) == 1000000 ? 'ok' : 'mismatch', "\n";
+bump($v, 20);
+echo 'get/set: ', $v[999999] == 1000019 ? 'ok' : 'mismatch', "\n";
+echo 'convert: ', convert($v, 50) == 50000000 ? 'ok' : 'mismatch', "\n";
@@ -0,0 +1,36 @@
+#!/bin/sh
+#
+# Times the loop-heavy vm-perf benchmarks with JitPGO loop regions
+# (Eval.JitPGOLoops) on and off, and checks their output.
+#
+# ./loop_benchmarks.sh [path/to/hhvm] [runs]
+#
+HPHP_HOME=$(git rev-parse --show-toplevel)
+: ${FBMAKE_BIN_ROOT=_bin}
+HHVM=${1:-$HPHP_HOME/$FBMAKE_BIN_ROOT/hphp/hhvm/hhvm}
+RUNS=${2:-3}
+PERF=$HPHP_HOME/hphp/test/vm-perf
+OPTS="-vEval.Jit=1 -vEval.JitPGO=1 -vEval.JitRegionSelector=hottrace"
+OUT=$(mktemp)
+trap 'rm -f $OUT' EXIT
+
+status=0
+for bench in nbody spectral-norm fannkuch; do
+  for loops in 1 0; do
+    best=
+    for i in $(seq $RUNS); do
+      start=$(date +%s%N)
+      $HHVM -c $PERF/config.hdf $OPTS -vEval.JitPGOLoops=$loops \
+        $PERF/$bench.php > $OUT 2>&1
+      ms=$(( ($(date +%s%N) - start) / 1000000 ))
+      if ! cmp -s $OUT $PERF/$bench.php.expect; then
+        echo "$bench (JitPGOLoops=$loops): wrong output"
+        status=1
+        break
+      fi
+      if [ -z "$best" ] || [ $ms -lt $best ]; then best=$ms; fi
+    done
+    [ -n "$best" ] && printf "%-16s JitPGOLoops=%d %8d ms\n" $bench $loops $best
+  done
+done
+exit $status
@@ -19,6 +19,7 @@
 
 #include <cstdint>
 #include <cstring>
+#include <stdexcept>
 #include <sys/mman.h>
 
 #include "hphp/util/assertions.h"
@@ -37,28 +38,46 @@ namespace sz {
 typedef uint8_t* Address;
 typedef uint8_t* CodeAddress;
 
+/*
+ * Thrown when an emit would run past the end of a DataBlock that was set
+ * up with setThrowWhenFull(). Callers that emit into a block of bounded
+ * size can catch it and start over elsewhere; every other block treats
+ * running out of room as fatal.
+ */
+struct DataBlockFull : std::runtime_error {
+  explicit DataBlockFull(size_t nBytes)
+    : std::runtime_error("DataBlock full"), bytes(nBytes) {}
+  size_t bytes;
+};
+
 /**
  * DataBlock is a simple bump-allocating wrapper around a chunk of memory.
  */
 struct DataBlock {
 
-  DataBlock() : m_base(nullptr), m_frontier(nullptr), m_size(0) {}
+  DataBlock()
+    : m_base(nullptr), m_frontier(nullptr), m_size(0)
+    , m_throwWhenFull(false) {}
 
   DataBlock(const DataBlock& other) = delete;
   DataBlock& operator=(const DataBlock& other) = delete;
 
   DataBlock(DataBlock&& other)
-    : m_base(other.m_base), m_frontier(other.m_frontier), m_size(other.m_size) {
+    : m_base(other.m_base), m_frontier(other.m_frontier), m_size(other.m_size)
+    , m_throwWhenFull(other.m_throwWhenFull) {
     other.m_base = other.m_frontier = nullptr;
     other.m_size = 0;
+    other.m_throwWhenFull = false;
   }
 
   DataBlock& operator=(DataBlock&& other) {
     m_base = other.m_base;
     m_frontier = other.m_frontier;
     m_size = other.m_size;
+    m_throwWhenFull = other.m_throwWhenFull;
     other.m_base = other.m_frontier = nullptr;
     other.m_size = 0;
+    other.m_throwWhenFull = false;
     return *this;
   }
 
@@ -70,6 +89,14 @@ struct DataBlock {
     m_size = sz;
   }
 
+  /*
+   * Makes emitting past the end throw DataBlockFull instead of failing an
+   * assertion.
+   */
+  void setThrowWhenFull(bool b) {
+    m_throwWhenFull = b;
+  }
+
   /*
    * alloc --
    *
@@ -109,33 +136,38 @@ struct DataBlock {
     return m_frontier + nBytes <= m_base + m_size;
   }
 
+  void assertCanEmit(size_t nBytes) {
+    if (m_throwWhenFull && !canEmit(nBytes)) throw DataBlockFull(nBytes);
+    always_assert(canEmit(nBytes));
+  }
+
   bool isValidAddress(const CodeAddress tca) const {
     return tca >= m_base && tca < (m_base + m_size);
   }
 
   void byte(const uint8_t byte) {
-    always_assert(canEmit(sz::byte));
+    assertCanEmit(sz::byte);
     *m_frontier = byte;
     m_frontier += sz::byte;
   }
   void word(const uint16_t word) {
-    always_assert(canEmit(sz::word));
+    assertCanEmit(sz::word);
     *(uint16_t*)m_frontier = word;
     m_frontier += sz::word;
   }
   void dword(const uint32_t dword) {
-    always_assert(canEmit(sz::dword));
+    assertCanEmit(sz::dword);
     *(uint32_t*)m_frontier = dword;
     m_frontier += sz::dword;
   }
   void qword(const uint64_t qword) {
-    always_assert(canEmit(sz::qword));
+    assertCanEmit(sz::qword);
     *(uint64_t*)m_frontier = qword;
     m_frontier += sz::qword;
   }
 
   void bytes(size_t n, const uint8_t *bs) {
-    always_assert(canEmit(n));
+    assertCanEmit(n);
     if (n <= 8) {
       // If it is a modest number of bytes, try executing in one machine
       // store. This allows control-flow edges, including nop, to be
@@ -204,6 +236,7 @@ struct DataBlock {
   Address m_base;
   Address m_frontier;
   size_t m_size;
+  bool m_throwWhenFull;
 };
 
 typedef DataBlock CodeBlock;